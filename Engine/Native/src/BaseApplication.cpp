@@ -2,11 +2,16 @@
 
 #include "BaseApplication.h"
 #include "Scene.h"
+#include "ComponentRegistry.h"
 #include "imgui_impl/ImGuiImpl.h"
 #include "mono_impl/Class.h"
 #include "mono_impl/MonoManager.h"
 
 #include "renderer/vk/VulkanRenderer.h"
+#include "renderer/vk/ShadowManager.h"
+#include "renderer/vk/LightManager.h"
+#include "renderer/vk/ModelCache.h"
+#include "renderer/vk/TextureCache.h"
 
 namespace plumbus
 {
@@ -26,6 +31,7 @@ namespace plumbus
 
     void BaseApplication::Run()
     {
+        JobSystem::Get()->Init(m_JobSystemConfig);
         m_Renderer->Init(m_AppName);
         mono::MonoManager::Get()->Init();
         PL_ASSERT(m_Scene != nullptr);
@@ -34,6 +40,13 @@ namespace plumbus
         MainLoop();
         Cleanup();
         m_Renderer->Cleanup();
+        JobSystem::Destroy();
+        ComponentRegistry::Destroy();
+        // lights and shadows unregister themselves when their components are destroyed.
+        vk::ShadowManager::Destroy();
+        vk::LightManager::Destroy();
+        vk::ModelCache::Destroy();
+        vk::TextureCache::Destroy();
     }
 
     void BaseApplication::InitScene()
@@ -73,6 +86,8 @@ namespace plumbus
 			m_DeltaTime = currTime - m_LastUpdateTime;
 			m_LastUpdateTime = currTime;
 
+            JobSystem::Get()->RunMainThreadJobs();
+            m_Renderer->BeginFrame();
             UpdateScene();
 #if ENABLE_IMGUI
         	m_Renderer->GetImGui()->OnGui();
@@ -2,6 +2,7 @@
 
 #include "plumbus.h"
 #include "mono_impl/mono_fwd.h"
+#include "JobSystem.h"
 
 namespace plumbus::vk
 {
@@ -33,6 +34,7 @@ namespace plumbus
 		virtual void OnGui();
 
 		void SetAppName(std::string name) { m_AppName = name; }
+		void SetJobSystemConfig(const JobSystemConfig& config) { m_JobSystemConfig = config; }
 
 		bool m_GameWindowFocused = false;
 
@@ -48,6 +50,7 @@ namespace plumbus
 
 		vk::VulkanRenderer* m_Renderer;
 		std::string m_AppName;
+		JobSystemConfig m_JobSystemConfig;
 	};
 
 	template <typename T>
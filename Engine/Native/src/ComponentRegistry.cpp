@@ -0,0 +1,73 @@
+#include "plumbus.h"
+#include "ComponentRegistry.h"
+
+namespace plumbus
+{
+	ComponentRegistry* ComponentRegistry::s_Instance = nullptr;
+
+	ComponentRegistry* ComponentRegistry::Get()
+	{
+		if (s_Instance == nullptr)
+			s_Instance = new ComponentRegistry();
+		return s_Instance;
+	}
+
+	void ComponentRegistry::Destroy()
+	{
+		if (s_Instance)
+		{
+			delete s_Instance;
+			s_Instance = nullptr;
+		}
+	}
+
+	EntityHandle ComponentRegistry::CreateEntity(GameObject* object)
+	{
+		EntityHandle entity;
+		if (!m_FreeIndices.empty())
+		{
+			entity.m_Index = m_FreeIndices.back();
+			m_FreeIndices.pop_back();
+		}
+		else
+		{
+			entity.m_Index = static_cast<uint32_t>(m_Objects.size());
+			m_Objects.push_back(nullptr);
+			m_Generations.push_back(0);
+		}
+
+		entity.m_Generation = m_Generations[entity.m_Index];
+		m_Objects[entity.m_Index] = object;
+		return entity;
+	}
+
+	void ComponentRegistry::DestroyEntity(EntityHandle entity)
+	{
+		if (!IsAlive(entity))
+		{
+			return;
+		}
+
+		for (std::unique_ptr<ComponentPoolBase>& pool : m_Pools)
+		{
+			if (pool)
+			{
+				delete pool->Remove(entity.m_Index);
+			}
+		}
+
+		m_Objects[entity.m_Index] = nullptr;
+		m_Generations[entity.m_Index]++;
+		m_FreeIndices.push_back(entity.m_Index);
+	}
+
+	bool ComponentRegistry::IsAlive(EntityHandle entity) const
+	{
+		return entity.m_Index < m_Generations.size() && m_Generations[entity.m_Index] == entity.m_Generation && m_Objects[entity.m_Index] != nullptr;
+	}
+
+	GameObject* ComponentRegistry::GetGameObject(EntityHandle entity) const
+	{
+		return IsAlive(entity) ? m_Objects[entity.m_Index] : nullptr;
+	}
+}
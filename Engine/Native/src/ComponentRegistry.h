@@ -0,0 +1,219 @@
+#pragma once
+
+#include "plumbus.h"
+#include "components/GameComponent.h"
+
+namespace plumbus
+{
+	class GameObject;
+
+	// index into the registry plus a generation, so a handle to a destroyed entity never resolves to whatever reuses its slot.
+	struct EntityHandle
+	{
+		static constexpr uint32_t s_InvalidIndex = UINT32_MAX;
+
+		uint32_t m_Index = s_InvalidIndex;
+		uint32_t m_Generation = 0;
+
+		bool IsValid() const { return m_Index != s_InvalidIndex; }
+		bool operator==(const EntityHandle& other) const { return m_Index == other.m_Index && m_Generation == other.m_Generation; }
+		bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+	};
+
+	class ComponentPoolBase
+	{
+	public:
+		virtual ~ComponentPoolBase() {}
+
+		virtual components::GameComponent* GetBase(uint32_t entity) const = 0;
+		virtual components::GameComponent* GetAt(uint32_t slot) const = 0;
+		virtual components::GameComponent* Remove(uint32_t entity) = 0;
+		virtual uint32_t Size() const = 0;
+	};
+
+	// sparse set. m_Sparse maps an entity index to a slot in the dense arrays, which only ever hold live components
+	// so systems can walk every component of a type without touching any entity that doesnt have one.
+	template <typename T>
+	class ComponentPool : public ComponentPoolBase
+	{
+	public:
+		void Add(uint32_t entity, T* component);
+		T* Get(uint32_t entity) const;
+		components::GameComponent* GetBase(uint32_t entity) const override { return Get(entity); }
+		components::GameComponent* GetAt(uint32_t slot) const override { return m_Components[slot]; }
+		components::GameComponent* Remove(uint32_t entity) override;
+		uint32_t Size() const override { return static_cast<uint32_t>(m_Components.size()); }
+
+		const std::vector<T*>& GetComponents() const { return m_Components; }
+		const std::vector<uint32_t>& GetEntities() const { return m_Entities; }
+
+	private:
+		std::vector<uint32_t> m_Sparse;
+		std::vector<uint32_t> m_Entities;
+		std::vector<T*> m_Components;
+	};
+
+	// owns the entity handles and one pool per component type. components are still owned by their GameObject,
+	// the registry only indexes them and deletes them when the entity is destroyed.
+	class ComponentRegistry
+	{
+	public:
+		static ComponentRegistry* Get();
+		static void Destroy();
+
+		EntityHandle CreateEntity(GameObject* object);
+		void DestroyEntity(EntityHandle entity);
+		bool IsAlive(EntityHandle entity) const;
+		GameObject* GetGameObject(EntityHandle entity) const;
+
+		template <typename T>
+		void AddComponent(EntityHandle entity, T* component);
+		template <typename T>
+		T* GetComponent(EntityHandle entity) const;
+		// dense list of every live component of type T.
+		template <typename T>
+		const std::vector<T*>& GetComponents();
+
+		// all of an entity's components, in ComponentType order.
+		template <typename F>
+		void ForEachComponent(EntityHandle entity, F function) const;
+		// every live component, one type at a time.
+		template <typename F>
+		void ForEachComponent(F function) const;
+
+	private:
+		template <typename T>
+		ComponentPool<T>& GetPool();
+
+		static ComponentRegistry* s_Instance;
+
+		std::array<std::unique_ptr<ComponentPoolBase>, components::GameComponent::Count> m_Pools;
+		std::vector<GameObject*> m_Objects;
+		std::vector<uint32_t> m_Generations;
+		std::vector<uint32_t> m_FreeIndices;
+	};
+
+	template <typename T>
+	void ComponentPool<T>::Add(uint32_t entity, T* component)
+	{
+		if (entity >= m_Sparse.size())
+		{
+			m_Sparse.resize(entity + 1, EntityHandle::s_InvalidIndex);
+		}
+
+		PL_ASSERT(m_Sparse[entity] == EntityHandle::s_InvalidIndex, "entity already has a component of this type");
+
+		m_Sparse[entity] = static_cast<uint32_t>(m_Components.size());
+		m_Entities.push_back(entity);
+		m_Components.push_back(component);
+	}
+
+	template <typename T>
+	T* ComponentPool<T>::Get(uint32_t entity) const
+	{
+		if (entity >= m_Sparse.size() || m_Sparse[entity] == EntityHandle::s_InvalidIndex)
+		{
+			return nullptr;
+		}
+
+		return m_Components[m_Sparse[entity]];
+	}
+
+	template <typename T>
+	components::GameComponent* ComponentPool<T>::Remove(uint32_t entity)
+	{
+		if (entity >= m_Sparse.size() || m_Sparse[entity] == EntityHandle::s_InvalidIndex)
+		{
+			return nullptr;
+		}
+
+		// swap the last component into the hole to keep the arrays packed.
+		uint32_t slot = m_Sparse[entity];
+		T* component = m_Components[slot];
+		uint32_t lastEntity = m_Entities.back();
+
+		m_Components[slot] = m_Components.back();
+		m_Entities[slot] = lastEntity;
+		m_Sparse[lastEntity] = slot;
+
+		m_Components.pop_back();
+		m_Entities.pop_back();
+		m_Sparse[entity] = EntityHandle::s_InvalidIndex;
+
+		return component;
+	}
+
+	template <typename T>
+	void ComponentRegistry::AddComponent(EntityHandle entity, T* component)
+	{
+		PL_ASSERT(IsAlive(entity));
+		GetPool<T>().Add(entity.m_Index, component);
+	}
+
+	template <typename T>
+	T* ComponentRegistry::GetComponent(EntityHandle entity) const
+	{
+		const std::unique_ptr<ComponentPoolBase>& pool = m_Pools[T::GetType()];
+		if (!pool || !IsAlive(entity))
+		{
+			return nullptr;
+		}
+
+		return static_cast<ComponentPool<T>*>(pool.get())->Get(entity.m_Index);
+	}
+
+	template <typename T>
+	const std::vector<T*>& ComponentRegistry::GetComponents()
+	{
+		return GetPool<T>().GetComponents();
+	}
+
+	template <typename F>
+	void ComponentRegistry::ForEachComponent(EntityHandle entity, F function) const
+	{
+		if (!IsAlive(entity))
+		{
+			return;
+		}
+
+		for (const std::unique_ptr<ComponentPoolBase>& pool : m_Pools)
+		{
+			if (pool)
+			{
+				if (components::GameComponent* component = pool->GetBase(entity.m_Index))
+				{
+					function(component);
+				}
+			}
+		}
+	}
+
+	template <typename F>
+	void ComponentRegistry::ForEachComponent(F function) const
+	{
+		for (const std::unique_ptr<ComponentPoolBase>& pool : m_Pools)
+		{
+			if (pool)
+			{
+				for (uint32_t i = 0; i < pool->Size(); ++i)
+				{
+					function(pool->GetAt(i));
+				}
+			}
+		}
+	}
+
+	template <typename T>
+	ComponentPool<T>& ComponentRegistry::GetPool()
+	{
+		PL_ASSERT(T::GetType() != components::GameComponent::Count, "component type needs its own GetType()");
+
+		std::unique_ptr<ComponentPoolBase>& pool = m_Pools[T::GetType()];
+		if (!pool)
+		{
+			pool = std::make_unique<ComponentPool<T>>();
+		}
+
+		return *static_cast<ComponentPool<T>*>(pool.get());
+	}
+}
@@ -15,38 +15,36 @@ namespace plumbus
 	GameObject::GameObject(std::string id)
 	{
 		m_ID = id;
+		m_Entity = ComponentRegistry::Get()->CreateEntity(this);
 	}
 
 	GameObject::~GameObject()
 	{
-		for (auto& [_, component] : m_Components)
-		{
-			delete component;
-		}
+		ComponentRegistry::Get()->DestroyEntity(m_Entity);
 	}
 
 	void GameObject::OnUpdate(Scene* scene)
 	{
-		for (auto& [_, component]: m_Components)
+		ComponentRegistry::Get()->ForEachComponent(m_Entity, [scene](components::GameComponent* component)
 		{
 			component->OnUpdate(scene);
-		}
+		});
 	}
 
 	void GameObject::Init()
 	{
-		for (auto& [_, component]: m_Components)
+		ComponentRegistry::Get()->ForEachComponent(m_Entity, [](components::GameComponent* component)
 		{
 			component->Init();
-		}
+		});
 	}
 
 	void GameObject::PostInit()
 	{
-		for (auto& [_, component]: m_Components)
+		ComponentRegistry::Get()->ForEachComponent(m_Entity, [](components::GameComponent* component)
 		{
 			component->PostInit();
-		}
+		});
 	}
 }
 
@@ -2,6 +2,7 @@
 #include "plumbus.h"
 #include "components/GameComponent.h"
 #include "components/ModelComponent.h"
+#include "ComponentRegistry.h"
 
 namespace plumbus::vk
 {
@@ -22,6 +23,7 @@ namespace plumbus
 		~GameObject();
 
 		std::string GetID() { return m_ID; }
+		EntityHandle GetEntity() { return m_Entity; }
 
 		template <typename T>
 		GameObject* AddComponent(T* component);
@@ -34,25 +36,21 @@ namespace plumbus
 		T* GetComponent();
 
 	private:
-		std::map<const components::GameComponent::ComponentType, components::GameComponent*> m_Components;
+		EntityHandle m_Entity;
 		std::string m_ID;
 	};
 
 	template <typename T>
 	T* GameObject::GetComponent()
 	{
-		auto it = m_Components.find(T::GetType());
-		if (it != m_Components.end())
-			return static_cast<T*>((*it).second);
-
-		return nullptr;
+		return ComponentRegistry::Get()->GetComponent<T>(m_Entity);
 	}
 
 	template <typename T>
 	GameObject* GameObject::AddComponent(T* component)
 	{
 		component->SetOwner(this);
-		m_Components[T::GetType()] = component;
+		ComponentRegistry::Get()->AddComponent<T>(m_Entity, component);
 		return this;
 	}
 }
@@ -1,5 +1,6 @@
 #include "plumbus.h"
 #include "Helpers.h"
+#include <filesystem>
 
 #if PL_PLATFORM_ANDROID
 #include "platform/android/Platform.h"
@@ -8,6 +9,17 @@
 #include "platform/Platform.h"
 #endif
 
+#if PL_PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif !PL_PLATFORM_ANDROID
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 std::string ErrorString(VkResult errorCode)
 {
 	switch (errorCode)
@@ -137,6 +149,171 @@ std::string Helpers::ReadTextFile(const std::string& filename)
 #endif
 }
 
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filename)
+{
+	Close();
+
+	std::string path = plumbus::Platform::GetAssetsPath() + filename;
+#if PL_PLATFORM_ANDROID
+	// uncompressed assets are mapped straight out of the apk.
+	AAssetManager* mgr = Android_application->activity->assetManager;
+	m_Asset = AAssetManager_open(mgr, path.c_str(), AASSET_MODE_BUFFER);
+	if (!m_Asset)
+	{
+		return false;
+	}
+
+	m_Data = static_cast<const char*>(AAsset_getBuffer(m_Asset));
+	m_Size = static_cast<size_t>(AAsset_getLength64(m_Asset));
+#elif PL_PLATFORM_WINDOWS
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	m_File = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	m_Size = static_cast<size_t>(fileSize.QuadPart);
+
+	m_Mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_Mapping)
+	{
+		m_Data = static_cast<const char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+	{
+		m_Size = static_cast<size_t>(fileStat.st_size);
+		void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED)
+		{
+			m_Data = static_cast<const char*>(data);
+		}
+	}
+
+	// the mapping keeps the file alive.
+	close(file);
+#endif
+
+	if (!m_Data)
+	{
+		plumbus::Log::Error("MappedFile::Open: failed to map file %s!", filename.c_str());
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#if PL_PLATFORM_ANDROID
+	if (m_Asset)
+	{
+		AAsset_close(m_Asset);
+		m_Asset = nullptr;
+	}
+#elif PL_PLATFORM_WINDOWS
+	if (m_Data)
+	{
+		UnmapViewOfFile(m_Data);
+	}
+	if (m_Mapping)
+	{
+		CloseHandle(m_Mapping);
+		m_Mapping = nullptr;
+	}
+	if (m_File)
+	{
+		CloseHandle(m_File);
+		m_File = nullptr;
+	}
+#else
+	if (m_Data)
+	{
+		munmap(const_cast<char*>(m_Data), m_Size);
+	}
+#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+bool Helpers::ReadCacheFile(const std::string& filename, std::vector<char>& outData)
+{
+	std::ifstream file(plumbus::Platform::GetCachePath() + filename, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	outData.resize(fileSize);
+
+	file.seekg(0);
+	file.read(outData.data(), fileSize);
+
+	return file.good();
+}
+
+bool Helpers::WriteCacheFile(const std::string& filename, const void* data, size_t size)
+{
+	std::filesystem::path path = plumbus::Platform::GetCachePath() + filename;
+
+	std::error_code error;
+	std::filesystem::create_directories(path.parent_path(), error);
+	if (error)
+	{
+		plumbus::Log::Warn("Helpers::WriteCacheFile: failed to create directory %s: %s", path.parent_path().string().c_str(), error.message().c_str());
+		return false;
+	}
+
+	// write to a temp file and rename so a crash mid write never leaves a truncated cache entry behind.
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			plumbus::Log::Warn("Helpers::WriteCacheFile: failed to open file %s!", tempPath.string().c_str());
+			return false;
+		}
+
+		file.write(static_cast<const char*>(data), size);
+		if (!file.good())
+		{
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, path, error);
+	if (error)
+	{
+		plumbus::Log::Warn("Helpers::WriteCacheFile: failed to write %s: %s", path.string().c_str(), error.message().c_str());
+		return false;
+	}
+
+	return true;
+}
+
 std::string Helpers::FormatStr(const char* fmt, ...)
 {
 	char buffer[256];
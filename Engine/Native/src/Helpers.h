@@ -20,5 +20,40 @@ public:
 	static std::vector<char> ReadBinaryFile(const std::string& filename);
 	static std::string ReadTextFile(const std::string& filename);
 
+	//relative to Platform::GetCachePath(), missing directories are created on write.
+	static bool ReadCacheFile(const std::string& filename, std::vector<char>& outData);
+	static bool WriteCacheFile(const std::string& filename, const void* data, size_t size);
+
 	static std::string FormatStr(const char* fmt, ...);
 };
+
+#if PL_PLATFORM_ANDROID
+struct AAsset;
+#endif
+
+// read only view of an asset mapped into memory, unmapped again when this goes out of scope.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// relative to Platform::GetAssetsPath(), same as Helpers::ReadBinaryFile.
+	bool Open(const std::string& filename);
+	void Close();
+
+	const char* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	const char* m_Data = nullptr;
+	size_t m_Size = 0;
+#if PL_PLATFORM_ANDROID
+	AAsset* m_Asset = nullptr;
+#elif PL_PLATFORM_WINDOWS
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#endif
+};
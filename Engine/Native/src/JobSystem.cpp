@@ -0,0 +1,352 @@
+#include "plumbus.h"
+#include "JobSystem.h"
+
+#if PL_PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif PL_PLATFORM_LINUX || PL_PLATFORM_ANDROID
+#include <sched.h>
+#endif
+
+namespace plumbus
+{
+	JobSystem* JobSystem::s_Instance = nullptr;
+
+	// -1 for any thread that isnt a worker (main thread included).
+	static thread_local int s_WorkerIndex = -1;
+
+	JobSystem* JobSystem::Get()
+	{
+		if (s_Instance == nullptr)
+			s_Instance = new JobSystem();
+		return s_Instance;
+	}
+
+	void JobSystem::Destroy()
+	{
+		if (s_Instance)
+		{
+			delete s_Instance;
+			s_Instance = nullptr;
+		}
+	}
+
+	JobSystem::JobSystem()
+		: m_MainThreadId(std::this_thread::get_id())
+	{
+	}
+
+	JobSystem::~JobSystem()
+	{
+		Shutdown();
+	}
+
+	void JobSystem::Init(const JobSystemConfig& config)
+	{
+		PL_ASSERT(!m_Running, "JobSystem already initialised");
+
+		m_MainThreadId = std::this_thread::get_id();
+
+		uint32_t workerCount = config.m_WorkerCount;
+		if (workerCount == 0)
+		{
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		// the workers start at core 1, keep the main thread on core 0 so none of them share with it. any workers past
+		// the last core are left for the os to place rather than doubling up on one that's already taken.
+		uint32_t pinnedWorkerCount = 0;
+		if (config.m_PinThreads)
+		{
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			pinnedWorkerCount = std::min(workerCount, hardwareThreads > 1 ? hardwareThreads - 1 : 0);
+			PinCurrentThread(0);
+		}
+
+		m_Running = true;
+		for (uint32_t i = 0; i < workerCount; ++i)
+		{
+			m_Queues.push_back(std::make_unique<JobQueue>());
+		}
+		for (uint32_t i = 0; i < workerCount; ++i)
+		{
+			m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i, i < pinnedWorkerCount);
+		}
+
+		Log::Info("JobSystem: started %u worker thread(s)%s", workerCount, config.m_PinThreads ? " (pinned)" : "");
+		if (config.m_PinThreads && pinnedWorkerCount < workerCount)
+		{
+			Log::Warn("JobSystem: only %u core(s) free for workers, %u worker thread(s) left unpinned", pinnedWorkerCount, workerCount - pinnedWorkerCount);
+		}
+	}
+
+	void JobSystem::Shutdown()
+	{
+		if (!m_Running)
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_SleepMutex);
+			m_Running = false;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+
+		Log::Info("JobSystem: executed %llu job(s), %llu stolen", (unsigned long long)GetJobsExecuted(), (unsigned long long)GetJobsStolen());
+
+		m_Workers.clear();
+		m_Queues.clear();
+	}
+
+	void JobSystem::Schedule(std::function<void()> function, JobCounter* counter, JobCounter* dependency, JobAffinity affinity)
+	{
+		Job job;
+		job.m_Function = std::move(function);
+		job.m_Counter = counter;
+		job.m_Affinity = affinity;
+
+		if (counter)
+		{
+			counter->m_Count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if (dependency)
+		{
+			std::lock_guard<std::mutex> lock(dependency->m_Mutex);
+			if (!dependency->IsDone())
+			{
+				// released by whichever job takes the dependency to zero.
+				dependency->m_Dependents.push_back(std::move(job));
+				return;
+			}
+		}
+
+		Submit(std::move(job));
+	}
+
+	void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t, uint32_t)> function, JobCounter* counter, JobCounter* dependency)
+	{
+		grainSize = std::max(grainSize, 1u);
+
+		// shared so every range job can reference the one copy.
+		auto sharedFunction = std::make_shared<std::function<void(uint32_t, uint32_t)>>(std::move(function));
+		for (uint32_t start = 0; start < count; start += grainSize)
+		{
+			uint32_t end = std::min(start + grainSize, count);
+			Schedule([sharedFunction, start, end]() { (*sharedFunction)(start, end); }, counter, dependency);
+		}
+	}
+
+	void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t, uint32_t)> function)
+	{
+		grainSize = std::max(grainSize, 1u);
+
+		// not worth the scheduling overhead for a single range.
+		if (count <= grainSize || m_Workers.empty())
+		{
+			if (count > 0)
+			{
+				for (uint32_t start = 0; start < count; start += grainSize)
+				{
+					function(start, std::min(start + grainSize, count));
+				}
+			}
+			return;
+		}
+
+		JobCounter counter;
+		ParallelFor(count, grainSize, std::move(function), &counter);
+		Wait(counter);
+	}
+
+	uint32_t JobSystem::GetThreadIndex() const
+	{
+		return static_cast<uint32_t>(s_WorkerIndex + 1);
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		while (!counter.IsDone())
+		{
+			if (!TryRunJob())
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		// the job that finished the counter may still hold its lock, make sure it has let go before the caller can destroy it.
+		std::lock_guard<std::mutex> lock(counter.m_Mutex);
+	}
+
+	void JobSystem::RunMainThreadJobs()
+	{
+		PL_ASSERT(IsMainThread());
+
+		Job job;
+		while (PopJob(m_MainThreadQueue, job, true))
+		{
+			Execute(job);
+		}
+	}
+
+	void JobSystem::Submit(Job&& job)
+	{
+		// with no workers everything falls back to the main thread.
+		if (job.m_Affinity == JobAffinity::MainThread || m_Queues.empty())
+		{
+			std::lock_guard<std::mutex> lock(m_MainThreadQueue.m_Mutex);
+			m_MainThreadQueue.m_Jobs.push_back(std::move(job));
+			return;
+		}
+
+		// workers keep what they spawn, anyone else hands work out round robin.
+		uint32_t queueIndex = s_WorkerIndex >= 0 ? s_WorkerIndex : m_NextQueue.fetch_add(1, std::memory_order_relaxed) % m_Queues.size();
+		{
+			std::lock_guard<std::mutex> lock(m_Queues[queueIndex]->m_Mutex);
+			m_Queues[queueIndex]->m_Jobs.push_back(std::move(job));
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_SleepMutex);
+			m_QueuedJobs.fetch_add(1, std::memory_order_release);
+		}
+		m_WakeCondition.notify_one();
+	}
+
+	bool JobSystem::PopJob(JobQueue& queue, Job& outJob, bool fromFront)
+	{
+		std::lock_guard<std::mutex> lock(queue.m_Mutex);
+		if (queue.m_Jobs.empty())
+		{
+			return false;
+		}
+
+		if (fromFront)
+		{
+			outJob = std::move(queue.m_Jobs.front());
+			queue.m_Jobs.pop_front();
+		}
+		else
+		{
+			outJob = std::move(queue.m_Jobs.back());
+			queue.m_Jobs.pop_back();
+		}
+
+		return true;
+	}
+
+	bool JobSystem::TryRunJob()
+	{
+		Job job;
+
+		if (IsMainThread() && PopJob(m_MainThreadQueue, job, true))
+		{
+			Execute(job);
+			return true;
+		}
+
+		uint32_t queueCount = static_cast<uint32_t>(m_Queues.size());
+		if (queueCount == 0)
+		{
+			return false;
+		}
+
+		// newest first from our own queue, it is the most likely to still be in cache.
+		if (s_WorkerIndex >= 0 && PopJob(*m_Queues[s_WorkerIndex], job, false))
+		{
+			m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			Execute(job);
+			return true;
+		}
+
+		// then steal the oldest work from everyone else.
+		uint32_t startIndex = s_WorkerIndex >= 0 ? s_WorkerIndex + 1 : 0;
+		for (uint32_t i = 0; i < queueCount; ++i)
+		{
+			uint32_t victim = (startIndex + i) % queueCount;
+			if ((int)victim == s_WorkerIndex)
+			{
+				continue;
+			}
+
+			if (PopJob(*m_Queues[victim], job, true))
+			{
+				m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				m_JobsStolen.fetch_add(1, std::memory_order_relaxed);
+				Execute(job);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void JobSystem::Execute(Job& job)
+	{
+		job.m_Function();
+		m_JobsExecuted.fetch_add(1, std::memory_order_relaxed);
+
+		if (JobCounter* counter = job.m_Counter)
+		{
+			// decrement under the lock so a waiter cant destroy the counter while we are still using it, see Wait.
+			std::vector<Job> dependents;
+			{
+				std::lock_guard<std::mutex> lock(counter->m_Mutex);
+				if (counter->m_Count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					dependents.swap(counter->m_Dependents);
+				}
+			}
+
+			for (Job& dependent : dependents)
+			{
+				Submit(std::move(dependent));
+			}
+		}
+	}
+
+	void JobSystem::WorkerLoop(uint32_t workerIndex, bool pinThread)
+	{
+		s_WorkerIndex = workerIndex;
+
+		if (pinThread)
+		{
+			// core 0 is left to the main thread, Init only pins as many workers as there are cores after it.
+			PinCurrentThread(workerIndex + 1);
+		}
+
+		while (m_Running)
+		{
+			if (!TryRunJob())
+			{
+				std::unique_lock<std::mutex> lock(m_SleepMutex);
+				m_WakeCondition.wait(lock, [this]() { return m_QueuedJobs.load(std::memory_order_acquire) > 0 || !m_Running; });
+			}
+		}
+	}
+
+	void JobSystem::PinCurrentThread(uint32_t core)
+	{
+#if PL_PLATFORM_WINDOWS
+		SetThreadAffinityMask(GetCurrentThread(), 1ull << core);
+#elif PL_PLATFORM_LINUX || PL_PLATFORM_ANDROID
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(core, &cpuSet);
+		if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0)
+		{
+			Log::Warn("JobSystem: failed to pin worker to core %u", core);
+		}
+#else
+		Log::Warn("JobSystem: thread pinning is not supported on this platform");
+#endif
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "plumbus.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace plumbus
+{
+	class JobCounter;
+
+	enum class JobAffinity
+	{
+		Any,
+		MainThread // only ever run by the main thread, from RunMainThreadJobs or while it waits on a counter.
+	};
+
+	struct Job
+	{
+		std::function<void()> m_Function;
+		JobCounter* m_Counter = nullptr;
+		JobAffinity m_Affinity = JobAffinity::Any;
+	};
+
+	// counts outstanding jobs. scheduling a job against a counter increments it, finishing the job decrements it.
+	// jobs can depend on a counter, they are held back until it reaches zero.
+	class JobCounter
+	{
+	public:
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool IsDone() const { return m_Count.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<uint32_t> m_Count = 0;
+		std::mutex m_Mutex;
+		std::vector<Job> m_Dependents;
+	};
+
+	struct JobSystemConfig
+	{
+		uint32_t m_WorkerCount = 0; // 0 = one worker per hardware thread, leaving one for the main thread.
+		bool m_PinThreads = false;  // lock each worker to its own core, and the main thread to core 0. workers past the core count stay unpinned.
+	};
+
+	// work stealing scheduler. every worker owns a deque, it pushes and pops its own work from the back and
+	// steals from the front of the others when it runs dry.
+	class JobSystem
+	{
+	public:
+		static JobSystem* Get();
+		static void Destroy();
+
+		JobSystem();
+		~JobSystem();
+
+		void Init(const JobSystemConfig& config);
+		void Shutdown();
+
+		void Schedule(std::function<void()> function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr, JobAffinity affinity = JobAffinity::Any);
+
+		// splits [0, count) into ranges of at most grainSize and runs them across the workers.
+		void ParallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t, uint32_t)> function, JobCounter* counter, JobCounter* dependency = nullptr);
+		// blocking version, the calling thread helps out until every range is done.
+		void ParallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t, uint32_t)> function);
+
+		// runs other jobs while waiting rather than blocking the thread.
+		void Wait(JobCounter& counter);
+		void RunMainThreadJobs();
+
+		uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+		bool IsMainThread() const { return std::this_thread::get_id() == m_MainThreadId; }
+		// 0 for the main thread (and anything else that isn't a worker), 1..GetWorkerCount() for the workers.
+		// stable for the life of the thread, so it can index per thread resources.
+		uint32_t GetThreadIndex() const;
+		uint64_t GetJobsExecuted() const { return m_JobsExecuted.load(std::memory_order_relaxed); }
+		uint64_t GetJobsStolen() const { return m_JobsStolen.load(std::memory_order_relaxed); }
+
+	private:
+		struct JobQueue
+		{
+			std::mutex m_Mutex;
+			std::deque<Job> m_Jobs;
+		};
+
+		void WorkerLoop(uint32_t workerIndex, bool pinThread);
+		void Submit(Job&& job);
+		bool TryRunJob();
+		bool PopJob(JobQueue& queue, Job& outJob, bool fromFront);
+		void Execute(Job& job);
+		void PinCurrentThread(uint32_t core);
+
+		static JobSystem* s_Instance;
+
+		std::vector<std::thread> m_Workers;
+		std::vector<std::unique_ptr<JobQueue>> m_Queues;
+		JobQueue m_MainThreadQueue;
+		std::thread::id m_MainThreadId;
+
+		std::atomic<bool> m_Running = false;
+		std::atomic<uint32_t> m_NextQueue = 0;
+		std::atomic<uint32_t> m_QueuedJobs = 0;
+		std::mutex m_SleepMutex;
+		std::condition_variable m_WakeCondition;
+
+		std::atomic<uint64_t> m_JobsExecuted = 0;
+		std::atomic<uint64_t> m_JobsStolen = 0;
+	};
+}
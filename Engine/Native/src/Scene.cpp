@@ -38,8 +38,13 @@ namespace plumbus
 	void Scene::OnUpdate()
 	{
 		m_Camera.OnUpdate();
-		for (GameObject* obj : m_GameObjects)
-			obj->OnUpdate(this);
+		ComponentRegistry::Get()->ForEachComponent([this](components::GameComponent* component)
+		{
+			component->OnUpdate(this);
+		});
+
+		// components have pushed their new bounds, bring the tree up to date before anything renders.
+		m_BVH.Update();
 	}
 
 	void Scene::ClearObjects()
@@ -54,12 +59,9 @@ namespace plumbus
 
 	void Scene::LoadAssets()
 	{
-		for (GameObject* obj : m_GameObjects)
+		for (components::ModelComponent* component : ComponentRegistry::Get()->GetComponents<components::ModelComponent>())
 		{
-			if (components::ModelComponent* component = obj->GetComponent<components::ModelComponent>())
-			{
-				component->LoadModel();
-			}
+			component->LoadModel();
 		}
 		for (GameObject* obj : m_GameObjects)
 		{
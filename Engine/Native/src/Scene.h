@@ -1,6 +1,7 @@
 #pragma once
 #include "plumbus.h"
 #include "Camera.h"
+#include "renderer/vk/BVH.h"
 
 namespace plumbus
 {
@@ -16,6 +17,7 @@ namespace plumbus
 		virtual bool IsInitialised();
 
 		Camera* GetCamera() { return &m_Camera; }
+		vk::BVH& GetBVH() { return m_BVH; }
 
 		void AddGameObject(GameObject* obj);
 		std::vector<GameObject*>& GetObjects() { return m_GameObjects; }
@@ -28,6 +30,7 @@ namespace plumbus
 
 	private:
 		Camera m_Camera;
+		vk::BVH m_BVH;
 		std::vector<GameObject*> m_GameObjects;
 
 		bool m_Initialised;
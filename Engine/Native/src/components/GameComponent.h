@@ -14,6 +14,7 @@ namespace plumbus::components
 			ModelComponent,
 			PointLightComponent,
 			TranslationComponent,
+			ScriptComponent,
 			Count
 		};
 
@@ -4,28 +4,50 @@
 #include "renderer/vk/ShadowDirectional.h"
 #include "renderer/vk/ShadowOmniDirectional.h"
 #include "renderer/vk/ShadowManager.h"
+#include "renderer/vk/LightManager.h"
+#include "renderer/vk/BVH.h"
+#include "components/TranslationComponent.h"
+#include "GameObject.h"
+#include "Scene.h"
 
 namespace plumbus
 {
-	void DirectionalLight::AddShadow() 
+	Light::~Light()
 	{
-		m_Shadow = std::static_pointer_cast<vk::Shadow>(vk::ShadowDirectional::CreateShadowDirectional(this));
-		vk::ShadowManager::Get()->RegisterShadow(static_cast<vk::ShadowDirectional*>(m_Shadow.get()));
+		vk::LightManager::Get()->UnregisterLight(this);
 	}
-	
-	glm::mat4 DirectionalLight::GetMVP() 
+
+	void Light::MarkDirty()
 	{
-		glm::mat4 proj = glm::ortho<float>(-25, 25, -25, 25, -50, 50);
-		glm::mat4 view = glm::lookAt(GetDirection(), glm::vec3(0,0,0), glm::vec3(0, 1,0));
-		glm::mat4 model = glm::mat4(1.0f);
+		if (m_Shadow)
+		{
+			m_Shadow->SetNeedsRender(true);
+		}
+		vk::LightManager::Get()->MarkDirty(this);
+	}
 
-		return proj * view * model;
+	void Light::RemoveShadow()
+	{
+		if (m_Shadow)
+		{
+			m_Shadow.reset();
+			MarkDirty();
+		}
+	}
+
+	void DirectionalLight::AddShadow() 
+	{
+		m_Shadow = std::static_pointer_cast<vk::Shadow>(vk::ShadowDirectional::CreateShadowDirectional(this));
+		vk::ShadowManager::Get()->RegisterShadow(m_Shadow.get());
+		// the light's buffer entry points at the shadow's atlas tiles.
+		MarkDirty();
 	}
 	
 	void PointLight::AddShadow() 
 	{
 		m_Shadow = std::static_pointer_cast<vk::Shadow>(vk::ShadowOmniDirectional::CreateShadowOmniDirectional(this));
-		vk::ShadowManager::Get()->RegisterShadow(static_cast<vk::ShadowOmniDirectional*>(m_Shadow.get()));
+		vk::ShadowManager::Get()->RegisterShadow(m_Shadow.get());
+		MarkDirty();
 	}
 }
 
@@ -38,6 +60,14 @@ namespace plumbus::components
 
 	LightComponent::~LightComponent()
 	{
+		for (uint32_t item : m_BVHItems)
+		{
+			if (item != vk::BVH::s_InvalidItem)
+			{
+				m_BVH->Remove(item);
+			}
+		}
+
 		for (Light* light : m_Lights)
 		{
 			delete light;
@@ -50,6 +80,7 @@ namespace plumbus::components
 	void LightComponent::AddPointLight(glm::vec3 colour, float radius, bool shadow)
 	{
 		m_Lights.push_back(new PointLight(colour, radius, this));
+		vk::LightManager::Get()->RegisterLight(m_Lights.back());
 
 		if (shadow)
         {
@@ -60,6 +91,7 @@ namespace plumbus::components
 	void LightComponent::AddDirectionalLight(glm::vec3 colour, glm::vec3 target, bool shadow)
 	{
 		m_Lights.push_back(new DirectionalLight(colour, target, this));
+		vk::LightManager::Get()->RegisterLight(m_Lights.back());
 
 		if (shadow)
 		{
@@ -69,6 +101,44 @@ namespace plumbus::components
 
 	void LightComponent::OnUpdate(Scene* scene)
 	{
+		TranslationComponent* translationComp = GetOwner()->GetComponent<TranslationComponent>();
+		glm::vec3 pos = translationComp->GetTranslation();
 
+		if (translationComp->GetVersion() != m_TranslationVersion)
+		{
+			m_TranslationVersion = translationComp->GetVersion();
+			for (Light* light : m_Lights)
+			{
+				if (light->GetType() == LightType::Point)
+				{
+					light->MarkDirty();
+				}
+			}
+		}
+
+		m_BVH = &scene->GetBVH();
+		m_BVHItems.resize(m_Lights.size(), vk::BVH::s_InvalidItem);
+		for (size_t i = 0; i < m_Lights.size(); ++i)
+		{
+			if (m_Lights[i]->GetType() != LightType::Point)
+			{
+				continue;
+			}
+
+			// the bvh ignores bounds that haven't changed, so position and radius edits are both picked up here.
+			float radius = static_cast<PointLight*>(m_Lights[i])->GetRadius();
+			vk::AABB bounds;
+			bounds.m_Min = pos - glm::vec3(radius);
+			bounds.m_Max = pos + glm::vec3(radius);
+
+			if (m_BVHItems[i] == vk::BVH::s_InvalidItem)
+			{
+				m_BVHItems[i] = m_BVH->Insert(bounds, m_Lights[i], vk::BVHItemType_Light);
+			}
+			else
+			{
+				m_BVH->SetBounds(m_BVHItems[i], bounds);
+			}
+		}
 	}
-}
+}
\ No newline at end of file
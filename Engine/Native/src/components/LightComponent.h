@@ -3,6 +3,11 @@
 #include "glm/glm.hpp"
 #include "renderer/vk/Shadow.h"
 
+namespace plumbus::vk
+{
+	class BVH;
+}
+
 namespace plumbus
 {
 	enum class LightType
@@ -19,21 +24,33 @@ namespace plumbus
     	class Light 
     	{
     	public:
+    		static constexpr uint32_t s_InvalidSlot = UINT32_MAX;
+
     		Light(glm::vec3 colour, components::LightComponent* parent) : m_Colour(colour), m_Shadow(nullptr), m_LightComponent(parent) {}
-    		virtual ~Light() {}
+    		virtual ~Light();
     		glm::vec3 GetColour() { return m_Colour; }
-    		void SetColour(glm::vec3 colour) { m_Colour = colour; }
+    		void SetColour(glm::vec3 colour) { if (colour != m_Colour) { m_Colour = colour; MarkDirty(); } }
     		LightType GetType() { return m_Type; }
+
+    		// queues the light for re-upload, setters call this so only lights that changed are copied to the gpu.
+    		void MarkDirty();
+    		bool IsDirty() { return m_Dirty; }
+    		void SetDirty(bool dirty) { m_Dirty = dirty; }
+    		// index into the LightManager's buffer for this light's type.
+    		uint32_t GetSlot() { return m_Slot; }
+    		void SetSlot(uint32_t slot) { m_Slot = slot; }
     
     		vk::ShadowRef GetShadow() { return m_Shadow; }
     		virtual void AddShadow() = 0;
     		components::LightComponent* GetParent() { return m_LightComponent; }
-    		void RemoveShadow() { if (m_Shadow) { m_Shadow.reset(); } }
+    		void RemoveShadow();
     	protected:
     		glm::vec3 m_Colour;
     		LightType m_Type = LightType::Invalid;
     		vk::ShadowRef m_Shadow;
     		components::LightComponent* m_LightComponent;
+    		uint32_t m_Slot = s_InvalidSlot;
+    		bool m_Dirty = false;
     	};
     
     	class DirectionalLight : public Light 
@@ -43,9 +60,8 @@ namespace plumbus
     		~DirectionalLight() {}
     
     		glm::vec3 GetDirection() { return m_Direction; }
-    		void SetDirection(glm::vec3 dir) { m_Direction = dir; }
+    		void SetDirection(glm::vec3 dir) { if (dir != m_Direction) { m_Direction = dir; MarkDirty(); } }
     		void AddShadow() override;
-    		glm::mat4 GetMVP();
     	private:
     		glm::vec3 m_Direction;
     	};
@@ -57,7 +73,7 @@ namespace plumbus
     		~PointLight() {}
     
     		float GetRadius() { return m_Radius; }
-    		void SetRadius(float radius) { m_Radius = radius; }
+    		void SetRadius(float radius) { if (radius != m_Radius) { m_Radius = radius; MarkDirty(); } }
     		void AddShadow() override;
     	private:
     		float m_Radius;
@@ -86,6 +102,13 @@ namespace plumbus::components
 	private:
 		
 		std::vector<Light*> m_Lights;
+
+		// point light influence volumes live in the scene's BVH, directional lights affect everything and are left out.
+		vk::BVH* m_BVH = nullptr;
+		std::vector<uint32_t> m_BVHItems;
+
+		// version of the owner's transform the lights were last marked dirty for.
+		uint32_t m_TranslationVersion = UINT32_MAX;
 	};
 
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include "GameObject.h"
 #include "Scene.h"
 #include "renderer/vk/Mesh.h"
+#include "renderer/vk/BVH.h"
+#include "renderer/vk/ShadowManager.h"
 
 namespace plumbus::components
 {
@@ -34,7 +36,7 @@ namespace plumbus::components
 
 	ModelComponent::~ModelComponent()
 	{
-
+		RemoveFromBVH();
 	}
 
 	std::vector<vk::Mesh*> ModelComponent::GetModels()
@@ -45,6 +47,12 @@ namespace plumbus::components
 	void ModelComponent::LoadModel()
 	{
 		m_Models = vk::Mesh::LoadModel(m_ModelPath, m_TexturePath, m_NormalPath);
+		m_WorldBoundsDirty = true;
+
+		for (vk::Mesh* model : m_Models)
+		{
+			model->SetOwner(this);
+		}
 
 		if (m_Material)
 		{
@@ -71,17 +79,65 @@ namespace plumbus::components
 	void ModelComponent::OnUpdate(Scene* scene)
 	{
 	    UpdateModelMatrix();
+	    UpdateBVH(scene);
         UpdateUniformBuffer(scene);
 	}
 
+	void ModelComponent::UpdateBVH(Scene* scene)
+	{
+		if (m_BVHItems.size() != m_Models.size())
+		{
+			// first update, or the model was reloaded.
+			RemoveFromBVH();
+
+			m_BVH = &scene->GetBVH();
+			for (vk::Mesh* model : m_Models)
+			{
+				vk::AABB bounds = model->HasBounds() ? model->GetWorldBounds() : vk::AABB();
+				m_BVHItems.push_back(m_BVH->Insert(bounds, model, vk::BVHItemType_Mesh));
+				vk::ShadowManager::Get()->InvalidateRegion(bounds);
+			}
+		}
+		else if (m_BVHBoundsDirty)
+		{
+			for (size_t i = 0; i < m_Models.size(); ++i)
+			{
+				// a rotation can leave the bounds where they were, so shadows are invalidated even if the bvh ignores it.
+				vk::ShadowManager::Get()->InvalidateRegion(m_BVH->GetBounds(m_BVHItems[i]));
+				if (m_Models[i]->HasBounds())
+				{
+					m_BVH->SetBounds(m_BVHItems[i], m_Models[i]->GetWorldBounds());
+					vk::ShadowManager::Get()->InvalidateRegion(m_Models[i]->GetWorldBounds());
+				}
+			}
+		}
+
+		m_BVHBoundsDirty = false;
+	}
+
+	void ModelComponent::RemoveFromBVH()
+	{
+		for (uint32_t item : m_BVHItems)
+		{
+			vk::ShadowManager::Get()->InvalidateRegion(m_BVH->GetBounds(item));
+			m_BVH->Remove(item);
+		}
+		m_BVHItems.clear();
+		m_BVH = nullptr;
+	}
+
 	void ModelComponent::Cleanup()
 	{
+		RemoveFromBVH();
+
 		for (vk::Mesh* model : m_Models)
 		{
 			model->Cleanup();
 			delete model;
 			model = nullptr;
 		}
+		// the meshes held this component's references to the shared geometry.
+		m_Models.clear();
 	}
 
 	void ModelComponent::UpdateUniformBuffer(Scene* scene)
@@ -125,6 +181,17 @@ namespace plumbus::components
             m_ModelMatrix = glm::rotate(m_ModelMatrix, rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
 
             m_ModelMatrix = glm::scale(m_ModelMatrix, scale);
+            m_WorldBoundsDirty = true;
+        }
+
+        if (m_WorldBoundsDirty)
+        {
+            for (vk::Mesh* model : m_Models)
+            {
+                model->UpdateWorldBounds(m_ModelMatrix);
+            }
+            m_WorldBoundsDirty = false;
+            m_BVHBoundsDirty = true;
         }
     }
 }
\ No newline at end of file
@@ -11,6 +11,7 @@ namespace plumbus::vk
 {
 	class Mesh;
 	class Material;
+	class BVH;
 }
 namespace plumbus::components
 {
@@ -39,6 +40,7 @@ namespace plumbus::components
 		void Cleanup();
 		void UpdateModelMatrix();
 		void UpdateUniformBuffer(Scene* scene);
+		void UpdateBVH(Scene* scene);
 
 		std::string GetModelPath() { return m_ModelPath; }
 		std::string GetTexturePath() { return m_TexturePath; }
@@ -49,6 +51,7 @@ namespace plumbus::components
 		glm::mat4 GetModelMatrix();
 
 	private:
+		void RemoveFromBVH();
 
 		UniformBufferObject m_UniformBufferObject;
 
@@ -65,5 +68,11 @@ namespace plumbus::components
 		glm::vec3 m_CachedScale;
 
 		glm::mat4 m_ModelMatrix;
+		bool m_WorldBoundsDirty = true;
+
+		// one item per mesh in the scene's BVH, pushed whenever the world bounds change.
+		vk::BVH* m_BVH = nullptr;
+		std::vector<uint32_t> m_BVHItems;
+		bool m_BVHBoundsDirty = false;
 	};
 }
\ No newline at end of file
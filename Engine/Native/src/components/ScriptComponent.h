@@ -17,6 +17,8 @@ namespace plumbus::components
 		void Init() override;
 		void PostInit() override {}
 		void OnUpdate(Scene* scene) override;
+
+		static const ComponentType GetType() { return GameComponent::ScriptComponent; }
 	private:
 		std::string m_ScriptNamespace;
 		std::string m_ScriptName;
@@ -4,28 +4,50 @@
 
 namespace plumbus::components
 {
+	std::vector<glm::vec3> TranslationComponent::s_Translations;
+	std::vector<glm::vec3> TranslationComponent::s_Rotations;
+	std::vector<glm::vec3> TranslationComponent::s_Scales;
+	std::vector<TranslationComponent*> TranslationComponent::s_Owners;
 
 	TranslationComponent::TranslationComponent() 
 		: GameComponent()
-		, m_Translation(0)
-		, m_Rotation(0)
-		, m_Scale(1)
+		, m_Slot(static_cast<uint32_t>(s_Owners.size()))
 	{
+		s_Translations.push_back(glm::vec3(0));
+		s_Rotations.push_back(glm::vec3(0));
+		s_Scales.push_back(glm::vec3(1));
+		s_Owners.push_back(this);
+	}
 
+	TranslationComponent::~TranslationComponent()
+	{
+		uint32_t last = static_cast<uint32_t>(s_Owners.size()) - 1;
+		if (m_Slot != last)
+		{
+			s_Translations[m_Slot] = s_Translations[last];
+			s_Rotations[m_Slot] = s_Rotations[last];
+			s_Scales[m_Slot] = s_Scales[last];
+			s_Owners[m_Slot] = s_Owners[last];
+			s_Owners[m_Slot]->m_Slot = m_Slot;
+		}
+
+		s_Translations.pop_back();
+		s_Rotations.pop_back();
+		s_Scales.pop_back();
+		s_Owners.pop_back();
 	}
 
 	glm::vec3 TranslationComponent::GetTranslation()
 	{
-		glm::vec3 trans = m_Translation;
-		return m_Translation;
+		return s_Translations[m_Slot];
 	}
 	glm::vec3 TranslationComponent::GetRotation()
 	{
-		return m_Rotation;
+		return s_Rotations[m_Slot];
 	}
 	glm::vec3 TranslationComponent::GetScale()
 	{
-		return m_Scale;
+		return s_Scales[m_Slot];
 	}
 
 	void TranslationComponent::OnUpdate(Scene* scene)
@@ -35,32 +57,56 @@ namespace plumbus::components
 
 	void TranslationComponent::SetTranslation(glm::vec3 translation)
 	{
-		m_Translation = translation;
+		if (s_Translations[m_Slot] != translation)
+		{
+			s_Translations[m_Slot] = translation;
+			m_Version++;
+		}
 	}
 
 	void TranslationComponent::SetRotation(glm::vec3 rotation)
 	{
-		m_Rotation = rotation;
+		if (s_Rotations[m_Slot] != rotation)
+		{
+			s_Rotations[m_Slot] = rotation;
+			m_Version++;
+		}
 	}
 
 	void TranslationComponent::SetScale(glm::vec3 scale)
 	{
-		m_Scale = scale;
+		if (s_Scales[m_Slot] != scale)
+		{
+			s_Scales[m_Slot] = scale;
+			m_Version++;
+		}
 	}
 
 	void TranslationComponent::Translate(glm::vec3 translation)
 	{
-		m_Translation += translation;
+		if (translation != glm::vec3(0.f))
+		{
+			s_Translations[m_Slot] += translation;
+			m_Version++;
+		}
 	}
 
 	void TranslationComponent::Rotate(glm::vec3 rotation)
 	{
-		m_Rotation += rotation;
+		if (rotation != glm::vec3(0.f))
+		{
+			s_Rotations[m_Slot] += rotation;
+			m_Version++;
+		}
 	}
 
 	void TranslationComponent::Scale(glm::vec3 scale)
 	{
-		m_Scale += scale;
+		if (scale != glm::vec3(0.f))
+		{
+			s_Scales[m_Slot] += scale;
+			m_Version++;
+		}
 	}
 }
 
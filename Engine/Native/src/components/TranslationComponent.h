@@ -9,6 +9,9 @@ namespace plumbus::components
 	{
 	public:
 		TranslationComponent();
+		~TranslationComponent();
+		TranslationComponent(const TranslationComponent&) = delete;
+		TranslationComponent& operator=(const TranslationComponent&) = delete;
 
 		void Init() override {}
 		void PostInit() override {}
@@ -26,12 +29,27 @@ namespace plumbus::components
 		void Rotate(glm::vec3 rotation);
 		void Scale(glm::vec3 scale);
 
+		// bumped whenever the transform actually changes, so systems can skip work for objects that haven't moved.
+		uint32_t GetVersion() { return m_Version; }
+
 		static const ComponentType GetType() { return GameComponent::TranslationComponent; }
 
+		// packed transform data for every live component, for systems that want to walk them all at once.
+		static uint32_t GetCount() { return static_cast<uint32_t>(s_Owners.size()); }
+		static const std::vector<glm::vec3>& GetTranslations() { return s_Translations; }
+		static const std::vector<glm::vec3>& GetRotations() { return s_Rotations; }
+		static const std::vector<glm::vec3>& GetScales() { return s_Scales; }
+		static const std::vector<TranslationComponent*>& GetOwners() { return s_Owners; }
+
 	private:
-		glm::vec3 m_Translation;
-		glm::vec3 m_Rotation;
-		glm::vec3 m_Scale = glm::vec3(1, 1, 1);
+		// stored struct of arrays, each component just owns a slot. slots are kept packed so they move on removal.
+		static std::vector<glm::vec3> s_Translations;
+		static std::vector<glm::vec3> s_Rotations;
+		static std::vector<glm::vec3> s_Scales;
+		static std::vector<TranslationComponent*> s_Owners;
+
+		uint32_t m_Slot;
+		uint32_t m_Version = 0;
 	};
 }
 
@@ -15,6 +15,11 @@
 #include "renderer/vk/PipelineLayout.h"
 #include "renderer/vk/vk_types_fwd.h"
 #include "renderer/vk/VulkanRenderer.h"
+#include "renderer/vk/LightManager.h"
+#include "renderer/vk/ShadowManager.h"
+#include "renderer/vk/ModelCache.h"
+#include "renderer/vk/TextureCache.h"
+#include "renderer/vk/SamplerCache.h"
 #include "renderer/vk/shader_compiler/ShaderSettings.h"
 
 #if ENABLE_IMGUI
@@ -29,12 +34,14 @@ namespace plumbus
 		std::shared_ptr<vk::Device> device = vk::VulkanRenderer::Get()->GetDevice();
 
 		// Release all Vulkan resources required for rendering imGui
-		m_VertexBuffer.Cleanup();
-		m_IndexBuffer.Cleanup();
+		for (FrameBuffers& frameBuffers : m_FrameBuffers)
+		{
+			frameBuffers.m_VertexBuffer.Cleanup();
+			frameBuffers.m_IndexBuffer.Cleanup();
+		}
 		vkDestroyImage(device->GetVulkanDevice(), m_FontImage, nullptr);
 		vkDestroyImageView(device->GetVulkanDevice(), m_FontView, nullptr);
-		vkFreeMemory(device->GetVulkanDevice(), m_FontMemory, nullptr);
-		vkDestroySampler(device->GetVulkanDevice(), m_Sampler, nullptr);
+		device->GetMemoryAllocator()->Free(m_FontAllocation);
 		
 		m_MaterialInstance.reset();
 		m_GameViewMaterialInstance.reset();
@@ -84,6 +91,8 @@ namespace plumbus
 
 		ImGuiIO& io = ImGui::GetIO();
 
+		m_FrameBuffers.resize(vk::VulkanRenderer::Get()->GetFramesInFlight());
+
 		// Create font texture
 		unsigned char* fontData;
 		int texWidth, texHeight;
@@ -106,14 +115,7 @@ namespace plumbus
 		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		CHECK_VK_RESULT(vkCreateImage(device->GetVulkanDevice(), &imageInfo, nullptr, &m_FontImage));
-		VkMemoryRequirements memReqs;
-		vkGetImageMemoryRequirements(device->GetVulkanDevice(), m_FontImage, &memReqs);
-		VkMemoryAllocateInfo memAllocInfo{};
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->FindMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		CHECK_VK_RESULT(vkAllocateMemory(device->GetVulkanDevice(), &memAllocInfo, nullptr, &m_FontMemory));
-		CHECK_VK_RESULT(vkBindImageMemory(device->GetVulkanDevice(), m_FontImage, m_FontMemory, 0));
+		CHECK_VK_RESULT(device->GetMemoryAllocator()->AllocateImageMemory(m_FontImage, imageInfo.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_FontAllocation));
 
 		// Image view
 		VkImageViewCreateInfo viewInfo{};
@@ -194,7 +196,7 @@ namespace plumbus
 		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
 		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
 		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-		CHECK_VK_RESULT(vkCreateSampler(device->GetVulkanDevice(), &samplerInfo, nullptr, &m_Sampler));
+		m_Sampler = device->GetSamplerCache()->GetSampler(samplerInfo);
 
 		m_Material = std::make_shared<vk::Material>("shaders/ui.vert", "shaders/ui.frag", renderPass, true);
 		m_Material->Setup();
@@ -249,6 +251,58 @@ namespace plumbus
 
 			ImGui::Begin("Properties", 0);
 			BaseApplication::Get().GetScene()->GetCamera()->OnGui();
+			if (ImGui::CollapsingHeader("Renderer Stats"))
+			{
+				const vk::CullingStats& gBufferStats = BaseApplication::Get().GetRenderer()->GetGBufferCullingStats();
+				ImGui::Text("G-Buffer: %u visible, %u culled", gBufferStats.m_Visible, gBufferStats.m_Culled);
+				const vk::RenderQueueStats& gBufferQueueStats = BaseApplication::Get().GetRenderer()->GetGBufferQueueStats();
+				ImGui::Text("G-Buffer Sort: %u draws, %u radix passes, %.3fms", gBufferQueueStats.m_Packets, gBufferQueueStats.m_SortPasses, gBufferQueueStats.m_SortMs);
+				ImGui::Text("G-Buffer Batches: %u draw calls, %u instanced drawing %u meshes", gBufferQueueStats.m_Batches, gBufferQueueStats.m_InstancedBatches, gBufferQueueStats.m_Instances);
+				const vk::BindStats& gBufferBindStats = BaseApplication::Get().GetRenderer()->GetGBufferBindStats();
+				ImGui::Text("G-Buffer Binds: pipeline %u (%u skipped), descriptor set %u (%u skipped)", gBufferBindStats.m_PipelineBinds, gBufferBindStats.m_PipelinesSkipped, gBufferBindStats.m_DescriptorSetBinds, gBufferBindStats.m_DescriptorSetsSkipped);
+				ImGui::Text("G-Buffer Binds: vertex %u (%u skipped), index %u (%u skipped)", gBufferBindStats.m_VertexBufferBinds, gBufferBindStats.m_VertexBuffersSkipped, gBufferBindStats.m_IndexBufferBinds, gBufferBindStats.m_IndexBuffersSkipped);
+
+				const vk::ModelCacheStats& modelCacheStats = vk::ModelCache::Get()->GetStats();
+				ImGui::Text("Models: %u loaded with %u meshes, %u imports for %u requests", modelCacheStats.m_LoadedModels, modelCacheStats.m_LoadedMeshes, modelCacheStats.m_Loads, modelCacheStats.m_Requests);
+				const vk::TextureCacheStats& textureCacheStats = vk::TextureCache::Get()->GetStats();
+				uint32_t samplerCount = BaseApplication::Get().GetRenderer()->GetDevice()->GetSamplerCache()->GetSamplerCount();
+				ImGui::Text("Textures: %u loaded, %u imports for %u requests, %u samplers", textureCacheStats.m_LoadedTextures, textureCacheStats.m_Loads, textureCacheStats.m_Requests, samplerCount);
+
+				const vk::BVHStats& bvhStats = BaseApplication::Get().GetScene()->GetBVH().GetStats();
+				ImGui::Text("BVH: %u items, %u nodes", bvhStats.m_ItemCount, bvhStats.m_NodeCount);
+				ImGui::Text("BVH Build: %.3fms (%u total)", bvhStats.m_BuildMs, bvhStats.m_Builds);
+				ImGui::Text("BVH Refit: %.3fms (%u total)", bvhStats.m_RefitMs, bvhStats.m_Refits);
+				ImGui::Text("BVH Queries: %u, %u nodes visited, %.3fms", bvhStats.m_Queries, bvhStats.m_NodesVisited, bvhStats.m_QueryMs);
+
+				const vk::LightUploadStats& lightUploadStats = vk::LightManager::Get()->GetStats();
+				ImGui::Text("Light Uploads: %u lights changed, %u ranges, %llu bytes", lightUploadStats.m_RefreshedLights, lightUploadStats.m_Ranges, (unsigned long long)lightUploadStats.m_UploadedBytes);
+
+				const vk::ShadowAtlasStats& shadowAtlasStats = vk::ShadowManager::Get()->GetAtlas()->GetStats();
+				ImGui::Text("Shadow Atlas: %ux%u, %u tiles, %.0f%% used", shadowAtlasStats.m_Size, shadowAtlasStats.m_Size, shadowAtlasStats.m_Tiles, shadowAtlasStats.m_Occupancy * 100.f);
+				ImGui::Text("Shadow Atlas: %u moved, %u shrunk, %u dropped", shadowAtlasStats.m_MovedTiles, shadowAtlasStats.m_ShrunkTiles, shadowAtlasStats.m_DroppedTiles);
+				const vk::ShadowUpdateStats& shadowUpdateStats = vk::ShadowManager::Get()->GetUpdateStats();
+				ImGui::Text("Shadow Updates: %u/%u rendered, %u deferred, %u passes", shadowUpdateStats.m_Updated, shadowUpdateStats.m_Pending, shadowUpdateStats.m_Deferred, shadowUpdateStats.m_Passes);
+				int maxShadowPasses = static_cast<int>(vk::ShadowManager::Get()->GetMaxPassesPerFrame());
+				if (ImGui::SliderInt("Shadow Passes Per Frame", &maxShadowPasses, 1, 96))
+				{
+					vk::ShadowManager::Get()->SetMaxPassesPerFrame(static_cast<uint32_t>(maxShadowPasses));
+				}
+
+				const vk::RenderGraphStats& renderGraphStats = BaseApplication::Get().GetRenderer()->GetRenderGraph()->GetStats();
+				ImGui::Text("Render Graph: %u/%u passes run, %u culled", renderGraphStats.m_ExecutedPasses, renderGraphStats.m_Passes, renderGraphStats.m_CulledPasses);
+				ImGui::Text("Render Graph: %u barriers in %u batches", renderGraphStats.m_Barriers, renderGraphStats.m_BarrierBatches);
+				ImGui::Text("Render Graph: %u/%u attachments aliased, %llu/%llu KB", renderGraphStats.m_AliasedAttachments, renderGraphStats.m_TransientAttachments, (unsigned long long)(renderGraphStats.m_AllocatedBytes / 1024), (unsigned long long)(renderGraphStats.m_TransientBytes / 1024));
+
+				vk::LightClusterGrid& lightClusters = BaseApplication::Get().GetRenderer()->GetLightClusterGrid();
+				const vk::LightClusterStats& clusterStats = lightClusters.GetStats();
+				ImGui::Text("Light Clusters: %u/%u lights visible, %u indices", clusterStats.m_VisibleLights, clusterStats.m_LightCount, clusterStats.m_IndexCount);
+				ImGui::Text("Light Clusters: max %u per cluster, %.3fms", clusterStats.m_MaxLightsPerCluster, clusterStats.m_BuildMs);
+				bool heatMap = lightClusters.IsHeatMapEnabled();
+				if (ImGui::Checkbox("Light Cluster Heat Map", &heatMap))
+				{
+					lightClusters.SetHeatMapEnabled(heatMap);
+				}
+			}
 			if (m_SelectedObject)
 			{
 				if (ImGui::CollapsingHeader("Components", ImGuiTreeNodeFlags_DefaultOpen))
@@ -347,6 +401,7 @@ namespace plumbus
 	void ImGUIImpl::UpdateBuffers()
 	{
 		std::shared_ptr<vk::Device> device = vk::VulkanRenderer::Get()->GetDevice();
+		FrameBuffers& frameBuffers = m_FrameBuffers[vk::VulkanRenderer::Get()->GetCurrentFrameIndex()];
 
 		ImDrawData* imDrawData = ImGui::GetDrawData();
 
@@ -357,28 +412,28 @@ namespace plumbus
 		// Update buffers only if vertex or index count has been changed compared to current buffer size
 
 		// Vertex buffer
-		if ((m_VertexBuffer.m_Buffer == VK_NULL_HANDLE) || (m_VertexCount != imDrawData->TotalVtxCount)) {
-			m_VertexBuffer.Unmap();
-			m_VertexBuffer.Cleanup();
-			CHECK_VK_RESULT(device->CreateBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &m_VertexBuffer, vertexBufferSize));
-			m_VertexCount = imDrawData->TotalVtxCount;
-			m_VertexBuffer.Unmap();
-			m_VertexBuffer.Map();
+		if ((frameBuffers.m_VertexBuffer.m_Buffer == VK_NULL_HANDLE) || (frameBuffers.m_VertexCount != imDrawData->TotalVtxCount)) {
+			frameBuffers.m_VertexBuffer.Unmap();
+			frameBuffers.m_VertexBuffer.Cleanup();
+			CHECK_VK_RESULT(device->CreateBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &frameBuffers.m_VertexBuffer, vertexBufferSize));
+			frameBuffers.m_VertexCount = imDrawData->TotalVtxCount;
+			frameBuffers.m_VertexBuffer.Unmap();
+			frameBuffers.m_VertexBuffer.Map();
 		}
 
 		// Index buffer
 		VkDeviceSize indexSize = imDrawData->TotalIdxCount * sizeof(ImDrawIdx);
-		if ((m_IndexBuffer.m_Buffer == VK_NULL_HANDLE) || (m_IndexCount < imDrawData->TotalIdxCount)) {
-			m_IndexBuffer.Unmap();
-			m_IndexBuffer.Cleanup();
-			CHECK_VK_RESULT(device->CreateBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &m_IndexBuffer, indexBufferSize));
-			m_IndexCount = imDrawData->TotalIdxCount;
-			m_IndexBuffer.Map();
+		if ((frameBuffers.m_IndexBuffer.m_Buffer == VK_NULL_HANDLE) || (frameBuffers.m_IndexCount < imDrawData->TotalIdxCount)) {
+			frameBuffers.m_IndexBuffer.Unmap();
+			frameBuffers.m_IndexBuffer.Cleanup();
+			CHECK_VK_RESULT(device->CreateBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &frameBuffers.m_IndexBuffer, indexBufferSize));
+			frameBuffers.m_IndexCount = imDrawData->TotalIdxCount;
+			frameBuffers.m_IndexBuffer.Map();
 		}
 
 		// Upload data
-		ImDrawVert* vtxDst = (ImDrawVert*)m_VertexBuffer.m_Mapped;
-		ImDrawIdx* idxDst = (ImDrawIdx*)m_IndexBuffer.m_Mapped;
+		ImDrawVert* vtxDst = (ImDrawVert*)frameBuffers.m_VertexBuffer.m_Mapped;
+		ImDrawIdx* idxDst = (ImDrawIdx*)frameBuffers.m_IndexBuffer.m_Mapped;
 
 		for (int n = 0; n < imDrawData->CmdListsCount; n++) {
 			const ImDrawList* cmd_list = imDrawData->CmdLists[n];
@@ -389,18 +444,18 @@ namespace plumbus
 		}
 
 		// Flush to make writes visible to GPU
-		m_VertexBuffer.Flush();
-		m_IndexBuffer.Flush();
+		frameBuffers.m_VertexBuffer.Flush();
+		frameBuffers.m_IndexBuffer.Flush();
 	}
 
 	void ImGUIImpl::DrawFrame(vk::CommandBufferRef commandBuffer)
 	{
 		ImGuiIO& io = ImGui::GetIO();
+		FrameBuffers& frameBuffers = m_FrameBuffers[vk::VulkanRenderer::Get()->GetCurrentFrameIndex()];
 
 		// Bind vertex and index buffer
-		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer->GetVulkanCommandBuffer(), 0, 1, &m_VertexBuffer.m_Buffer, offsets);
-		vkCmdBindIndexBuffer(commandBuffer->GetVulkanCommandBuffer(), m_IndexBuffer.m_Buffer, 0, VK_INDEX_TYPE_UINT16);
+		commandBuffer->BindVertexBuffer(frameBuffers.m_VertexBuffer);
+		commandBuffer->BindIndexBuffer(frameBuffers.m_IndexBuffer, VK_INDEX_TYPE_UINT16);
         
 		VkViewport viewport{};
         viewport.width = io.DisplaySize.x * io.DisplayFramebufferScale.x;
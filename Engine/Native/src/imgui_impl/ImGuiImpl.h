@@ -38,12 +38,18 @@ namespace plumbus
 		static void OnKeyDown(GLFWwindow*, int key, int, int action, int mods);
 		static void OnChar(GLFWwindow*, unsigned int c);
 	private:
-		VkSampler m_Sampler;
-		vk::Buffer m_VertexBuffer;
-		vk::Buffer m_IndexBuffer;
-		int32_t m_VertexCount = 0;
-		int32_t m_IndexCount = 0;
-		VkDeviceMemory m_FontMemory = VK_NULL_HANDLE;
+		//geometry is rewritten every frame, so keep a set per frame in flight.
+		struct FrameBuffers
+		{
+			vk::Buffer m_VertexBuffer;
+			vk::Buffer m_IndexBuffer;
+			int32_t m_VertexCount = 0;
+			int32_t m_IndexCount = 0;
+		};
+
+		VkSampler m_Sampler; // from the device SamplerCache, not destroyed here.
+		std::vector<FrameBuffers> m_FrameBuffers;
+		vk::MemoryAllocation m_FontAllocation;
 		VkImage m_FontImage = VK_NULL_HANDLE;
 		VkImageView m_FontView = VK_NULL_HANDLE;
 
@@ -9,5 +9,7 @@ namespace plumbus
         static std::string GetTextureDirPath();
         static std::string GetAssetsPath();
         static std::string GetTextureExtension();
+        // writable directory for generated data (shader/pipeline caches), not shipped with the assets.
+        static std::string GetCachePath();
     };
 }
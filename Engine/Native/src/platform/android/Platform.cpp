@@ -1,4 +1,7 @@
 #include "platform/Platform.h"
+#include "android_native_app_glue.h"
+
+extern android_app* Android_application;
 
 namespace plumbus
 {
@@ -16,4 +19,10 @@ namespace plumbus
     {
         return "";
     }
+
+    std::string Platform::GetCachePath()
+    {
+        // the apk assets are read only, so caches live in the app's internal storage.
+        return std::string(Android_application->activity->internalDataPath) + "/cache/";
+    }
 }
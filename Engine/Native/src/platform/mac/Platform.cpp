@@ -12,6 +12,11 @@ namespace plumbus
         return "../../PlumbusTester/assets/";
     }
 
+    std::string Platform::GetCachePath()
+    {
+        return "cache/";
+    }
+
     std::string Platform::GetTextureExtension()
     {
         return ".ktx";
@@ -0,0 +1,603 @@
+#include "plumbus.h"
+#include "BVH.h"
+
+namespace plumbus::vk
+{
+	// refitting only ever stretches nodes, once the tree costs this much more than it did when built start again.
+	constexpr float s_RebuildCostRatio = 1.5f;
+
+	static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// slab test, returns the entry distance or FLT_MAX on a miss.
+	static float RayAABB(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const AABB& aabb)
+	{
+		glm::vec3 t0 = (aabb.m_Min - origin) * inverseDirection;
+		glm::vec3 t1 = (aabb.m_Max - origin) * inverseDirection;
+		glm::vec3 tMin = glm::min(t0, t1);
+		glm::vec3 tMax = glm::max(t0, t1);
+
+		float entry = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.f));
+		float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+		return entry <= exit ? entry : FLT_MAX;
+	}
+
+	uint32_t BVH::Insert(const AABB& bounds, void* userData, uint32_t typeMask)
+	{
+		uint32_t index;
+		if (!m_FreeItems.empty())
+		{
+			index = m_FreeItems.back();
+			m_FreeItems.pop_back();
+		}
+		else
+		{
+			index = static_cast<uint32_t>(m_Items.size());
+			m_Items.emplace_back();
+		}
+
+		Item& item = m_Items[index];
+		item.m_Bounds = bounds;
+		item.m_UserData = userData;
+		item.m_TypeMask = typeMask;
+		item.m_Leaf = UINT32_MAX;
+		item.m_Alive = true;
+
+		if (bounds.IsValid())
+		{
+			m_NeedsRebuild = true;
+		}
+		else
+		{
+			m_UnboundedItems.push_back(index);
+		}
+
+		for (uint32_t bit = 0; bit < 32; ++bit)
+		{
+			if (typeMask & (1u << bit))
+			{
+				m_TypeCounts[bit]++;
+			}
+		}
+
+		return index;
+	}
+
+	void BVH::Remove(uint32_t itemIndex)
+	{
+		PL_ASSERT(itemIndex < m_Items.size() && m_Items[itemIndex].m_Alive);
+
+		Item& item = m_Items[itemIndex];
+		if (item.m_Bounds.IsValid())
+		{
+			m_NeedsRebuild = true;
+		}
+		else
+		{
+			m_UnboundedItems.erase(std::find(m_UnboundedItems.begin(), m_UnboundedItems.end(), itemIndex));
+		}
+
+		for (uint32_t bit = 0; bit < 32; ++bit)
+		{
+			if (item.m_TypeMask & (1u << bit))
+			{
+				m_TypeCounts[bit]--;
+			}
+		}
+
+		item = Item();
+		m_FreeItems.push_back(itemIndex);
+	}
+
+	void BVH::SetBounds(uint32_t itemIndex, const AABB& bounds)
+	{
+		PL_ASSERT(itemIndex < m_Items.size() && m_Items[itemIndex].m_Alive);
+
+		Item& item = m_Items[itemIndex];
+		if (item.m_Bounds.m_Min == bounds.m_Min && item.m_Bounds.m_Max == bounds.m_Max)
+		{
+			return;
+		}
+
+		bool wasBounded = item.m_Bounds.IsValid();
+		bool isBounded = bounds.IsValid();
+		item.m_Bounds = bounds;
+
+		if (wasBounded != isBounded)
+		{
+			// moving in or out of the tree changes its structure.
+			if (isBounded)
+			{
+				m_UnboundedItems.erase(std::find(m_UnboundedItems.begin(), m_UnboundedItems.end(), itemIndex));
+			}
+			else
+			{
+				m_UnboundedItems.push_back(itemIndex);
+			}
+			m_NeedsRebuild = true;
+		}
+		else if (isBounded && !m_NeedsRebuild)
+		{
+			m_DirtyItems.push_back(itemIndex);
+		}
+	}
+
+	void BVH::Update()
+	{
+		m_Stats.m_Queries = 0;
+		m_Stats.m_NodesVisited = 0;
+		m_Stats.m_QueryMs = 0.0;
+
+		if (m_NeedsRebuild)
+		{
+			Build();
+		}
+		else if (!m_DirtyItems.empty())
+		{
+			Refit();
+			if (ComputeCost() > m_BuildCost * s_RebuildCostRatio)
+			{
+				Build();
+			}
+		}
+	}
+
+	uint32_t BVH::GetItemCount(uint32_t typeMask) const
+	{
+		uint32_t count = 0;
+		for (uint32_t bit = 0; bit < 32; ++bit)
+		{
+			if (typeMask & (1u << bit))
+			{
+				count += m_TypeCounts[bit];
+			}
+		}
+		return count;
+	}
+
+	void BVH::Build()
+	{
+		auto buildStart = std::chrono::steady_clock::now();
+
+		m_ItemIndices.clear();
+		for (uint32_t i = 0; i < m_Items.size(); ++i)
+		{
+			if (m_Items[i].m_Alive && m_Items[i].m_Bounds.IsValid())
+			{
+				m_ItemIndices.push_back(i);
+			}
+		}
+
+		m_Nodes.clear();
+		if (!m_ItemIndices.empty())
+		{
+			m_Nodes.reserve(m_ItemIndices.size() * 2);
+
+			Node root;
+			root.m_First = 0;
+			root.m_Count = static_cast<uint32_t>(m_ItemIndices.size());
+			m_Nodes.push_back(root);
+
+			Subdivide();
+		}
+
+		m_DirtyItems.clear();
+		m_NeedsRebuild = false;
+		m_BuildCost = ComputeCost();
+
+		m_Stats.m_Builds++;
+		m_Stats.m_BuildMs = MillisecondsSince(buildStart);
+		m_Stats.m_ItemCount = static_cast<uint32_t>(m_ItemIndices.size() + m_UnboundedItems.size());
+		m_Stats.m_NodeCount = static_cast<uint32_t>(m_Nodes.size());
+	}
+
+	void BVH::Subdivide()
+	{
+		struct PendingNode
+		{
+			uint32_t m_Index;
+			uint32_t m_Depth;
+		};
+
+		std::vector<PendingNode> pending = { { 0, 0 } };
+		while (!pending.empty())
+		{
+			PendingNode current = pending.back();
+			pending.pop_back();
+
+			UpdateLeaf(current.m_Index);
+
+			uint32_t first = m_Nodes[current.m_Index].m_First;
+			uint32_t count = m_Nodes[current.m_Index].m_Count;
+			if (count <= s_MaxLeafItems || current.m_Depth + 1 >= s_MaxDepth)
+			{
+				continue;
+			}
+
+			AABB centroidBounds;
+			for (uint32_t i = first; i < first + count; ++i)
+			{
+				centroidBounds.Expand(m_Items[m_ItemIndices[i]].m_Bounds.GetCenter());
+			}
+
+			// binned SAH, try every axis and keep the cheapest split.
+			float bestCost = FLT_MAX;
+			int bestAxis = -1;
+			uint32_t bestSplit = 0;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float axisMin = centroidBounds.m_Min[axis];
+				float axisExtent = centroidBounds.m_Max[axis] - axisMin;
+				if (axisExtent <= 0.f)
+				{
+					continue;
+				}
+
+				AABB binBounds[s_BinCount];
+				uint32_t binCounts[s_BinCount] = {};
+				float binScale = s_BinCount / axisExtent;
+				for (uint32_t i = first; i < first + count; ++i)
+				{
+					const AABB& itemBounds = m_Items[m_ItemIndices[i]].m_Bounds;
+					uint32_t bin = std::min(s_BinCount - 1, (uint32_t)((itemBounds.GetCenter()[axis] - axisMin) * binScale));
+					binCounts[bin]++;
+					binBounds[bin].Expand(itemBounds);
+				}
+
+				float leftArea[s_BinCount - 1];
+				uint32_t leftCount[s_BinCount - 1];
+				AABB sweep;
+				uint32_t sweepCount = 0;
+				for (uint32_t i = 0; i < s_BinCount - 1; ++i)
+				{
+					sweepCount += binCounts[i];
+					sweep.Expand(binBounds[i]);
+					leftCount[i] = sweepCount;
+					leftArea[i] = sweep.GetSurfaceArea();
+				}
+
+				sweep = AABB();
+				sweepCount = 0;
+				for (uint32_t i = s_BinCount - 1; i > 0; --i)
+				{
+					sweepCount += binCounts[i];
+					sweep.Expand(binBounds[i]);
+
+					if (leftCount[i - 1] == 0 || sweepCount == 0)
+					{
+						continue;
+					}
+
+					float cost = leftArea[i - 1] * leftCount[i - 1] + sweep.GetSurfaceArea() * sweepCount;
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = i;
+					}
+				}
+			}
+
+			// every centroid in the same place, nothing to split on.
+			if (bestAxis < 0)
+			{
+				continue;
+			}
+
+			float leafCost = m_Nodes[current.m_Index].m_Bounds.GetSurfaceArea() * count;
+			if (bestCost >= leafCost && count <= s_MaxLeafItems * 4)
+			{
+				continue;
+			}
+
+			float axisMin = centroidBounds.m_Min[bestAxis];
+			float binScale = s_BinCount / (centroidBounds.m_Max[bestAxis] - axisMin);
+			auto middle = std::partition(m_ItemIndices.begin() + first, m_ItemIndices.begin() + first + count, [&](uint32_t itemIndex)
+			{
+				uint32_t bin = std::min(s_BinCount - 1, (uint32_t)((m_Items[itemIndex].m_Bounds.GetCenter()[bestAxis] - axisMin) * binScale));
+				return bin < bestSplit;
+			});
+
+			uint32_t leftCount = static_cast<uint32_t>(middle - m_ItemIndices.begin()) - first;
+			PL_ASSERT(leftCount > 0 && leftCount < count);
+
+			uint32_t leftIndex = static_cast<uint32_t>(m_Nodes.size());
+
+			Node left;
+			left.m_First = first;
+			left.m_Count = leftCount;
+			left.m_Parent = current.m_Index;
+
+			Node right;
+			right.m_First = first + leftCount;
+			right.m_Count = count - leftCount;
+			right.m_Parent = current.m_Index;
+
+			m_Nodes.push_back(left);
+			m_Nodes.push_back(right);
+
+			m_Nodes[current.m_Index].m_First = leftIndex;
+			m_Nodes[current.m_Index].m_Count = 0;
+
+			pending.push_back({ leftIndex, current.m_Depth + 1 });
+			pending.push_back({ leftIndex + 1, current.m_Depth + 1 });
+		}
+
+		for (uint32_t i = 0; i < m_Nodes.size(); ++i)
+		{
+			const Node& node = m_Nodes[i];
+			for (uint32_t j = node.m_First; node.IsLeaf() && j < node.m_First + node.m_Count; ++j)
+			{
+				m_Items[m_ItemIndices[j]].m_Leaf = i;
+			}
+		}
+	}
+
+	void BVH::UpdateLeaf(uint32_t nodeIndex)
+	{
+		Node& node = m_Nodes[nodeIndex];
+		node.m_Bounds = AABB();
+		node.m_TypeMask = 0;
+		for (uint32_t i = node.m_First; i < node.m_First + node.m_Count; ++i)
+		{
+			const Item& item = m_Items[m_ItemIndices[i]];
+			if (item.m_Alive)
+			{
+				node.m_Bounds.Expand(item.m_Bounds);
+				node.m_TypeMask |= item.m_TypeMask;
+			}
+		}
+	}
+
+	void BVH::Refit()
+	{
+		auto refitStart = std::chrono::steady_clock::now();
+
+		// collect every node above a moved item, children always come after their parent so refitting
+		// in descending order finishes each child before its parent reads it.
+		std::vector<uint32_t> nodes;
+		std::vector<bool> visited(m_Nodes.size(), false);
+		for (uint32_t itemIndex : m_DirtyItems)
+		{
+			const Item& item = m_Items[itemIndex];
+			for (uint32_t node = item.m_Alive ? item.m_Leaf : UINT32_MAX; node != UINT32_MAX && !visited[node]; node = m_Nodes[node].m_Parent)
+			{
+				visited[node] = true;
+				nodes.push_back(node);
+			}
+		}
+		m_DirtyItems.clear();
+
+		std::sort(nodes.begin(), nodes.end(), std::greater<uint32_t>());
+		for (uint32_t nodeIndex : nodes)
+		{
+			Node& node = m_Nodes[nodeIndex];
+			if (node.IsLeaf())
+			{
+				UpdateLeaf(nodeIndex);
+			}
+			else
+			{
+				const Node& left = m_Nodes[node.m_First];
+				const Node& right = m_Nodes[node.m_First + 1];
+				node.m_Bounds = left.m_Bounds;
+				node.m_Bounds.Expand(right.m_Bounds);
+				node.m_TypeMask = left.m_TypeMask | right.m_TypeMask;
+			}
+		}
+
+		m_Stats.m_Refits++;
+		m_Stats.m_RefitMs = MillisecondsSince(refitStart);
+	}
+
+	float BVH::ComputeCost() const
+	{
+		if (m_Nodes.empty())
+		{
+			return 0.f;
+		}
+
+		float cost = 0.f;
+		for (const Node& node : m_Nodes)
+		{
+			cost += node.m_Bounds.GetSurfaceArea() * (node.IsLeaf() ? node.m_Count : 1);
+		}
+
+		float rootArea = m_Nodes[0].m_Bounds.GetSurfaceArea();
+		return rootArea > 0.f ? cost / rootArea : cost;
+	}
+
+	void BVH::AppendSubtree(uint32_t nodeIndex, uint32_t typeMask, std::vector<void*>& outItems)
+	{
+		uint32_t stack[s_MaxDepth + 1];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = nodeIndex;
+
+		while (stackSize > 0)
+		{
+			const Node& node = m_Nodes[stack[--stackSize]];
+			if ((node.m_TypeMask & typeMask) == 0)
+			{
+				continue;
+			}
+
+			if (node.IsLeaf())
+			{
+				for (uint32_t i = node.m_First; i < node.m_First + node.m_Count; ++i)
+				{
+					const Item& item = m_Items[m_ItemIndices[i]];
+					if (item.m_Alive && (item.m_TypeMask & typeMask))
+					{
+						outItems.push_back(item.m_UserData);
+					}
+				}
+			}
+			else
+			{
+				stack[stackSize++] = node.m_First;
+				stack[stackSize++] = node.m_First + 1;
+			}
+		}
+	}
+
+	void BVH::RecordQuery(uint32_t nodesVisited, double ms)
+	{
+		// queries can come from several recording threads at once.
+		std::lock_guard<std::mutex> lock(m_StatsMutex);
+		m_Stats.m_Queries++;
+		m_Stats.m_NodesVisited += nodesVisited;
+		m_Stats.m_QueryMs += ms;
+	}
+
+	template <typename NodeTest, typename ItemTest>
+	void BVH::Query(uint32_t typeMask, bool includeUnbounded, std::vector<void*>& outItems, NodeTest nodeTest, ItemTest itemTest)
+	{
+		auto queryStart = std::chrono::steady_clock::now();
+
+		if (includeUnbounded)
+		{
+			for (uint32_t itemIndex : m_UnboundedItems)
+			{
+				if (m_Items[itemIndex].m_TypeMask & typeMask)
+				{
+					outItems.push_back(m_Items[itemIndex].m_UserData);
+				}
+			}
+		}
+
+		uint32_t visited = 0;
+		if (!m_Nodes.empty())
+		{
+			uint32_t stack[s_MaxDepth + 1];
+			uint32_t stackSize = 0;
+			stack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				uint32_t nodeIndex = stack[--stackSize];
+				const Node& node = m_Nodes[nodeIndex];
+				visited++;
+
+				if ((node.m_TypeMask & typeMask) == 0)
+				{
+					continue;
+				}
+
+				FrustumTest result = nodeTest(node.m_Bounds);
+				if (result == FrustumTest::Outside)
+				{
+					continue;
+				}
+
+				if (result == FrustumTest::Inside)
+				{
+					AppendSubtree(nodeIndex, typeMask, outItems);
+				}
+				else if (node.IsLeaf())
+				{
+					for (uint32_t i = node.m_First; i < node.m_First + node.m_Count; ++i)
+					{
+						const Item& item = m_Items[m_ItemIndices[i]];
+						if (item.m_Alive && (item.m_TypeMask & typeMask) && itemTest(item.m_Bounds))
+						{
+							outItems.push_back(item.m_UserData);
+						}
+					}
+				}
+				else
+				{
+					stack[stackSize++] = node.m_First;
+					stack[stackSize++] = node.m_First + 1;
+				}
+			}
+		}
+
+		RecordQuery(visited, MillisecondsSince(queryStart));
+	}
+
+	void BVH::QueryFrustum(const Frustum& frustum, uint32_t typeMask, std::vector<void*>& outItems)
+	{
+		Query(typeMask, true, outItems,
+			[&frustum](const AABB& bounds) { return frustum.Classify(bounds); },
+			[&frustum](const AABB& bounds) { return frustum.Intersects(bounds); });
+	}
+
+	void BVH::QueryAABB(const AABB& queryBounds, uint32_t typeMask, std::vector<void*>& outItems)
+	{
+		Query(typeMask, false, outItems,
+			[&queryBounds](const AABB& bounds) { return queryBounds.Overlaps(bounds) ? FrustumTest::Intersects : FrustumTest::Outside; },
+			[&queryBounds](const AABB& bounds) { return queryBounds.Overlaps(bounds); });
+	}
+
+	void BVH::QuerySphere(const BoundingSphere& sphere, uint32_t typeMask, std::vector<void*>& outItems)
+	{
+		Query(typeMask, false, outItems,
+			[&sphere](const AABB& bounds) { return sphere.Overlaps(bounds) ? FrustumTest::Intersects : FrustumTest::Outside; },
+			[&sphere](const AABB& bounds) { return sphere.Overlaps(bounds); });
+	}
+
+	bool BVH::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, uint32_t typeMask, BVHRayHit& outHit)
+	{
+		auto queryStart = std::chrono::steady_clock::now();
+
+		outHit = BVHRayHit();
+		outHit.m_Distance = maxDistance;
+
+		glm::vec3 inverseDirection = 1.f / direction;
+		uint32_t visited = 0;
+		bool hit = false;
+
+		if (!m_Nodes.empty())
+		{
+			uint32_t stack[s_MaxDepth + 1];
+			uint32_t stackSize = 0;
+			stack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const Node& node = m_Nodes[stack[--stackSize]];
+				visited++;
+
+				if ((node.m_TypeMask & typeMask) == 0 || RayAABB(origin, inverseDirection, outHit.m_Distance, node.m_Bounds) == FLT_MAX)
+				{
+					continue;
+				}
+
+				if (node.IsLeaf())
+				{
+					for (uint32_t i = node.m_First; i < node.m_First + node.m_Count; ++i)
+					{
+						const Item& item = m_Items[m_ItemIndices[i]];
+						if (!item.m_Alive || (item.m_TypeMask & typeMask) == 0)
+						{
+							continue;
+						}
+
+						float distance = RayAABB(origin, inverseDirection, outHit.m_Distance, item.m_Bounds);
+						if (distance < outHit.m_Distance || (!hit && distance != FLT_MAX))
+						{
+							outHit.m_Distance = distance;
+							outHit.m_UserData = item.m_UserData;
+							hit = true;
+						}
+					}
+				}
+				else
+				{
+					// visit the nearer child first so it can tighten the distance for the other one.
+					float leftDistance = RayAABB(origin, inverseDirection, outHit.m_Distance, m_Nodes[node.m_First].m_Bounds);
+					float rightDistance = RayAABB(origin, inverseDirection, outHit.m_Distance, m_Nodes[node.m_First + 1].m_Bounds);
+					bool leftFirst = leftDistance <= rightDistance;
+					stack[stackSize++] = leftFirst ? node.m_First + 1 : node.m_First;
+					stack[stackSize++] = leftFirst ? node.m_First : node.m_First + 1;
+				}
+			}
+		}
+
+		RecordQuery(visited, MillisecondsSince(queryStart));
+
+		return hit;
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "plumbus.h"
+#include "renderer/vk/Frustum.h"
+#include <mutex>
+
+namespace plumbus::vk
+{
+	enum BVHItemType : uint32_t
+	{
+		BVHItemType_Mesh = 1 << 0,
+		BVHItemType_Light = 1 << 1,
+		BVHItemType_All = 0xffffffff
+	};
+
+	struct BVHStats
+	{
+		uint32_t m_ItemCount = 0;
+		uint32_t m_NodeCount = 0;
+		uint32_t m_Builds = 0;
+		uint32_t m_Refits = 0;
+		double m_BuildMs = 0.0;
+		double m_RefitMs = 0.0;
+		// summed over every query since the last Update.
+		uint32_t m_Queries = 0;
+		uint32_t m_NodesVisited = 0;
+		double m_QueryMs = 0.0;
+	};
+
+	struct BVHRayHit
+	{
+		void* m_UserData = nullptr;
+		float m_Distance = FLT_MAX;
+	};
+
+	// dynamic bounding volume hierarchy over scene items. built top down with a binned SAH, moving items only refit
+	// the nodes above them, the tree is rebuilt when items are added/removed or refitting has let it get too loose.
+	// items without valid bounds are kept out of the tree and returned by every frustum query.
+	class BVH
+	{
+	public:
+		static constexpr uint32_t s_InvalidItem = UINT32_MAX;
+
+		uint32_t Insert(const AABB& bounds, void* userData, uint32_t typeMask);
+		void Remove(uint32_t item);
+		void SetBounds(uint32_t item, const AABB& bounds);
+		const AABB& GetBounds(uint32_t item) const { return m_Items[item].m_Bounds; }
+
+		// call once per frame after items have moved, rebuilds or refits as needed.
+		void Update();
+
+		void QueryFrustum(const Frustum& frustum, uint32_t typeMask, std::vector<void*>& outItems);
+		void QueryAABB(const AABB& bounds, uint32_t typeMask, std::vector<void*>& outItems);
+		void QuerySphere(const BoundingSphere& sphere, uint32_t typeMask, std::vector<void*>& outItems);
+		// closest item whose bounds the ray enters within maxDistance. direction should be normalised.
+		bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, uint32_t typeMask, BVHRayHit& outHit);
+
+		uint32_t GetItemCount(uint32_t typeMask) const;
+		const BVHStats& GetStats() const { return m_Stats; }
+
+	private:
+		struct Item
+		{
+			AABB m_Bounds;
+			void* m_UserData = nullptr;
+			uint32_t m_TypeMask = 0;
+			uint32_t m_Leaf = UINT32_MAX;
+			bool m_Alive = false;
+		};
+
+		// leaves own m_Count items starting at m_First in m_ItemIndices, interior nodes have their children at m_First and m_First + 1.
+		struct Node
+		{
+			AABB m_Bounds;
+			uint32_t m_First = 0;
+			uint32_t m_Count = 0;
+			uint32_t m_Parent = UINT32_MAX;
+			uint32_t m_TypeMask = 0;
+
+			bool IsLeaf() const { return m_Count > 0; }
+		};
+
+		static constexpr uint32_t s_MaxDepth = 64;
+		static constexpr uint32_t s_MaxLeafItems = 4;
+		static constexpr uint32_t s_BinCount = 12;
+
+		void Build();
+		void Refit();
+		void Subdivide();
+		void UpdateLeaf(uint32_t nodeIndex);
+		void AppendSubtree(uint32_t nodeIndex, uint32_t typeMask, std::vector<void*>& outItems);
+		float ComputeCost() const;
+
+		template <typename NodeTest, typename ItemTest>
+		void Query(uint32_t typeMask, bool includeUnbounded, std::vector<void*>& outItems, NodeTest nodeTest, ItemTest itemTest);
+		void RecordQuery(uint32_t nodesVisited, double ms);
+
+		std::vector<Item> m_Items;
+		std::vector<uint32_t> m_FreeItems;
+		std::vector<uint32_t> m_UnboundedItems;
+		std::vector<uint32_t> m_DirtyItems;
+
+		std::vector<Node> m_Nodes;
+		std::vector<uint32_t> m_ItemIndices;
+
+		std::array<uint32_t, 32> m_TypeCounts = {};
+		bool m_NeedsRebuild = false;
+		float m_BuildCost = 0.f;
+		BVHStats m_Stats;
+		std::mutex m_StatsMutex;
+	};
+}
@@ -5,21 +5,24 @@ namespace plumbus::vk
 {
 	VkResult Buffer::Map(VkDeviceSize size , VkDeviceSize offset)
 	{
-		return vkMapMemory(m_Device, m_Memory, offset, size, 0, &m_Mapped);
+		// host visible memory is persistently mapped by the allocator, so this just hands out a pointer into it.
+		if (!m_Allocation.m_Mapped)
+		{
+			return VK_ERROR_MEMORY_MAP_FAILED;
+		}
+
+		m_Mapped = static_cast<char*>(m_Allocation.m_Mapped) + offset;
+		return VK_SUCCESS;
 	}
 
 	void Buffer::Unmap()
 	{
-		if (m_Mapped)
-		{
-			vkUnmapMemory(m_Device, m_Memory);
-			m_Mapped = nullptr;
-		}
+		m_Mapped = nullptr;
 	}
 
 	VkResult Buffer::Bind(VkDeviceSize offset /*= 0*/)
 	{
-		return vkBindBufferMemory(m_Device, m_Buffer, m_Memory, offset);
+		return vkBindBufferMemory(m_Device, m_Buffer, m_Allocation.m_Memory, m_Allocation.m_Offset + offset);
 	}
 
 	void Buffer::SetupDescriptor(VkDeviceSize size /*= VK_WHOLE_SIZE*/, VkDeviceSize offset /*= 0*/)
@@ -37,22 +40,12 @@ namespace plumbus::vk
 
 	VkResult Buffer::Flush(VkDeviceSize size /*= VK_WHOLE_SIZE*/, VkDeviceSize offset /*= 0*/)
 	{
-		VkMappedMemoryRange mappedRange = {};
-		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = m_Memory;
-		mappedRange.offset = offset;
-		mappedRange.size = size;
-		return vkFlushMappedMemoryRanges(m_Device, 1, &mappedRange);
+		return m_Allocator->Flush(m_Allocation, size, offset);
 	}
 
 	VkResult Buffer::Invalidate(VkDeviceSize size /*= VK_WHOLE_SIZE*/, VkDeviceSize offset /*= 0*/)
 	{
-		VkMappedMemoryRange mappedRange = {};
-		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = m_Memory;
-		mappedRange.offset = offset;
-		mappedRange.size = size;
-		return vkInvalidateMappedMemoryRanges(m_Device, 1, &mappedRange);
+		return m_Allocator->Invalidate(m_Allocation, size, offset);
 	}
 
 	void Buffer::Cleanup()
@@ -62,11 +55,11 @@ namespace plumbus::vk
 			vkDestroyBuffer(m_Device, m_Buffer, nullptr);
 			m_Buffer = VK_NULL_HANDLE;
 		}
-		if (m_Memory != VK_NULL_HANDLE)
+		if (m_Allocation.IsValid())
 		{
-			vkFreeMemory(m_Device, m_Memory, nullptr);
-			m_Memory = VK_NULL_HANDLE;
+			m_Allocator->Free(m_Allocation);
 		}
+		m_Mapped = nullptr;
 	}
 
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "plumbus.h"
 #include "vulkan/vulkan.h"
 #include "Helpers.h"
+#include "MemoryAllocator.h"
 
 namespace plumbus::vk
 {
@@ -15,12 +16,13 @@ namespace plumbus::vk
 		void CopyTo(void* data, VkDeviceSize size);
 		VkResult Flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 		VkResult Invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
-		bool IsInitialised() { return m_Memory != VK_NULL_HANDLE; }
+		bool IsInitialised() { return m_Allocation.IsValid(); }
 		void Cleanup();
 
 		VkDevice m_Device;
 		VkBuffer m_Buffer = VK_NULL_HANDLE;
-		VkDeviceMemory m_Memory = VK_NULL_HANDLE;
+		MemoryAllocator* m_Allocator = nullptr;
+		MemoryAllocation m_Allocation;
 		VkDescriptorBufferInfo m_Descriptor;
 		VkDeviceSize m_Size = 0;
 		VkDeviceSize m_Alignment = 0;
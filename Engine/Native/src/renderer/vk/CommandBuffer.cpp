@@ -8,22 +8,41 @@
 
 namespace plumbus::vk
 {
-    CommandBufferRef CommandBuffer::CreateCommandBuffer()
+    BindStats& BindStats::operator+=(const BindStats& other)
     {
+        m_PipelineBinds += other.m_PipelineBinds;
+        m_PipelinesSkipped += other.m_PipelinesSkipped;
+        m_DescriptorSetBinds += other.m_DescriptorSetBinds;
+        m_DescriptorSetsSkipped += other.m_DescriptorSetsSkipped;
+        m_VertexBufferBinds += other.m_VertexBufferBinds;
+        m_VertexBuffersSkipped += other.m_VertexBuffersSkipped;
+        m_IndexBufferBinds += other.m_IndexBufferBinds;
+        m_IndexBuffersSkipped += other.m_IndexBuffersSkipped;
+        return *this;
+    }
+
+    CommandBufferRef CommandBuffer::CreateCommandBuffer(VkCommandPool commandPool, VkCommandBufferLevel level)
+    {
+        if (commandPool == VK_NULL_HANDLE)
+        {
+            commandPool = VulkanRenderer::Get()->GetDevice()->GetCommandPool();
+        }
+
         VkCommandBuffer vkCommandBuffer;
         VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
         commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        commandBufferAllocateInfo.commandPool = VulkanRenderer::Get()->GetDevice()->GetCommandPool();
-        commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        commandBufferAllocateInfo.commandPool = commandPool;
+        commandBufferAllocateInfo.level = level;
         commandBufferAllocateInfo.commandBufferCount = 1;
 
         CHECK_VK_RESULT(vkAllocateCommandBuffers(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), &commandBufferAllocateInfo, &vkCommandBuffer));
 
-        return std::make_shared<CommandBuffer>(vkCommandBuffer);
+        return std::make_shared<CommandBuffer>(vkCommandBuffer, commandPool);
     }
 
-	CommandBuffer::CommandBuffer(VkCommandBuffer cmdBuffer)
+	CommandBuffer::CommandBuffer(VkCommandBuffer cmdBuffer, VkCommandPool commandPool)
         : m_CommandBuffer(cmdBuffer)
+        , m_CommandPool(commandPool)
 	{
         
 	}
@@ -33,13 +52,45 @@ namespace plumbus::vk
 		Cleanup();
 	}
 
-	void CommandBuffer::BeginRecording() const
+	void CommandBuffer::ResetBoundState()
+	{
+		// bound state doesnt carry over between command buffers.
+		m_BoundMaterialInstance = nullptr;
+		m_BoundPipeline = VK_NULL_HANDLE;
+		m_BoundDescriptorSet = VK_NULL_HANDLE;
+		m_BoundVertexBuffer = VK_NULL_HANDLE;
+		m_BoundInstanceBuffer = VK_NULL_HANDLE;
+		m_BoundIndexBuffer = VK_NULL_HANDLE;
+		m_BindStats = BindStats();
+	}
+
+	void CommandBuffer::BeginRecording()
 	{
+		ResetBoundState();
+
 		VkCommandBufferBeginInfo cmdBufInfo{};
 		cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         CHECK_VK_RESULT(vkBeginCommandBuffer(m_CommandBuffer, &cmdBufInfo));
 	}
 
+	void CommandBuffer::BeginSecondaryRecording(const FrameBufferRef& frameBuffer)
+	{
+		ResetBoundState();
+		m_FrameBuffer = frameBuffer;
+
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = frameBuffer->GetRenderPass();
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = frameBuffer->GetVulkanFrameBuffer();
+
+		VkCommandBufferBeginInfo cmdBufInfo{};
+		cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		cmdBufInfo.pInheritanceInfo = &inheritanceInfo;
+		CHECK_VK_RESULT(vkBeginCommandBuffer(m_CommandBuffer, &cmdBufInfo));
+	}
+
 	void CommandBuffer::EndRecording() const
 	{
         CHECK_VK_RESULT(vkEndCommandBuffer(m_CommandBuffer));
@@ -50,7 +101,7 @@ namespace plumbus::vk
 		if (m_CommandBuffer != VK_NULL_HANDLE)
 		{
 			DeviceRef device = VulkanRenderer::Get()->GetDevice();
-			vkFreeCommandBuffers(device->GetVulkanDevice(), device->GetCommandPool(), 1, &m_CommandBuffer);
+			vkFreeCommandBuffers(device->GetVulkanDevice(), m_CommandPool, 1, &m_CommandBuffer);
 			m_CommandBuffer = VK_NULL_HANDLE;
 		}
 	}
@@ -75,33 +126,111 @@ namespace plumbus::vk
 		vkCmdSetScissor(m_CommandBuffer, 0, 1, &scissor);
 	}
 
-	void CommandBuffer::BindPipeline(const PipelineRef& pipeline) const
+	void CommandBuffer::SetViewport(const VkRect2D& area) const
+	{
+		VkViewport viewport{};
+		viewport.x = (float)area.offset.x;
+		viewport.y = (float)area.offset.y;
+		viewport.width = (float)area.extent.width;
+		viewport.height = (float)area.extent.height;
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		vkCmdSetViewport(m_CommandBuffer, 0, 1, &viewport);
+	}
+
+	void CommandBuffer::SetScissor(const VkRect2D& area) const
+	{
+		vkCmdSetScissor(m_CommandBuffer, 0, 1, &area);
+	}
+
+	void CommandBuffer::ClearDepth(const VkRect2D& area) const
+	{
+		VkClearAttachment clearAttachment{};
+		clearAttachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		clearAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+		VkClearRect clearRect{};
+		clearRect.rect = area;
+		clearRect.baseArrayLayer = 0;
+		clearRect.layerCount = 1;
+		vkCmdClearAttachments(m_CommandBuffer, 1, &clearAttachment, 1, &clearRect);
+	}
+
+	void CommandBuffer::BindPipeline(const PipelineRef& pipeline)
 	{
+		if (m_BoundPipeline == pipeline->GetVulkanPipeline())
+		{
+			m_BindStats.m_PipelinesSkipped++;
+			return;
+		}
+
 		vkCmdBindPipeline(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetVulkanPipeline());
+		m_BoundPipeline = pipeline->GetVulkanPipeline();
+		m_BindStats.m_PipelineBinds++;
 	}
 
-	void CommandBuffer::BindDescriptorSet(const PipelineLayoutRef& layout, const DescriptorSetRef& descriptorSet) const
+	void CommandBuffer::BindDescriptorSet(const PipelineLayoutRef& layout, const DescriptorSetRef& descriptorSet)
 	{
+		// a set only ever belongs to one material, so the same set means the same layout too.
+		if (m_BoundDescriptorSet == descriptorSet->GetVulkanDescriptorSet())
+		{
+			m_BindStats.m_DescriptorSetsSkipped++;
+			return;
+		}
+
 		vkCmdBindDescriptorSets(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout->GetVulkanPipelineLayout(), 0, 1, &descriptorSet->GetVulkanDescriptorSet(), 0, NULL);
+		m_BoundDescriptorSet = descriptorSet->GetVulkanDescriptorSet();
+		m_BindStats.m_DescriptorSetBinds++;
 	}
 
-	void CommandBuffer::BindVertexBuffer(const vk::Buffer& buffer) const
+	void CommandBuffer::BindVertexBuffer(const vk::Buffer& buffer)
 	{
+		if (m_BoundVertexBuffer == buffer.m_Buffer)
+		{
+			m_BindStats.m_VertexBuffersSkipped++;
+			return;
+		}
+
 		VkDeviceSize offsets[1] = { 0 };
 		vkCmdBindVertexBuffers(m_CommandBuffer, 0, 1, &buffer.m_Buffer, offsets);
+		m_BoundVertexBuffer = buffer.m_Buffer;
+		m_BindStats.m_VertexBufferBinds++;
+	}
+
+	void CommandBuffer::BindInstanceBuffer(const vk::Buffer& buffer)
+	{
+		if (m_BoundInstanceBuffer == buffer.m_Buffer)
+		{
+			m_BindStats.m_VertexBuffersSkipped++;
+			return;
+		}
+
+		VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindVertexBuffers(m_CommandBuffer, 1, 1, &buffer.m_Buffer, offsets);
+		m_BoundInstanceBuffer = buffer.m_Buffer;
+		m_BindStats.m_VertexBufferBinds++;
 	}
 
-	void CommandBuffer::BindIndexBuffer(const vk::Buffer& buffer) const
+	void CommandBuffer::BindIndexBuffer(const vk::Buffer& buffer, VkIndexType indexType)
 	{
-		vkCmdBindIndexBuffer(m_CommandBuffer, buffer.m_Buffer, 0, VK_INDEX_TYPE_UINT32);
+		if (m_BoundIndexBuffer == buffer.m_Buffer && m_BoundIndexType == indexType)
+		{
+			m_BindStats.m_IndexBuffersSkipped++;
+			return;
+		}
+
+		vkCmdBindIndexBuffer(m_CommandBuffer, buffer.m_Buffer, 0, indexType);
+		m_BoundIndexBuffer = buffer.m_Buffer;
+		m_BoundIndexType = indexType;
+		m_BindStats.m_IndexBufferBinds++;
 	}
 
-	void CommandBuffer::RecordDraw(const uint32_t indexCount) const
+	void CommandBuffer::RecordDraw(const uint32_t indexCount, const uint32_t instanceCount, const uint32_t firstInstance) const
 	{
-		vkCmdDrawIndexed(m_CommandBuffer, indexCount, 1, 0, 0, 0);
+		vkCmdDrawIndexed(m_CommandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
 	}
 
-	void CommandBuffer::BeginRenderPass() const
+	void CommandBuffer::BeginRenderPass(VkSubpassContents contents) const
 	{
 		std::vector<VkClearValue> clearValues;
 		clearValues.resize(m_FrameBuffer->GetAttachmentCount());
@@ -131,7 +260,23 @@ namespace plumbus::vk
 		renderPassBeginInfo.clearValueCount = (uint32_t)clearValues.size();
 		renderPassBeginInfo.pClearValues = clearValues.data();
 
-		vkCmdBeginRenderPass(m_CommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(m_CommandBuffer, &renderPassBeginInfo, contents);
+	}
+
+	void CommandBuffer::ExecuteCommands(const std::vector<CommandBufferRef>& commandBuffers) const
+	{
+		if (commandBuffers.empty())
+		{
+			return;
+		}
+
+		std::vector<VkCommandBuffer> vkCommandBuffers;
+		vkCommandBuffers.reserve(commandBuffers.size());
+		for (const CommandBufferRef& commandBuffer : commandBuffers)
+		{
+			vkCommandBuffers.push_back(commandBuffer->m_CommandBuffer);
+		}
+		vkCmdExecuteCommands(m_CommandBuffer, static_cast<uint32_t>(vkCommandBuffers.size()), vkCommandBuffers.data());
 	}
 
 	void CommandBuffer::EndRenderPass() const
@@ -6,35 +6,81 @@
 
 namespace plumbus::vk
 {
+    // binds recorded since the buffer began, a skipped bind would have set what was already bound.
+    struct BindStats
+    {
+        uint32_t m_PipelineBinds = 0;
+        uint32_t m_PipelinesSkipped = 0;
+        uint32_t m_DescriptorSetBinds = 0;
+        uint32_t m_DescriptorSetsSkipped = 0;
+        uint32_t m_VertexBufferBinds = 0;
+        uint32_t m_VertexBuffersSkipped = 0;
+        uint32_t m_IndexBufferBinds = 0;
+        uint32_t m_IndexBuffersSkipped = 0;
+
+        BindStats& operator+=(const BindStats& other);
+    };
+
     class CommandBuffer
     {
         public:
-            static CommandBufferRef CreateCommandBuffer();
+            // allocates from the device's pool unless one is given, secondaries are recorded inside another buffer's render pass.
+            static CommandBufferRef CreateCommandBuffer(VkCommandPool commandPool = VK_NULL_HANDLE, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
-            CommandBuffer(VkCommandBuffer cmdBuffer);
+            CommandBuffer(VkCommandBuffer cmdBuffer, VkCommandPool commandPool);
             ~CommandBuffer();
 
             VkCommandBuffer& GetVulkanCommandBuffer() { return m_CommandBuffer; }
 
-            void BeginRecording() const;
-            void BeginRenderPass() const;
+            void BeginRecording();
+            // for a secondary buffer that will be executed inside the frame buffer's render pass.
+            void BeginSecondaryRecording(const FrameBufferRef& frameBuffer);
+            void BeginRenderPass(VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE) const;
+            // the render pass has to have been begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+            void ExecuteCommands(const std::vector<CommandBufferRef>& commandBuffers) const;
             void EndRecording() const;
             void EndRenderPass() const;
-            void RecordDraw(const uint32_t indexCount) const;
+            // instances past the first read their per instance vertex data from firstInstance onwards.
+            void RecordDraw(const uint32_t indexCount, const uint32_t instanceCount = 1, const uint32_t firstInstance = 0) const;
             void Flush();
 
             void SetViewport(const float width, const float height, const float minDepth, const float maxDepth) const;
             void SetScissor(const uint32_t width, const uint32_t height, const int32_t minDepth, const int32_t maxDepth) const;
-            void BindPipeline(const PipelineRef& piepline) const;
-            void BindDescriptorSet(const PipelineLayoutRef& layout, const DescriptorSetRef& descriptorSet) const;
-            void BindVertexBuffer(const vk::Buffer& buffer) const;
-            void BindIndexBuffer(const vk::Buffer& buffer) const;
+            void SetViewport(const VkRect2D& area) const;
+            void SetScissor(const VkRect2D& area) const;
+            // clears the depth attachment of the current render pass, only inside the area.
+            void ClearDepth(const VkRect2D& area) const;
+            // binds are skipped when the same object is already bound in this buffer.
+            void BindPipeline(const PipelineRef& piepline);
+            void BindDescriptorSet(const PipelineLayoutRef& layout, const DescriptorSetRef& descriptorSet);
+            void BindVertexBuffer(const vk::Buffer& buffer);
+            // the per instance vertex stream, binding 1.
+            void BindInstanceBuffer(const vk::Buffer& buffer);
+            void BindIndexBuffer(const vk::Buffer& buffer, VkIndexType indexType = VK_INDEX_TYPE_UINT32);
 
             void SetFrameBuffer(FrameBufferRef frameBuffer) { m_FrameBuffer = frameBuffer; }
+            const FrameBufferRef& GetFrameBuffer() const { return m_FrameBuffer; }
+
+            // lets consecutive draws with the same material skip rebinding it.
+            const MaterialInstance* GetBoundMaterialInstance() const { return m_BoundMaterialInstance; }
+            void SetBoundMaterialInstance(const MaterialInstance* materialInstance) { m_BoundMaterialInstance = materialInstance; }
+
+            BindStats& GetBindStats() { return m_BindStats; }
 
             void Cleanup();
         private:
             VkCommandBuffer m_CommandBuffer = VK_NULL_HANDLE;
+            VkCommandPool m_CommandPool = VK_NULL_HANDLE;
             FrameBufferRef m_FrameBuffer;
+            void ResetBoundState();
+
+            const MaterialInstance* m_BoundMaterialInstance = nullptr;
+            VkPipeline m_BoundPipeline = VK_NULL_HANDLE;
+            VkDescriptorSet m_BoundDescriptorSet = VK_NULL_HANDLE;
+            VkBuffer m_BoundVertexBuffer = VK_NULL_HANDLE;
+            VkBuffer m_BoundInstanceBuffer = VK_NULL_HANDLE;
+            VkBuffer m_BoundIndexBuffer = VK_NULL_HANDLE;
+            VkIndexType m_BoundIndexType = VK_INDEX_TYPE_UINT32;
+            BindStats m_BindStats;
     };
 }
\ No newline at end of file
@@ -19,6 +19,11 @@ namespace plumbus::vk
             uniformPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
             uniformPoolSize.descriptorCount = numBuffers;
             poolSizes.push_back(uniformPoolSize);
+
+            VkDescriptorPoolSize storagePoolSize{};
+            storagePoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            storagePoolSize.descriptorCount = numBuffers;
+            poolSizes.push_back(storagePoolSize);
         }
 
         if (numSamplers > 0)
@@ -21,6 +21,7 @@ namespace plumbus::vk
 			switch (binding.m_Type)
 			{
 				case DescriptorBindingType::UniformBuffer:
+				case DescriptorBindingType::StorageBuffer:
 				{
 					BufferBindingValue* value = new BufferBindingValue(); 
 					value->buffer = nullptr;
@@ -132,6 +133,7 @@ namespace plumbus::vk
 					break;
 				}
 				case DescriptorBindingType::UniformBuffer:
+				case DescriptorBindingType::StorageBuffer:
 				{
 					const BufferBindingValue* bufferBinding = static_cast<const BufferBindingValue*>(m_BindingValues[binding.m_Name]);
 
@@ -142,7 +144,7 @@ namespace plumbus::vk
 						VkWriteDescriptorSet writeSet{};
 						writeSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 						writeSet.dstSet = m_DescriptorSet;
-						writeSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+						writeSet.descriptorType = binding.m_Type == DescriptorBindingType::StorageBuffer ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 						writeSet.dstBinding = binding.m_Location;
 						writeSet.pBufferInfo = &bufferInfo;
 						writeSet.descriptorCount = 1;
@@ -65,6 +65,17 @@ namespace plumbus::vk
 					layoutBindings.push_back(layoutBinding);
 					break;
 				}
+				case DescriptorBindingType::StorageBuffer:
+				{
+					VkDescriptorSetLayoutBinding layoutBinding{};
+					layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					layoutBinding.stageFlags = binding.m_Usage == DescriptorBindingUsage::VertexShader ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+					layoutBinding.binding = binding.m_Location;
+					layoutBinding.descriptorCount = binding.m_Count;
+
+					layoutBindings.push_back(layoutBinding);
+					break;
+				}
 				default:
 				{
 					PL_ASSERT(false, "Unhandled PendingDescriptorBindingType in plumbus::vk::DescriptorSet::Build");
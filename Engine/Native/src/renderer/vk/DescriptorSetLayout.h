@@ -13,7 +13,8 @@ namespace plumbus::vk
     enum class DescriptorBindingType
     {
         UniformBuffer,
-        ImageSampler
+        ImageSampler,
+        StorageBuffer
     };
 
     struct DescriptorBinding
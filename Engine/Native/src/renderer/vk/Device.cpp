@@ -4,6 +4,8 @@
 #include "Buffer.h"
 #include "VulkanRenderer.h"
 #include "Instance.h"
+#include "MemoryAllocator.h"
+#include "SamplerCache.h"
 
 namespace plumbus::vk
 {
@@ -26,25 +28,45 @@ namespace plumbus::vk
 	{
 		if (m_Device)
 		{
+			m_MemoryAllocator->LogStats();
+			m_MemoryAllocator.reset();
+			m_SamplerCache.reset();
 			vkDestroyDevice(m_Device, nullptr);
 		}
 	}
 
-	uint32_t Device::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	VkSemaphore Device::CreateTimelineSemaphore(uint64_t initialValue)
 	{
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memProperties);
-		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-		{
-			if ((typeFilter & (1 << i))
-				&& (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-			{
-				return i;
-			}
-		}
+		PL_ASSERT(m_TimelineSemaphoreSupported);
+
+		VkSemaphoreTypeCreateInfoKHR typeCreateInfo = {};
+		typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		typeCreateInfo.initialValue = initialValue;
 
-		Log::Fatal("failed to find suitable memory type!");
-		return -1;
+		VkSemaphoreCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		createInfo.pNext = &typeCreateInfo;
+
+		VkSemaphore semaphore;
+		CHECK_VK_RESULT(vkCreateSemaphore(m_Device, &createInfo, nullptr, &semaphore));
+		return semaphore;
+	}
+
+	void Device::WaitForTimelineValue(VkSemaphore semaphore, uint64_t value)
+	{
+		VkSemaphoreWaitInfoKHR waitInfo = {};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &value;
+		CHECK_VK_RESULT(m_WaitSemaphores(m_Device, &waitInfo, std::numeric_limits<uint64_t>::max()));
+	}
+
+	uint32_t Device::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		// memory properties are cached by the allocator, no need to query the physical device every time.
+		return m_MemoryAllocator->FindMemoryType(typeFilter, properties);
 	}
 
 	Device::QueueFamilyIndices Device::FindQueueFamilies(VkPhysicalDevice device)
@@ -127,8 +149,28 @@ namespace plumbus::vk
 		deviceFeatures.textureCompressionBC = VK_TRUE;
 #endif
 
+		//needs the properties2 instance extension on a 1.0 instance, the feature itself is mandatory for the extension.
+		VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures = {};
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+		timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+		m_TimelineSemaphoreSupported = VulkanRenderer::Get()->GetInstance()->IsExtensionEnabled(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) &&
+									   IsDeviceExtensionAvailable(m_PhysicalDevice, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		if (m_TimelineSemaphoreSupported)
+		{
+			deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		}
+		Log::Info("\tTimeline semaphores %s", m_TimelineSemaphoreSupported ? "enabled" : "not supported");
+
+		void* features = nullptr;
+		if (m_TimelineSemaphoreSupported)
+		{
+			timelineSemaphoreFeatures.pNext = features;
+			features = &timelineSemaphoreFeatures;
+		}
+
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = features;
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 		createInfo.pEnabledFeatures = &deviceFeatures;
@@ -149,7 +191,15 @@ namespace plumbus::vk
 
 		CHECK_VK_RESULT(vkCreateDevice(m_PhysicalDevice, &createInfo, nullptr, &m_Device));
 
+		if (m_TimelineSemaphoreSupported)
+		{
+			m_WaitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(m_Device, "vkWaitSemaphoresKHR"));
+			m_TimelineSemaphoreSupported = m_WaitSemaphores != nullptr;
+		}
+
 		m_CommandPool = CreateCommandPool();
+		m_MemoryAllocator = MemoryAllocator::CreateMemoryAllocator(m_PhysicalDevice, m_Device);
+		m_SamplerCache = SamplerCache::CreateSamplerCache(m_Device);
 
 		//i now have a logical device and a graphics queue  with vulkan wrappers (m_Device) (m_GraphicsQueue) that let me control them
 	}
@@ -157,6 +207,7 @@ namespace plumbus::vk
 	VkResult Device::CreateBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, vk::Buffer *buffer, VkDeviceSize size, void *data /*= nullptr*/)
 	{
 		buffer->m_Device = m_Device;
+		buffer->m_Allocator = m_MemoryAllocator.get();
 
 		// Create the buffer handle
 		VkBufferCreateInfo bufferCreateInfo{};
@@ -166,15 +217,11 @@ namespace plumbus::vk
 		if (vkCreateBuffer(m_Device, &bufferCreateInfo, nullptr, &buffer->m_Buffer) != VK_SUCCESS)
 			Log::Fatal("Failed to create buffer");
 
-		// Create the memory backing up the buffer handle
+		// Sub allocate the memory backing up the buffer handle, staging buffers are short lived so bump allocate them.
+		AllocationStrategy strategy = usageFlags == VK_BUFFER_USAGE_TRANSFER_SRC_BIT ? AllocationStrategy::Linear : AllocationStrategy::FreeList;
 		VkMemoryRequirements memReqs;
-		VkMemoryAllocateInfo memAllocInfo{};
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		vkGetBufferMemoryRequirements(m_Device, buffer->m_Buffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		// Find a memory type index that fits the properties of the buffer
-		memAllocInfo.memoryTypeIndex = FindMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
-		if (vkAllocateMemory(m_Device, &memAllocInfo, nullptr, &buffer->m_Memory) != VK_SUCCESS)
+		if (!m_MemoryAllocator->Allocate(memReqs, memoryPropertyFlags, AllocationResourceType::Linear, strategy, buffer->m_Allocation))
 			Log::Fatal("Failed to allocate buffer memory");
 
 		buffer->m_Alignment = memReqs.alignment;
@@ -182,13 +229,15 @@ namespace plumbus::vk
 		buffer->m_UsageFlags = usageFlags;
 		buffer->m_MemoryPropertyFlags = memoryPropertyFlags;
 
-		// If a pointer to the buffer data has been passed, map the buffer and copy over the data
+		// If a pointer to the buffer data has been passed, copy it into the persistently mapped memory
 		if (data != nullptr)
 		{
 			if (buffer->Map() != VK_SUCCESS)
 				Log::Fatal("failed to map buffer");
 
 			memcpy(buffer->m_Mapped, data, size);
+			// If host coherency hasn't been requested, do a manual flush to make writes visible
+			buffer->Flush();
 			buffer->Unmap();
 		}
 
@@ -199,63 +248,14 @@ namespace plumbus::vk
 		return buffer->Bind();
 	}
 
-	VkResult Device::CreateBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer *buffer, VkDeviceMemory *memory, void *data /*= nullptr*/)
-	{
-		// Create the buffer handle
-		VkBufferCreateInfo bufferCreateInfo{};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.usage = usageFlags;
-		bufferCreateInfo.size = size;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		if (vkCreateBuffer(m_Device, &bufferCreateInfo, nullptr, buffer) != VK_SUCCESS)
-			Log::Fatal("Failed to create buffer");
-
-		// Create the memory backing up the buffer handle
-		VkMemoryRequirements memReqs;
-		VkMemoryAllocateInfo memAllocInfo{};
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		vkGetBufferMemoryRequirements(m_Device, *buffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		// Find a memory type index that fits the properties of the buffer
-		memAllocInfo.memoryTypeIndex = FindMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
-		if (vkAllocateMemory(m_Device, &memAllocInfo, nullptr, memory) != VK_SUCCESS)
-			Log::Fatal("Failed to allocate buffer memory");
-
-		// If a pointer to the buffer data has been passed, map the buffer and copy over the data
-		if (data != nullptr)
-		{
-			void *mapped;
-			if (vkMapMemory(m_Device, *memory, 0, size, 0, &mapped) != VK_SUCCESS)
-				Log::Fatal("Failed to map buffer data");
-			memcpy(mapped, data, size);
-			// If host coherency hasn't been requested, do a manual flush to make writes visible
-			if ((memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
-			{
-				VkMappedMemoryRange mappedMemoryRange{};
-				mappedMemoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-				mappedMemoryRange.memory = *memory;
-				mappedMemoryRange.offset = 0;
-				mappedMemoryRange.size = size;
-				vkFlushMappedMemoryRanges(m_Device, 1, &mappedMemoryRange);
-			}
-			vkUnmapMemory(m_Device, *memory);
-		}
-
-		// Attach the memory to the buffer object
-		if (vkBindBufferMemory(m_Device, *buffer, *memory, 0) != VK_SUCCESS)
-			Log::Fatal("failed to bind buffer memory");
-
-		return VK_SUCCESS;
-	}
-
-	VkCommandPool Device::CreateCommandPool()
+	VkCommandPool Device::CreateCommandPool(VkCommandPoolCreateFlags flags)
 	{
 		QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(m_PhysicalDevice);
 
 		VkCommandPoolCreateInfo poolInfo = {};
 		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 		poolInfo.queueFamilyIndex = queueFamilyIndices.m_GraphicsFamily;
-		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // Optional
+		poolInfo.flags = flags;
 
 		VkCommandPool commandPool;
 
@@ -406,6 +406,25 @@ namespace plumbus::vk
 		return requiredExtensions.empty();
 	}
 
+	bool Device::IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* extension)
+	{
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		for (const VkExtensionProperties& prop : availableExtensions)
+		{
+			if (strcmp(prop.extensionName, extension) == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	Device::SwapChainSupportDetails Device::QuerySwapChainSupport(VkPhysicalDevice device)
 	{
 		VulkanRenderer* renderer = VulkanRenderer::Get();
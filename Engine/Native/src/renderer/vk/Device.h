@@ -36,15 +36,21 @@ namespace plumbus::vk
 		VkCommandPool GetCommandPool() { return m_CommandPool; }
 		VkQueue GetGraphicsQueue() { return m_GraphicsQueue; }
 		VkQueue GetPresentQueue() { return m_PresentQueue; }
+		MemoryAllocatorRef GetMemoryAllocator() { return m_MemoryAllocator; }
+		const SamplerCacheRef& GetSamplerCache() { return m_SamplerCache; }
+		//VK_KHR_timeline_semaphore is optional, frames are paced with fences without it.
+		bool IsTimelineSemaphoreSupported() const { return m_TimelineSemaphoreSupported; }
+		VkSemaphore CreateTimelineSemaphore(uint64_t initialValue);
+		//blocks until the semaphore's counter reaches value.
+		void WaitForTimelineValue(VkSemaphore semaphore, uint64_t value);
 
 		void CreateLogicalDevice(std::vector<const char*> deviceExtensions, const std::vector<const char*> validationLayers, bool enableValidationLayers);
 		uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 		QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device);
-		VkResult CreateBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer *buffer, VkDeviceMemory *memory, void *data = nullptr);
 		VkResult CreateBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, vk::Buffer *buffer, VkDeviceSize size, void *data = nullptr);
 		VkCommandBuffer CreateCommandBuffer(bool begin = true);
 		void FlushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue);
-		VkCommandPool CreateCommandPool();
+		VkCommandPool CreateCommandPool(VkCommandPoolCreateFlags flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 		SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
 
 	private:
@@ -52,6 +58,7 @@ namespace plumbus::vk
 		void PickPhysicalDevice();
 		bool IsDeviceSuitable(VkPhysicalDevice device);
 		bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+		bool IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* extension);
 
 		VkPhysicalDevice m_PhysicalDevice;
 		VkDevice m_Device;
@@ -60,5 +67,9 @@ namespace plumbus::vk
 		VkCommandPool m_CommandPool;
 		VkQueue m_GraphicsQueue;
 		VkQueue m_PresentQueue;
+		MemoryAllocatorRef m_MemoryAllocator;
+		SamplerCacheRef m_SamplerCache;
+		bool m_TimelineSemaphoreSupported = false;
+		PFN_vkWaitSemaphoresKHR m_WaitSemaphores = nullptr;
 	};
 }
\ No newline at end of file
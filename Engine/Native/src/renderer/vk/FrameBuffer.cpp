@@ -3,6 +3,7 @@
 #include "Helpers.h"
 #include "BaseApplication.h"
 #include "Device.h"
+#include "SamplerCache.h"
 #include "renderer/vk/VulkanRenderer.h"
 
 namespace plumbus::vk
@@ -35,18 +36,12 @@ namespace plumbus::vk
 					attachment.m_Image = VK_NULL_HANDLE;
 				}
 
-				if (attachment.m_Memory != VK_NULL_HANDLE)
+				if (attachment.m_Allocation.IsValid())
 				{
-					vkFreeMemory(device, attachment.m_Memory, nullptr);
-					attachment.m_Memory = VK_NULL_HANDLE;
+					VulkanRenderer::Get()->GetDevice()->GetMemoryAllocator()->Free(attachment.m_Allocation);
 				}
 			}
 
-			if (m_ColourSampler != VK_NULL_HANDLE)
-			{
-				vkDestroySampler(device, m_ColourSampler, nullptr);
-			}
-
 			vkDestroyRenderPass(device, m_RenderPass, nullptr);
 		}
 
@@ -93,16 +88,8 @@ namespace plumbus::vk
 
 		std::shared_ptr<vk::Device> device = VulkanRenderer::Get()->GetDevice();
 
-		VkMemoryAllocateInfo memAlloc{};
-		memAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		VkMemoryRequirements memReqs;
-
 		CHECK_VK_RESULT(vkCreateImage(device->GetVulkanDevice(), &image, nullptr, &attachment.m_Image));
-		vkGetImageMemoryRequirements(device->GetVulkanDevice(), attachment.m_Image, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-		memAlloc.memoryTypeIndex = device->FindMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		CHECK_VK_RESULT(vkAllocateMemory(device->GetVulkanDevice(), &memAlloc, nullptr, &attachment.m_Memory));
-		CHECK_VK_RESULT(vkBindImageMemory(device->GetVulkanDevice(), attachment.m_Image, attachment.m_Memory, 0));
+		CHECK_VK_RESULT(device->GetMemoryAllocator()->AllocateImageMemory(attachment.m_Image, image.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, attachment.m_Allocation));
 
 		VkImageViewCreateInfo imageView{};
 		imageView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -130,9 +117,10 @@ namespace plumbus::vk
         m_Attachments.emplace_back(std::make_pair(id, attachment));
 	}
 
-	plumbus::vk::FrameBufferRef FrameBuffer::CreateFrameBuffer(uint32_t width, uint32_t height, VkRenderPass renderPass, std::vector<VkImageView> attachments, std::vector<VkFormat> attachmentFormats)
+	plumbus::vk::FrameBufferRef FrameBuffer::CreateFrameBuffer(uint32_t width, uint32_t height, VkRenderPass renderPass, std::vector<VkImageView> attachments, std::vector<VkFormat> attachmentFormats, std::vector<std::string> attachmentNames)
 	{
 		PL_ASSERT(attachments.size() == attachmentFormats.size());
+		PL_ASSERT(attachmentNames.empty() || attachmentNames.size() == attachments.size());
 
 		VkFramebufferCreateInfo frameBufferCreateInfo = {};
 		frameBufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -151,7 +139,7 @@ namespace plumbus::vk
 		fb->SetVulkanFrameBuffer(frameBufferObj);
 		for (int i = 0; i < attachments.size(); ++i)
 		{
-			fb->AddAttachment(attachments[i], attachmentFormats[i], std::to_string(i));
+			fb->AddAttachment(attachments[i], attachmentFormats[i], attachmentNames.empty() ? std::to_string(i) : attachmentNames[i]);
 		}
 
 		return fb;
@@ -281,9 +269,7 @@ namespace plumbus::vk
 		samplerCreateInfo.maxLod = 1.0f;
 		samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
 
-		VkSampler sampler;
-		CHECK_VK_RESULT(vkCreateSampler(device->GetVulkanDevice(), &samplerCreateInfo, nullptr, &sampler));
-		fb->SetSampler(sampler);
+		fb->SetSampler(device->GetSamplerCache()->GetSampler(samplerCreateInfo));
 
 		return fb;
 	}
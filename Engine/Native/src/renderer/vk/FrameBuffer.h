@@ -1,6 +1,7 @@
 #pragma once
 #include "plumbus.h"
 #include "vulkan/vulkan.h"
+#include "MemoryAllocator.h"
 
 namespace plumbus::vk
 {
@@ -40,7 +41,7 @@ namespace plumbus::vk
 		struct FrameBufferAttachment
 		{
 			VkImage m_Image;
-			VkDeviceMemory m_Memory;
+			MemoryAllocation m_Allocation;
 			VkImageView m_ImageView;
 			VkFormat m_Format;
 
@@ -56,7 +57,8 @@ namespace plumbus::vk
 		};
 
 		static FrameBufferRef CreateFrameBuffer(uint32_t width, uint32_t height, std::vector<FrameBufferAttachmentInfo> attachments);
-		static FrameBufferRef CreateFrameBuffer(uint32_t width, uint32_t height, VkRenderPass renderPass, std::vector<VkImageView> attachments, std::vector<VkFormat> attachmentFormats);
+		// wraps views and a render pass owned by someone else. attachments are named by index unless names are given.
+		static FrameBufferRef CreateFrameBuffer(uint32_t width, uint32_t height, VkRenderPass renderPass, std::vector<VkImageView> attachments, std::vector<VkFormat> attachmentFormats, std::vector<std::string> attachmentNames = {});
 
 		FrameBuffer(int32_t width, int32_t height, bool ownsResources);
 		~FrameBuffer();
@@ -84,7 +86,7 @@ namespace plumbus::vk
 		VkFramebuffer m_FrameBuffer;
 		std::vector<std::pair<std::string, FrameBufferAttachment>> m_Attachments;
 		VkRenderPass m_RenderPass;
-		VkSampler m_ColourSampler = VK_NULL_HANDLE;
+		VkSampler m_ColourSampler = VK_NULL_HANDLE; // from the device SamplerCache, not destroyed here.
 
 		bool m_OwnsResources;
 	};
@@ -0,0 +1,304 @@
+#include "plumbus.h"
+#include "Frustum.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PL_FRUSTUM_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PL_FRUSTUM_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace plumbus::vk
+{
+	float AABB::GetSurfaceArea() const
+	{
+		if (!IsValid())
+		{
+			return 0.f;
+		}
+
+		glm::vec3 size = m_Max - m_Min;
+		return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool AABB::Overlaps(const AABB& other) const
+	{
+		return m_Min.x <= other.m_Max.x && m_Max.x >= other.m_Min.x &&
+			   m_Min.y <= other.m_Max.y && m_Max.y >= other.m_Min.y &&
+			   m_Min.z <= other.m_Max.z && m_Max.z >= other.m_Min.z;
+	}
+
+	void AABB::Expand(const glm::vec3& point)
+	{
+		m_Min = glm::min(m_Min, point);
+		m_Max = glm::max(m_Max, point);
+	}
+
+	void AABB::Expand(const AABB& other)
+	{
+		m_Min = glm::min(m_Min, other.m_Min);
+		m_Max = glm::max(m_Max, other.m_Max);
+	}
+
+	AABB AABB::Transform(const glm::mat4& matrix) const
+	{
+		// transform the centre, then project the extents onto each world axis.
+		glm::vec3 center = glm::vec3(matrix * glm::vec4(GetCenter(), 1.f));
+		glm::vec3 extents = GetExtents();
+		glm::vec3 worldExtents = glm::abs(glm::vec3(matrix[0])) * extents.x +
+								 glm::abs(glm::vec3(matrix[1])) * extents.y +
+								 glm::abs(glm::vec3(matrix[2])) * extents.z;
+
+		AABB result;
+		result.m_Min = center - worldExtents;
+		result.m_Max = center + worldExtents;
+		return result;
+	}
+
+	BoundingSphere BoundingSphere::FromAABB(const AABB& aabb)
+	{
+		BoundingSphere sphere;
+		sphere.m_Center = aabb.GetCenter();
+		sphere.m_Radius = glm::length(aabb.GetExtents());
+		return sphere;
+	}
+
+	BoundingSphere BoundingSphere::Transform(const glm::mat4& matrix) const
+	{
+		float maxScale = std::max(glm::length(glm::vec3(matrix[0])), std::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
+
+		BoundingSphere sphere;
+		sphere.m_Center = glm::vec3(matrix * glm::vec4(m_Center, 1.f));
+		sphere.m_Radius = m_Radius * maxScale;
+		return sphere;
+	}
+
+	bool BoundingSphere::Overlaps(const AABB& aabb) const
+	{
+		glm::vec3 closest = glm::clamp(m_Center, aabb.m_Min, aabb.m_Max);
+		glm::vec3 delta = closest - m_Center;
+		return glm::dot(delta, delta) <= m_Radius * m_Radius;
+	}
+
+	void Frustum::Extract(const glm::mat4& viewProjection)
+	{
+		auto row = [&viewProjection](int i) { return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]); };
+
+		glm::vec4 planes[6] =
+		{
+			row(3) + row(0), // left
+			row(3) - row(0), // right
+			row(3) + row(1), // bottom
+			row(3) - row(1), // top
+			row(2),          // near, depth is zero to one
+			row(3) - row(2)  // far
+		};
+
+		for (int i = 0; i < 8; ++i)
+		{
+			glm::vec4 plane = planes[std::min(i, 5)];
+			plane /= glm::length(glm::vec3(plane));
+
+			m_PlaneX[i] = plane.x;
+			m_PlaneY[i] = plane.y;
+			m_PlaneZ[i] = plane.z;
+			m_PlaneW[i] = plane.w;
+		}
+	}
+
+	bool Frustum::Intersects(const AABB& aabb) const
+	{
+		// outside if the box is entirely behind any plane: dot(n, c) + dot(|n|, e) + w < 0.
+		glm::vec3 c = aabb.GetCenter();
+		glm::vec3 e = aabb.GetExtents();
+
+#if PL_FRUSTUM_SSE
+		const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+		const __m128 ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+		for (int i = 0; i < 8; i += 4)
+		{
+			__m128 nx = _mm_load_ps(&m_PlaneX[i]);
+			__m128 ny = _mm_load_ps(&m_PlaneY[i]);
+			__m128 nz = _mm_load_ps(&m_PlaneZ[i]);
+			__m128 nw = _mm_load_ps(&m_PlaneW[i]);
+
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), nw));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, absMask), ex), _mm_mul_ps(_mm_and_ps(ny, absMask), ey)), _mm_mul_ps(_mm_and_ps(nz, absMask), ez));
+
+			if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps())) != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+#elif PL_FRUSTUM_NEON
+		const float32x4_t cx = vdupq_n_f32(c.x), cy = vdupq_n_f32(c.y), cz = vdupq_n_f32(c.z);
+		const float32x4_t ex = vdupq_n_f32(e.x), ey = vdupq_n_f32(e.y), ez = vdupq_n_f32(e.z);
+
+		for (int i = 0; i < 8; i += 4)
+		{
+			float32x4_t nx = vld1q_f32(&m_PlaneX[i]);
+			float32x4_t ny = vld1q_f32(&m_PlaneY[i]);
+			float32x4_t nz = vld1q_f32(&m_PlaneZ[i]);
+			float32x4_t nw = vld1q_f32(&m_PlaneW[i]);
+
+			float32x4_t distance = vmlaq_f32(vmlaq_f32(vmlaq_f32(nw, nx, cx), ny, cy), nz, cz);
+			float32x4_t radius = vmlaq_f32(vmlaq_f32(vmulq_f32(vabsq_f32(nx), ex), vabsq_f32(ny), ey), vabsq_f32(nz), ez);
+
+			uint32x4_t outside = vcltq_f32(vaddq_f32(distance, radius), vdupq_n_f32(0.f));
+			uint32x2_t folded = vorr_u32(vget_low_u32(outside), vget_high_u32(outside));
+			if ((vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+#else
+		for (int i = 0; i < 6; ++i)
+		{
+			float distance = m_PlaneX[i] * c.x + m_PlaneY[i] * c.y + m_PlaneZ[i] * c.z + m_PlaneW[i];
+			float radius = fabsf(m_PlaneX[i]) * e.x + fabsf(m_PlaneY[i]) * e.y + fabsf(m_PlaneZ[i]) * e.z;
+			if (distance + radius < 0.f)
+			{
+				return false;
+			}
+		}
+
+		return true;
+#endif
+	}
+
+	bool Frustum::Intersects(const BoundingSphere& sphere) const
+	{
+		const glm::vec3& c = sphere.m_Center;
+
+#if PL_FRUSTUM_SSE
+		const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+		const __m128 negRadius = _mm_set1_ps(-sphere.m_Radius);
+
+		for (int i = 0; i < 8; i += 4)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(&m_PlaneX[i]), cx), _mm_mul_ps(_mm_load_ps(&m_PlaneY[i]), cy)),
+										 _mm_add_ps(_mm_mul_ps(_mm_load_ps(&m_PlaneZ[i]), cz), _mm_load_ps(&m_PlaneW[i])));
+
+			if (_mm_movemask_ps(_mm_cmplt_ps(distance, negRadius)) != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+#elif PL_FRUSTUM_NEON
+		const float32x4_t cx = vdupq_n_f32(c.x), cy = vdupq_n_f32(c.y), cz = vdupq_n_f32(c.z);
+		const float32x4_t negRadius = vdupq_n_f32(-sphere.m_Radius);
+
+		for (int i = 0; i < 8; i += 4)
+		{
+			float32x4_t distance = vmlaq_f32(vmlaq_f32(vmlaq_f32(vld1q_f32(&m_PlaneW[i]), vld1q_f32(&m_PlaneX[i]), cx), vld1q_f32(&m_PlaneY[i]), cy), vld1q_f32(&m_PlaneZ[i]), cz);
+
+			uint32x4_t outside = vcltq_f32(distance, negRadius);
+			uint32x2_t folded = vorr_u32(vget_low_u32(outside), vget_high_u32(outside));
+			if ((vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+#else
+		for (int i = 0; i < 6; ++i)
+		{
+			if (m_PlaneX[i] * c.x + m_PlaneY[i] * c.y + m_PlaneZ[i] * c.z + m_PlaneW[i] < -sphere.m_Radius)
+			{
+				return false;
+			}
+		}
+
+		return true;
+#endif
+	}
+
+	FrustumTest Frustum::Classify(const AABB& aabb) const
+	{
+		// outside if behind any plane, inside if in front of all of them: dot(n, c) - dot(|n|, e) + w >= 0.
+		glm::vec3 c = aabb.GetCenter();
+		glm::vec3 e = aabb.GetExtents();
+		bool inside = true;
+
+#if PL_FRUSTUM_SSE
+		const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+		const __m128 ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+		for (int i = 0; i < 8; i += 4)
+		{
+			__m128 nx = _mm_load_ps(&m_PlaneX[i]);
+			__m128 ny = _mm_load_ps(&m_PlaneY[i]);
+			__m128 nz = _mm_load_ps(&m_PlaneZ[i]);
+			__m128 nw = _mm_load_ps(&m_PlaneW[i]);
+
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), nw));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, absMask), ex), _mm_mul_ps(_mm_and_ps(ny, absMask), ey)), _mm_mul_ps(_mm_and_ps(nz, absMask), ez));
+
+			if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps())) != 0)
+			{
+				return FrustumTest::Outside;
+			}
+			if (_mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), _mm_setzero_ps())) != 0)
+			{
+				inside = false;
+			}
+		}
+#elif PL_FRUSTUM_NEON
+		const float32x4_t cx = vdupq_n_f32(c.x), cy = vdupq_n_f32(c.y), cz = vdupq_n_f32(c.z);
+		const float32x4_t ex = vdupq_n_f32(e.x), ey = vdupq_n_f32(e.y), ez = vdupq_n_f32(e.z);
+		const float32x4_t zero = vdupq_n_f32(0.f);
+
+		for (int i = 0; i < 8; i += 4)
+		{
+			float32x4_t nx = vld1q_f32(&m_PlaneX[i]);
+			float32x4_t ny = vld1q_f32(&m_PlaneY[i]);
+			float32x4_t nz = vld1q_f32(&m_PlaneZ[i]);
+			float32x4_t nw = vld1q_f32(&m_PlaneW[i]);
+
+			float32x4_t distance = vmlaq_f32(vmlaq_f32(vmlaq_f32(nw, nx, cx), ny, cy), nz, cz);
+			float32x4_t radius = vmlaq_f32(vmlaq_f32(vmulq_f32(vabsq_f32(nx), ex), vabsq_f32(ny), ey), vabsq_f32(nz), ez);
+
+			uint32x4_t outside = vcltq_f32(vaddq_f32(distance, radius), zero);
+			uint32x2_t foldedOutside = vorr_u32(vget_low_u32(outside), vget_high_u32(outside));
+			if ((vget_lane_u32(foldedOutside, 0) | vget_lane_u32(foldedOutside, 1)) != 0)
+			{
+				return FrustumTest::Outside;
+			}
+
+			uint32x4_t straddling = vcltq_f32(vsubq_f32(distance, radius), zero);
+			uint32x2_t foldedStraddling = vorr_u32(vget_low_u32(straddling), vget_high_u32(straddling));
+			if ((vget_lane_u32(foldedStraddling, 0) | vget_lane_u32(foldedStraddling, 1)) != 0)
+			{
+				inside = false;
+			}
+		}
+#else
+		for (int i = 0; i < 6; ++i)
+		{
+			float distance = m_PlaneX[i] * c.x + m_PlaneY[i] * c.y + m_PlaneZ[i] * c.z + m_PlaneW[i];
+			float radius = fabsf(m_PlaneX[i]) * e.x + fabsf(m_PlaneY[i]) * e.y + fabsf(m_PlaneZ[i]) * e.z;
+			if (distance + radius < 0.f)
+			{
+				return FrustumTest::Outside;
+			}
+			if (distance - radius < 0.f)
+			{
+				inside = false;
+			}
+		}
+#endif
+
+		return inside ? FrustumTest::Inside : FrustumTest::Intersects;
+	}
+}
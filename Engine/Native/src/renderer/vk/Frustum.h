@@ -0,0 +1,69 @@
+#pragma once
+#include "plumbus.h"
+
+namespace plumbus::vk
+{
+	struct AABB
+	{
+		glm::vec3 m_Min = glm::vec3(FLT_MAX);
+		glm::vec3 m_Max = glm::vec3(-FLT_MAX);
+
+		bool IsValid() const { return m_Min.x <= m_Max.x && m_Min.y <= m_Max.y && m_Min.z <= m_Max.z; }
+		glm::vec3 GetCenter() const { return (m_Min + m_Max) * 0.5f; }
+		glm::vec3 GetExtents() const { return (m_Max - m_Min) * 0.5f; }
+
+		float GetSurfaceArea() const;
+		bool Overlaps(const AABB& other) const;
+
+		void Expand(const glm::vec3& point);
+		void Expand(const AABB& other);
+		AABB Transform(const glm::mat4& matrix) const;
+	};
+
+	struct BoundingSphere
+	{
+		glm::vec3 m_Center = glm::vec3(0.f);
+		float m_Radius = 0.f;
+
+		static BoundingSphere FromAABB(const AABB& aabb);
+		BoundingSphere Transform(const glm::mat4& matrix) const;
+		bool Overlaps(const AABB& aabb) const;
+	};
+
+	enum class FrustumTest
+	{
+		Outside,
+		Intersects,
+		Inside
+	};
+
+	struct CullingStats
+	{
+		uint32_t m_Visible = 0;
+		uint32_t m_Culled = 0;
+	};
+
+	// six planes pulled out of a view projection matrix (zero to one depth), stored as struct of arrays so each
+	// test checks four planes per instruction. padded to eight by repeating the last plane.
+	class Frustum
+	{
+	public:
+		Frustum() = default;
+		explicit Frustum(const glm::mat4& viewProjection) { Extract(viewProjection); }
+
+		void Extract(const glm::mat4& viewProjection);
+
+		bool Intersects(const AABB& aabb) const;
+		bool Intersects(const BoundingSphere& sphere) const;
+		// sphere first as an early out, then the tighter box.
+		bool Intersects(const AABB& aabb, const BoundingSphere& sphere) const { return Intersects(sphere) && Intersects(aabb); }
+		// also tells apart boxes that are fully inside, so hierarchy queries can accept a whole subtree at once.
+		FrustumTest Classify(const AABB& aabb) const;
+
+	private:
+		alignas(16) float m_PlaneX[8];
+		alignas(16) float m_PlaneY[8];
+		alignas(16) float m_PlaneZ[8];
+		alignas(16) float m_PlaneW[8];
+	};
+}
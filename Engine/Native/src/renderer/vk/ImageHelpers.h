@@ -2,13 +2,14 @@
 #include "BaseApplication.h"
 #include "Helpers.h"
 #include "renderer/vk/VulkanRenderer.h"
+#include "renderer/vk/MemoryAllocator.h"
 
 namespace plumbus
 {
 	class ImageHelpers
 	{
 	public:
-		static void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, bool isCubeMap)
+		static void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, vk::MemoryAllocation& imageAllocation, bool isCubeMap)
 		{
 			vk::VulkanRenderer* renderer = vk::VulkanRenderer::Get();
 
@@ -33,23 +34,14 @@ namespace plumbus
 				Log::Fatal("failed to create image!");
 			}
 
-			VkMemoryRequirements memRequirements;
-			vkGetImageMemoryRequirements(renderer->GetDevice()->GetVulkanDevice(), image, &memRequirements);
-
-			VkMemoryAllocateInfo allocInfo = {};
-			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			allocInfo.allocationSize = memRequirements.size;
-			allocInfo.memoryTypeIndex = renderer->GetDevice()->FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-			if (vkAllocateMemory(renderer->GetDevice()->GetVulkanDevice(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+			if (renderer->GetDevice()->GetMemoryAllocator()->AllocateImageMemory(image, tiling, properties, imageAllocation) != VK_SUCCESS)
 			{
 				Log::Fatal("failed to allocate image memory!");
 			}
-
-			vkBindImageMemory(renderer->GetDevice()->GetVulkanDevice(), image, imageMemory, 0);
 		}
 
-		static VkImageView CreateImageView(VkImage image, VkFormat format, VkImageViewType viewType, VkImageAspectFlags aspectFlags)
+		//a layerCount of 0 covers the whole cube for cube views and a single layer otherwise.
+		static VkImageView CreateImageView(VkImage image, VkFormat format, VkImageViewType viewType, VkImageAspectFlags aspectFlags, uint32_t baseArrayLayer = 0, uint32_t layerCount = 0)
 		{
 			VkImageViewCreateInfo createInfo = {};
 			createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -65,8 +57,8 @@ namespace plumbus
 			createInfo.subresourceRange.aspectMask = aspectFlags;
 			createInfo.subresourceRange.baseMipLevel = 0;
 			createInfo.subresourceRange.levelCount = 1;
-			createInfo.subresourceRange.baseArrayLayer = 0;
-			createInfo.subresourceRange.layerCount = viewType == VK_IMAGE_VIEW_TYPE_CUBE ? 6 : 1;
+			createInfo.subresourceRange.baseArrayLayer = baseArrayLayer;
+			createInfo.subresourceRange.layerCount = layerCount != 0 ? layerCount : viewType == VK_IMAGE_VIEW_TYPE_CUBE ? 6 : 1;
 
 			VkImageView imageView;
 			if (vkCreateImageView(vk::VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), &createInfo, nullptr, &imageView) != VK_SUCCESS)
@@ -40,10 +40,30 @@ namespace plumbus::vk
 		createInfo.ppEnabledLayerNames = enabledLayers.data();
 
 		CHECK_VK_RESULT(vkCreateInstance(&createInfo, nullptr, &instance->m_VulkanInstance));
+		instance->m_EnabledExtensions.insert(enabledExtensions.begin(), enabledExtensions.end());
 
 		return instance;
 	}
 
+	bool Instance::IsExtensionAvailable(const char* extension)
+	{
+		uint32_t extensionCount;
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+		for (const VkExtensionProperties& prop : availableExtensions)
+		{
+			if (strcmp(prop.extensionName, extension) == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	bool Instance::CheckLayerSupport(const std::vector<const char*>& enabledLayers)
 	{
 		uint32_t layerCount;
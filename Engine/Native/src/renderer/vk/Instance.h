@@ -12,10 +12,14 @@ namespace plumbus::vk
 		VkInstance GetVulkanInstance() { return m_VulkanInstance; }
 		void Destroy();
 
+		static bool IsExtensionAvailable(const char* extension);
+		bool IsExtensionEnabled(const char* extension) const { return m_EnabledExtensions.count(extension) > 0; }
+
 	private:
 
 		static bool CheckLayerSupport(const std::vector<const char*>& enabledLayers);
 
 		VkInstance m_VulkanInstance;
+		std::set<std::string> m_EnabledExtensions;
 	};
 }
\ No newline at end of file
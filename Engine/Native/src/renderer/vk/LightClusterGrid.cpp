@@ -0,0 +1,276 @@
+#include "plumbus.h"
+#include "LightClusterGrid.h"
+#include "JobSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PL_CLUSTERS_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PL_CLUSTERS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace plumbus::vk
+{
+	// lights transformed / binned per job, small enough to spread a few hundred lights across the workers.
+	constexpr uint32_t s_LightGrainSize = 128;
+
+	void LightClusterGrid::Build(const glm::mat4& view, const glm::mat4& projection, const std::vector<glm::vec4>& lights)
+	{
+		auto buildStart = std::chrono::steady_clock::now();
+
+		// pull the clip planes back out of the (zero to one) projection so scripts can swap the camera projection freely.
+		m_Near = projection[3][2] / projection[2][2];
+		m_Far = projection[3][2] / (projection[2][2] + 1.f);
+
+		float logDepthRange = std::log(m_Far / m_Near);
+		m_Info.m_View = view;
+		m_Info.m_GridSize = glm::uvec4(s_TilesX, s_TilesY, s_DepthSlices, m_HeatMapEnabled ? 1 : 0);
+		m_Info.m_DepthParams = glm::vec4(s_DepthSlices / logDepthRange, -(s_DepthSlices * std::log(m_Near)) / logDepthRange, m_Near, m_Far);
+
+		uint32_t lightCount = static_cast<uint32_t>(lights.size());
+		m_ViewX.resize(lightCount);
+		m_ViewY.resize(lightCount);
+		m_Depth.resize(lightCount);
+		m_Radius.resize(lightCount);
+		m_MinSlice.resize(lightCount);
+		m_MaxSlice.resize(lightCount);
+
+		JobSystem::Get()->ParallelFor(lightCount, s_LightGrainSize, [this, &view, &lights](uint32_t begin, uint32_t end)
+		{
+			TransformLights(view, lights, begin, end);
+		});
+
+		JobSystem::Get()->ParallelFor(s_DepthSlices, 1, [this, &projection](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t slice = begin; slice < end; ++slice)
+			{
+				BinSlice(slice, projection);
+			}
+		});
+
+		// every slice knows its own size now, lay them out back to back.
+		uint32_t sliceOffsets[s_DepthSlices];
+		uint32_t indexCount = 0;
+		for (uint32_t slice = 0; slice < s_DepthSlices; ++slice)
+		{
+			sliceOffsets[slice] = indexCount;
+			indexCount += static_cast<uint32_t>(m_Slices[slice].m_Indices.size());
+		}
+
+		m_Clusters.resize(s_ClusterCount);
+		m_LightIndices.resize(indexCount);
+		JobSystem::Get()->ParallelFor(s_DepthSlices, 1, [this, &sliceOffsets](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t slice = begin; slice < end; ++slice)
+			{
+				const Slice& sliceData = m_Slices[slice];
+				uint32_t offset = sliceOffsets[slice];
+				LightCluster* clusters = &m_Clusters[slice * s_TilesX * s_TilesY];
+				for (uint32_t tile = 0; tile < s_TilesX * s_TilesY; ++tile)
+				{
+					clusters[tile].m_Offset = offset;
+					clusters[tile].m_Count = sliceData.m_Counts[tile];
+					offset += sliceData.m_Counts[tile];
+				}
+
+				if (!sliceData.m_Indices.empty())
+				{
+					memcpy(&m_LightIndices[sliceOffsets[slice]], sliceData.m_Indices.data(), sliceData.m_Indices.size() * sizeof(uint32_t));
+				}
+			}
+		});
+
+		m_Stats = LightClusterStats();
+		m_Stats.m_LightCount = lightCount;
+		m_Stats.m_IndexCount = indexCount;
+		for (uint32_t i = 0; i < lightCount; ++i)
+		{
+			if (m_MinSlice[i] <= m_MaxSlice[i])
+			{
+				m_Stats.m_VisibleLights++;
+			}
+		}
+		for (const LightCluster& cluster : m_Clusters)
+		{
+			m_Stats.m_MaxLightsPerCluster = std::max(m_Stats.m_MaxLightsPerCluster, cluster.m_Count);
+		}
+		m_Stats.m_BuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+	}
+
+	void LightClusterGrid::TransformLights(const glm::mat4& view, const std::vector<glm::vec4>& lights, uint32_t begin, uint32_t end)
+	{
+		// only the translation and the first three rows of the rotation matter, the view matrix never scales.
+		uint32_t i = begin;
+#if PL_CLUSTERS_SSE
+		__m128 m00 = _mm_set1_ps(view[0][0]), m10 = _mm_set1_ps(view[1][0]), m20 = _mm_set1_ps(view[2][0]), m30 = _mm_set1_ps(view[3][0]);
+		__m128 m01 = _mm_set1_ps(view[0][1]), m11 = _mm_set1_ps(view[1][1]), m21 = _mm_set1_ps(view[2][1]), m31 = _mm_set1_ps(view[3][1]);
+		__m128 m02 = _mm_set1_ps(view[0][2]), m12 = _mm_set1_ps(view[1][2]), m22 = _mm_set1_ps(view[2][2]), m32 = _mm_set1_ps(view[3][2]);
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&lights[i].x);
+			__m128 y = _mm_loadu_ps(&lights[i + 1].x);
+			__m128 z = _mm_loadu_ps(&lights[i + 2].x);
+			__m128 r = _mm_loadu_ps(&lights[i + 3].x);
+			_MM_TRANSPOSE4_PS(x, y, z, r);
+
+			__m128 viewX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m10, y)), _mm_add_ps(_mm_mul_ps(m20, z), m30));
+			__m128 viewY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, x), _mm_mul_ps(m11, y)), _mm_add_ps(_mm_mul_ps(m21, z), m31));
+			__m128 viewZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, x), _mm_mul_ps(m12, y)), _mm_add_ps(_mm_mul_ps(m22, z), m32));
+
+			_mm_storeu_ps(&m_ViewX[i], viewX);
+			_mm_storeu_ps(&m_ViewY[i], viewY);
+			_mm_storeu_ps(&m_Depth[i], _mm_sub_ps(_mm_setzero_ps(), viewZ));
+			_mm_storeu_ps(&m_Radius[i], r);
+		}
+#elif PL_CLUSTERS_NEON
+		for (; i + 4 <= end; i += 4)
+		{
+			float32x4x4_t light = vld4q_f32(&lights[i].x);
+
+			float32x4_t viewX = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(view[3][0]), light.val[0], view[0][0]), light.val[1], view[1][0]), light.val[2], view[2][0]);
+			float32x4_t viewY = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(view[3][1]), light.val[0], view[0][1]), light.val[1], view[1][1]), light.val[2], view[2][1]);
+			float32x4_t viewZ = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(view[3][2]), light.val[0], view[0][2]), light.val[1], view[1][2]), light.val[2], view[2][2]);
+
+			vst1q_f32(&m_ViewX[i], viewX);
+			vst1q_f32(&m_ViewY[i], viewY);
+			vst1q_f32(&m_Depth[i], vnegq_f32(viewZ));
+			vst1q_f32(&m_Radius[i], light.val[3]);
+		}
+#endif
+		for (; i < end; ++i)
+		{
+			glm::vec4 viewPos = view * glm::vec4(glm::vec3(lights[i]), 1.f);
+			m_ViewX[i] = viewPos.x;
+			m_ViewY[i] = viewPos.y;
+			m_Depth[i] = -viewPos.z;
+			m_Radius[i] = lights[i].w;
+		}
+
+		for (i = begin; i < end; ++i)
+		{
+			float minDepth = m_Depth[i] - m_Radius[i];
+			float maxDepth = m_Depth[i] + m_Radius[i];
+			if (maxDepth < m_Near || minDepth > m_Far || m_Radius[i] <= 0.f)
+			{
+				// empty range, skipped by every slice.
+				m_MinSlice[i] = 1;
+				m_MaxSlice[i] = 0;
+				continue;
+			}
+
+			m_MinSlice[i] = static_cast<uint16_t>(GetSlice(minDepth));
+			m_MaxSlice[i] = static_cast<uint16_t>(GetSlice(maxDepth));
+		}
+	}
+
+	void LightClusterGrid::BinSlice(uint32_t slice, const glm::mat4& projection)
+	{
+		Slice& sliceData = m_Slices[slice];
+		sliceData.m_Rects.clear();
+		sliceData.m_Counts.assign(s_TilesX * s_TilesY, 0);
+
+		float sliceNear = GetSliceDepth(slice);
+		float sliceFar = GetSliceDepth(slice + 1);
+
+		uint32_t lightCount = static_cast<uint32_t>(m_Depth.size());
+		for (uint32_t light = 0; light < lightCount; ++light)
+		{
+			if (slice < m_MinSlice[light] || slice > m_MaxSlice[light])
+			{
+				continue;
+			}
+
+			TileRect rect;
+			float minDepth = std::max(sliceNear, m_Depth[light] - m_Radius[light]);
+			float maxDepth = std::min(sliceFar, m_Depth[light] + m_Radius[light]);
+			if (!ComputeTileRect(projection, light, minDepth, maxDepth, rect))
+			{
+				continue;
+			}
+
+			sliceData.m_Rects.push_back(rect);
+			for (uint32_t y = rect.m_MinY; y <= rect.m_MaxY; ++y)
+			{
+				for (uint32_t x = rect.m_MinX; x <= rect.m_MaxX; ++x)
+				{
+					sliceData.m_Counts[y * s_TilesX + x]++;
+				}
+			}
+		}
+
+		// counting sort, turn counts into write cursors then scatter the light indices into place.
+		uint32_t cursors[s_TilesX * s_TilesY];
+		uint32_t total = 0;
+		for (uint32_t tile = 0; tile < s_TilesX * s_TilesY; ++tile)
+		{
+			cursors[tile] = total;
+			total += sliceData.m_Counts[tile];
+		}
+
+		sliceData.m_Indices.resize(total);
+		for (const TileRect& rect : sliceData.m_Rects)
+		{
+			for (uint32_t y = rect.m_MinY; y <= rect.m_MaxY; ++y)
+			{
+				for (uint32_t x = rect.m_MinX; x <= rect.m_MaxX; ++x)
+				{
+					sliceData.m_Indices[cursors[y * s_TilesX + x]++] = rect.m_Light;
+				}
+			}
+		}
+	}
+
+	bool LightClusterGrid::ComputeTileRect(const glm::mat4& projection, uint32_t light, float minDepth, float maxDepth, TileRect& outRect) const
+	{
+		// project the corners of the sphere's view space box clipped to this slice, the box is entirely in front of the
+		// near plane so its outline on screen is bounded by the projected corners.
+		glm::vec2 minUV(FLT_MAX);
+		glm::vec2 maxUV(-FLT_MAX);
+		float radius = m_Radius[light];
+		for (uint32_t corner = 0; corner < 8; ++corner)
+		{
+			glm::vec4 viewPos(m_ViewX[light] + ((corner & 1) ? radius : -radius),
+							  m_ViewY[light] + ((corner & 2) ? radius : -radius),
+							  -((corner & 4) ? maxDepth : minDepth),
+							  1.f);
+			glm::vec4 clip = projection * viewPos;
+			glm::vec2 uv = glm::vec2(clip) / clip.w * 0.5f + 0.5f;
+			minUV = glm::min(minUV, uv);
+			maxUV = glm::max(maxUV, uv);
+		}
+
+		if (maxUV.x < 0.f || maxUV.y < 0.f || minUV.x > 1.f || minUV.y > 1.f)
+		{
+			return false;
+		}
+
+		glm::vec2 tiles((float)s_TilesX, (float)s_TilesY);
+		glm::ivec2 minTile = glm::clamp(glm::ivec2(glm::floor(minUV * tiles)), glm::ivec2(0), glm::ivec2(s_TilesX - 1, s_TilesY - 1));
+		glm::ivec2 maxTile = glm::clamp(glm::ivec2(glm::floor(maxUV * tiles)), glm::ivec2(0), glm::ivec2(s_TilesX - 1, s_TilesY - 1));
+
+		outRect.m_Light = light;
+		outRect.m_MinX = static_cast<uint8_t>(minTile.x);
+		outRect.m_MaxX = static_cast<uint8_t>(maxTile.x);
+		outRect.m_MinY = static_cast<uint8_t>(minTile.y);
+		outRect.m_MaxY = static_cast<uint8_t>(maxTile.y);
+		return true;
+	}
+
+	uint32_t LightClusterGrid::GetSlice(float depth) const
+	{
+		// same mapping as deferred.frag.
+		float slice = std::log(std::max(depth, m_Near)) * m_Info.m_DepthParams.x + m_Info.m_DepthParams.y;
+		return std::min(static_cast<uint32_t>(std::max(slice, 0.f)), s_DepthSlices - 1);
+	}
+
+	float LightClusterGrid::GetSliceDepth(uint32_t slice) const
+	{
+		// the last slice soaks up everything past the far plane, the shader clamps the same way.
+		if (slice >= s_DepthSlices)
+		{
+			return FLT_MAX;
+		}
+		return m_Near * std::pow(m_Far / m_Near, slice / (float)s_DepthSlices);
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "plumbus.h"
+
+namespace plumbus::vk
+{
+	// matches ClusterInfo in deferred.frag (std140).
+	struct LightClusterInfo
+	{
+		glm::mat4 m_View;
+		glm::uvec4 m_GridSize;   // tiles x, tiles y, depth slices, w = heat map enabled.
+		glm::vec4 m_DepthParams; // slice = log(depth) * x + y, z = near, w = far.
+	};
+
+	// matches the per cluster entries in the LightClusters storage buffer.
+	struct LightCluster
+	{
+		uint32_t m_Offset;
+		uint32_t m_Count;
+	};
+
+	struct LightClusterStats
+	{
+		uint32_t m_LightCount = 0;
+		uint32_t m_VisibleLights = 0;
+		uint32_t m_IndexCount = 0;
+		uint32_t m_MaxLightsPerCluster = 0;
+		double m_BuildMs = 0.0;
+	};
+
+	// bins point lights into a view space froxel grid, screen tiles in x/y and exponential depth slices in z. each cluster
+	// stores a range into a shared light index list so the lighting pass only evaluates the lights that can reach it.
+	class LightClusterGrid
+	{
+	public:
+		static constexpr uint32_t s_TilesX = 16;
+		static constexpr uint32_t s_TilesY = 9;
+		static constexpr uint32_t s_DepthSlices = 24;
+		static constexpr uint32_t s_ClusterCount = s_TilesX * s_TilesY * s_DepthSlices;
+
+		// lights are world space spheres, xyz = position, w = radius.
+		void Build(const glm::mat4& view, const glm::mat4& projection, const std::vector<glm::vec4>& lights);
+
+		const LightClusterInfo& GetInfo() const { return m_Info; }
+		const std::vector<LightCluster>& GetClusters() const { return m_Clusters; }
+		const std::vector<uint32_t>& GetLightIndices() const { return m_LightIndices; }
+		const LightClusterStats& GetStats() const { return m_Stats; }
+
+		void SetHeatMapEnabled(bool enabled) { m_HeatMapEnabled = enabled; }
+		bool IsHeatMapEnabled() const { return m_HeatMapEnabled; }
+
+	private:
+		struct TileRect
+		{
+			uint32_t m_Light;
+			uint8_t m_MinX, m_MaxX, m_MinY, m_MaxY;
+		};
+
+		// per slice scratch, slices are binned in parallel so each gets its own.
+		struct Slice
+		{
+			std::vector<TileRect> m_Rects;
+			std::vector<uint32_t> m_Counts;
+			std::vector<uint32_t> m_Indices;
+		};
+
+		void TransformLights(const glm::mat4& view, const std::vector<glm::vec4>& lights, uint32_t begin, uint32_t end);
+		void BinSlice(uint32_t slice, const glm::mat4& projection);
+		bool ComputeTileRect(const glm::mat4& projection, uint32_t light, float minDepth, float maxDepth, TileRect& outRect) const;
+		uint32_t GetSlice(float depth) const;
+		float GetSliceDepth(uint32_t slice) const;
+
+		LightClusterInfo m_Info;
+		float m_Near = 0.1f;
+		float m_Far = 256.f;
+		bool m_HeatMapEnabled = false;
+
+		// view space light spheres, struct of arrays so they can be transformed four at a time.
+		std::vector<float> m_ViewX;
+		std::vector<float> m_ViewY;
+		std::vector<float> m_Depth;
+		std::vector<float> m_Radius;
+		std::vector<uint16_t> m_MinSlice;
+		std::vector<uint16_t> m_MaxSlice;
+
+		std::array<Slice, s_DepthSlices> m_Slices;
+		std::vector<LightCluster> m_Clusters;
+		std::vector<uint32_t> m_LightIndices;
+		LightClusterStats m_Stats;
+	};
+}
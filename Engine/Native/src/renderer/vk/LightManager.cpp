@@ -0,0 +1,148 @@
+#include "plumbus.h"
+#include "renderer/vk/LightManager.h"
+#include "components/LightComponent.h"
+#include "components/TranslationComponent.h"
+#include "GameObject.h"
+
+namespace plumbus::vk
+{
+	LightManager* LightManager::s_Instance = nullptr;
+
+	LightManager* LightManager::Get()
+	{
+		if (s_Instance == nullptr)
+			s_Instance = new LightManager();
+		return s_Instance;
+	}
+
+	void LightManager::Destroy()
+	{
+		if (s_Instance)
+		{
+			delete s_Instance;
+			s_Instance = nullptr;
+		}
+	}
+
+	void LightManager::SetFrameCount(uint32_t frameCount)
+	{
+		m_PointLights.SetFrameCount(frameCount);
+		m_DirectionalLights.SetFrameCount(frameCount);
+	}
+
+	void LightManager::RegisterLight(Light* light)
+	{
+		PL_ASSERT(light->GetSlot() == Light::s_InvalidSlot);
+
+		if (light->GetType() == LightType::Point)
+		{
+			light->SetSlot(m_PointLights.Add(light));
+			m_PointLightSpheres.emplace_back();
+		}
+		else if (light->GetType() == LightType::Directional)
+		{
+			light->SetSlot(m_DirectionalLights.Add(light));
+		}
+
+		MarkDirty(light);
+	}
+
+	void LightManager::UnregisterLight(Light* light)
+	{
+		uint32_t slot = light->GetSlot();
+		if (slot == Light::s_InvalidSlot)
+		{
+			return;
+		}
+
+		if (light->IsDirty())
+		{
+			m_DirtyLights.erase(std::remove(m_DirtyLights.begin(), m_DirtyLights.end(), light), m_DirtyLights.end());
+			light->SetDirty(false);
+		}
+
+		Light* moved = nullptr;
+		if (light->GetType() == LightType::Point)
+		{
+			moved = m_PointLights.Remove(slot);
+			m_PointLightSpheres[slot] = m_PointLightSpheres.back();
+			m_PointLightSpheres.pop_back();
+		}
+		else if (light->GetType() == LightType::Directional)
+		{
+			moved = m_DirectionalLights.Remove(slot);
+		}
+
+		if (moved)
+		{
+			moved->SetSlot(slot);
+		}
+		light->SetSlot(Light::s_InvalidSlot);
+	}
+
+	void LightManager::MarkDirty(Light* light)
+	{
+		if (light->IsDirty() || light->GetSlot() == Light::s_InvalidSlot)
+		{
+			return;
+		}
+
+		light->SetDirty(true);
+		m_DirtyLights.push_back(light);
+	}
+
+	void LightManager::Update()
+	{
+		m_Stats = LightUploadStats();
+		m_Stats.m_RefreshedLights = static_cast<uint32_t>(m_DirtyLights.size());
+
+		for (Light* light : m_DirtyLights)
+		{
+			RefreshLight(light);
+			light->SetDirty(false);
+		}
+
+		m_DirtyLights.clear();
+	}
+
+	static int32_t GetShadowTile(Light* light)
+	{
+		ShadowRef shadow = light->GetShadow();
+		return shadow && shadow->GetFirstTile() != Shadow::s_InvalidTile ? static_cast<int32_t>(shadow->GetFirstTile()) : -1;
+	}
+
+	void LightManager::RefreshLight(Light* light)
+	{
+		uint32_t slot = light->GetSlot();
+		if (light->GetType() == LightType::Point)
+		{
+			PointLight* pointLight = static_cast<PointLight*>(light);
+
+			glm::vec3 position = glm::vec3(0.f);
+			GameObject* owner = light->GetParent()->GetOwner();
+			if (components::TranslationComponent* translationComp = owner ? owner->GetComponent<components::TranslationComponent>() : nullptr)
+			{
+				position = translationComp->GetTranslation();
+			}
+
+			PointLightBufferInfo& info = m_PointLights[slot];
+			info.m_Position = glm::vec4(position, 0.f);
+			info.m_Colour = glm::vec4(pointLight->GetColour(), 1.0f);
+			info.m_Radius = pointLight->GetRadius();
+			info.m_ShadowTile = GetShadowTile(light);
+			m_PointLightSpheres[slot] = glm::vec4(position, pointLight->GetRadius());
+			m_PointLights.MarkDirty(slot);
+		}
+		else if (light->GetType() == LightType::Directional)
+		{
+			DirectionalLight* directionalLight = static_cast<DirectionalLight*>(light);
+
+			DirectionalLightBufferInfo& info = m_DirectionalLights[slot];
+			info.m_Direction = glm::vec4(directionalLight->GetDirection(), 1);
+			info.m_Colour = glm::vec4(directionalLight->GetColour(), 1);
+			info.m_ShadowTile = GetShadowTile(light);
+			info.m_ShadowTileCount = info.m_ShadowTile >= 0 ? static_cast<int32_t>(light->GetShadow()->GetTileCount()) : 0;
+			m_DirectionalLights.MarkDirty(slot);
+		}
+	}
+}
@@ -0,0 +1,211 @@
+#pragma once
+#include "plumbus.h"
+#include "renderer/vk/Buffer.h"
+
+namespace plumbus
+{
+	class Light;
+}
+
+namespace plumbus::vk
+{
+	// std430 layouts of PointLight and DirectionalLight in deferred.frag.
+	struct PointLightBufferInfo
+	{
+		glm::vec4 m_Position;
+		glm::vec4 m_Colour;
+		float m_Radius;
+		int32_t m_ShadowTile; // first of the six cube face tiles in the shadow atlas, -1 if the light has no shadow.
+		glm::vec2 dummyValue; // pads to the 16 byte struct alignment.
+	};
+
+	struct DirectionalLightBufferInfo
+	{
+		glm::vec4 m_Direction;
+		glm::vec4 m_Colour;
+		int32_t m_ShadowTile; // first cascade's tile, -1 if the light has no shadow.
+		int32_t m_ShadowTileCount;
+		int32_t dummyValue[2];
+	};
+
+	struct LightUploadStats
+	{
+		uint32_t m_RefreshedLights = 0;
+		uint32_t m_Ranges = 0;
+		VkDeviceSize m_UploadedBytes = 0;
+	};
+
+	// densely packed gpu data for one type of light, each light owns a slot until it is removed. every frame in flight
+	// has its own copy of the buffer, so a changed slot stays dirty until each of them has uploaded it.
+	template <typename T>
+	class LightArray
+	{
+	public:
+		uint32_t Add(Light* light);
+		// swap removes the slot, returns the light that was moved into it or nullptr.
+		Light* Remove(uint32_t slot);
+
+		void SetFrameCount(uint32_t frameCount);
+		void MarkDirty(uint32_t slot);
+		void MarkAllDirty(uint32_t frame);
+
+		// copies the frame's dirty slots into its mapped buffer, merging neighbouring slots into a single flushed range.
+		void Upload(uint32_t frame, Buffer& buffer, LightUploadStats& stats);
+
+		T& operator[](uint32_t slot) { return m_Data[slot]; }
+		uint32_t GetCount() const { return static_cast<uint32_t>(m_Data.size()); }
+
+	private:
+		std::vector<T> m_Data;
+		std::vector<Light*> m_Lights;
+		// bit per frame in flight that has yet to upload the slot.
+		std::vector<uint32_t> m_DirtyFrames;
+		std::vector<std::vector<uint32_t>> m_DirtySlots;
+		uint32_t m_AllFrames = 1;
+	};
+
+	// tracks the lights the deferred pass shades. lights and their transforms report changes, so a frame where nothing
+	// moved refreshes and uploads nothing.
+	class LightManager
+	{
+	public:
+		static LightManager* Get();
+		static void Destroy();
+
+		void SetFrameCount(uint32_t frameCount);
+
+		void RegisterLight(Light* light);
+		void UnregisterLight(Light* light);
+		void MarkDirty(Light* light);
+
+		// rebuilds the gpu data of every light marked dirty since the last update.
+		void Update();
+
+		LightArray<PointLightBufferInfo>& GetPointLights() { return m_PointLights; }
+		LightArray<DirectionalLightBufferInfo>& GetDirectionalLights() { return m_DirectionalLights; }
+		// world space spheres of the point lights by slot, fed to the cluster grid.
+		const std::vector<glm::vec4>& GetPointLightSpheres() const { return m_PointLightSpheres; }
+		LightUploadStats& GetStats() { return m_Stats; }
+
+	private:
+		static LightManager* s_Instance;
+
+		void RefreshLight(Light* light);
+
+		LightArray<PointLightBufferInfo> m_PointLights;
+		LightArray<DirectionalLightBufferInfo> m_DirectionalLights;
+		std::vector<glm::vec4> m_PointLightSpheres;
+		std::vector<Light*> m_DirtyLights;
+		LightUploadStats m_Stats;
+	};
+
+	template <typename T>
+	uint32_t LightArray<T>::Add(Light* light)
+	{
+		uint32_t slot = GetCount();
+		m_Data.emplace_back();
+		m_Lights.push_back(light);
+		m_DirtyFrames.push_back(0);
+		MarkDirty(slot);
+		return slot;
+	}
+
+	template <typename T>
+	Light* LightArray<T>::Remove(uint32_t slot)
+	{
+		uint32_t last = GetCount() - 1;
+		Light* moved = nullptr;
+		if (slot != last)
+		{
+			m_Data[slot] = m_Data[last];
+			m_Lights[slot] = m_Lights[last];
+			moved = m_Lights[slot];
+			MarkDirty(slot);
+		}
+
+		// stale entries for the popped slot are skipped on upload.
+		m_Data.pop_back();
+		m_Lights.pop_back();
+		m_DirtyFrames.pop_back();
+		return moved;
+	}
+
+	template <typename T>
+	void LightArray<T>::SetFrameCount(uint32_t frameCount)
+	{
+		PL_ASSERT(frameCount > 0 && frameCount < 32);
+		m_AllFrames = (1u << frameCount) - 1;
+		m_DirtySlots.resize(frameCount);
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			MarkAllDirty(frame);
+		}
+	}
+
+	template <typename T>
+	void LightArray<T>::MarkDirty(uint32_t slot)
+	{
+		uint32_t newFrames = m_AllFrames & ~m_DirtyFrames[slot];
+		m_DirtyFrames[slot] |= newFrames;
+		for (uint32_t frame = 0; newFrames != 0; ++frame, newFrames >>= 1)
+		{
+			if (newFrames & 1)
+			{
+				m_DirtySlots[frame].push_back(slot);
+			}
+		}
+	}
+
+	template <typename T>
+	void LightArray<T>::MarkAllDirty(uint32_t frame)
+	{
+		uint32_t frameBit = 1u << frame;
+		for (uint32_t slot = 0; slot < GetCount(); ++slot)
+		{
+			if (!(m_DirtyFrames[slot] & frameBit))
+			{
+				m_DirtyFrames[slot] |= frameBit;
+				m_DirtySlots[frame].push_back(slot);
+			}
+		}
+	}
+
+	template <typename T>
+	void LightArray<T>::Upload(uint32_t frame, Buffer& buffer, LightUploadStats& stats)
+	{
+		std::vector<uint32_t>& dirtySlots = m_DirtySlots[frame];
+		if (dirtySlots.empty())
+		{
+			return;
+		}
+
+		// a removed slot can be re-added before this frame uploads, so it may be listed twice.
+		std::sort(dirtySlots.begin(), dirtySlots.end());
+		dirtySlots.erase(std::unique(dirtySlots.begin(), dirtySlots.end()), dirtySlots.end());
+
+		uint32_t frameBit = 1u << frame;
+		uint8_t* mapped = static_cast<uint8_t*>(buffer.m_Mapped);
+		size_t i = 0;
+		while (i < dirtySlots.size() && dirtySlots[i] < GetCount())
+		{
+			uint32_t first = dirtySlots[i];
+			uint32_t count = 0;
+			while (i < dirtySlots.size() && dirtySlots[i] == first + count && dirtySlots[i] < GetCount())
+			{
+				m_DirtyFrames[dirtySlots[i]] &= ~frameBit;
+				count++;
+				i++;
+			}
+
+			VkDeviceSize offset = sizeof(T) * first;
+			VkDeviceSize size = sizeof(T) * count;
+			memcpy(mapped + offset, &m_Data[first], size);
+			CHECK_VK_RESULT(buffer.Flush(size, offset));
+
+			stats.m_Ranges++;
+			stats.m_UploadedBytes += size;
+		}
+
+		dirtySlots.clear();
+	}
+}
@@ -35,16 +35,21 @@ namespace plumbus::vk
 	void Material::Setup()
 	{
 		ShaderReflectionObject shaderReflection;
+		ShaderReflectionObject instancedShaderReflection;
 		if (!m_ShadersLoaded)
 		{
 			VulkanRenderer* renderer = VulkanRenderer::Get();
 
 			m_VertShaderPipelineCreateInfo = renderer->LoadShader(m_VertShaderName, VK_SHADER_STAGE_VERTEX_BIT, m_ShaderSettings, shaderReflection);
 			m_FragShaderPipelineCreateInfo = renderer->LoadShader(m_FragShaderName, VK_SHADER_STAGE_FRAGMENT_BIT, m_ShaderSettings, shaderReflection);
+			if (m_InstancedVertShaderName)
+			{
+				m_InstancedVertShaderPipelineCreateInfo = renderer->LoadShader(m_InstancedVertShaderName, VK_SHADER_STAGE_VERTEX_BIT, m_ShaderSettings, instancedShaderReflection);
+			}
 			m_ShadersLoaded = true;
 		}
 
-		CreateVertexDescriptions(shaderReflection);
+		CreateVertexDescriptions(shaderReflection, m_VertexDescriptions);
 
 		if (m_PipelineLayout == VK_NULL_HANDLE)
 		{
@@ -55,6 +60,13 @@ namespace plumbus::vk
 		{
 			m_Pipeline = Pipeline::CreatePipeline(m_PipelineLayout, shaderReflection.m_FragmentStageOutputCount, m_VertexDescriptions, m_VertShaderPipelineCreateInfo, m_FragShaderPipelineCreateInfo, m_RenderPass, m_EnableAlphaBlending, m_CullMode);
 		}
+
+		// the instanced shader has to declare the same bindings as the regular one, only its vertex inputs are used.
+		if (m_InstancedVertShaderName && !m_InstancedPipeline)
+		{
+			CreateVertexDescriptions(instancedShaderReflection, m_InstancedVertexDescriptions);
+			m_InstancedPipeline = Pipeline::CreatePipeline(m_PipelineLayout, shaderReflection.m_FragmentStageOutputCount, m_InstancedVertexDescriptions, m_InstancedVertShaderPipelineCreateInfo, m_FragShaderPipelineCreateInfo, m_RenderPass, m_EnableAlphaBlending, m_CullMode);
+		}
 	}
 
 	void Material::CreatePipelineLayout(const ShaderReflectionObject& shaderReflection)
@@ -69,45 +81,50 @@ namespace plumbus::vk
 		m_PipelineLayout = PipelineLayout::CreatePipelineLayout(m_DescriptorSetLayout, shaderReflection.m_PushConstants);
 	}
 
-	void Material::CreateVertexDescriptions(const ShaderReflectionObject& shaderReflection)
+	void Material::CreateVertexDescriptions(const ShaderReflectionObject& shaderReflection, VertexDescription& outDescription)
 	{
-		int stride = 0;
-		for (const StageInput& input : shaderReflection.m_VertexStageInputs)
+		// per vertex data comes from binding 0, inputs named inInstance* step once per instance and come from binding 1.
+		outDescription.m_BindingDescriptions.clear();
+		outDescription.m_AttributeDescriptions.clear();
+
+		uint32_t strides[2] = { 0, 0 };
+		for (const StageInput& stageInput : shaderReflection.m_VertexStageInputs)
 		{
-			stride += input.m_Size;
+			uint32_t binding = stageInput.m_Name.rfind("inInstance", 0) == 0 ? 1 : 0;
+
+			VkVertexInputAttributeDescription input{};
+			input.location = stageInput.m_Location;
+			input.binding = binding;
+			input.format = stageInput.m_Format;
+			input.offset = strides[binding];
+			outDescription.m_AttributeDescriptions.push_back(input);
+			strides[binding] += stageInput.m_Size;
 		}
-		
-		// Binding description
+
+		// Binding descriptions
 		VkVertexInputBindingDescription vInputBindDescription{};
 		vInputBindDescription.binding = 0;
-		vInputBindDescription.stride = stride;
+		vInputBindDescription.stride = strides[0];
 		vInputBindDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		outDescription.m_BindingDescriptions.push_back(vInputBindDescription);
 
-		m_VertexDescriptions.m_BindingDescriptions.resize(1);
-		m_VertexDescriptions.m_BindingDescriptions[0] = vInputBindDescription;
-
-		int currOffset = 0;
-		//shaderReflection
-		for (const StageInput& stageInput : shaderReflection.m_VertexStageInputs)
+		if (strides[1] > 0)
 		{
-			VkVertexInputAttributeDescription input{};
-			input.location = stageInput.m_Location;
-			input.binding = stageInput.m_Binding;
-			input.format = stageInput.m_Format;
-			input.offset = currOffset;
-			m_VertexDescriptions.m_AttributeDescriptions.push_back(input);
-			currOffset += stageInput.m_Size;
+			vInputBindDescription.binding = 1;
+			vInputBindDescription.stride = strides[1];
+			vInputBindDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+			outDescription.m_BindingDescriptions.push_back(vInputBindDescription);
 		}
 
 		VkPipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo{};
 		pipelineVertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-		m_VertexDescriptions.m_InputState = pipelineVertexInputStateCreateInfo;
-		m_VertexDescriptions.m_InputState.vertexBindingDescriptionCount = static_cast<uint32_t>(m_VertexDescriptions.m_BindingDescriptions.size());
-		m_VertexDescriptions.m_InputState.pVertexBindingDescriptions = m_VertexDescriptions.m_BindingDescriptions.data();
-		m_VertexDescriptions.m_InputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(m_VertexDescriptions.m_AttributeDescriptions.size());
-		m_VertexDescriptions.m_InputState.pVertexAttributeDescriptions = m_VertexDescriptions.m_AttributeDescriptions.data();
+		outDescription.m_InputState = pipelineVertexInputStateCreateInfo;
+		outDescription.m_InputState.vertexBindingDescriptionCount = static_cast<uint32_t>(outDescription.m_BindingDescriptions.size());
+		outDescription.m_InputState.pVertexBindingDescriptions = outDescription.m_BindingDescriptions.data();
+		outDescription.m_InputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(outDescription.m_AttributeDescriptions.size());
+		outDescription.m_InputState.pVertexAttributeDescriptions = outDescription.m_AttributeDescriptions.data();
 
-		m_VertexDescriptions.m_Valid = true;
+		outDescription.m_Valid = true;
 	}
 }
@@ -4,6 +4,7 @@
 
 #include "DescriptorSetLayout.h"
 #include "Pipeline.h"
+#include "VertexLayout.h"
 #include "shader_compiler/ShaderSettings.h"
 
 namespace plumbus::vk
@@ -11,18 +12,6 @@ namespace plumbus::vk
 	struct PushConstant;
 	struct ShaderReflectionObject;
 
-	enum class VertexLayoutComponent
-	{
-		Position = 0x0,
-		Normal = 0x1,
-		Colour = 0x2,
-		UV = 0x3,
-		Tangent = 0x4,
-		Bitangent = 0x5,
-		DummyFloat = 0x6,
-		DummyVec4 = 0x7
-	};
-
 	class Material
 	{
 	public:
@@ -30,32 +19,40 @@ namespace plumbus::vk
 		~Material();
 		virtual void Setup();
 		const PipelineRef& GetPipeline() { return m_Pipeline; }
+		// null unless an instanced vertex shader was given. it shares the pipeline layout, so the same descriptor sets work with both.
+		const PipelineRef& GetInstancedPipeline() { return m_InstancedPipeline; }
 		const PipelineLayoutRef& GetPipelineLayout() { return m_PipelineLayout; }
 
 		const DescriptorSetLayoutRef& GetLayout() { return m_DescriptorSetLayout; }
 		shaders::ShaderSettings& GetShaderSettings() { return m_ShaderSettings; }
 
         void SetCullingMode(VkCullModeFlagBits cullMode) { m_CullMode = cullMode; }
+		// must be set before Setup. the shader reads each instance's model matrix from the per instance vertex stream.
+		void SetInstancedVertShader(const char* vertShader) { m_InstancedVertShaderName = vertShader; }
 
 	private:
 		void CreatePipelineLayout(const ShaderReflectionObject& shaderReflection);
-		void CreateVertexDescriptions(const ShaderReflectionObject& shaderReflection);
+		static void CreateVertexDescriptions(const ShaderReflectionObject& shaderReflection, VertexDescription& outDescription);
 
 		VertexDescription m_VertexDescriptions;
+		VertexDescription m_InstancedVertexDescriptions;
 		DescriptorSetLayoutRef m_DescriptorSetLayout;
 
 		bool m_EnableAlphaBlending;
 		PipelineLayoutRef m_PipelineLayout;
 		PipelineRef m_Pipeline;
+		PipelineRef m_InstancedPipeline;
 		VkCullModeFlagBits m_CullMode;
 
 		const char* m_VertShaderName;
 		const char* m_FragShaderName;
+		const char* m_InstancedVertShaderName = nullptr;
 
 		VkRenderPass m_RenderPass;
 
 		VkPipelineShaderStageCreateInfo m_VertShaderPipelineCreateInfo;
 		VkPipelineShaderStageCreateInfo m_FragShaderPipelineCreateInfo;
+		VkPipelineShaderStageCreateInfo m_InstancedVertShaderPipelineCreateInfo;
 		bool m_ShadersLoaded;
 
 		shaders::ShaderSettings m_ShaderSettings;
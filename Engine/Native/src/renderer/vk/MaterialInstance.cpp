@@ -5,51 +5,110 @@
 
 namespace plumbus::vk
 {
+    std::vector<MaterialInstance*> MaterialInstance::s_DirtyInstances;
+
     MaterialInstanceRef MaterialInstance::CreateMaterialInstance(MaterialRef material) 
     {
         return std::make_shared<MaterialInstance>(material);
     }
     
     MaterialInstance::MaterialInstance(MaterialRef material) 
-        : m_UniformsDirty(true)
     {
         m_Material = material;
-        m_DescriptorSet = DescriptorSet::CreateDescriptorSet(VulkanRenderer::Get()->GetDescriptorPool(), material->GetLayout());
+
+        uint32_t framesInFlight = VulkanRenderer::Get()->GetFramesInFlight();
+        for (uint32_t i = 0; i < framesInFlight; ++i)
+        {
+            m_DescriptorSets.push_back(DescriptorSet::CreateDescriptorSet(VulkanRenderer::Get()->GetDescriptorPool(), material->GetLayout()));
+        }
+        m_UniformsDirty.resize(framesInFlight, false);
+        for (uint32_t i = 0; i < framesInFlight; ++i)
+        {
+            MarkDirty(i);
+        }
     }
     
     MaterialInstance::~MaterialInstance() 
     {
+        if (m_QueuedForBuild)
+        {
+            s_DirtyInstances.erase(std::find(s_DirtyInstances.begin(), s_DirtyInstances.end(), this));
+        }
+
         m_Material.reset();
-        m_DescriptorSet.reset();
+        m_DescriptorSets.clear();
     }
 
     void MaterialInstance::SetTextureUniform(std::string name, std::vector<DescriptorSet::TextureUniform> textureUniforms, bool isDepth)
 	{
-        m_DescriptorSet->SetTextureUniform(name, textureUniforms, isDepth);
-        m_UniformsDirty = true;
+        for (uint32_t i = 0; i < m_DescriptorSets.size(); ++i)
+        {
+            m_DescriptorSets[i]->SetTextureUniform(name, textureUniforms, isDepth);
+            MarkDirty(i);
+        }
 	}
 	
 	void MaterialInstance::SetBufferUniform(std::string name, Buffer* buffer) 
 	{
-        m_DescriptorSet->SetBufferUniform(name, buffer);
-        m_UniformsDirty = true;
+        for (uint32_t i = 0; i < m_DescriptorSets.size(); ++i)
+        {
+            SetBufferUniform(name, buffer, i);
+        }
 	}
-    
-    void MaterialInstance::Bind(CommandBufferRef commandBuffer) 
+
+	void MaterialInstance::SetBufferUniform(std::string name, Buffer* buffer, uint32_t frameIndex)
+	{
+        m_DescriptorSets[frameIndex]->SetBufferUniform(name, buffer);
+        MarkDirty(frameIndex);
+	}
+
+    void MaterialInstance::MarkDirty(uint32_t frameIndex)
+    {
+        m_UniformsDirty[frameIndex] = true;
+        if (!m_QueuedForBuild)
+        {
+            s_DirtyInstances.push_back(this);
+            m_QueuedForBuild = true;
+        }
+    }
+
+    void MaterialInstance::BuildDirtyDescriptorSets(uint32_t frameIndex)
     {
-        if (VulkanRenderer::Get()->GetBoundMaterialInstance() != this)
+        // instances stay queued until the sets for the other frames in flight have been built too.
+        auto it = std::remove_if(s_DirtyInstances.begin(), s_DirtyInstances.end(), [frameIndex](MaterialInstance* instance)
         {
-            if (m_UniformsDirty)
+            if (instance->m_UniformsDirty[frameIndex])
             {
-                m_DescriptorSet->Build();
-                m_UniformsDirty = false;
+                instance->m_DescriptorSets[frameIndex]->Build();
+                instance->m_UniformsDirty[frameIndex] = false;
             }
 
-            commandBuffer->BindPipeline(m_Material->GetPipeline());
-            commandBuffer->BindDescriptorSet(m_Material->GetPipelineLayout(), m_DescriptorSet);
-            VulkanRenderer::Get()->SetBoundMaterial(this);
+            bool stillDirty = std::find(instance->m_UniformsDirty.begin(), instance->m_UniformsDirty.end(), true) != instance->m_UniformsDirty.end();
+            instance->m_QueuedForBuild = stillDirty;
+            return !stillDirty;
+        });
+        s_DirtyInstances.erase(it, s_DirtyInstances.end());
+    }
+    
+    void MaterialInstance::Bind(CommandBufferRef commandBuffer, bool instanced)
+    {
+        if (instanced || commandBuffer->GetBoundMaterialInstance() != this)
+        {
+            uint32_t frameIndex = VulkanRenderer::Get()->GetCurrentFrameIndex();
+            PL_ASSERT(!m_UniformsDirty[frameIndex], "uniforms were set after BuildDirtyDescriptorSets ran for this frame.");
+
+            commandBuffer->BindPipeline(instanced ? m_Material->GetInstancedPipeline() : m_Material->GetPipeline());
+            commandBuffer->BindDescriptorSet(m_Material->GetPipelineLayout(), m_DescriptorSets[frameIndex]);
+            // the bound material only stands for the regular pipeline, the command buffer still filters the instanced binds.
+            commandBuffer->SetBoundMaterialInstance(instanced ? nullptr : this);
+        }
+        else
+        {
+            // counted the same as the command buffer filtering them out.
+            commandBuffer->GetBindStats().m_PipelinesSkipped++;
+            commandBuffer->GetBindStats().m_DescriptorSetsSkipped++;
         }
     }
 
 
-}
\ No newline at end of file
+}
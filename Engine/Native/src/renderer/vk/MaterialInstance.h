@@ -16,15 +16,28 @@ namespace plumbus::vk
 
         void SetTextureUniform(std::string name, std::vector<DescriptorSet::TextureUniform> textureUniforms, bool isDepth);
 		void SetBufferUniform(std::string name, Buffer* buffer);
+		void SetBufferUniform(std::string name, Buffer* buffer, uint32_t frameIndex);
 
-        void Bind(CommandBufferRef commandBuffer);
+        // builds every instance's set for the frame that changed since it was last built. called on the main thread
+        // before the passes record, binding only reads the sets so the recording threads never touch the pool.
+        static void BuildDirtyDescriptorSets(uint32_t frameIndex);
+
+        // instanced binds the material's instanced pipeline with the same descriptor set.
+        void Bind(CommandBufferRef commandBuffer, bool instanced = false);
 
 		MaterialRef GetMaterial() { return m_Material; }
 
 	private:
+		void MarkDirty(uint32_t frameIndex);
+
 		MaterialRef m_Material;
-        DescriptorSetRef m_DescriptorSet;
 
-        bool m_UniformsDirty;
+        // one set per frame in flight, so a set is never rebuilt while the gpu may still be reading it.
+        std::vector<DescriptorSetRef> m_DescriptorSets;
+        std::vector<bool> m_UniformsDirty;
+        bool m_QueuedForBuild = false;
+
+        // instances with at least one dirty set, uniforms are only set from the main thread.
+        static std::vector<MaterialInstance*> s_DirtyInstances;
 	};
 }
\ No newline at end of file
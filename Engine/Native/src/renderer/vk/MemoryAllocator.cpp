@@ -0,0 +1,487 @@
+#include "plumbus.h"
+#include "MemoryAllocator.h"
+#include "Helpers.h"
+
+namespace plumbus::vk
+{
+	static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return alignment > 1 ? (value + alignment - 1) & ~(alignment - 1) : value;
+	}
+
+	static VkDeviceSize AlignDown(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return alignment > 1 ? value & ~(alignment - 1) : value;
+	}
+
+	// true if a resource of typeA ending at endA (exclusive) and one of typeB starting at startB would share a granularity page.
+	static bool HasGranularityConflict(AllocationResourceType typeA, VkDeviceSize endA, AllocationResourceType typeB, VkDeviceSize startB, VkDeviceSize granularity)
+	{
+		if (granularity <= 1 || typeA == AllocationResourceType::Free || typeB == AllocationResourceType::Free || typeA == typeB)
+		{
+			return false;
+		}
+
+		return AlignDown(endA - 1, granularity) == AlignDown(startB, granularity);
+	}
+
+	MemoryBlock::MemoryBlock(VkDevice device, uint32_t memoryTypeIndex, VkDeviceSize size, AllocationStrategy strategy, VkMemoryPropertyFlags properties, bool dedicated)
+		: m_Device(device)
+		, m_MemoryTypeIndex(memoryTypeIndex)
+		, m_Size(size)
+		, m_Strategy(strategy)
+		, m_Properties(properties)
+		, m_Dedicated(dedicated)
+	{
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryTypeIndex;
+		if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &m_Memory) != VK_SUCCESS)
+		{
+			Log::Fatal("Failed to allocate %llu bytes of device memory (type %u)", (unsigned long long)size, memoryTypeIndex);
+		}
+
+		if (m_Properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			CHECK_VK_RESULT(vkMapMemory(m_Device, m_Memory, 0, VK_WHOLE_SIZE, 0, &m_Mapped));
+		}
+
+		m_Ranges.push_back({ 0, m_Size, 0, AllocationResourceType::Free });
+	}
+
+	MemoryBlock::~MemoryBlock()
+	{
+		if (m_Mapped)
+		{
+			vkUnmapMemory(m_Device, m_Memory);
+		}
+
+		vkFreeMemory(m_Device, m_Memory, nullptr);
+	}
+
+	bool MemoryBlock::Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize granularity, AllocationResourceType type, MemoryAllocation& outAllocation)
+	{
+		VkDeviceSize offset = 0;
+		bool success = m_Strategy == AllocationStrategy::Linear ? AllocateLinear(size, alignment, granularity, type, offset)
+																: AllocateFreeList(size, alignment, granularity, type, offset);
+		if (!success)
+		{
+			return false;
+		}
+
+		m_AllocationCount++;
+		m_BytesUsed += size;
+
+		outAllocation.m_Memory = m_Memory;
+		outAllocation.m_Offset = offset;
+		outAllocation.m_Size = size;
+		outAllocation.m_Mapped = m_Mapped ? static_cast<char*>(m_Mapped) + offset : nullptr;
+		outAllocation.m_Block = this;
+		return true;
+	}
+
+	bool MemoryBlock::AllocateFreeList(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize granularity, AllocationResourceType type, VkDeviceSize& outOffset)
+	{
+		// best fit, smallest free range that can hold the allocation once aligned.
+		int bestIndex = -1;
+		VkDeviceSize bestOffset = 0;
+		for (int i = 0; i < (int)m_Ranges.size(); ++i)
+		{
+			const Range& range = m_Ranges[i];
+			if (range.m_Type != AllocationResourceType::Free || range.m_Size < size)
+			{
+				continue;
+			}
+
+			if (bestIndex >= 0 && range.m_Size >= m_Ranges[bestIndex].m_Size)
+			{
+				continue;
+			}
+
+			VkDeviceSize offset = AlignUp(range.m_Offset, alignment);
+			if (i > 0)
+			{
+				const Range& prev = m_Ranges[i - 1];
+				if (HasGranularityConflict(prev.m_Type, prev.m_Offset + prev.m_Size, type, offset, granularity))
+				{
+					offset = AlignUp(offset, granularity);
+				}
+			}
+
+			VkDeviceSize rangeEnd = range.m_Offset + range.m_Size;
+			if (offset + size > rangeEnd)
+			{
+				continue;
+			}
+
+			if (i + 1 < (int)m_Ranges.size())
+			{
+				const Range& next = m_Ranges[i + 1];
+				if (HasGranularityConflict(type, offset + size, next.m_Type, next.m_Offset, granularity))
+				{
+					continue;
+				}
+			}
+
+			bestIndex = i;
+			bestOffset = offset;
+		}
+
+		if (bestIndex < 0)
+		{
+			return false;
+		}
+
+		// alignment padding stays with the allocation, the tail is split off as a new free range.
+		Range& range = m_Ranges[bestIndex];
+		VkDeviceSize padding = bestOffset - range.m_Offset;
+		VkDeviceSize remaining = range.m_Size - padding - size;
+		range.m_Size = padding + size;
+		range.m_Padding = padding;
+		range.m_Type = type;
+		m_BytesPadding += padding;
+
+		if (remaining > 0)
+		{
+			m_Ranges.insert(m_Ranges.begin() + bestIndex + 1, { bestOffset + size, remaining, 0, AllocationResourceType::Free });
+		}
+
+		outOffset = bestOffset;
+		return true;
+	}
+
+	bool MemoryBlock::AllocateLinear(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize granularity, AllocationResourceType type, VkDeviceSize& outOffset)
+	{
+		VkDeviceSize offset = AlignUp(m_LinearOffset, alignment);
+		if (HasGranularityConflict(m_LinearLastType, m_LinearLastEnd, type, offset, granularity))
+		{
+			offset = AlignUp(offset, granularity);
+		}
+
+		if (offset + size > m_Size)
+		{
+			return false;
+		}
+
+		m_LinearOffset = offset + size;
+		m_LinearLastEnd = m_LinearOffset;
+		m_LinearLastType = type;
+
+		outOffset = offset;
+		return true;
+	}
+
+	void MemoryBlock::Free(const MemoryAllocation& allocation)
+	{
+		PL_ASSERT(allocation.m_Block == this);
+		PL_ASSERT(m_AllocationCount > 0);
+
+		m_AllocationCount--;
+		m_BytesUsed -= allocation.m_Size;
+
+		if (m_Strategy == AllocationStrategy::Linear)
+		{
+			// linear blocks can only be reclaimed as a whole.
+			if (m_AllocationCount == 0)
+			{
+				m_LinearOffset = 0;
+				m_LinearLastEnd = 0;
+				m_LinearLastType = AllocationResourceType::Free;
+			}
+			return;
+		}
+
+		auto it = std::upper_bound(m_Ranges.begin(), m_Ranges.end(), allocation.m_Offset, [](VkDeviceSize offset, const Range& range) { return offset < range.m_Offset; });
+		PL_ASSERT(it != m_Ranges.begin());
+		--it;
+		PL_ASSERT(it->m_Type != AllocationResourceType::Free && it->m_Offset + it->m_Padding == allocation.m_Offset, "Freeing an allocation the block does not own");
+
+		m_BytesPadding -= it->m_Padding;
+		it->m_Type = AllocationResourceType::Free;
+		it->m_Padding = 0;
+
+		// merge with neighbouring free ranges so the list never holds two adjacent free ranges.
+		auto next = it + 1;
+		if (next != m_Ranges.end() && next->m_Type == AllocationResourceType::Free)
+		{
+			it->m_Size += next->m_Size;
+			it = m_Ranges.erase(next) - 1;
+		}
+
+		if (it != m_Ranges.begin())
+		{
+			auto prev = it - 1;
+			if (prev->m_Type == AllocationResourceType::Free)
+			{
+				prev->m_Size += it->m_Size;
+				m_Ranges.erase(it);
+			}
+		}
+	}
+
+	void MemoryBlock::AddStats(MemoryStats& stats) const
+	{
+		stats.m_BlockCount++;
+		stats.m_AllocationCount += m_AllocationCount;
+		stats.m_BytesReserved += m_Size;
+		stats.m_BytesUsed += m_BytesUsed;
+		if (m_Strategy == AllocationStrategy::Linear)
+		{
+			stats.m_BytesWasted += m_LinearOffset - m_BytesUsed;
+		}
+		else
+		{
+			stats.m_BytesWasted += m_BytesPadding;
+		}
+	}
+
+	MemoryAllocatorRef MemoryAllocator::CreateMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device)
+	{
+		return std::make_shared<MemoryAllocator>(physicalDevice, device);
+	}
+
+	MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device)
+		: m_Device(device)
+	{
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_MemoryProperties);
+
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+		m_BufferImageGranularity = deviceProperties.limits.bufferImageGranularity;
+		m_NonCoherentAtomSize = deviceProperties.limits.nonCoherentAtomSize;
+	}
+
+	MemoryAllocator::~MemoryAllocator()
+	{
+		MemoryStats stats = GetStats();
+		if (stats.m_AllocationCount > 0)
+		{
+			Log::Warn("MemoryAllocator: %u allocation(s) still alive on shutdown (%llu bytes)", stats.m_AllocationCount, (unsigned long long)stats.m_BytesUsed);
+		}
+
+		for (MemoryPool& pool : m_Pools)
+		{
+			for (MemoryBlock* block : pool.m_Blocks)
+			{
+				delete block;
+			}
+			pool.m_Blocks.clear();
+		}
+	}
+
+	uint32_t MemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+	{
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i))
+				&& (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			{
+				return i;
+			}
+		}
+
+		Log::Fatal("failed to find suitable memory type!");
+		return -1;
+	}
+
+	VkDeviceSize MemoryAllocator::GetBlockSize(uint32_t memoryTypeIndex) const
+	{
+		// dont let a single block eat a large chunk of a small heap (eg the 256MB device local + host visible heap).
+		uint32_t heapIndex = m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+		VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[heapIndex].size;
+		return std::min(m_PreferredBlockSize, AlignUp(heapSize / 8, 1024));
+	}
+
+	bool MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationResourceType type, AllocationStrategy strategy, MemoryAllocation& outAllocation)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		uint32_t memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+		VkMemoryPropertyFlags typeProperties = m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+		MemoryPool& pool = m_Pools[memoryTypeIndex];
+		VkDeviceSize blockSize = GetBlockSize(memoryTypeIndex);
+
+		// big resources get their own VkDeviceMemory rather than fragmenting the shared blocks.
+		if (requirements.size > blockSize / 2)
+		{
+			MemoryBlock* block = new MemoryBlock(m_Device, memoryTypeIndex, requirements.size, AllocationStrategy::FreeList, typeProperties, true);
+			pool.m_Blocks.push_back(block);
+			return block->Allocate(requirements.size, requirements.alignment, m_BufferImageGranularity, type, outAllocation);
+		}
+
+		for (MemoryBlock* block : pool.m_Blocks)
+		{
+			if (block->IsDedicated() || block->GetStrategy() != strategy)
+			{
+				continue;
+			}
+
+			if (block->Allocate(requirements.size, requirements.alignment, m_BufferImageGranularity, type, outAllocation))
+			{
+				return true;
+			}
+		}
+
+		MemoryBlock* block = new MemoryBlock(m_Device, memoryTypeIndex, blockSize, strategy, typeProperties, false);
+		pool.m_Blocks.push_back(block);
+		if (!block->Allocate(requirements.size, requirements.alignment, m_BufferImageGranularity, type, outAllocation))
+		{
+			Log::Error("MemoryAllocator: failed to allocate %llu bytes from a fresh block", (unsigned long long)requirements.size);
+			return false;
+		}
+
+		return true;
+	}
+
+	void MemoryAllocator::Free(MemoryAllocation& allocation)
+	{
+		if (!allocation.IsValid())
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		MemoryBlock* block = allocation.m_Block;
+		block->Free(allocation);
+		allocation = MemoryAllocation();
+
+		if (!block->IsEmpty())
+		{
+			return;
+		}
+
+		// dedicated blocks go straight away, otherwise keep a single empty block per pool and strategy around to avoid churn.
+		MemoryPool& pool = m_Pools[block->GetMemoryTypeIndex()];
+		bool release = block->IsDedicated();
+		if (!release)
+		{
+			for (MemoryBlock* other : pool.m_Blocks)
+			{
+				if (other != block && !other->IsDedicated() && other->GetStrategy() == block->GetStrategy() && other->IsEmpty())
+				{
+					release = true;
+					break;
+				}
+			}
+		}
+
+		if (release)
+		{
+			pool.m_Blocks.erase(std::find(pool.m_Blocks.begin(), pool.m_Blocks.end(), block));
+			delete block;
+		}
+	}
+
+	VkResult MemoryAllocator::AllocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties, AllocationStrategy strategy, MemoryAllocation& outAllocation)
+	{
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(m_Device, buffer, &memReqs);
+		if (!Allocate(memReqs, properties, AllocationResourceType::Linear, strategy, outAllocation))
+		{
+			return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+		}
+
+		return vkBindBufferMemory(m_Device, buffer, outAllocation.m_Memory, outAllocation.m_Offset);
+	}
+
+	VkResult MemoryAllocator::AllocateImageMemory(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties, MemoryAllocation& outAllocation)
+	{
+		VkMemoryRequirements memReqs;
+		vkGetImageMemoryRequirements(m_Device, image, &memReqs);
+		AllocationResourceType type = tiling == VK_IMAGE_TILING_LINEAR ? AllocationResourceType::Linear : AllocationResourceType::Optimal;
+		if (!Allocate(memReqs, properties, type, AllocationStrategy::FreeList, outAllocation))
+		{
+			return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+		}
+
+		return vkBindImageMemory(m_Device, image, outAllocation.m_Memory, outAllocation.m_Offset);
+	}
+
+	VkMappedMemoryRange MemoryAllocator::GetMappedRange(const MemoryAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const
+	{
+		if (size == VK_WHOLE_SIZE)
+		{
+			size = allocation.m_Size - offset;
+		}
+
+		VkDeviceSize blockSize = allocation.m_Block->GetSize();
+		VkDeviceSize start = AlignDown(allocation.m_Offset + offset, m_NonCoherentAtomSize);
+		VkDeviceSize end = std::min(AlignUp(allocation.m_Offset + offset + size, m_NonCoherentAtomSize), blockSize);
+
+		VkMappedMemoryRange mappedRange = {};
+		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		mappedRange.memory = allocation.m_Memory;
+		mappedRange.offset = start;
+		mappedRange.size = end - start;
+		return mappedRange;
+	}
+
+	VkResult MemoryAllocator::Flush(const MemoryAllocation& allocation, VkDeviceSize size, VkDeviceSize offset)
+	{
+		if (!allocation.IsValid() || allocation.m_Block->IsHostCoherent())
+		{
+			return VK_SUCCESS;
+		}
+
+		VkMappedMemoryRange mappedRange = GetMappedRange(allocation, size, offset);
+		return vkFlushMappedMemoryRanges(m_Device, 1, &mappedRange);
+	}
+
+	VkResult MemoryAllocator::Invalidate(const MemoryAllocation& allocation, VkDeviceSize size, VkDeviceSize offset)
+	{
+		if (!allocation.IsValid() || allocation.m_Block->IsHostCoherent())
+		{
+			return VK_SUCCESS;
+		}
+
+		VkMappedMemoryRange mappedRange = GetMappedRange(allocation, size, offset);
+		return vkInvalidateMappedMemoryRanges(m_Device, 1, &mappedRange);
+	}
+
+	MemoryStats MemoryAllocator::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		MemoryStats stats;
+		for (const MemoryPool& pool : m_Pools)
+		{
+			for (const MemoryBlock* block : pool.m_Blocks)
+			{
+				block->AddStats(stats);
+			}
+		}
+
+		return stats;
+	}
+
+	MemoryStats MemoryAllocator::GetStats(uint32_t memoryTypeIndex) const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		MemoryStats stats;
+		for (const MemoryBlock* block : m_Pools[memoryTypeIndex].m_Blocks)
+		{
+			block->AddStats(stats);
+		}
+
+		return stats;
+	}
+
+	void MemoryAllocator::LogStats() const
+	{
+		constexpr double toMB = 1.0 / (1024.0 * 1024.0);
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; ++i)
+		{
+			MemoryStats stats = GetStats(i);
+			if (stats.m_BlockCount == 0)
+			{
+				continue;
+			}
+
+			Log::Info("Memory type %u: %u block(s), %u allocation(s), %.2fMB reserved, %.2fMB used, %.2fMB wasted",
+					  i, stats.m_BlockCount, stats.m_AllocationCount, stats.m_BytesReserved * toMB, stats.m_BytesUsed * toMB, stats.m_BytesWasted * toMB);
+		}
+	}
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "plumbus.h"
+#include <mutex>
+
+namespace plumbus::vk
+{
+    class MemoryBlock;
+
+    enum class AllocationStrategy
+    {
+        FreeList,   // general purpose, allocations can be freed in any order.
+        Linear      // bump allocator, only reclaimed once every allocation in the block is freed. good for staging data.
+    };
+
+    // linear resources (buffers, linear images) and optimal images must not share a bufferImageGranularity page.
+    enum class AllocationResourceType
+    {
+        Free,
+        Linear,
+        Optimal
+    };
+
+    struct MemoryAllocation
+    {
+        VkDeviceMemory m_Memory = VK_NULL_HANDLE;
+        VkDeviceSize m_Offset = 0;
+        VkDeviceSize m_Size = 0;
+        void* m_Mapped = nullptr; // points at m_Offset within the persistently mapped block, null if not host visible.
+        MemoryBlock* m_Block = nullptr;
+
+        bool IsValid() const { return m_Memory != VK_NULL_HANDLE; }
+    };
+
+    struct MemoryStats
+    {
+        uint32_t m_BlockCount = 0;
+        uint32_t m_AllocationCount = 0;
+        VkDeviceSize m_BytesReserved = 0;   // size of every VkDeviceMemory we own
+        VkDeviceSize m_BytesUsed = 0;       // bytes handed out to allocations
+        VkDeviceSize m_BytesWasted = 0;     // alignment / granularity padding and unreclaimed linear space
+    };
+
+    class MemoryBlock
+    {
+    public:
+        MemoryBlock(VkDevice device, uint32_t memoryTypeIndex, VkDeviceSize size, AllocationStrategy strategy, VkMemoryPropertyFlags properties, bool dedicated);
+        ~MemoryBlock();
+
+        bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize granularity, AllocationResourceType type, MemoryAllocation& outAllocation);
+        void Free(const MemoryAllocation& allocation);
+
+        void AddStats(MemoryStats& stats) const;
+
+        bool IsEmpty() const { return m_AllocationCount == 0; }
+        bool IsDedicated() const { return m_Dedicated; }
+        bool IsHostCoherent() const { return (m_Properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0; }
+        AllocationStrategy GetStrategy() const { return m_Strategy; }
+        uint32_t GetMemoryTypeIndex() const { return m_MemoryTypeIndex; }
+        VkDeviceSize GetSize() const { return m_Size; }
+        VkDeviceMemory GetVulkanMemory() const { return m_Memory; }
+
+    private:
+        bool AllocateFreeList(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize granularity, AllocationResourceType type, VkDeviceSize& outOffset);
+        bool AllocateLinear(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize granularity, AllocationResourceType type, VkDeviceSize& outOffset);
+
+        // sorted by offset and always covering the whole block. free ranges have type Free.
+        struct Range
+        {
+            VkDeviceSize m_Offset;
+            VkDeviceSize m_Size;
+            VkDeviceSize m_Padding;
+            AllocationResourceType m_Type;
+        };
+
+        VkDevice m_Device;
+        VkDeviceMemory m_Memory = VK_NULL_HANDLE;
+        void* m_Mapped = nullptr;
+        uint32_t m_MemoryTypeIndex;
+        VkDeviceSize m_Size;
+        AllocationStrategy m_Strategy;
+        VkMemoryPropertyFlags m_Properties;
+        bool m_Dedicated;
+
+        std::vector<Range> m_Ranges;
+
+        VkDeviceSize m_LinearOffset = 0;
+        VkDeviceSize m_LinearLastEnd = 0;
+        AllocationResourceType m_LinearLastType = AllocationResourceType::Free;
+
+        uint32_t m_AllocationCount = 0;
+        VkDeviceSize m_BytesUsed = 0;
+        VkDeviceSize m_BytesPadding = 0;
+    };
+
+    // sub allocates buffers and images out of large VkDeviceMemory blocks, one pool of blocks per memory type.
+    // host visible blocks are mapped once on creation and stay mapped until they are destroyed.
+    class MemoryAllocator
+    {
+    public:
+        static MemoryAllocatorRef CreateMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+
+        MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+        ~MemoryAllocator();
+
+        bool Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationResourceType type, AllocationStrategy strategy, MemoryAllocation& outAllocation);
+        void Free(MemoryAllocation& allocation);
+
+        // allocate and bind in one go.
+        VkResult AllocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties, AllocationStrategy strategy, MemoryAllocation& outAllocation);
+        VkResult AllocateImageMemory(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties, MemoryAllocation& outAllocation);
+
+        // offset and size are relative to the allocation, expanded to nonCoherentAtomSize. no-op on coherent memory.
+        VkResult Flush(const MemoryAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+        VkResult Invalidate(const MemoryAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
+        uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const { return m_MemoryProperties; }
+
+        MemoryStats GetStats() const;
+        MemoryStats GetStats(uint32_t memoryTypeIndex) const;
+        void LogStats() const;
+
+        void SetBlockSize(VkDeviceSize blockSize) { m_PreferredBlockSize = blockSize; }
+
+    private:
+        struct MemoryPool
+        {
+            std::vector<MemoryBlock*> m_Blocks;
+        };
+
+        VkDeviceSize GetBlockSize(uint32_t memoryTypeIndex) const;
+        VkMappedMemoryRange GetMappedRange(const MemoryAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const;
+
+        VkDevice m_Device;
+        VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+        VkDeviceSize m_BufferImageGranularity;
+        VkDeviceSize m_NonCoherentAtomSize;
+        VkDeviceSize m_PreferredBlockSize = 64 * 1024 * 1024;
+
+        std::array<MemoryPool, VK_MAX_MEMORY_TYPES> m_Pools;
+        mutable std::mutex m_Mutex;
+    };
+}
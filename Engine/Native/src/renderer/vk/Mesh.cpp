@@ -2,11 +2,6 @@
 
 #include "renderer/vk/Mesh.h"
 
-#include "assimp/Importer.hpp"
-#include "assimp/scene.h"     
-#include "assimp/postprocess.h"
-#include "assimp/cimport.h"
-
 #include "BaseApplication.h"
 #include "renderer/vk/ImageHelpers.h"
 #include "Helpers.h"
@@ -15,6 +10,9 @@
 #include "DescriptorSet.h"
 #include "PipelineLayout.h"
 #include "MaterialInstance.h"
+#include "ModelCache.h"
+#include "TextureCache.h"
+#include "PMesh.h"
 #if PL_PLATFORM_ANDROID
 #include "platform/android/Platform.h"
 #else
@@ -24,9 +22,15 @@
 namespace plumbus::vk
 {
 	Mesh::Mesh()
+		: m_Geometry(MeshGeometry::CreateMeshGeometry())
+	{
+	}
+
+	Mesh::Mesh(MeshGeometryRef geometry)
+		: m_Geometry(geometry)
 	{
-		m_ColourMap = new vk::Texture();
-		m_NormalMap = new vk::Texture();
+		m_WorldBounds = m_Geometry->GetLocalBounds();
+		m_WorldSphere = m_Geometry->GetLocalSphere();
 	}
 
 	Mesh::~Mesh()
@@ -35,80 +39,21 @@ namespace plumbus::vk
 
 	void Mesh::PostLoad()
 	{
-		vk::VulkanRenderer* renderer = VulkanRenderer::Get();
-		VkDevice device = renderer->GetDevice()->GetVulkanDevice();
-
-		uint32_t vBufferSize = static_cast<uint32_t>(m_StagingVertexBuffer.size()) * sizeof(float);
-		uint32_t iBufferSize = static_cast<uint32_t>(m_StagingIndexBuffer.size()) * sizeof(uint32_t);
-
-		m_IndexSize = (uint32_t)m_StagingIndexBuffer.size();
-
-		Buffer vertexStaging, indexStaging;
-
-		// Vertex buffer staging
-		if (renderer->GetDevice()->CreateBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&vertexStaging,
-			vBufferSize,
-			m_StagingVertexBuffer.data()) != VK_SUCCESS)
-			Log::Fatal("failed to create vertex staging buffer");
-
-		// Index buffer staging
-		if (renderer->GetDevice()->CreateBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&indexStaging,
-			iBufferSize,
-			m_StagingIndexBuffer.data()) != VK_SUCCESS)
-			Log::Fatal("failed to create index staging buffer");
-		// Create device local target buffers
-		// Vertex buffer
-		if (renderer->GetDevice()->CreateBuffer(
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			&m_VulkanVertexBuffer,
-			vBufferSize) != VK_SUCCESS)
-			Log::Fatal("failed to create vertex buffer");
-
-		// Index buffer
-		if (renderer->GetDevice()->CreateBuffer(
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			&m_VulkanIndexBuffer,
-			iBufferSize) != VK_SUCCESS)
-			Log::Fatal("failed to create index buffer");
-
-		// Copy from staging buffers
-		VkCommandBuffer copyCmd = renderer->GetDevice()->CreateCommandBuffer();
-
-		VkBufferCopy copyRegion{};
-
-		copyRegion.size = m_VulkanVertexBuffer.m_Size;
-		vkCmdCopyBuffer(copyCmd, vertexStaging.m_Buffer, m_VulkanVertexBuffer.m_Buffer, 1, &copyRegion);
-
-		copyRegion.size = m_VulkanIndexBuffer.m_Size;
-		vkCmdCopyBuffer(copyCmd, indexStaging.m_Buffer, m_VulkanIndexBuffer.m_Buffer, 1, &copyRegion);
-
-		renderer->GetDevice()->FlushCommandBuffer(copyCmd, renderer->GetDevice()->GetGraphicsQueue());
-
-		// Destroy staging resources
-		vkDestroyBuffer(renderer->GetDevice()->GetVulkanDevice(), vertexStaging.m_Buffer, nullptr);
-		vkFreeMemory(renderer->GetDevice()->GetVulkanDevice(), vertexStaging.m_Memory, nullptr);
-		vkDestroyBuffer(renderer->GetDevice()->GetVulkanDevice(), indexStaging.m_Buffer, nullptr);
-		vkFreeMemory(renderer->GetDevice()->GetVulkanDevice(), indexStaging.m_Memory, nullptr);
+		m_Geometry->Upload();
 	}
 
 	void Mesh::Cleanup()
 	{
 		vk::VulkanRenderer* renderer = VulkanRenderer::Get();
 
-		m_UniformBuffer.Cleanup();
-		m_VulkanVertexBuffer.Cleanup();
-		m_VulkanIndexBuffer.Cleanup();
+		for (Buffer& uniformBuffer : m_UniformBuffers)
+		{
+			uniformBuffer.Cleanup();
+		}
+		m_UniformBuffers.clear();
 
-		m_ColourMap->Cleanup();
-		m_NormalMap->Cleanup();
+		// the geometry goes once the last mesh sharing it is cleaned up.
+		m_Geometry.reset();
 	}
 
 	void Mesh::Setup()
@@ -123,26 +68,33 @@ namespace plumbus::vk
 
 	void Mesh::UpdateUniformBuffer(components::ModelComponent::UniformBufferObject& ubo)
 	{
-		memcpy(m_UniformBuffer.m_Mapped, &ubo, sizeof(ubo));
+		memcpy(m_UniformBuffers[VulkanRenderer::Get()->GetCurrentFrameIndex()].m_Mapped, &ubo, sizeof(ubo));
 	}
 
 	void Mesh::CreateUniformBuffer(Device* vulkanDevice)
 	{
-		CHECK_VK_RESULT(vulkanDevice->CreateBuffer(
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&m_UniformBuffer,
-			sizeof(components::ModelComponent::UniformBufferObject)));
+		m_UniformBuffers.resize(VulkanRenderer::Get()->GetFramesInFlight());
+		for (Buffer& uniformBuffer : m_UniformBuffers)
+		{
+			CHECK_VK_RESULT(vulkanDevice->CreateBuffer(
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&uniformBuffer,
+				sizeof(components::ModelComponent::UniformBufferObject)));
 
-		CHECK_VK_RESULT(m_UniformBuffer.Map());
+			CHECK_VK_RESULT(uniformBuffer.Map());
+		}
 	}
 
 	void Mesh::SetupUniforms()
 	{
-		vk::Texture* vkColourMap = static_cast<vk::Texture*>(m_ColourMap);
-		vk::Texture* vkNormalMap = static_cast<vk::Texture*>(m_NormalMap);
+		vk::Texture* vkColourMap = m_Geometry->GetColourMap();
+		vk::Texture* vkNormalMap = m_Geometry->GetNormalMap();
 
-		m_MaterialInstance->SetBufferUniform("UBO", &m_UniformBuffer);
+		for (uint32_t i = 0; i < m_UniformBuffers.size(); ++i)
+		{
+			m_MaterialInstance->SetBufferUniform("UBO", &m_UniformBuffers[i], i);
+		}
 		m_MaterialInstance->SetTextureUniform("samplerColor", {{vkColourMap->m_TextureSampler, vkColourMap->m_ImageView}}, false);
 		m_MaterialInstance->SetTextureUniform("samplerNormalMap", {{vkNormalMap->m_TextureSampler, vkNormalMap->m_ImageView}}, false);
 	}
@@ -153,25 +105,64 @@ namespace plumbus::vk
 		material->Bind(commandBuffer);
 		if(bind)
         {
-            commandBuffer->BindVertexBuffer(m_VulkanVertexBuffer);
-            commandBuffer->BindIndexBuffer(m_VulkanIndexBuffer);
+            commandBuffer->BindVertexBuffer(m_Geometry->GetVertexBuffer());
+            commandBuffer->BindIndexBuffer(m_Geometry->GetIndexBuffer());
         }
-		commandBuffer->RecordDraw(m_IndexSize);
+		commandBuffer->RecordDraw(m_Geometry->GetIndexCount());
+	}
+
+	void Mesh::RenderInstanced(CommandBufferRef commandBuffer, const Buffer& instanceBuffer, uint32_t firstInstance, uint32_t instanceCount)
+	{
+		m_MaterialInstance->Bind(commandBuffer, true);
+		commandBuffer->BindVertexBuffer(m_Geometry->GetVertexBuffer());
+		commandBuffer->BindInstanceBuffer(instanceBuffer);
+		commandBuffer->BindIndexBuffer(m_Geometry->GetIndexBuffer());
+		commandBuffer->RecordDraw(m_Geometry->GetIndexCount(), instanceCount, firstInstance);
+	}
+
+	uint64_t Mesh::GetInstanceKey()
+	{
+		// the owner supplies the model matrix, the material has to have an instanced pipeline. meshes sharing geometry
+		// also share its textures, so any of them can stand in for the others' descriptor sets.
+		if (!m_Owner || !m_MaterialInstance || !m_MaterialInstance->GetMaterial()->GetInstancedPipeline())
+		{
+			return 0;
+		}
+
+		uint64_t geometryKey = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(m_Geometry.get()));
+		uint64_t materialKey = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(m_MaterialInstance->GetMaterial().get()));
+		return geometryKey ^ (materialKey * 0x9E3779B97F4A7C15ull);
 	}
 
 	Buffer& Mesh::GetVertexBuffer()
 	{
-		return m_VulkanVertexBuffer;
+		return m_Geometry->GetVertexBuffer();
 	}
 
 	Buffer& Mesh::GetIndexBuffer()
 	{
-		return m_VulkanIndexBuffer;
+		return m_Geometry->GetIndexBuffer();
 	}
 
 	void Mesh::SetIndexSize(uint32_t indexSize)
 	{
-		m_IndexSize = indexSize;
+		m_Geometry->SetIndexCount(indexSize);
+	}
+
+	void Mesh::SetLocalBounds(const AABB& bounds)
+	{
+		m_Geometry->SetLocalBounds(bounds);
+		m_WorldBounds = m_Geometry->GetLocalBounds();
+		m_WorldSphere = m_Geometry->GetLocalSphere();
+	}
+
+	void Mesh::UpdateWorldBounds(const glm::mat4& modelMatrix)
+	{
+		if (HasBounds())
+		{
+			m_WorldBounds = m_Geometry->GetLocalBounds().Transform(modelMatrix);
+			m_WorldSphere = m_Geometry->GetLocalSphere().Transform(modelMatrix);
+		}
 	}
 
 	void Mesh::SetMaterial(MaterialRef material)
@@ -180,185 +171,154 @@ namespace plumbus::vk
 		m_MaterialInstance = MaterialInstance::CreateMaterialInstance(material);
 	}
 
-	std::vector<vk::Mesh*> Mesh::LoadFromFile(const std::string& fileName,
-                        std::vector<VertexLayoutComponent> vertLayoutComponents,
-		                std::string defaultDiffuseTexture,
-		                std::string defaultNormalTexture)
-    {
-        std::vector<vk::Mesh*> meshes;
-
-        const int flags = aiProcess_FlipWindingOrder | aiProcess_Triangulate | aiProcess_PreTransformVertices | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals;
-        
-        Assimp::Importer Importer;
-        const aiScene* scene;
-
-        std::vector<char> fileContents = Helpers::ReadBinaryFile(fileName.c_str());
-        scene = Importer.ReadFileFromMemory(fileContents.data(), fileContents.size(), flags);
-        if (!scene)
-        {
-            Log::Error(Importer.GetErrorString());
-        }
-        
-        std::vector<ModelPart> parts;
-        
-        if (scene)
-        {
-            parts.clear();
-            parts.resize(scene->mNumMeshes);
-            
-            glm::vec3 scale(1.0f);
-            glm::vec2 uvscale(1.0f);
-			glm::vec3 center(0.0f);
-
-            int vertexCount = 0;
-            int indexCount = 0;
-            
-            for (unsigned int i = 0; i < scene->mNumMeshes; i++)
-            {
-                const aiMesh* paiMesh = scene->mMeshes[i];
-
-                aiString diffusePath;
-                aiReturn hasDiffuse = scene->mMaterials[paiMesh->mMaterialIndex]->Get(_AI_MATKEY_TEXTURE_BASE, aiTextureType_DIFFUSE, 0, diffusePath);
-                aiString normalPath;
-                aiReturn hasNormal = scene->mMaterials[paiMesh->mMaterialIndex]->Get(_AI_MATKEY_TEXTURE_BASE, aiTextureType_NORMALS, 0, normalPath);
-
-                if (hasDiffuse != AI_SUCCESS)
-                {
-                    Log::Warn("No diffuse texture defined for submesh: %i, in file: %s", i, fileName.c_str());
-                    diffusePath = defaultDiffuseTexture + Platform::GetTextureExtension();
-                }
-
-                if (hasNormal != AI_SUCCESS)
-                {
-                    Log::Warn("No normal texture defined for submesh: %i, in file: %s", i, fileName.c_str());
-                    normalPath = defaultNormalTexture + Platform::GetTextureExtension();
-                }
-
-                vk::Mesh* newModel = new vk::Mesh();
-
-                meshes.push_back(newModel);
-
-                parts[i] = ModelPart();
-                parts[i].m_VertexBase = vertexCount;
-                parts[i].m_IndexBase = indexCount;
-                
-                vertexCount += scene->mMeshes[i]->mNumVertices;
-
-				aiColor3D pColor(0.f, 0.f, 0.f);
-				scene->mMaterials[paiMesh->mMaterialIndex]->Get(AI_MATKEY_COLOR_DIFFUSE, pColor);
-                
-                meshes.back()->GetColourMap()->LoadTexture(Platform::GetTextureDirPath() + diffusePath.C_Str());
-			    meshes.back()->GetNormalMap()->LoadTexture(Platform::GetTextureDirPath() + normalPath.C_Str());
-
-                const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
-                
-                Dimension dim;
-                for (unsigned int j = 0; j < paiMesh->mNumVertices; j++)
-                {
-                    const aiVector3D* pPos = &(paiMesh->mVertices[j]);
-                    const aiVector3D* pNormal = &(paiMesh->mNormals[j]);
-                    const aiVector3D* pTexCoord = (paiMesh->HasTextureCoords(0)) ? &(paiMesh->mTextureCoords[0][j]) : &Zero3D;
-                    const aiVector3D* pTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mTangents[j]) : &Zero3D;
-                    const aiVector3D* pBiTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mBitangents[j]) : &Zero3D;
-                    
-                    for (auto& component : vertLayoutComponents)
-                    {
-                        switch (component)
-                        {
-                            case VertexLayoutComponent::Position:
-                                meshes.back()->GetStagingVertexBuffer().push_back(pPos->x * scale.x + center.x);
-                                meshes.back()->GetStagingVertexBuffer().push_back(-pPos->y * scale.y + center.y);
-                                meshes.back()->GetStagingVertexBuffer().push_back(pPos->z * scale.z + center.z);
-                                break;
-                            case VertexLayoutComponent::Normal:
-                                meshes.back()->GetStagingVertexBuffer().push_back(pNormal->x);
-                                meshes.back()->GetStagingVertexBuffer().push_back(-pNormal->y);
-                                meshes.back()->GetStagingVertexBuffer().push_back(pNormal->z);
-                                break;
-                            case VertexLayoutComponent::UV:
-                                meshes.back()->GetStagingVertexBuffer().push_back(pTexCoord->x * uvscale.s);
-                                meshes.back()->GetStagingVertexBuffer().push_back(pTexCoord->y * uvscale.t);
-                                break;
-                            case VertexLayoutComponent::Colour:
-                                meshes.back()->GetStagingVertexBuffer().push_back(pColor.r);
-                                meshes.back()->GetStagingVertexBuffer().push_back(pColor.g);
-                                meshes.back()->GetStagingVertexBuffer().push_back(pColor.b);
-                                break;
-                            case VertexLayoutComponent::Tangent:
-                                meshes.back()->GetStagingVertexBuffer().push_back(pTangent->x);
-                                meshes.back()->GetStagingVertexBuffer().push_back(pTangent->y);
-                                meshes.back()->GetStagingVertexBuffer().push_back(pTangent->z);
-                                break;
-                            case VertexLayoutComponent::Bitangent:
-                                meshes.back()->GetStagingVertexBuffer().push_back(pBiTangent->x);
-                                meshes.back()->GetStagingVertexBuffer().push_back(pBiTangent->y);
-                                meshes.back()->GetStagingVertexBuffer().push_back(pBiTangent->z);
-                                break;
-                            case VertexLayoutComponent::DummyFloat:
-                                meshes.back()->GetStagingVertexBuffer().push_back(1.0f);
-                                break;
-                            case VertexLayoutComponent::DummyVec4:
-                                meshes.back()->GetStagingVertexBuffer().push_back(0.0f);
-                                meshes.back()->GetStagingVertexBuffer().push_back(0.0f);
-                                meshes.back()->GetStagingVertexBuffer().push_back(0.0f);
-                                meshes.back()->GetStagingVertexBuffer().push_back(0.0f);
-                                break;
-                        };
-                    }
-                    
-                    dim.max.x = fmax(pPos->x, dim.max.x);
-                    dim.max.y = fmax(pPos->y, dim.max.y);
-                    dim.max.z = fmax(pPos->z, dim.max.z);
-                    
-                    dim.min.x = fmin(pPos->x, dim.min.x);
-                    dim.min.y = fmin(pPos->y, dim.min.y);
-                    dim.min.z = fmin(pPos->z, dim.min.z);
-                }
-                
-                dim.size = dim.max - dim.min;
-                
-                parts[i].m_VertexCount = paiMesh->mNumVertices;
-                
-                uint32_t indexBase = static_cast<uint32_t>(meshes.back()->GetStagingIndexBuffer().size());
-                for (unsigned int j = 0; j < paiMesh->mNumFaces; j++)
-                {
-                    const aiFace& Face = paiMesh->mFaces[j];
-                    if (Face.mNumIndices != 3)
-                        continue;
-                    meshes.back()->GetStagingIndexBuffer().push_back(indexBase + Face.mIndices[0]);
-                    meshes.back()->GetStagingIndexBuffer().push_back(indexBase + Face.mIndices[1]);
-                    meshes.back()->GetStagingIndexBuffer().push_back(indexBase + Face.mIndices[2]);
-                    parts[i].m_IndexCount += 3;
-                    indexCount += 3;
-                }
-            }
-        }
-        else
-        {
-            Log::Error("Error loading model");
-        }
+	std::string Mesh::GetCookedFileName(const std::string& fileName)
+	{
+		size_t extension = fileName.find_last_of('.');
+		size_t directory = fileName.find_last_of("/\\");
+		if (extension == std::string::npos || (directory != std::string::npos && extension < directory))
+		{
+			return fileName + s_PMeshExtension;
+		}
 
-        return meshes;
-    }
+		return fileName.substr(0, extension) + s_PMeshExtension;
+	}
 
-	std::vector<Mesh*> Mesh::LoadModel(const std::string& fileName, std::string defaultTexturePath, std::string defaultNormalPath)
+	bool Mesh::ValidateCookedFile(const MappedFile& file, const std::string& fileName)
 	{
-		std::vector<VertexLayoutComponent> vertLayoutComponents;
-		vertLayoutComponents.push_back(VertexLayoutComponent::Position);
-		vertLayoutComponents.push_back(VertexLayoutComponent::UV);
-		vertLayoutComponents.push_back(VertexLayoutComponent::Colour);
-		vertLayoutComponents.push_back(VertexLayoutComponent::Normal);
-		vertLayoutComponents.push_back(VertexLayoutComponent::Tangent);
+		if (file.GetSize() < sizeof(PMeshHeader))
+		{
+			Log::Error("Mesh::ValidateCookedFile: %s is truncated.", fileName.c_str());
+			return false;
+		}
 
-        std::vector<Mesh*> models = LoadFromFile(fileName, vertLayoutComponents, defaultTexturePath, defaultNormalPath);
+		const PMeshHeader* header = reinterpret_cast<const PMeshHeader*>(file.GetData());
+		if (header->m_Magic != PMeshHeader::s_Magic)
+		{
+			Log::Error("Mesh::ValidateCookedFile: %s is not a cooked mesh.", fileName.c_str());
+			return false;
+		}
 
-        for (Mesh* model : models)
+		if (header->m_Version != PMeshHeader::s_Version)
+		{
+			Log::Error("Mesh::ValidateCookedFile: %s was cooked with version %u, expected %u. run PlumbusCooker on it again.", fileName.c_str(), header->m_Version, PMeshHeader::s_Version);
+			return false;
+		}
+
+		if (header->m_FileSize != file.GetSize())
+		{
+			Log::Error("Mesh::ValidateCookedFile: %s is truncated.", fileName.c_str());
+			return false;
+		}
+
+		uint32_t componentCount = static_cast<uint32_t>(std::size(s_PMeshModelLayout));
+		uint32_t stride = 0;
+		bool layoutMatches = header->m_VertexComponentCount == componentCount;
+		for (uint32_t i = 0; layoutMatches && i < componentCount; ++i)
+		{
+			layoutMatches = header->m_VertexComponents[i] == static_cast<uint8_t>(s_PMeshModelLayout[i]);
+			stride += GetComponentSize(s_PMeshModelLayout[i]) * sizeof(float);
+		}
+
+		if (!layoutMatches || header->m_VertexStride != stride)
+		{
+			Log::Error("Mesh::ValidateCookedFile: %s has a different vertex layout to the one models are drawn with.", fileName.c_str());
+			return false;
+		}
+
+		uint64_t fileSize = file.GetSize();
+		uint64_t submeshTableEnd = sizeof(PMeshHeader) + static_cast<uint64_t>(header->m_SubmeshCount) * sizeof(PMeshSubmesh);
+		if (submeshTableEnd > fileSize || static_cast<uint64_t>(header->m_StringTableOffset) + header->m_StringTableSize > fileSize)
+		{
+			Log::Error("Mesh::ValidateCookedFile: %s is corrupt.", fileName.c_str());
+			return false;
+		}
+
+		// names are read straight out of the table, the last one has to be terminated inside it.
+		if (header->m_StringTableSize > 0 && file.GetData()[header->m_StringTableOffset + header->m_StringTableSize - 1] != '\0')
+		{
+			Log::Error("Mesh::ValidateCookedFile: %s is corrupt.", fileName.c_str());
+			return false;
+		}
+
+		const PMeshSubmesh* submeshes = reinterpret_cast<const PMeshSubmesh*>(file.GetData() + sizeof(PMeshHeader));
+		for (uint32_t i = 0; i < header->m_SubmeshCount; ++i)
+		{
+			const PMeshSubmesh& submesh = submeshes[i];
+			bool valid = submesh.m_VertexCount > 0 && submesh.m_IndexCount > 0
+				&& submesh.m_VertexOffset % PMeshHeader::s_BlobAlignment == 0
+				&& submesh.m_IndexOffset % PMeshHeader::s_BlobAlignment == 0
+				&& submesh.m_VertexOffset + static_cast<uint64_t>(submesh.m_VertexCount) * header->m_VertexStride <= fileSize
+				&& submesh.m_IndexOffset + static_cast<uint64_t>(submesh.m_IndexCount) * sizeof(uint32_t) <= fileSize
+				&& (submesh.m_DiffuseTexture == PMeshSubmesh::s_NoString || submesh.m_DiffuseTexture < header->m_StringTableSize)
+				&& (submesh.m_NormalTexture == PMeshSubmesh::s_NoString || submesh.m_NormalTexture < header->m_StringTableSize);
+			if (!valid)
+			{
+				Log::Error("Mesh::ValidateCookedFile: submesh %u in %s is corrupt.", i, fileName.c_str());
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	std::vector<MeshGeometryRef> Mesh::LoadGeometry(const std::string& fileName, const std::string& defaultTexturePath, const std::string& defaultNormalPath)
+	{
+		std::vector<MeshGeometryRef> meshes;
+
+		std::string cookedFileName = GetCookedFileName(fileName);
+		MappedFile file;
+		if (!file.Open(cookedFileName))
+		{
+			Log::Error("Mesh::LoadGeometry: no cooked mesh for %s, run PlumbusCooker on it to create %s.", fileName.c_str(), cookedFileName.c_str());
+			return meshes;
+		}
+
+		if (!ValidateCookedFile(file, cookedFileName))
+		{
+			return meshes;
+		}
+
+		// everything was baked by the cooker, the blobs go to the gpu as they are.
+		const char* data = file.GetData();
+		const PMeshHeader* header = reinterpret_cast<const PMeshHeader*>(data);
+		const PMeshSubmesh* submeshes = reinterpret_cast<const PMeshSubmesh*>(data + sizeof(PMeshHeader));
+		const char* strings = data + header->m_StringTableOffset;
+
+		for (uint32_t i = 0; i < header->m_SubmeshCount; ++i)
+		{
+			const PMeshSubmesh& submesh = submeshes[i];
+			MeshGeometryRef geometry = MeshGeometry::CreateMeshGeometry();
+
+			std::string diffusePath = submesh.m_DiffuseTexture != PMeshSubmesh::s_NoString ? strings + submesh.m_DiffuseTexture : defaultTexturePath + Platform::GetTextureExtension();
+			std::string normalPath = submesh.m_NormalTexture != PMeshSubmesh::s_NoString ? strings + submesh.m_NormalTexture : defaultNormalPath + Platform::GetTextureExtension();
+			geometry->SetColourMap(TextureCache::Get()->GetTexture(Platform::GetTextureDirPath() + diffusePath));
+			geometry->SetNormalMap(TextureCache::Get()->GetTexture(Platform::GetTextureDirPath() + normalPath));
+
+			AABB bounds;
+			bounds.m_Min = glm::vec3(submesh.m_BoundsMin[0], submesh.m_BoundsMin[1], submesh.m_BoundsMin[2]);
+			bounds.m_Max = glm::vec3(submesh.m_BoundsMax[0], submesh.m_BoundsMax[1], submesh.m_BoundsMax[2]);
+			geometry->SetLocalBounds(bounds);
+
+			geometry->Upload(data + submesh.m_VertexOffset,
+				submesh.m_VertexCount * header->m_VertexStride,
+				reinterpret_cast<const uint32_t*>(data + submesh.m_IndexOffset),
+				submesh.m_IndexCount);
+
+			meshes.push_back(geometry);
+		}
+
+		return meshes;
+	}
+
+	std::vector<Mesh*> Mesh::LoadModel(const std::string& fileName, std::string defaultTexturePath, std::string defaultNormalPath)
+	{
+        std::vector<Mesh*> models;
+        for (const MeshGeometryRef& geometry : ModelCache::Get()->GetModel(fileName, defaultTexturePath, defaultNormalPath))
         {
-            model->PostLoad();
+            models.push_back(new Mesh(geometry));
         }
 
         return models;
 	}
 
-}
-
+}
\ No newline at end of file
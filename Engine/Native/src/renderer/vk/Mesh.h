@@ -5,80 +5,93 @@
 #include "glm/glm.hpp"
 #include "components/ModelComponent.h"
 #include "renderer/vk/Material.h"
+#include "renderer/vk/Frustum.h"
+#include "renderer/vk/MeshGeometry.h"
+
+class MappedFile;
 
 namespace plumbus::vk
 {
 	class Scene;
 	class Device;
+	// one placement of a submesh in the scene. the geometry may be shared with other meshes, the material instance,
+	// uniform buffers and world bounds belong to this one.
 	class Mesh
 	{
 	public:
+		// with geometry of its own, to be filled in by the caller.
 		Mesh();
+		Mesh(MeshGeometryRef geometry);
 		~Mesh();
 
+		// a mesh per submesh, sharing geometry through the ModelCache with everything else placed from the same file.
 		static std::vector<Mesh*> LoadModel(const std::string& fileName, std::string defaultTexturePath, std::string defaultNormalPath);
+		// maps the cooked version of the file and uploads it, bypassing the cache. submeshes whose material doesn't name
+		// a texture fall back to the defaults.
+		static std::vector<MeshGeometryRef> LoadGeometry(const std::string& fileName, const std::string& defaultTexturePath, const std::string& defaultNormalPath);
+		// source models are cooked offline by PlumbusCooker, models/foo.dae is loaded from models/foo.pmesh.
+		static std::string GetCookedFileName(const std::string& fileName);
+
+		const MeshGeometryRef& GetGeometry() const { return m_Geometry; }
 
 		void PostLoad();
 		void Cleanup();
 
 		void Setup();
 		void SetMaterial(MaterialRef material);
+		const MaterialInstanceRef& GetMaterialInstance() const { return m_MaterialInstance; }
 
 		void CreateUniformBuffer(Device* vulkanDevice);
 		void SetupUniforms();
 		void Render(CommandBufferRef commandBuffer, MaterialInstanceRef overrideMaterial = nullptr, bool bind = true);
+		// draws instanceCount copies with this mesh's geometry and material, each transformed by its model matrix in instanceBuffer.
+		void RenderInstanced(CommandBufferRef commandBuffer, const Buffer& instanceBuffer, uint32_t firstInstance, uint32_t instanceCount);
+
+		// meshes with the same key can be drawn as instances of each other, 0 if this one can't be instanced.
+		uint64_t GetInstanceKey();
 
 		void UpdateUniformBuffer(components::ModelComponent::UniformBufferObject& ubo);
 
 		Buffer& GetVertexBuffer();
 		Buffer& GetIndexBuffer();
 
-		std::vector<float>& GetStagingVertexBuffer() { return m_StagingVertexBuffer; }
-		std::vector<uint32_t>& GetStagingIndexBuffer() { return m_StagingIndexBuffer; }
+		std::vector<float>& GetStagingVertexBuffer() { return m_Geometry->GetStagingVertexBuffer(); }
+		std::vector<uint32_t>& GetStagingIndexBuffer() { return m_Geometry->GetStagingIndexBuffer(); }
 
 		//todo there should really be a constructor for custom geometry, remove this once added.
 		void SetIndexSize(uint32_t indexSize); 
-		Texture* GetColourMap() { return m_ColourMap; }
-		Texture* GetNormalMap() { return m_NormalMap; }
-
-private:
-        static std::vector<vk::Mesh*> LoadFromFile(const std::string& fileName,
-                        std::vector<VertexLayoutComponent> vertLayoutComponents,
-						std::string defaultDiffuseTexture,
-						std::string defaultNormalTexture);
+		Texture* GetColourMap() { return m_Geometry->GetColourMap(); }
+		Texture* GetNormalMap() { return m_Geometry->GetNormalMap(); }
 
-		uint32_t m_IndexSize;
+		// local bounds are in the same space as the vertex data, world bounds follow the owning model matrix.
+		void SetLocalBounds(const AABB& bounds);
+		void UpdateWorldBounds(const glm::mat4& modelMatrix);
+		bool HasBounds() { return m_Geometry->HasBounds(); }
+		const AABB& GetLocalBounds() { return m_Geometry->GetLocalBounds(); }
+		const AABB& GetWorldBounds() { return m_WorldBounds; }
+		const BoundingSphere& GetWorldSphere() { return m_WorldSphere; }
 
-		Texture* m_ColourMap;
-		Texture* m_NormalMap;
+		// the component that placed this mesh in the scene, lets spatial queries get back to per model state.
+		void SetOwner(components::ModelComponent* owner) { m_Owner = owner; }
+		components::ModelComponent* GetOwner() { return m_Owner; }
 
-		std::vector<float> m_StagingVertexBuffer;
-		std::vector<uint32_t> m_StagingIndexBuffer;
+private:
+		static bool ValidateCookedFile(const MappedFile& file, const std::string& fileName);
 
-		Buffer m_VulkanVertexBuffer;
-		Buffer m_VulkanIndexBuffer;
+		MeshGeometryRef m_Geometry;
 
 		DescriptorSetRef m_DescriptorSet;
 
-		Buffer m_UniformBuffer;
+		//one per frame in flight.
+		std::vector<Buffer> m_UniformBuffers;
 
 		CommandBufferRef m_CommandBuffer;
 
 		MaterialInstanceRef m_MaterialInstance;
-	};
 
-	struct ModelPart
-	{
-		uint32_t m_VertexBase;
-		uint32_t m_VertexCount;
-		uint32_t m_IndexBase;
-		uint32_t m_IndexCount;
-	};
+		AABB m_WorldBounds;
+		BoundingSphere m_WorldSphere;
 
-	struct Dimension
-	{
-		glm::vec3 min = glm::vec3(FLT_MAX);
-		glm::vec3 max = glm::vec3(-FLT_MAX);
-		glm::vec3 size;
+		components::ModelComponent* m_Owner = nullptr;
 	};
 }
@@ -0,0 +1,99 @@
+#include "plumbus.h"
+
+#include "renderer/vk/MeshGeometry.h"
+#include "renderer/vk/VulkanRenderer.h"
+
+namespace plumbus::vk
+{
+	MeshGeometryRef MeshGeometry::CreateMeshGeometry()
+	{
+		return std::make_shared<MeshGeometry>();
+	}
+
+	MeshGeometry::~MeshGeometry()
+	{
+		m_VertexBuffer.Cleanup();
+		m_IndexBuffer.Cleanup();
+	}
+
+	void MeshGeometry::Upload()
+	{
+		Upload(m_StagingVertexBuffer.data(),
+			static_cast<uint32_t>(m_StagingVertexBuffer.size()) * sizeof(float),
+			m_StagingIndexBuffer.data(),
+			static_cast<uint32_t>(m_StagingIndexBuffer.size()));
+
+		// the gpu copy is all that's needed from here on.
+		std::vector<float>().swap(m_StagingVertexBuffer);
+		std::vector<uint32_t>().swap(m_StagingIndexBuffer);
+	}
+
+	void MeshGeometry::Upload(const void* vertexData, uint32_t vertexDataSize, const uint32_t* indexData, uint32_t indexCount)
+	{
+		vk::VulkanRenderer* renderer = VulkanRenderer::Get();
+
+		uint32_t vBufferSize = vertexDataSize;
+		uint32_t iBufferSize = indexCount * sizeof(uint32_t);
+
+		m_IndexCount = indexCount;
+
+		Buffer vertexStaging, indexStaging;
+
+		// Vertex buffer staging
+		if (renderer->GetDevice()->CreateBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&vertexStaging,
+			vBufferSize,
+			const_cast<void*>(vertexData)) != VK_SUCCESS)
+			Log::Fatal("failed to create vertex staging buffer");
+
+		// Index buffer staging
+		if (renderer->GetDevice()->CreateBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&indexStaging,
+			iBufferSize,
+			const_cast<uint32_t*>(indexData)) != VK_SUCCESS)
+			Log::Fatal("failed to create index staging buffer");
+		// Create device local target buffers
+		// Vertex buffer
+		if (renderer->GetDevice()->CreateBuffer(
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&m_VertexBuffer,
+			vBufferSize) != VK_SUCCESS)
+			Log::Fatal("failed to create vertex buffer");
+
+		// Index buffer
+		if (renderer->GetDevice()->CreateBuffer(
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&m_IndexBuffer,
+			iBufferSize) != VK_SUCCESS)
+			Log::Fatal("failed to create index buffer");
+
+		// Copy from staging buffers
+		VkCommandBuffer copyCmd = renderer->GetDevice()->CreateCommandBuffer();
+
+		VkBufferCopy copyRegion{};
+
+		copyRegion.size = m_VertexBuffer.m_Size;
+		vkCmdCopyBuffer(copyCmd, vertexStaging.m_Buffer, m_VertexBuffer.m_Buffer, 1, &copyRegion);
+
+		copyRegion.size = m_IndexBuffer.m_Size;
+		vkCmdCopyBuffer(copyCmd, indexStaging.m_Buffer, m_IndexBuffer.m_Buffer, 1, &copyRegion);
+
+		renderer->GetDevice()->FlushCommandBuffer(copyCmd, renderer->GetDevice()->GetGraphicsQueue());
+
+		// Destroy staging resources
+		vertexStaging.Cleanup();
+		indexStaging.Cleanup();
+	}
+
+	void MeshGeometry::SetLocalBounds(const AABB& bounds)
+	{
+		m_LocalBounds = bounds;
+		m_LocalSphere = BoundingSphere::FromAABB(bounds);
+	}
+}
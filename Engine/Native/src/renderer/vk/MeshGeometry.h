@@ -0,0 +1,57 @@
+#pragma once
+#include "plumbus.h"
+#include "renderer/vk/Buffer.h"
+#include "renderer/vk/Texture.h"
+#include "renderer/vk/Frustum.h"
+
+namespace plumbus::vk
+{
+	// the vertex and index buffers, textures and local bounds of one submesh. every Mesh placed from the same model file
+	// holds a reference to the same geometry, the gpu resources are freed when the last one lets go.
+	class MeshGeometry
+	{
+	public:
+		static MeshGeometryRef CreateMeshGeometry();
+
+		~MeshGeometry();
+
+		// copies the staging data into device local buffers, the staging data is freed afterwards.
+		void Upload();
+		// copies ready made vertex and index data into device local buffers, e.g. straight out of a mapped .pmesh.
+		void Upload(const void* vertexData, uint32_t vertexDataSize, const uint32_t* indexData, uint32_t indexCount);
+
+		Buffer& GetVertexBuffer() { return m_VertexBuffer; }
+		Buffer& GetIndexBuffer() { return m_IndexBuffer; }
+		uint32_t GetIndexCount() const { return m_IndexCount; }
+		void SetIndexCount(uint32_t indexCount) { m_IndexCount = indexCount; }
+
+		std::vector<float>& GetStagingVertexBuffer() { return m_StagingVertexBuffer; }
+		std::vector<uint32_t>& GetStagingIndexBuffer() { return m_StagingIndexBuffer; }
+
+		// null until set, loaded textures come from the TextureCache and may be shared with other geometry.
+		Texture* GetColourMap() { return m_ColourMap.get(); }
+		Texture* GetNormalMap() { return m_NormalMap.get(); }
+		void SetColourMap(TextureRef texture) { m_ColourMap = texture; }
+		void SetNormalMap(TextureRef texture) { m_NormalMap = texture; }
+
+		void SetLocalBounds(const AABB& bounds);
+		bool HasBounds() const { return m_LocalBounds.IsValid(); }
+		const AABB& GetLocalBounds() const { return m_LocalBounds; }
+		const BoundingSphere& GetLocalSphere() const { return m_LocalSphere; }
+
+	private:
+		uint32_t m_IndexCount = 0;
+
+		TextureRef m_ColourMap;
+		TextureRef m_NormalMap;
+
+		std::vector<float> m_StagingVertexBuffer;
+		std::vector<uint32_t> m_StagingIndexBuffer;
+
+		Buffer m_VertexBuffer;
+		Buffer m_IndexBuffer;
+
+		AABB m_LocalBounds;
+		BoundingSphere m_LocalSphere;
+	};
+}
@@ -0,0 +1,100 @@
+#include "plumbus.h"
+
+#include "renderer/vk/ModelCache.h"
+#include "renderer/vk/Mesh.h"
+#include "renderer/vk/MeshGeometry.h"
+
+namespace plumbus::vk
+{
+	ModelCache* ModelCache::s_Instance = nullptr;
+
+	ModelCache* ModelCache::Get()
+	{
+		if (s_Instance == nullptr)
+			s_Instance = new ModelCache();
+		return s_Instance;
+	}
+
+	void ModelCache::Destroy()
+	{
+		if (s_Instance)
+		{
+			delete s_Instance;
+			s_Instance = nullptr;
+		}
+	}
+
+	std::string ModelCache::MakeKey(const std::string& fileName, const std::string& defaultTexture, const std::string& defaultNormal)
+	{
+		return fileName + "|" + defaultTexture + "|" + defaultNormal;
+	}
+
+	std::vector<MeshGeometryRef> ModelCache::GetModel(const std::string& fileName, const std::string& defaultTexture, const std::string& defaultNormal)
+	{
+		m_Stats.m_Requests++;
+
+		std::string key = MakeKey(fileName, defaultTexture, defaultNormal);
+		std::vector<MeshGeometryRef> meshes;
+
+		auto it = m_Models.find(key);
+		if (it != m_Models.end())
+		{
+			for (const std::weak_ptr<MeshGeometry>& weakMesh : it->second)
+			{
+				if (MeshGeometryRef mesh = weakMesh.lock())
+				{
+					meshes.push_back(mesh);
+				}
+			}
+
+			// the submeshes are only ever released together, a partial set means the model is on its way out.
+			if (!meshes.empty() && meshes.size() == it->second.size())
+			{
+				return meshes;
+			}
+			meshes.clear();
+		}
+
+		RemoveExpired();
+
+		meshes = Mesh::LoadGeometry(fileName, defaultTexture, defaultNormal);
+		m_Stats.m_Loads++;
+
+		std::vector<std::weak_ptr<MeshGeometry>>& entry = m_Models[key];
+		entry.assign(meshes.begin(), meshes.end());
+
+		return meshes;
+	}
+
+	void ModelCache::RemoveExpired()
+	{
+		for (auto it = m_Models.begin(); it != m_Models.end();)
+		{
+			bool expired = std::any_of(it->second.begin(), it->second.end(), [](const std::weak_ptr<MeshGeometry>& mesh) { return mesh.expired(); });
+			if (expired || it->second.empty())
+			{
+				it = m_Models.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	const ModelCacheStats& ModelCache::GetStats()
+	{
+		m_Stats.m_LoadedModels = 0;
+		m_Stats.m_LoadedMeshes = 0;
+		for (const auto& [_, meshes] : m_Models)
+		{
+			uint32_t loadedMeshes = static_cast<uint32_t>(std::count_if(meshes.begin(), meshes.end(), [](const std::weak_ptr<MeshGeometry>& mesh) { return !mesh.expired(); }));
+			if (loadedMeshes > 0)
+			{
+				m_Stats.m_LoadedModels++;
+				m_Stats.m_LoadedMeshes += loadedMeshes;
+			}
+		}
+		return m_Stats;
+	}
+}
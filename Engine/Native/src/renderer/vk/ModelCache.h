@@ -0,0 +1,38 @@
+#pragma once
+#include "plumbus.h"
+
+namespace plumbus::vk
+{
+	struct ModelCacheStats
+	{
+		uint32_t m_Requests = 0;
+		uint32_t m_Loads = 0; // requests that had to import the file, the rest shared geometry already loaded.
+		uint32_t m_LoadedModels = 0;
+		uint32_t m_LoadedMeshes = 0;
+	};
+
+	// shares model geometry between everything placed from the same file. the cache only holds weak references, a
+	// model is unloaded as soon as the last Mesh using it lets go and is imported again if it's asked for later.
+	class ModelCache
+	{
+	public:
+		static ModelCache* Get();
+		static void Destroy();
+
+		// one geometry per submesh. the default textures are used by submeshes whose material doesn't name its own, so
+		// they're part of the key along with the file.
+		std::vector<MeshGeometryRef> GetModel(const std::string& fileName, const std::string& defaultTexture, const std::string& defaultNormal);
+
+		const ModelCacheStats& GetStats();
+
+	private:
+		static ModelCache* s_Instance;
+
+		static std::string MakeKey(const std::string& fileName, const std::string& defaultTexture, const std::string& defaultNormal);
+		// forgets models that have been unloaded since.
+		void RemoveExpired();
+
+		std::unordered_map<std::string, std::vector<std::weak_ptr<MeshGeometry>>> m_Models;
+		ModelCacheStats m_Stats;
+	};
+}
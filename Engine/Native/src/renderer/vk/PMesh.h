@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include "renderer/vk/VertexLayout.h"
+
+namespace plumbus::vk
+{
+	// cooked model files (.pmesh), written offline by PlumbusCooker and mapped straight into memory at runtime. kept
+	// free of engine includes so the cooker can share it. the file is little endian and laid out as:
+	//
+	//     PMeshHeader | PMeshSubmesh * m_SubmeshCount | string table | vertex and index blobs
+	//
+	// each blob starts on a s_BlobAlignment boundary and is already in the form the vertex/index buffers want.
+	struct PMeshHeader
+	{
+		static constexpr uint32_t s_Magic = 0x48534D50; // "PMSH"
+		// bump whenever this layout or the way vertex data is baked changes, older files are rejected and need cooking again.
+		static constexpr uint32_t s_Version = 1;
+		static constexpr uint32_t s_MaxVertexComponents = 8;
+		static constexpr uint32_t s_BlobAlignment = 16;
+
+		uint32_t m_Magic;
+		uint32_t m_Version;
+		uint32_t m_SubmeshCount;
+		uint32_t m_VertexStride; // bytes
+		uint8_t m_VertexComponents[s_MaxVertexComponents]; // VertexLayoutComponent values, in vertex order.
+		uint32_t m_VertexComponentCount;
+		uint32_t m_StringTableOffset;
+		uint32_t m_StringTableSize;
+		uint32_t m_Padding;
+		uint64_t m_FileSize;
+	};
+
+	struct PMeshSubmesh
+	{
+		static constexpr uint32_t s_NoString = 0xFFFFFFFF;
+
+		uint64_t m_VertexOffset; // from the start of the file.
+		uint64_t m_IndexOffset;
+		uint32_t m_VertexCount;
+		uint32_t m_IndexCount; // uint32_t indices, local to this submesh.
+		float m_BoundsMin[3]; // same space as the vertex data.
+		float m_BoundsMax[3];
+		// null terminated texture names relative to the texture directory, offsets into the string table.
+		// s_NoString when the source material didn't name one and the model's default texture should be used.
+		uint32_t m_DiffuseTexture;
+		uint32_t m_NormalTexture;
+	};
+
+	static_assert(sizeof(PMeshHeader) == 48, "PMeshHeader layout changed, bump s_Version");
+	static_assert(sizeof(PMeshSubmesh) == 56, "PMeshSubmesh layout changed, bump s_Version");
+
+	// the layout every model is cooked with, matches the vertex inputs of the g-buffer shaders.
+	constexpr VertexLayoutComponent s_PMeshModelLayout[] =
+	{
+		VertexLayoutComponent::Position,
+		VertexLayoutComponent::UV,
+		VertexLayoutComponent::Colour,
+		VertexLayoutComponent::Normal,
+		VertexLayoutComponent::Tangent
+	};
+
+	constexpr const char* s_PMeshExtension = ".pmesh";
+}
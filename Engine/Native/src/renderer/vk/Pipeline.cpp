@@ -134,7 +134,10 @@ namespace plumbus::vk
 		colorBlendState.attachmentCount = static_cast<uint32_t>(blendAttachmentStates.size());
 		colorBlendState.pAttachments = blendAttachmentStates.data();
 
-		CHECK_VK_RESULT(vkCreateGraphicsPipelines(renderer->GetDevice()->GetVulkanDevice(), renderer->GetPipelineCache()->GetVulkanPipelineCache(), 1, &pipelineCreateInfo, nullptr, &m_Pipeline));
+		const PipelineCacheRef& pipelineCache = renderer->GetPipelineCache();
+		auto createStart = std::chrono::steady_clock::now();
+		CHECK_VK_RESULT(vkCreateGraphicsPipelines(renderer->GetDevice()->GetVulkanDevice(), pipelineCache->GetVulkanPipelineCache(), 1, &pipelineCreateInfo, nullptr, &m_Pipeline));
+		pipelineCache->RecordPipelineCreation(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - createStart).count());
 	}
 
 	Pipeline::~Pipeline()
@@ -14,6 +14,7 @@ namespace plumbus::vk
 
 	struct StageInput
 	{
+		std::string m_Name;
 		uint32_t m_Location;
 		uint32_t m_Binding;
 		uint32_t m_Size;
@@ -21,6 +22,7 @@ namespace plumbus::vk
 		
 		StageInput& operator =(const StageInput& other)
 		{
+			m_Name = other.m_Name;
 			m_Location = other.m_Location;
 			m_Binding = other.m_Binding;
 			m_Size = other.m_Size;
@@ -1,5 +1,6 @@
 #include "PipelineCache.h"
 #include "VulkanRenderer.h"
+#include "Helpers.h"
 
 namespace plumbus::vk
 {
@@ -10,14 +11,117 @@ namespace plumbus::vk
 
 	PipelineCache::PipelineCache()
 	{
+		std::vector<char> cacheData;
+		if (Helpers::ReadCacheFile(s_CacheFileName, cacheData))
+		{
+			m_LoadedFromDisk = ValidateCacheData(cacheData);
+			if (!m_LoadedFromDisk)
+			{
+				Log::Warn("PipelineCache: discarding stale or corrupt %s", s_CacheFileName);
+				cacheData.clear();
+			}
+		}
+
 		VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
 		pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-		CHECK_VK_RESULT(vkCreatePipelineCache(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), &pipelineCacheCreateInfo, nullptr, &m_Cache));
+		pipelineCacheCreateInfo.initialDataSize = cacheData.size();
+		pipelineCacheCreateInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+		if (vkCreatePipelineCache(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), &pipelineCacheCreateInfo, nullptr, &m_Cache) != VK_SUCCESS)
+		{
+			//the driver is allowed to reject data it doesnt like, just start from scratch.
+			Log::Warn("PipelineCache: driver rejected cache data, starting empty");
+			m_LoadedFromDisk = false;
+			pipelineCacheCreateInfo.initialDataSize = 0;
+			pipelineCacheCreateInfo.pInitialData = nullptr;
+			CHECK_VK_RESULT(vkCreatePipelineCache(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), &pipelineCacheCreateInfo, nullptr, &m_Cache));
+		}
+
+		Log::Info("PipelineCache: %s", m_LoadedFromDisk ? "loaded from disk" : "starting empty");
+		m_LastSaveTime = std::chrono::steady_clock::now();
 	}
 
 	PipelineCache::~PipelineCache()
 	{
+		LogStats();
+		Save();
 		vkDestroyPipelineCache(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), m_Cache, nullptr);
 	}
 
-}
\ No newline at end of file
+	bool PipelineCache::ValidateCacheData(const std::vector<char>& data) const
+	{
+		if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne))
+		{
+			return false;
+		}
+
+		VkPipelineCacheHeaderVersionOne header;
+		memcpy(&header, data.data(), sizeof(header));
+
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(VulkanRenderer::Get()->GetDevice()->GetPhysicalDevice(), &deviceProperties);
+
+		return header.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+			   header.headerSize <= data.size() &&
+			   header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			   header.vendorID == deviceProperties.vendorID &&
+			   header.deviceID == deviceProperties.deviceID &&
+			   memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	void PipelineCache::Save()
+	{
+		if (m_PipelinesCreatedSinceSave == 0)
+		{
+			return;
+		}
+
+		VkDevice device = VulkanRenderer::Get()->GetDevice()->GetVulkanDevice();
+
+		size_t dataSize = 0;
+		CHECK_VK_RESULT(vkGetPipelineCacheData(device, m_Cache, &dataSize, nullptr));
+
+		std::vector<char> data(dataSize);
+		CHECK_VK_RESULT(vkGetPipelineCacheData(device, m_Cache, &dataSize, data.data()));
+
+		if (Helpers::WriteCacheFile(s_CacheFileName, data.data(), dataSize))
+		{
+			Log::Info("PipelineCache: saved %zu bytes", dataSize);
+			m_PipelinesCreatedSinceSave = 0;
+		}
+
+		m_LastSaveTime = std::chrono::steady_clock::now();
+	}
+
+	void PipelineCache::Update()
+	{
+		//everything created before the first frame counts as startup cost.
+		if (!m_StartupStatsLogged)
+		{
+			LogStats();
+			m_StartupStatsLogged = true;
+		}
+
+		if (m_PipelinesCreatedSinceSave == 0)
+		{
+			return;
+		}
+
+		std::chrono::duration<double> timeSinceSave = std::chrono::steady_clock::now() - m_LastSaveTime;
+		if (timeSinceSave.count() >= s_CheckpointIntervalSeconds)
+		{
+			Save();
+		}
+	}
+
+	void PipelineCache::RecordPipelineCreation(double milliseconds)
+	{
+		m_PipelineCreationCount++;
+		m_PipelinesCreatedSinceSave++;
+		m_PipelineCreationTime += milliseconds;
+	}
+
+	void PipelineCache::LogStats() const
+	{
+		Log::Info("PipelineCache: created %u pipeline(s) in %.2fms (%s cache)", m_PipelineCreationCount, m_PipelineCreationTime, m_LoadedFromDisk ? "warm" : "cold");
+	}
+}
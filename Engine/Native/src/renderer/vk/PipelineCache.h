@@ -4,6 +4,7 @@
 
 namespace plumbus::vk
 {
+	// wraps the driver pipeline cache and persists it between runs so pipelines dont have to be recompiled every launch.
 	class PipelineCache
 	{
 	public:
@@ -13,7 +14,31 @@ namespace plumbus::vk
 		~PipelineCache();
 
 		const VkPipelineCache& GetVulkanPipelineCache() { return m_Cache; }
+
+		//writes the cache to disk if any pipelines have been created since the last save.
+		void Save();
+		//call once a frame, checkpoints the cache to disk periodically.
+		void Update();
+
+		void RecordPipelineCreation(double milliseconds);
+		uint32_t GetPipelineCreationCount() const { return m_PipelineCreationCount; }
+		double GetPipelineCreationTime() const { return m_PipelineCreationTime; }
+		bool WasLoadedFromDisk() const { return m_LoadedFromDisk; }
+		void LogStats() const;
+
 	private:
+		bool ValidateCacheData(const std::vector<char>& data) const;
+
 		VkPipelineCache m_Cache;
+		bool m_LoadedFromDisk = false;
+		bool m_StartupStatsLogged = false;
+
+		uint32_t m_PipelineCreationCount = 0;
+		uint32_t m_PipelinesCreatedSinceSave = 0;
+		double m_PipelineCreationTime = 0.0;
+		std::chrono::steady_clock::time_point m_LastSaveTime;
+
+		static constexpr const char* s_CacheFileName = "pipeline_cache.bin";
+		static constexpr double s_CheckpointIntervalSeconds = 30.0;
 	};
-}
\ No newline at end of file
+}
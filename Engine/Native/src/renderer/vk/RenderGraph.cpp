@@ -0,0 +1,606 @@
+#include "RenderGraph.h"
+#include "VulkanRenderer.h"
+#include "CommandBuffer.h"
+#include "FrameBuffer.h"
+#include "Device.h"
+#include "SamplerCache.h"
+#include "ImageHelpers.h"
+
+namespace plumbus::vk
+{
+	static bool IsDepthFormat(VkFormat format)
+	{
+		return format == VK_FORMAT_D16_UNORM ||
+			   format == VK_FORMAT_D16_UNORM_S8_UINT ||
+			   format == VK_FORMAT_D24_UNORM_S8_UINT ||
+			   format == VK_FORMAT_D32_SFLOAT ||
+			   format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+
+	static VkImageAspectFlags GetAspect(VkFormat format)
+	{
+		if (!IsDepthFormat(format))
+		{
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+
+		return ImageHelpers::HasStencilComponent(format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+	}
+
+	static constexpr VkAccessFlags s_WriteAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	void RenderGraphPass::WriteColour(RenderGraphResource resource, bool clear)
+	{
+		m_ColourAttachments.push_back(resource);
+		VkAccessFlags access = clear ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		m_Accesses.push_back({ resource, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, access, true, clear, false });
+	}
+
+	void RenderGraphPass::WriteDepth(RenderGraphResource resource, bool clear)
+	{
+		PL_ASSERT(m_DepthAttachment == UINT32_MAX, "a pass can only have one depth attachment.");
+		m_DepthAttachment = resource;
+		m_Accesses.push_back({ resource,
+							   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+							   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+							   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+							   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+							   true, clear, false });
+	}
+
+	void RenderGraphPass::Read(RenderGraphResource resource)
+	{
+		// the layout depends on the format, it's filled in once the graph compiles.
+		m_Accesses.push_back({ resource, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false, false, false });
+	}
+
+	void RenderGraphPass::WriteExternal(RenderGraphResource resource, VkImageLayout initialLayout, VkImageLayout finalLayout)
+	{
+		m_Accesses.push_back({ resource, initialLayout, finalLayout, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, true, false, true });
+	}
+
+	RenderGraphRef RenderGraph::CreateRenderGraph()
+	{
+		return std::make_shared<RenderGraph>();
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		DeviceRef device = VulkanRenderer::Get()->GetDevice();
+		m_Passes.clear();
+
+		for (Resource& resource : m_Resources)
+		{
+			if (!resource.m_Imported)
+			{
+				vkDestroyImageView(device->GetVulkanDevice(), resource.m_ImageView, nullptr);
+				vkDestroyImage(device->GetVulkanDevice(), resource.m_Image, nullptr);
+			}
+		}
+
+		for (MemorySlot& slot : m_Slots)
+		{
+			if (slot.m_Allocation.IsValid())
+			{
+				device->GetMemoryAllocator()->Free(slot.m_Allocation);
+			}
+		}
+
+		for (VkRenderPass renderPass : m_RenderPasses)
+		{
+			vkDestroyRenderPass(device->GetVulkanDevice(), renderPass, nullptr);
+		}
+	}
+
+	RenderGraphResource RenderGraph::CreateAttachment(const std::string& name, const RenderGraphAttachmentInfo& info)
+	{
+		PL_ASSERT(!m_Compiled);
+
+		Resource resource;
+		resource.m_Name = name;
+		resource.m_Info = info;
+		resource.m_Aspect = GetAspect(info.m_Format);
+		m_Resources.push_back(resource);
+		return static_cast<RenderGraphResource>(m_Resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::ImportImage(const std::string& name, VkImage image, VkFormat format, VkImageLayout layout)
+	{
+		PL_ASSERT(!m_Compiled);
+
+		Resource resource;
+		resource.m_Name = name;
+		resource.m_Info = { format, 0, 0 };
+		resource.m_Imported = true;
+		resource.m_Image = image;
+		resource.m_Aspect = GetAspect(format);
+		resource.m_Layout = layout;
+		// imported images never alias, they just need somewhere to keep their hazard state.
+		RenderGraphResource index = static_cast<RenderGraphResource>(m_Resources.size());
+		resource.m_Slot = static_cast<uint32_t>(m_Slots.size());
+		MemorySlot slot;
+		slot.m_Occupant = index;
+		m_Slots.push_back(slot);
+		m_Resources.push_back(resource);
+		return index;
+	}
+
+	void RenderGraph::SetImportedImage(RenderGraphResource resource, VkImage image)
+	{
+		PL_ASSERT(m_Resources[resource].m_Imported);
+		m_Resources[resource].m_Image = image;
+	}
+
+	void RenderGraph::Export(RenderGraphResource resource)
+	{
+		PL_ASSERT(!m_Compiled);
+		m_Resources[resource].m_Exported = true;
+	}
+
+	RenderGraphPass* RenderGraph::AddPass(const std::string& name)
+	{
+		PL_ASSERT(!m_Compiled);
+		m_Passes.push_back(std::make_unique<RenderGraphPass>(name));
+		return m_Passes.back().get();
+	}
+
+	void RenderGraph::Compile()
+	{
+		PL_ASSERT(!m_Compiled, "the render graph has already been compiled.");
+
+		for (std::unique_ptr<RenderGraphPass>& pass : m_Passes)
+		{
+			for (RenderGraphPass::Access& access : pass->m_Accesses)
+			{
+				if (!access.m_Write)
+				{
+					Resource& resource = m_Resources[access.m_Resource];
+					resource.m_Sampled = true;
+					access.m_Layout = IsDepthFormat(resource.m_Info.m_Format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+					access.m_FinalLayout = access.m_Layout;
+				}
+			}
+		}
+
+		CullPasses();
+		ComputeLifetimes();
+		CreateTransients();
+
+		VkSamplerCreateInfo samplerCreateInfo{};
+		samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+		samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerCreateInfo.maxAnisotropy = 1.0f;
+		samplerCreateInfo.maxLod = 1.0f;
+		samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		m_Sampler = VulkanRenderer::Get()->GetDevice()->GetSamplerCache()->GetSampler(samplerCreateInfo);
+
+		for (uint32_t i = 0; i < m_Passes.size(); ++i)
+		{
+			RenderGraphPass& pass = *m_Passes[i];
+			if (!pass.m_Culled && (!pass.m_ColourAttachments.empty() || pass.m_DepthAttachment != UINT32_MAX))
+			{
+				CreateRenderPass(pass, i);
+			}
+		}
+
+		m_Compiled = true;
+		Log::Info("Render graph: %u passes, %u culled, %u transient attachments (%u aliased), %llu KB instead of %llu KB",
+				  m_Stats.m_Passes,
+				  m_Stats.m_CulledPasses,
+				  m_Stats.m_TransientAttachments,
+				  m_Stats.m_AliasedAttachments,
+				  (unsigned long long)(m_Stats.m_AllocatedBytes / 1024),
+				  (unsigned long long)(m_Stats.m_TransientBytes / 1024));
+	}
+
+	void RenderGraph::CullPasses()
+	{
+		// walk backwards from what leaves the graph, a pass is only kept if something later uses what it writes.
+		std::vector<bool> needed(m_Resources.size());
+		for (uint32_t i = 0; i < m_Resources.size(); ++i)
+		{
+			needed[i] = m_Resources[i].m_Imported || m_Resources[i].m_Exported;
+		}
+
+		m_Stats.m_Passes = static_cast<uint32_t>(m_Passes.size());
+		m_Stats.m_CulledPasses = 0;
+		for (int32_t i = static_cast<int32_t>(m_Passes.size()) - 1; i >= 0; --i)
+		{
+			RenderGraphPass& pass = *m_Passes[i];
+			bool live = pass.m_SideEffects;
+			for (const RenderGraphPass::Access& access : pass.m_Accesses)
+			{
+				live |= access.m_Write && needed[access.m_Resource];
+			}
+
+			pass.m_Culled = !live;
+			if (!live)
+			{
+				Log::Info("Render graph: culled pass %s, nothing reads its output.", pass.m_Name.c_str());
+				m_Stats.m_CulledPasses++;
+				continue;
+			}
+
+			for (const RenderGraphPass::Access& access : pass.m_Accesses)
+			{
+				// loading an attachment reads it too.
+				if (!access.m_Write || (!access.m_Clear && !access.m_External))
+				{
+					needed[access.m_Resource] = true;
+				}
+			}
+		}
+	}
+
+	void RenderGraph::ComputeLifetimes()
+	{
+		for (uint32_t i = 0; i < m_Passes.size(); ++i)
+		{
+			if (m_Passes[i]->m_Culled)
+			{
+				continue;
+			}
+
+			for (const RenderGraphPass::Access& access : m_Passes[i]->m_Accesses)
+			{
+				Resource& resource = m_Resources[access.m_Resource];
+				resource.m_FirstPass = std::min(resource.m_FirstPass, i);
+				resource.m_LastPass = std::max(resource.m_LastPass, i);
+			}
+		}
+
+		for (Resource& resource : m_Resources)
+		{
+			if (resource.m_Exported)
+			{
+				resource.m_LastPass = static_cast<uint32_t>(m_Passes.size());
+			}
+		}
+	}
+
+	void RenderGraph::CreateTransients()
+	{
+		DeviceRef device = VulkanRenderer::Get()->GetDevice();
+
+		// anything only touched by culled passes is never created.
+		std::vector<RenderGraphResource> transients;
+		for (uint32_t i = 0; i < m_Resources.size(); ++i)
+		{
+			if (!m_Resources[i].m_Imported && m_Resources[i].m_FirstPass != UINT32_MAX)
+			{
+				transients.push_back(i);
+			}
+		}
+		std::stable_sort(transients.begin(), transients.end(), [this](RenderGraphResource lhs, RenderGraphResource rhs)
+		{
+			return m_Resources[lhs].m_FirstPass < m_Resources[rhs].m_FirstPass;
+		});
+
+		// in order of first use, each attachment takes over the memory of one that's finished with by then.
+		uint32_t firstTransientSlot = static_cast<uint32_t>(m_Slots.size());
+		for (RenderGraphResource index : transients)
+		{
+			Resource& resource = m_Resources[index];
+			bool depth = IsDepthFormat(resource.m_Info.m_Format);
+
+			VkImageCreateInfo imageInfo = {};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = resource.m_Info.m_Format;
+			imageInfo.extent = { resource.m_Info.m_Width, resource.m_Info.m_Height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = depth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+			if (resource.m_Sampled || resource.m_Exported)
+			{
+				imageInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+			}
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			CHECK_VK_RESULT(vkCreateImage(device->GetVulkanDevice(), &imageInfo, nullptr, &resource.m_Image));
+
+			VkMemoryRequirements requirements;
+			vkGetImageMemoryRequirements(device->GetVulkanDevice(), resource.m_Image, &requirements);
+			m_Stats.m_TransientAttachments++;
+			m_Stats.m_TransientBytes += requirements.size;
+
+			for (uint32_t slotIndex = firstTransientSlot; slotIndex < m_Slots.size(); ++slotIndex)
+			{
+				MemorySlot& slot = m_Slots[slotIndex];
+				if (slot.m_LastPass < resource.m_FirstPass && (slot.m_Requirements.memoryTypeBits & requirements.memoryTypeBits) != 0)
+				{
+					slot.m_Requirements.size = std::max(slot.m_Requirements.size, requirements.size);
+					slot.m_Requirements.alignment = std::max(slot.m_Requirements.alignment, requirements.alignment);
+					slot.m_Requirements.memoryTypeBits &= requirements.memoryTypeBits;
+					slot.m_LastPass = resource.m_LastPass;
+					resource.m_Slot = slotIndex;
+					m_Stats.m_AliasedAttachments++;
+					break;
+				}
+			}
+
+			if (resource.m_Slot == UINT32_MAX)
+			{
+				MemorySlot slot;
+				slot.m_Requirements = requirements;
+				slot.m_LastPass = resource.m_LastPass;
+				resource.m_Slot = static_cast<uint32_t>(m_Slots.size());
+				m_Slots.push_back(slot);
+			}
+		}
+
+		for (uint32_t slotIndex = firstTransientSlot; slotIndex < m_Slots.size(); ++slotIndex)
+		{
+			MemorySlot& slot = m_Slots[slotIndex];
+			bool allocated = device->GetMemoryAllocator()->Allocate(slot.m_Requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationResourceType::Optimal, AllocationStrategy::FreeList, slot.m_Allocation);
+			PL_ASSERT(allocated, "failed to allocate render graph attachment memory.");
+			m_Stats.m_AllocatedBytes += slot.m_Requirements.size;
+		}
+
+		for (RenderGraphResource index : transients)
+		{
+			Resource& resource = m_Resources[index];
+			const MemorySlot& slot = m_Slots[resource.m_Slot];
+			CHECK_VK_RESULT(vkBindImageMemory(device->GetVulkanDevice(), resource.m_Image, slot.m_Allocation.m_Memory, slot.m_Allocation.m_Offset));
+
+			// views of depth formats only sample the depth.
+			VkImageAspectFlags viewAspect = resource.m_Aspect & VK_IMAGE_ASPECT_DEPTH_BIT ? VK_IMAGE_ASPECT_DEPTH_BIT : resource.m_Aspect;
+			resource.m_ImageView = ImageHelpers::CreateImageView(resource.m_Image, resource.m_Info.m_Format, VK_IMAGE_VIEW_TYPE_2D, viewAspect);
+		}
+	}
+
+	bool RenderGraph::IsUsedAfter(RenderGraphResource resource, uint32_t passIndex) const
+	{
+		const Resource& info = m_Resources[resource];
+		if (info.m_Imported || info.m_Exported)
+		{
+			return true;
+		}
+
+		for (uint32_t i = passIndex + 1; i < m_Passes.size(); ++i)
+		{
+			if (m_Passes[i]->m_Culled)
+			{
+				continue;
+			}
+
+			for (const RenderGraphPass::Access& access : m_Passes[i]->m_Accesses)
+			{
+				if (access.m_Resource == resource)
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	bool RenderGraph::IsWrittenBefore(RenderGraphResource resource, uint32_t passIndex) const
+	{
+		for (uint32_t i = 0; i < passIndex; ++i)
+		{
+			if (m_Passes[i]->m_Culled)
+			{
+				continue;
+			}
+
+			for (const RenderGraphPass::Access& access : m_Passes[i]->m_Accesses)
+			{
+				if (access.m_Resource == resource && access.m_Write)
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	void RenderGraph::CreateRenderPass(RenderGraphPass& pass, uint32_t passIndex)
+	{
+		std::vector<RenderGraphResource> attachments = pass.m_ColourAttachments;
+		if (pass.m_DepthAttachment != UINT32_MAX)
+		{
+			attachments.push_back(pass.m_DepthAttachment);
+		}
+
+		std::vector<VkAttachmentDescription> attachmentDescs(attachments.size());
+		std::vector<VkAttachmentReference> colourReferences;
+		VkAttachmentReference depthReference = {};
+		std::vector<VkImageView> views;
+		std::vector<VkFormat> formats;
+		std::vector<std::string> names;
+
+		for (uint32_t i = 0; i < attachments.size(); ++i)
+		{
+			RenderGraphResource resource = attachments[i];
+			const Resource& info = m_Resources[resource];
+			auto access = std::find_if(pass.m_Accesses.begin(), pass.m_Accesses.end(), [resource](const RenderGraphPass::Access& access) { return access.m_Resource == resource && access.m_Write; });
+			PL_ASSERT(access != pass.m_Accesses.end());
+
+			// the graph's barriers put the attachment in its layout before the pass and take it out afterwards,
+			// so the render pass itself never transitions anything.
+			VkAttachmentDescription& desc = attachmentDescs[i];
+			desc.format = info.m_Info.m_Format;
+			desc.samples = VK_SAMPLE_COUNT_1_BIT;
+			desc.loadOp = access->m_Clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : IsWrittenBefore(resource, passIndex) ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			desc.storeOp = IsUsedAfter(resource, passIndex) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			desc.initialLayout = access->m_Layout;
+			desc.finalLayout = access->m_Layout;
+
+			if (resource == pass.m_DepthAttachment)
+			{
+				depthReference = { i, access->m_Layout };
+			}
+			else
+			{
+				colourReferences.push_back({ i, access->m_Layout });
+			}
+
+			views.push_back(info.m_ImageView);
+			formats.push_back(info.m_Info.m_Format);
+			names.push_back(info.m_Name);
+		}
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = static_cast<uint32_t>(colourReferences.size());
+		subpass.pColorAttachments = colourReferences.data();
+		if (pass.m_DepthAttachment != UINT32_MAX)
+		{
+			subpass.pDepthStencilAttachment = &depthReference;
+		}
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescs.size());
+		renderPassInfo.pAttachments = attachmentDescs.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		VkRenderPass renderPass;
+		CHECK_VK_RESULT(vkCreateRenderPass(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), &renderPassInfo, nullptr, &renderPass));
+		m_RenderPasses.push_back(renderPass);
+
+		const RenderGraphAttachmentInfo& size = m_Resources[attachments[0]].m_Info;
+		pass.m_FrameBuffer = FrameBuffer::CreateFrameBuffer(size.m_Width, size.m_Height, renderPass, views, formats, names);
+		pass.m_FrameBuffer->SetSampler(m_Sampler);
+	}
+
+	void RenderGraph::Execute(const CommandBufferRef& commandBuffer)
+	{
+		PL_ASSERT(m_Compiled, "the render graph has to be compiled before it's executed.");
+
+		m_Stats.m_ExecutedPasses = 0;
+		m_Stats.m_Barriers = 0;
+		m_Stats.m_BarrierBatches = 0;
+
+		for (std::unique_ptr<RenderGraphPass>& passPtr : m_Passes)
+		{
+			RenderGraphPass& pass = *passPtr;
+			if (pass.m_Culled || (pass.m_Condition && !pass.m_Condition()))
+			{
+				continue;
+			}
+
+			// every barrier the pass needs goes into one call.
+			m_Barriers.clear();
+			VkPipelineStageFlags srcStageMask = 0;
+			VkPipelineStageFlags dstStageMask = 0;
+			for (const RenderGraphPass::Access& access : pass.m_Accesses)
+			{
+				Resource& resource = m_Resources[access.m_Resource];
+				MemorySlot& slot = m_Slots[resource.m_Slot];
+
+				// another image has used this memory since, so whatever this one held is gone.
+				bool aliased = slot.m_Occupant != access.m_Resource;
+				bool discard = aliased || (access.m_Write && access.m_Clear);
+				VkImageLayout oldLayout = aliased ? VK_IMAGE_LAYOUT_UNDEFINED : resource.m_Layout;
+				if (discard && oldLayout != access.m_Layout)
+				{
+					oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				}
+
+				bool layoutChange = oldLayout != access.m_Layout;
+				VkPipelineStageFlags srcStages = 0;
+				bool needsBarrier;
+				if (access.m_External)
+				{
+					// the pass's own render pass synchronises with what came before it.
+					needsBarrier = access.m_Layout != VK_IMAGE_LAYOUT_UNDEFINED && layoutChange;
+					srcStages = slot.m_WriteStages | slot.m_ReadStages;
+				}
+				else if (access.m_Write || layoutChange)
+				{
+					srcStages = slot.m_WriteStages | slot.m_ReadStages;
+					needsBarrier = layoutChange || srcStages != 0;
+				}
+				else
+				{
+					// reads after reads need nothing, a read after a write needs the write made visible to it.
+					srcStages = (slot.m_VisibleStages & access.m_Stages) == access.m_Stages ? 0 : slot.m_WriteStages;
+					needsBarrier = srcStages != 0;
+				}
+
+				if (needsBarrier)
+				{
+					VkImageMemoryBarrier barrier = {};
+					barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+					barrier.srcAccessMask = slot.m_WriteAccess;
+					barrier.dstAccessMask = access.m_AccessMask;
+					barrier.oldLayout = oldLayout;
+					barrier.newLayout = access.m_Layout;
+					barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+					barrier.image = resource.m_Image;
+					barrier.subresourceRange = { resource.m_Aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+					m_Barriers.push_back(barrier);
+
+					srcStageMask |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+					dstStageMask |= access.m_Stages;
+				}
+
+				if (access.m_External)
+				{
+					slot.m_WriteStages = 0;
+					slot.m_WriteAccess = 0;
+					slot.m_ReadStages = 0;
+					slot.m_VisibleStages = 0;
+				}
+				else if (access.m_Write)
+				{
+					slot.m_WriteStages = access.m_Stages;
+					slot.m_WriteAccess = access.m_AccessMask & s_WriteAccess;
+					slot.m_ReadStages = 0;
+					slot.m_VisibleStages = 0;
+				}
+				else
+				{
+					slot.m_ReadStages |= access.m_Stages;
+					if (needsBarrier)
+					{
+						slot.m_VisibleStages |= access.m_Stages;
+					}
+				}
+
+				resource.m_Layout = access.m_FinalLayout;
+				slot.m_Occupant = access.m_Resource;
+			}
+
+			if (!m_Barriers.empty())
+			{
+				vkCmdPipelineBarrier(commandBuffer->GetVulkanCommandBuffer(), srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(m_Barriers.size()), m_Barriers.data());
+				m_Stats.m_Barriers += static_cast<uint32_t>(m_Barriers.size());
+				m_Stats.m_BarrierBatches++;
+			}
+
+			if (pass.m_FrameBuffer)
+			{
+				commandBuffer->SetFrameBuffer(pass.m_FrameBuffer);
+				commandBuffer->BeginRenderPass(pass.m_SecondaryCommandBuffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+			}
+
+			if (pass.m_Record)
+			{
+				pass.m_Record(commandBuffer);
+			}
+
+			if (pass.m_FrameBuffer)
+			{
+				commandBuffer->EndRenderPass();
+			}
+
+			m_Stats.m_ExecutedPasses++;
+		}
+	}
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "plumbus.h"
+#include "MemoryAllocator.h"
+
+namespace plumbus::vk
+{
+	typedef uint32_t RenderGraphResource;
+
+	struct RenderGraphAttachmentInfo
+	{
+		VkFormat m_Format;
+		uint32_t m_Width;
+		uint32_t m_Height;
+	};
+
+	struct RenderGraphStats
+	{
+		uint32_t m_Passes = 0;
+		uint32_t m_CulledPasses = 0;
+		uint32_t m_ExecutedPasses = 0; // last frame, passes whose condition failed are skipped.
+		uint32_t m_Barriers = 0; // image barriers last frame.
+		uint32_t m_BarrierBatches = 0; // vkCmdPipelineBarrier calls last frame.
+		uint32_t m_TransientAttachments = 0;
+		uint32_t m_AliasedAttachments = 0; // transients sharing memory with an earlier one.
+		VkDeviceSize m_TransientBytes = 0; // what the transients would take with their own memory each.
+		VkDeviceSize m_AllocatedBytes = 0;
+	};
+
+	class RenderGraphPass
+	{
+	public:
+		typedef std::function<void(const CommandBufferRef&)> RecordFunction;
+
+		RenderGraphPass(std::string name) : m_Name(std::move(name)) {}
+
+		// attachments the graph builds this pass's render pass and frame buffer from. colour attachments are in the
+		// order they're added, followed by the depth attachment. without clear the previous contents are loaded.
+		void WriteColour(RenderGraphResource resource, bool clear = true);
+		void WriteDepth(RenderGraphResource resource, bool clear = true);
+		// sampled in a fragment shader.
+		void Read(RenderGraphResource resource);
+		// for passes that bring their own frame buffer. the render pass's own dependencies cover the writes, the graph
+		// only makes sure the image is in initialLayout beforehand. an undefined initialLayout needs nothing at all.
+		void WriteExternal(RenderGraphResource resource, VkImageLayout initialLayout, VkImageLayout finalLayout);
+
+		void SetFrameBuffer(const FrameBufferRef& frameBuffer) { m_FrameBuffer = frameBuffer; }
+		const FrameBufferRef& GetFrameBuffer() const { return m_FrameBuffer; }
+		void SetRecordFunction(RecordFunction function) { m_Record = std::move(function); }
+		// checked every frame before recording, a pass with nothing to do is skipped along with its barriers.
+		void SetCondition(std::function<bool()> condition) { m_Condition = std::move(condition); }
+		// the render pass is begun for secondaries, the record function executes them.
+		void SetSecondaryCommandBuffers(bool secondary) { m_SecondaryCommandBuffers = secondary; }
+		// kept even when nothing in the graph reads what it writes.
+		void SetSideEffects(bool sideEffects) { m_SideEffects = sideEffects; }
+
+		const std::string& GetName() const { return m_Name; }
+		bool IsCulled() const { return m_Culled; }
+
+	private:
+		friend class RenderGraph;
+
+		struct Access
+		{
+			RenderGraphResource m_Resource;
+			VkImageLayout m_Layout;
+			VkImageLayout m_FinalLayout;
+			VkPipelineStageFlags m_Stages;
+			VkAccessFlags m_AccessMask;
+			bool m_Write;
+			bool m_Clear;
+			bool m_External;
+		};
+
+		std::string m_Name;
+		std::vector<Access> m_Accesses;
+		std::vector<RenderGraphResource> m_ColourAttachments;
+		RenderGraphResource m_DepthAttachment = UINT32_MAX;
+
+		FrameBufferRef m_FrameBuffer;
+		RecordFunction m_Record;
+		std::function<bool()> m_Condition;
+		bool m_SecondaryCommandBuffers = false;
+		bool m_SideEffects = false;
+		bool m_Culled = false;
+	};
+
+	// the frame as a list of passes that declare which images they read and write. from that the graph drops passes
+	// whose output nobody uses, builds the render passes for the attachments it owns, places the barriers between
+	// passes and lets attachments whose lifetimes don't overlap share memory. passes run in the order they're added.
+	class RenderGraph
+	{
+	public:
+		static RenderGraphRef CreateRenderGraph();
+
+		RenderGraph() = default;
+		~RenderGraph();
+
+		// owned by the graph and only valid within a frame, names don't need to be unique and become the attachment
+		// names in the pass's frame buffer.
+		RenderGraphResource CreateAttachment(const std::string& name, const RenderGraphAttachmentInfo& info);
+		// an image owned elsewhere, currently in layout. the graph tracks its layout from then on.
+		RenderGraphResource ImportImage(const std::string& name, VkImage image, VkFormat format, VkImageLayout layout);
+		// for imported images that get recreated or swapped each frame.
+		void SetImportedImage(RenderGraphResource resource, VkImage image);
+		// kept alive to the end of the frame, for attachments something outside the graph samples (debug views).
+		void Export(RenderGraphResource resource);
+
+		RenderGraphPass* AddPass(const std::string& name);
+
+		void Compile();
+		// records every pass that survived culling into the command buffer, with the barriers between them.
+		void Execute(const CommandBufferRef& commandBuffer);
+
+		VkImageView GetImageView(RenderGraphResource resource) const { return m_Resources[resource].m_ImageView; }
+		const RenderGraphStats& GetStats() const { return m_Stats; }
+
+	private:
+		// hazard tracking is per block of memory rather than per image, so an image taking over memory from one it
+		// aliases waits for the previous one's accesses too.
+		struct MemorySlot
+		{
+			MemoryAllocation m_Allocation;
+			VkMemoryRequirements m_Requirements = {};
+			uint32_t m_LastPass = 0;
+
+			RenderGraphResource m_Occupant = UINT32_MAX;
+			VkPipelineStageFlags m_WriteStages = 0;
+			VkAccessFlags m_WriteAccess = 0;
+			VkPipelineStageFlags m_ReadStages = 0; // since the last write.
+			VkPipelineStageFlags m_VisibleStages = 0; // the last write has been made visible to these.
+		};
+
+		struct Resource
+		{
+			std::string m_Name;
+			RenderGraphAttachmentInfo m_Info;
+			bool m_Imported = false;
+			bool m_Exported = false;
+			bool m_Sampled = false;
+
+			VkImage m_Image = VK_NULL_HANDLE;
+			VkImageView m_ImageView = VK_NULL_HANDLE;
+			VkImageAspectFlags m_Aspect = 0;
+			VkImageLayout m_Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			uint32_t m_FirstPass = UINT32_MAX;
+			uint32_t m_LastPass = 0;
+			uint32_t m_Slot = UINT32_MAX;
+		};
+
+		void CullPasses();
+		void ComputeLifetimes();
+		void CreateTransients();
+		void CreateRenderPass(RenderGraphPass& pass, uint32_t passIndex);
+		bool IsUsedAfter(RenderGraphResource resource, uint32_t passIndex) const;
+		bool IsWrittenBefore(RenderGraphResource resource, uint32_t passIndex) const;
+
+		std::vector<Resource> m_Resources;
+		std::vector<std::unique_ptr<RenderGraphPass>> m_Passes;
+		std::vector<MemorySlot> m_Slots;
+		std::vector<VkRenderPass> m_RenderPasses;
+		VkSampler m_Sampler = VK_NULL_HANDLE; // from the device SamplerCache, not destroyed here.
+		bool m_Compiled = false;
+
+		std::vector<VkImageMemoryBarrier> m_Barriers;
+		RenderGraphStats m_Stats;
+	};
+}
@@ -0,0 +1,145 @@
+#include "RenderQueue.h"
+#include "Mesh.h"
+#include "MaterialInstance.h"
+#include "Material.h"
+#include "components/ModelComponent.h"
+
+namespace plumbus::vk
+{
+	static uint64_t HashAddress(const void* address, uint32_t bits)
+	{
+		// fibonacci hashing, the top bits of the product are the well mixed ones.
+		uint64_t value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address));
+		return (value * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+	}
+
+	static uint64_t QuantizeDepth(float viewDepth)
+	{
+		// the bits of a positive float sort the same as its value, the top ones keep the exponent and some mantissa.
+		viewDepth = std::max(viewDepth, 0.f);
+		uint32_t bits;
+		memcpy(&bits, &viewDepth, sizeof(bits));
+		return bits >> (32 - RenderQueue::s_DepthBits);
+	}
+
+	uint64_t RenderQueue::MakeSortKey(uint32_t pass, const void* pipeline, const void* descriptorSet, const void* vertexBuffer, float viewDepth)
+	{
+		static_assert(s_PassBits + s_PipelineBits + s_DescriptorSetBits + s_VertexBufferBits + s_DepthBits == 64, "the sort key fields have to fill 64 bits.");
+		PL_ASSERT(pass < (1u << s_PassBits));
+
+		uint64_t key = pass;
+		key = (key << s_PipelineBits) | HashAddress(pipeline, s_PipelineBits);
+		key = (key << s_DescriptorSetBits) | HashAddress(descriptorSet, s_DescriptorSetBits);
+		key = (key << s_VertexBufferBits) | HashAddress(vertexBuffer, s_VertexBufferBits);
+		key = (key << s_DepthBits) | QuantizeDepth(viewDepth);
+		return key;
+	}
+
+	void RenderQueue::Clear()
+	{
+		m_Packets.clear();
+		m_Batches.clear();
+		m_InstanceData.clear();
+	}
+
+	void RenderQueue::Add(uint32_t pass, Mesh* mesh, float viewDepth)
+	{
+		// each mesh owns its vertex buffer and its material instance owns the descriptor sets.
+		const MaterialInstanceRef& materialInstance = mesh->GetMaterialInstance();
+		const void* pipeline = materialInstance->GetMaterial()->GetPipeline().get();
+		uint64_t instanceKey = mesh->GetInstanceKey();
+		if (instanceKey != 0)
+		{
+			// the key is only hashed, its value standing in for an address is fine.
+			const void* instance = reinterpret_cast<const void*>(static_cast<uintptr_t>(instanceKey));
+			m_Packets.push_back({ MakeSortKey(pass, pipeline, instance, instance, viewDepth), instanceKey, mesh });
+		}
+		else
+		{
+			m_Packets.push_back({ MakeSortKey(pass, pipeline, materialInstance.get(), mesh, viewDepth), 0, mesh });
+		}
+	}
+
+	void RenderQueue::Sort()
+	{
+		auto sortStart = std::chrono::steady_clock::now();
+
+		// lsd radix sort a byte at a time, stable so equal keys keep the order they were added in.
+		uint32_t count = static_cast<uint32_t>(m_Packets.size());
+		m_Scratch.resize(count);
+		m_Stats.m_Packets = count;
+		m_Stats.m_SortPasses = 0;
+
+		for (uint32_t shift = 0; shift < 64; shift += 8)
+		{
+			uint32_t offsets[256] = {};
+			for (const DrawPacket& packet : m_Packets)
+			{
+				offsets[(packet.m_SortKey >> shift) & 0xFF]++;
+			}
+
+			// a digit every key shares wouldn't move anything.
+			if (count == 0 || offsets[(m_Packets[0].m_SortKey >> shift) & 0xFF] == count)
+			{
+				continue;
+			}
+
+			uint32_t total = 0;
+			for (uint32_t& offset : offsets)
+			{
+				uint32_t digitCount = offset;
+				offset = total;
+				total += digitCount;
+			}
+
+			for (const DrawPacket& packet : m_Packets)
+			{
+				m_Scratch[offsets[(packet.m_SortKey >> shift) & 0xFF]++] = packet;
+			}
+
+			m_Packets.swap(m_Scratch);
+			m_Stats.m_SortPasses++;
+		}
+
+		m_Stats.m_SortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sortStart).count();
+	}
+
+	void RenderQueue::BuildBatches()
+	{
+		m_Batches.clear();
+		m_InstanceData.clear();
+		m_Stats.m_InstancedBatches = 0;
+		m_Stats.m_Instances = 0;
+
+		uint32_t count = static_cast<uint32_t>(m_Packets.size());
+		for (uint32_t start = 0; start < count;)
+		{
+			// the sort key only hashes the instance key, so the run is checked against the real one.
+			uint64_t instanceKey = m_Packets[start].m_InstanceKey;
+			uint32_t end = start + 1;
+			while (instanceKey != 0 && end < count && m_Packets[end].m_InstanceKey == instanceKey)
+			{
+				end++;
+			}
+
+			if (end - start > 1)
+			{
+				m_Batches.push_back({ m_Packets[start].m_Mesh, static_cast<uint32_t>(m_InstanceData.size()), end - start });
+				for (uint32_t i = start; i < end; ++i)
+				{
+					m_InstanceData.push_back(m_Packets[i].m_Mesh->GetOwner()->GetModelMatrix());
+				}
+				m_Stats.m_InstancedBatches++;
+				m_Stats.m_Instances += end - start;
+			}
+			else
+			{
+				m_Batches.push_back({ m_Packets[start].m_Mesh, 0, 0 });
+			}
+
+			start = end;
+		}
+
+		m_Stats.m_Batches = static_cast<uint32_t>(m_Batches.size());
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "plumbus.h"
+
+namespace plumbus::vk
+{
+	class Mesh;
+
+	struct DrawPacket
+	{
+		uint64_t m_SortKey;
+		uint64_t m_InstanceKey;
+		Mesh* m_Mesh;
+	};
+
+	// one draw call. an instanced batch draws its mesh once per model matrix in the queue's instance data.
+	struct DrawBatch
+	{
+		Mesh* m_Mesh;
+		uint32_t m_FirstInstance;
+		uint32_t m_InstanceCount; // 0 for a regular draw that uses the mesh's own uniforms.
+	};
+
+	struct RenderQueueStats
+	{
+		uint32_t m_Packets = 0;
+		uint32_t m_SortPasses = 0; // radix passes that weren't skipped because every key had the same digit.
+		double m_SortMs = 0.0;
+		uint32_t m_Batches = 0; // draw calls left after merging instances.
+		uint32_t m_InstancedBatches = 0;
+		uint32_t m_Instances = 0;
+	};
+
+	// collects a pass's draws and orders them so draws sharing state end up next to each other, the command buffer
+	// then skips the binds that would set what's already bound. from the most significant bits down the key holds the
+	// pass, pipeline, descriptor set, vertex buffer and view depth, so within the same state draws go front to back.
+	// meshes that can be instanced use their instance key in place of the descriptor set and vertex buffer, so copies of
+	// the same mesh sort together and BuildBatches can merge them into one draw.
+	class RenderQueue
+	{
+	public:
+		static constexpr uint32_t s_PassBits = 4;
+		static constexpr uint32_t s_PipelineBits = 12;
+		static constexpr uint32_t s_DescriptorSetBits = 16;
+		static constexpr uint32_t s_VertexBufferBits = 16;
+		static constexpr uint32_t s_DepthBits = 16;
+
+		// the state is only compared for equality, so objects are identified by a hash of their address. a collision
+		// just puts two groups side by side.
+		static uint64_t MakeSortKey(uint32_t pass, const void* pipeline, const void* descriptorSet, const void* vertexBuffer, float viewDepth);
+
+		void Clear();
+		// depth is the view space distance along the camera's forward axis.
+		void Add(uint32_t pass, Mesh* mesh, float viewDepth);
+		void Sort();
+		// merges runs of sorted packets that share an instance key, must come after Sort.
+		void BuildBatches();
+
+		const std::vector<DrawPacket>& GetPackets() const { return m_Packets; }
+		const std::vector<DrawBatch>& GetBatches() const { return m_Batches; }
+		// model matrices of every instanced batch, each batch's run starts at its first instance.
+		const std::vector<glm::mat4>& GetInstanceData() const { return m_InstanceData; }
+		const RenderQueueStats& GetStats() const { return m_Stats; }
+
+	private:
+		std::vector<DrawPacket> m_Packets;
+		// the radix sort ping pongs between the two.
+		std::vector<DrawPacket> m_Scratch;
+		std::vector<DrawBatch> m_Batches;
+		std::vector<glm::mat4> m_InstanceData;
+		RenderQueueStats m_Stats;
+	};
+}
@@ -0,0 +1,77 @@
+#include "plumbus.h"
+
+#include "renderer/vk/SamplerCache.h"
+
+namespace plumbus::vk
+{
+	SamplerCacheRef SamplerCache::CreateSamplerCache(VkDevice device)
+	{
+		return std::make_shared<SamplerCache>(device);
+	}
+
+	SamplerCache::SamplerCache(VkDevice device)
+		: m_Device(device)
+	{
+	}
+
+	SamplerCache::~SamplerCache()
+	{
+		for (const auto& [_, sampler] : m_Samplers)
+		{
+			vkDestroySampler(m_Device, sampler, nullptr);
+		}
+		m_Samplers.clear();
+	}
+
+	SamplerCache::SamplerKey SamplerCache::MakeKey(const VkSamplerCreateInfo& createInfo)
+	{
+		// field by field, the padding in the struct itself isn't guaranteed to be zeroed.
+		auto floatBits = [](float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		};
+
+		return SamplerKey {
+			createInfo.flags,
+			static_cast<uint32_t>(createInfo.magFilter),
+			static_cast<uint32_t>(createInfo.minFilter),
+			static_cast<uint32_t>(createInfo.mipmapMode),
+			static_cast<uint32_t>(createInfo.addressModeU),
+			static_cast<uint32_t>(createInfo.addressModeV),
+			static_cast<uint32_t>(createInfo.addressModeW),
+			floatBits(createInfo.mipLodBias),
+			createInfo.anisotropyEnable,
+			floatBits(createInfo.maxAnisotropy),
+			createInfo.compareEnable,
+			static_cast<uint32_t>(createInfo.compareOp),
+			floatBits(createInfo.minLod),
+			floatBits(createInfo.maxLod),
+			static_cast<uint32_t>(createInfo.borderColor),
+			createInfo.unnormalizedCoordinates
+		};
+	}
+
+	VkSampler SamplerCache::GetSampler(const VkSamplerCreateInfo& createInfo)
+	{
+		PL_ASSERT(createInfo.pNext == nullptr);
+
+		SamplerKey key = MakeKey(createInfo);
+		auto it = m_Samplers.find(key);
+		if (it != m_Samplers.end())
+		{
+			return it->second;
+		}
+
+		VkSampler sampler = VK_NULL_HANDLE;
+		if (vkCreateSampler(m_Device, &createInfo, nullptr, &sampler) != VK_SUCCESS)
+		{
+			Log::Error("failed to create texture sampler!");
+			return VK_NULL_HANDLE;
+		}
+
+		m_Samplers[key] = sampler;
+		return sampler;
+	}
+}
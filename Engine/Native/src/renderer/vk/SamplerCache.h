@@ -0,0 +1,29 @@
+#pragma once
+#include "plumbus.h"
+#include "vulkan/vulkan.h"
+
+namespace plumbus::vk
+{
+	// hands out one VkSampler per distinct create info. samplers are immutable, so everything asking for the same
+	// state shares one. they live until the cache is destroyed along with the device.
+	class SamplerCache
+	{
+	public:
+		static SamplerCacheRef CreateSamplerCache(VkDevice device);
+
+		SamplerCache(VkDevice device);
+		~SamplerCache();
+
+		// the returned sampler belongs to the cache, don't destroy it. extension structs aren't supported.
+		VkSampler GetSampler(const VkSamplerCreateInfo& createInfo);
+
+		uint32_t GetSamplerCount() const { return static_cast<uint32_t>(m_Samplers.size()); }
+
+	private:
+		typedef std::array<uint32_t, 16> SamplerKey;
+		static SamplerKey MakeKey(const VkSamplerCreateInfo& createInfo);
+
+		VkDevice m_Device;
+		std::map<SamplerKey, VkSampler> m_Samplers;
+	};
+}
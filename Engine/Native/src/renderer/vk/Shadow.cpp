@@ -1,14 +1,28 @@
-﻿#include "Shadow.h"
+#include "Shadow.h"
 
-#include "ShadowManager.h"
-#include "VulkanRenderer.h"
+#include "ShadowAtlas.h"
 
 namespace plumbus::vk
 {
-	Shadow::~Shadow()
+	uint32_t Shadow::UpdateTileSize(float importance, uint32_t atlasSize)
 	{
-		m_CommandBuffer.reset();
-		m_FrameBuffer.reset();
-		vkDestroySemaphore(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), m_Semaphore, nullptr);
+		uint32_t maxTileSize = std::max(GetMaxTileSize(atlasSize), ShadowAtlas::s_MinTileSize);
+		float texels = glm::clamp(importance, 0.f, 1.f) * maxTileSize;
+
+		uint32_t tileSize = ShadowAtlas::s_MinTileSize;
+		while (tileSize < texels && tileSize < maxTileSize)
+		{
+			tileSize *= 2;
+		}
+
+		// a resized tile has to be re-rendered, so only shrink once the light is well under the smaller size rather
+		// than flipping back and forth while it sits on the boundary.
+		if (tileSize < m_TileSize && m_TileSize <= maxTileSize && texels > m_TileSize * 0.375f)
+		{
+			tileSize = m_TileSize;
+		}
+
+		m_TileSize = tileSize;
+		return tileSize;
 	}
 }
@@ -2,6 +2,7 @@
 #include "plumbus.h"
 #include "components/LightComponent.h"
 #include "Buffer.h"
+#include "Frustum.h"
 
 namespace plumbus
 {
@@ -10,21 +11,49 @@ namespace plumbus
 
 namespace plumbus::vk
 {
+    class ShadowAtlas;
+
     class Shadow
     {
         public:
+            static constexpr uint32_t s_InvalidTile = UINT32_MAX;
+
             Shadow(Light* light) : m_Light(light) {}
-    		virtual ~Shadow();
+    		virtual ~Shadow() = default;
             virtual void Init() = 0;
-            
-            FrameBufferRef GetFrameBuffer() const { return m_FrameBuffer; }
-            VkSemaphore GetSemaphore() const { return m_Semaphore; }
-            CommandBufferRef GetCommandBuffer() const { return m_CommandBuffer; }
+
+            // shadow maps are kept between frames and only re-rendered once the light or a caster it can see changes.
+            bool NeedsRender() const { return m_NeedsRender; }
+            void SetNeedsRender(bool needsRender) { m_NeedsRender = needsRender; }
+            // ShadowManager frame the map was last drawn on, 0 if it never has been.
+            uint64_t GetLastRenderFrame() const { return m_LastRenderFrame; }
+            void SetLastRenderFrame(uint64_t frame) { m_LastRenderFrame = frame; }
+            // could a caster with these bounds end up in this shadow map.
+            virtual bool IsAffectedBy(const AABB& bounds) = 0;
+
+            // the shadow's tiles in the ShadowManager's atlas, the deferred pass finds them through the light's buffer entry.
+            virtual uint32_t GetTileCount() const = 0;
+            uint32_t GetFirstTile() const { return m_FirstTile; }
+            void SetFirstTile(uint32_t firstTile) { m_FirstTile = firstTile; }
+
+            // roughly how much of the screen the light reaches, 0 to 1.
+            virtual float GetImportance(const glm::vec3& cameraPos, float projectionScale, const Frustum& cameraFrustum) = 0;
+            // tile size for this frame, the largest allowed scaled by importance and rounded up to a power of two.
+            uint32_t UpdateTileSize(float importance, uint32_t atlasSize);
+            // called once the atlas is packed each frame, for shadows whose projection follows the camera.
+            virtual void FitToCamera(const glm::mat4& view, const glm::mat4& proj, const ShadowAtlas& atlas) {}
+
+            // draws the casters into each of the shadow's tiles, inside the atlas render pass.
+            virtual void Render(const CommandBufferRef& commandBuffer, ShadowAtlas& atlas) = 0;
 
     protected:
-            FrameBufferRef m_FrameBuffer = VK_NULL_HANDLE;
-            VkSemaphore m_Semaphore = VK_NULL_HANDLE; 
-            CommandBufferRef m_CommandBuffer = VK_NULL_HANDLE;
+            // largest side a tile of this shadow gets in an atlas this size.
+            virtual uint32_t GetMaxTileSize(uint32_t atlasSize) const = 0;
+
             Light* m_Light;
+            bool m_NeedsRender = true;
+            uint64_t m_LastRenderFrame = 0;
+            uint32_t m_FirstTile = s_InvalidTile;
+            uint32_t m_TileSize = 0;
     };
 }
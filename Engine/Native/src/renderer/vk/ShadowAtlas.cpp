@@ -0,0 +1,384 @@
+#include "plumbus.h"
+#include "renderer/vk/ShadowAtlas.h"
+#include "renderer/vk/VulkanRenderer.h"
+#include "renderer/vk/CommandBuffer.h"
+#include "renderer/vk/FrameBuffer.h"
+#include "renderer/vk/ImageHelpers.h"
+#include "renderer/vk/SamplerCache.h"
+
+namespace plumbus::vk
+{
+	// the x (even bits) or y (odd bits) half of a z-order index.
+	static uint32_t CompactBits(uint64_t value)
+	{
+		value &= 0x5555555555555555ull;
+		value = (value | (value >> 1)) & 0x3333333333333333ull;
+		value = (value | (value >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+		value = (value | (value >> 4)) & 0x00FF00FF00FF00FFull;
+		value = (value | (value >> 8)) & 0x0000FFFF0000FFFFull;
+		value = (value | (value >> 16)) & 0x00000000FFFFFFFFull;
+		return static_cast<uint32_t>(value);
+	}
+
+	// area of a tile in minimum sized cells.
+	static uint64_t GetCellCount(uint32_t tileSize)
+	{
+		uint64_t cellsPerSide = tileSize / ShadowAtlas::s_MinTileSize;
+		return cellsPerSide * cellsPerSide;
+	}
+
+	ShadowAtlas::ShadowAtlas(VkDeviceSize memoryBudget)
+		: m_MemoryBudget(memoryBudget)
+	{
+		m_Format = VulkanRenderer::Get()->GetSampledDepthFormat();
+		CreateRenderPass();
+		CreateImage();
+	}
+
+	ShadowAtlas::~ShadowAtlas()
+	{
+		DestroyImage();
+		vkDestroyRenderPass(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), m_RenderPass, nullptr);
+	}
+
+	uint32_t ShadowAtlas::GetSizeForBudget(VkDeviceSize memoryBudget, uint32_t bytesPerTexel)
+	{
+		uint32_t size = s_MinTileSize;
+		while (VkDeviceSize(size) * 2 * size * 2 * bytesPerTexel <= memoryBudget)
+		{
+			size *= 2;
+		}
+		return size;
+	}
+
+	void ShadowAtlas::SetMemoryBudget(VkDeviceSize memoryBudget)
+	{
+		if (memoryBudget == m_MemoryBudget)
+		{
+			return;
+		}
+
+		m_MemoryBudget = memoryBudget;
+
+		// the old image may still be sampled by frames in flight.
+		VulkanRenderer::Get()->AwaitIdle();
+		DestroyImage();
+		CreateImage();
+	}
+
+	void ShadowAtlas::CreateRenderPass()
+	{
+		// tiles that didn't change are kept, so the atlas is loaded and only re-rendered tiles are cleared.
+		VkAttachmentDescription depthAttachment = {};
+		depthAttachment.format = m_Format;
+		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+		VkAttachmentReference depthReference = {};
+		depthReference.attachment = 0;
+		depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.pDepthStencilAttachment = &depthReference;
+
+		// the lighting pass samples the atlas between renders.
+		std::array<VkSubpassDependency, 2> dependencies = {};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 1;
+		renderPassInfo.pAttachments = &depthAttachment;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+		renderPassInfo.pDependencies = dependencies.data();
+
+		CHECK_VK_RESULT(vkCreateRenderPass(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), &renderPassInfo, nullptr, &m_RenderPass));
+	}
+
+	void ShadowAtlas::CreateImage()
+	{
+		DeviceRef device = VulkanRenderer::Get()->GetDevice();
+
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(device->GetPhysicalDevice(), &deviceProperties);
+		uint32_t bytesPerTexel = m_Format == VK_FORMAT_D16_UNORM ? 2 : 4;
+		m_Size = std::min(GetSizeForBudget(m_MemoryBudget, bytesPerTexel), deviceProperties.limits.maxImageDimension2D);
+		Log::Info("Shadow atlas: %ux%u", m_Size, m_Size);
+
+		ImageHelpers::CreateImage(m_Size,
+								  m_Size,
+								  m_Format,
+								  VK_IMAGE_TILING_OPTIMAL,
+								  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+								  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+								  m_Texture.m_Image,
+								  m_Texture.m_ImageAllocation,
+								  false);
+
+		// the render pass loads the atlas, so it starts in the layout every pass leaves it in.
+		CommandBufferRef cmdBuffer = CommandBuffer::CreateCommandBuffer();
+		cmdBuffer->BeginRecording();
+		ImageHelpers::SetImageLayout(
+				cmdBuffer->GetVulkanCommandBuffer(),
+				m_Texture.m_Image,
+				VK_IMAGE_ASPECT_DEPTH_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+		cmdBuffer->Flush();
+
+		m_Texture.m_ImageView = ImageHelpers::CreateImageView(m_Texture.m_Image, m_Format, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+		// sampler2DShadow, the hardware compares against the stored depth and filters the results.
+		VkSamplerCreateInfo samplerInfo = {};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.compareEnable = VK_TRUE;
+		samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = 0.0f;
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+		m_Texture.m_TextureSampler = device->GetSamplerCache()->GetSampler(samplerInfo);
+
+		// plain reads of the stored depth, for showing the atlas in the debug ui.
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.compareEnable = VK_FALSE;
+		m_DebugSampler = device->GetSamplerCache()->GetSampler(samplerInfo);
+
+		m_FrameBuffer = FrameBuffer::CreateFrameBuffer(m_Size, m_Size, m_RenderPass, { m_Texture.m_ImageView }, { m_Format });
+
+		// nothing is in the new image yet, emptying the rects makes the next pack treat every tile as moved.
+		for (uint32_t tile = 0; tile < GetTileCount(); ++tile)
+		{
+			m_TileRects[tile] = VkRect2D{};
+			m_Tiles[tile].m_Rect = glm::vec4(0.f);
+		}
+		MarkTilesDirty();
+	}
+
+	void ShadowAtlas::DestroyImage()
+	{
+		m_FrameBuffer.reset();
+		// both samplers belong to the sampler cache.
+		m_DebugSampler = VK_NULL_HANDLE;
+		m_Texture.Cleanup();
+		m_Texture = Texture();
+	}
+
+	uint32_t ShadowAtlas::AllocateTiles(uint32_t count)
+	{
+		uint32_t run = 0;
+		uint32_t first = GetTileCount();
+		for (uint32_t tile = 0; tile < GetTileCount(); ++tile)
+		{
+			run = m_UsedTiles[tile] ? 0 : run + 1;
+			if (run == count)
+			{
+				first = tile + 1 - count;
+				break;
+			}
+		}
+
+		// no gap big enough, extend past the free run at the end (if any).
+		if (run < count)
+		{
+			first = GetTileCount() - run;
+			m_UsedTiles.resize(first + count, false);
+			m_Tiles.resize(first + count, ShadowTileInfo{ glm::mat4(1.f), glm::vec4(0.f) });
+			m_TileRects.resize(first + count, VkRect2D{});
+		}
+
+		for (uint32_t tile = first; tile < first + count; ++tile)
+		{
+			m_UsedTiles[tile] = true;
+		}
+
+		return first;
+	}
+
+	void ShadowAtlas::FreeTiles(uint32_t first, uint32_t count)
+	{
+		for (uint32_t tile = first; tile < first + count; ++tile)
+		{
+			m_UsedTiles[tile] = false;
+			m_TileRects[tile] = VkRect2D{};
+			m_Tiles[tile].m_Rect = glm::vec4(0.f);
+		}
+		MarkTilesDirty();
+	}
+
+	void ShadowAtlas::Pack(std::vector<ShadowTileRequest>& requests)
+	{
+		m_Stats = ShadowAtlasStats();
+		m_Stats.m_Size = m_Size;
+
+		const uint64_t capacity = GetCellCount(m_Size);
+		std::vector<uint32_t> requestedSizes(requests.size());
+		uint64_t used = 0;
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			ShadowTileRequest& request = requests[i];
+			request.m_TileSize = std::clamp(request.m_TileSize, s_MinTileSize, m_Size);
+			request.m_Moved = false;
+			requestedSizes[i] = request.m_TileSize;
+			used += request.m_TileCount * GetCellCount(request.m_TileSize);
+			m_Stats.m_Tiles += request.m_TileCount;
+		}
+
+		// halve the biggest tiles first, the least important of equal sizes, until everything fits.
+		while (used > capacity)
+		{
+			ShadowTileRequest* largest = nullptr;
+			for (ShadowTileRequest& request : requests)
+			{
+				if (request.m_TileSize > s_MinTileSize &&
+					(!largest || request.m_TileSize > largest->m_TileSize ||
+					(request.m_TileSize == largest->m_TileSize && request.m_Importance < largest->m_Importance)))
+				{
+					largest = &request;
+				}
+			}
+
+			if (!largest)
+			{
+				break;
+			}
+
+			used -= largest->m_TileCount * (GetCellCount(largest->m_TileSize) - GetCellCount(largest->m_TileSize / 2));
+			largest->m_TileSize /= 2;
+		}
+
+		// still over with every tile at the minimum, the least important lights go without a shadow.
+		if (used > capacity)
+		{
+			std::vector<ShadowTileRequest*> byImportance;
+			for (ShadowTileRequest& request : requests)
+			{
+				byImportance.push_back(&request);
+			}
+			std::sort(byImportance.begin(), byImportance.end(), [](const ShadowTileRequest* lhs, const ShadowTileRequest* rhs)
+			{
+				return lhs->m_Importance < rhs->m_Importance;
+			});
+
+			for (ShadowTileRequest* request : byImportance)
+			{
+				if (used <= capacity)
+				{
+					break;
+				}
+
+				used -= request->m_TileCount * GetCellCount(request->m_TileSize);
+				request->m_TileSize = 0;
+				m_Stats.m_DroppedTiles += request->m_TileCount;
+			}
+		}
+
+		for (size_t i = 0; i < requests.size(); ++i)
+		{
+			if (requests[i].m_TileSize != 0 && requests[i].m_TileSize < requestedSizes[i])
+			{
+				m_Stats.m_ShrunkTiles += requests[i].m_TileCount;
+			}
+		}
+
+		// largest first along a z-order curve. every power of two tile then starts on a multiple of its own area, so
+		// tiles never overlap or leave gaps. equal sizes stay in slot order so tiles only move when a size changes.
+		std::vector<ShadowTileRequest*> order;
+		for (ShadowTileRequest& request : requests)
+		{
+			order.push_back(&request);
+		}
+		std::sort(order.begin(), order.end(), [](const ShadowTileRequest* lhs, const ShadowTileRequest* rhs)
+		{
+			if (lhs->m_TileSize != rhs->m_TileSize)
+			{
+				return lhs->m_TileSize > rhs->m_TileSize;
+			}
+			return lhs->m_FirstTile < rhs->m_FirstTile;
+		});
+
+		const float texelSize = 1.f / m_Size;
+		uint64_t cursor = 0;
+		for (ShadowTileRequest* request : order)
+		{
+			for (uint32_t tile = request->m_FirstTile; tile < request->m_FirstTile + request->m_TileCount; ++tile)
+			{
+				VkRect2D rect = {};
+				if (request->m_TileSize != 0)
+				{
+					rect.offset.x = static_cast<int32_t>(CompactBits(cursor) * s_MinTileSize);
+					rect.offset.y = static_cast<int32_t>(CompactBits(cursor >> 1) * s_MinTileSize);
+					rect.extent.width = request->m_TileSize;
+					rect.extent.height = request->m_TileSize;
+					cursor += GetCellCount(request->m_TileSize);
+				}
+
+				VkRect2D& current = m_TileRects[tile];
+				if (rect.offset.x != current.offset.x || rect.offset.y != current.offset.y || rect.extent.width != current.extent.width)
+				{
+					current = rect;
+					m_Tiles[tile].m_Rect = glm::vec4(rect.offset.x, rect.offset.y, rect.extent.width, rect.extent.height) * texelSize;
+					request->m_Moved = true;
+					m_Stats.m_MovedTiles++;
+					MarkTilesDirty();
+				}
+			}
+		}
+
+		m_Stats.m_Occupancy = capacity > 0 ? float(double(used) / double(capacity)) : 0.f;
+	}
+
+	void ShadowAtlas::SetTileViewProj(uint32_t tile, const glm::mat4& viewProj)
+	{
+		if (m_Tiles[tile].m_ViewProj != viewProj)
+		{
+			m_Tiles[tile].m_ViewProj = viewProj;
+			MarkTilesDirty();
+		}
+	}
+
+	void ShadowAtlas::MarkTilesDirty()
+	{
+		m_DirtyFrames = UINT32_MAX;
+	}
+
+	void ShadowAtlas::Upload(uint32_t frame, Buffer& buffer)
+	{
+		uint32_t frameBit = 1u << frame;
+		if (!(m_DirtyFrames & frameBit) || m_Tiles.empty())
+		{
+			return;
+		}
+
+		VkDeviceSize size = sizeof(ShadowTileInfo) * m_Tiles.size();
+		memcpy(buffer.m_Mapped, m_Tiles.data(), size);
+		CHECK_VK_RESULT(buffer.Flush(size, 0));
+		m_DirtyFrames.fetch_and(~frameBit);
+	}
+}
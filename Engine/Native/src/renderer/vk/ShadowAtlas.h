@@ -0,0 +1,99 @@
+#pragma once
+#include "plumbus.h"
+#include "Buffer.h"
+#include "Texture.h"
+#include <atomic>
+
+namespace plumbus::vk
+{
+	// std430 layout of ShadowTile in deferred.frag.
+	struct ShadowTileInfo
+	{
+		glm::mat4 m_ViewProj;
+		glm::vec4 m_Rect; // uv offset xy, uv scale zw. a zero scale means the tile didn't fit and the light is unshadowed.
+	};
+
+	// one shadow's tiles for a frame, all of them get the same size.
+	struct ShadowTileRequest
+	{
+		uint32_t m_FirstTile;
+		uint32_t m_TileCount;
+		uint32_t m_TileSize; // in texels, a power of two. the packer shrinks it if the atlas is full.
+		float m_Importance;
+		bool m_Moved = false; // set when any of the tiles got a new rect, their contents are no longer valid.
+	};
+
+	struct ShadowAtlasStats
+	{
+		uint32_t m_Size = 0;
+		uint32_t m_Tiles = 0;
+		uint32_t m_ShrunkTiles = 0;
+		uint32_t m_DroppedTiles = 0;
+		uint32_t m_MovedTiles = 0;
+		float m_Occupancy = 0.f;
+	};
+
+	// every shadow map is a square tile in a single depth texture. tile sizes are picked each frame from how much of the
+	// screen the light can affect, so shadows share a fixed memory budget instead of each light owning its own targets.
+	class ShadowAtlas
+	{
+	public:
+		static constexpr uint32_t s_MinTileSize = 64;
+		static constexpr VkDeviceSize s_DefaultMemoryBudget = 64 * 1024 * 1024;
+
+		ShadowAtlas(VkDeviceSize memoryBudget);
+		~ShadowAtlas();
+
+		// side of the largest power of two square that fits in the budget.
+		static uint32_t GetSizeForBudget(VkDeviceSize memoryBudget, uint32_t bytesPerTexel);
+		// drops the current contents, every tile has to be rendered again.
+		void SetMemoryBudget(VkDeviceSize memoryBudget);
+		VkDeviceSize GetMemoryBudget() const { return m_MemoryBudget; }
+		uint32_t GetSize() const { return m_Size; }
+
+		// a contiguous range of tile slots, stable for as long as the shadow lives so lights can refer to them.
+		uint32_t AllocateTiles(uint32_t count);
+		void FreeTiles(uint32_t first, uint32_t count);
+
+		// places every request's tiles, shrinking the largest and least important first if they don't all fit.
+		void Pack(std::vector<ShadowTileRequest>& requests);
+
+		// pixel rect of a tile, empty if it didn't fit.
+		const VkRect2D& GetTileRect(uint32_t tile) const { return m_TileRects[tile]; }
+		void SetTileViewProj(uint32_t tile, const glm::mat4& viewProj);
+
+		uint32_t GetTileCount() const { return static_cast<uint32_t>(m_Tiles.size()); }
+		// copies the tiles into this frame's buffer if they've changed since it was last written.
+		void Upload(uint32_t frame, Buffer& buffer);
+		void MarkAllDirty(uint32_t frame) { m_DirtyFrames.fetch_or(1u << frame); }
+
+		const FrameBufferRef& GetFrameBuffer() const { return m_FrameBuffer; }
+		VkRenderPass GetRenderPass() const { return m_RenderPass; }
+		const Texture& GetTexture() const { return m_Texture; }
+		// samples depth without the comparison, the texture's own sampler is for sampler2DShadow.
+		VkSampler GetDebugSampler() const { return m_DebugSampler; }
+		const ShadowAtlasStats& GetStats() const { return m_Stats; }
+
+	private:
+		void CreateRenderPass();
+		void CreateImage();
+		void DestroyImage();
+		void MarkTilesDirty();
+
+		VkDeviceSize m_MemoryBudget;
+		VkFormat m_Format;
+		uint32_t m_Size = 0;
+
+		VkRenderPass m_RenderPass = VK_NULL_HANDLE;
+		FrameBufferRef m_FrameBuffer;
+		Texture m_Texture;
+		VkSampler m_DebugSampler = VK_NULL_HANDLE;
+
+		std::vector<bool> m_UsedTiles;
+		std::vector<ShadowTileInfo> m_Tiles;
+		std::vector<VkRect2D> m_TileRects;
+		// shadows set their tiles from whichever thread records them.
+		std::atomic<uint32_t> m_DirtyFrames = 0;
+		ShadowAtlasStats m_Stats;
+	};
+}
@@ -8,134 +8,221 @@
 #include "ModelComponent.h"
 #include "MaterialInstance.h"
 #include "ShadowManager.h"
+#include "Mesh.h"
+#include "PipelineLayout.h"
+#include "ShadowAtlas.h"
 
 namespace plumbus::vk
 {
     MaterialRef ShadowDirectional::s_ShadowDirectionalMaterial = nullptr;
+    uint32_t ShadowDirectional::s_InstanceCount = 0;
 
     ShadowDirectionalRef ShadowDirectional::CreateShadowDirectional(Light* light) 
     {
         ShadowDirectionalRef shadow = std::make_shared<ShadowDirectional>(light);
         shadow->Init();
 
-        if(!s_ShadowDirectionalMaterial)
-        {
-             s_ShadowDirectionalMaterial = std::make_shared<Material>("shaders/shadow.vert", "shaders/shadow.frag", shadow->GetFrameBuffer()->GetRenderPass());
-             s_ShadowDirectionalMaterial->SetCullingMode(VK_CULL_MODE_FRONT_BIT);
-             s_ShadowDirectionalMaterial->Setup();
-        }
-
         return shadow;
     }
 	
 	ShadowDirectional::~ShadowDirectional()
 	{
-        s_ShadowDirectionalMaterial.reset();
-        m_ShadowDirectionalMaterialInstances.clear();
-        m_UniformBufferObjects.clear();
-        for(auto& [_, buffer] : m_UniformBuffers)
+        m_ShadowDirectionalMaterialInstance.reset();
+        for (Buffer& buffer : m_UniformBuffers)
         {
             buffer.Cleanup();
         }
-        m_UniformBuffers.clear();
+
+        if (--s_InstanceCount == 0)
+        {
+            s_ShadowDirectionalMaterial.reset();
+        }
 
         ShadowManager::Get()->UnregisterShadow(this);
 	}
 
     void ShadowDirectional::Init() 
     {
-        //create framebuffer
-        std::vector<FrameBuffer::FrameBufferAttachmentInfo> offscreenAttachmentInfo =
+        s_InstanceCount++;
+
+        for (uint32_t cascade = 0; cascade < s_CascadeCount; ++cascade)
+        {
+            m_Cascades.m_CascadeViewProj[cascade] = glm::mat4(1.f);
+            m_RenderedCascades.m_CascadeViewProj[cascade] = glm::mat4(1.f);
+        }
+
+        if (!s_ShadowDirectionalMaterial)
         {
-            FrameBuffer::FrameBufferAttachmentInfo(VulkanRenderer::Get()->GetDepthFormat(), FrameBuffer::FrameBufferAttachmentType::Depth, "depth")
-        };
+            s_ShadowDirectionalMaterial = std::make_shared<Material>("shaders/shadow.vert", "shaders/shadow.frag", ShadowManager::Get()->GetAtlas()->GetRenderPass());
+            s_ShadowDirectionalMaterial->GetShaderSettings().SetValue("CASCADE_COUNT", static_cast<int>(s_CascadeCount));
+            s_ShadowDirectionalMaterial->SetCullingMode(VK_CULL_MODE_FRONT_BIT);
+            s_ShadowDirectionalMaterial->Setup();
+        }
 
-        SwapChainRef swapChain = VulkanRenderer::Get()->GetSwapChain();
-        m_FrameBuffer = FrameBuffer::CreateFrameBuffer(swapChain->GetExtents().width, swapChain->GetExtents().height, offscreenAttachmentInfo);
+        m_ShadowDirectionalMaterialInstance = MaterialInstance::CreateMaterialInstance(s_ShadowDirectionalMaterial);
 
+        m_UniformBuffers.resize(VulkanRenderer::Get()->GetFramesInFlight());
+        for (uint32_t i = 0; i < m_UniformBuffers.size(); ++i)
+        {
+            CHECK_VK_RESULT(VulkanRenderer::Get()->GetDevice()->CreateBuffer(
+                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    &m_UniformBuffers[i],
+                    sizeof(UniformBufferObject)));
+
+            CHECK_VK_RESULT(m_UniformBuffers[i].Map());
+            m_ShadowDirectionalMaterialInstance->SetBufferUniform("UBO", &m_UniformBuffers[i], i);
+        }
     }
 
-    void ShadowDirectional::BuildCommandBuffer() 
+    bool ShadowDirectional::IsAffectedBy(const AABB& bounds)
     {
-        if (m_CommandBuffer == VK_NULL_HANDLE)
+        for (const glm::mat4& viewProj : m_Cascades.m_CascadeViewProj)
         {
-            m_CommandBuffer = CommandBuffer::CreateCommandBuffer();
-            m_CommandBuffer->SetFrameBuffer(m_FrameBuffer);
+            if (Frustum(viewProj).Intersects(bounds))
+            {
+                return true;
+            }
         }
+        return false;
+    }
 
-        if (m_Semaphore == VK_NULL_HANDLE)
+    float ShadowDirectional::GetImportance(const glm::vec3&, float, const Frustum&)
+    {
+        // the light reaches everything on screen.
+        return 1.f;
+    }
+
+    void ShadowDirectional::FitToCamera(const glm::mat4& view, const glm::mat4& proj, const ShadowAtlas& atlas)
+    {
+        // corners of the camera frustum, near plane first.
+        glm::mat4 invViewProj = glm::inverse(proj * view);
+        glm::vec3 corners[8];
+        for (uint32_t i = 0; i < 8; ++i)
         {
-            VkSemaphoreCreateInfo semaphoreCreateInfo{};
-            semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-            CHECK_VK_RESULT(vkCreateSemaphore(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), &semaphoreCreateInfo, nullptr, &m_Semaphore));
-       
+            glm::vec4 corner = invViewProj * glm::vec4(i & 1 ? 1.f : -1.f, i & 2 ? 1.f : -1.f, i < 4 ? 0.f : 1.f, 1.f);
+            corners[i] = glm::vec3(corner) / corner.w;
         }
 
-        m_CommandBuffer->BeginRecording();
-        m_CommandBuffer->BeginRenderPass();
-        m_CommandBuffer->SetViewport((float)m_FrameBuffer->GetWidth(), (float)m_FrameBuffer->GetHeight(), 0.f, 1.f);
-        m_CommandBuffer->SetScissor(m_FrameBuffer->GetWidth(), m_FrameBuffer->GetHeight(), 0, 0);
+        float nearDepth = -(view * glm::vec4(corners[0], 1.f)).z;
+        float farDepth = -(view * glm::vec4(corners[4], 1.f)).z;
+        float shadowDepth = glm::min(farDepth, s_MaxDistance);
 
-        for (GameObject* obj : BaseApplication::Get().GetScene()->GetObjects())
+        glm::vec3 lightDir = glm::normalize(static_cast<DirectionalLight*>(m_Light)->GetDirection());
+        glm::vec3 up = glm::abs(lightDir.y) > 0.99f ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f, 1.f, 0.f);
+
+        float splitStart = nearDepth;
+        for (uint32_t cascade = 0; cascade < s_CascadeCount; ++cascade)
         {
-            if (components::ModelComponent* comp = obj->GetComponent<components::ModelComponent>())
+            float fraction = static_cast<float>(cascade + 1) / s_CascadeCount;
+            float logSplit = nearDepth * glm::pow(shadowDepth / nearDepth, fraction);
+            float evenSplit = nearDepth + (shadowDepth - nearDepth) * fraction;
+            float splitEnd = glm::mix(evenSplit, logSplit, s_SplitLambda);
+
+            // a bounding sphere rather than a box, so the projection's size doesn't change as the camera turns.
+            glm::vec3 sliceCorners[8];
+            glm::vec3 center = glm::vec3(0.f);
+            for (uint32_t i = 0; i < 4; ++i)
             {
-                DirectionalLight* dirLight = static_cast<DirectionalLight *>(m_Light);
-                m_UniformBufferObjects[comp].m_Proj = glm::ortho<float>(-25, 25, -25, 25, -50, 50);
-                m_UniformBufferObjects[comp].m_View = glm::lookAt(dirLight->GetDirection(), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
-                m_UniformBufferObjects[comp].m_Model = comp->GetModelMatrix();
-
-            	if(m_UniformBuffers.count(comp) == 0)
-            	{
-            		CHECK_VK_RESULT(VulkanRenderer::Get()->GetDevice()->CreateBuffer(
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                    &m_UniformBuffers[comp],
-                    sizeof(components::ModelComponent::UniformBufferObject)));
+                float start = (splitStart - nearDepth) / (farDepth - nearDepth);
+                float end = (splitEnd - nearDepth) / (farDepth - nearDepth);
+                sliceCorners[i] = glm::mix(corners[i], corners[i + 4], start);
+                sliceCorners[i + 4] = glm::mix(corners[i], corners[i + 4], end);
+                center += sliceCorners[i] + sliceCorners[i + 4];
+            }
+            center /= 8.f;
 
-            		CHECK_VK_RESULT(m_UniformBuffers[comp].Map());
-            	}
+            float radius = 0.f;
+            for (const glm::vec3& corner : sliceCorners)
+            {
+                radius = glm::max(radius, glm::distance(center, corner));
+            }
+            radius = glm::ceil(radius * 16.f) / 16.f;
 
-            	if (m_ShadowDirectionalMaterialInstances.count(comp) == 0)
-            	{
-            		m_ShadowDirectionalMaterialInstances[comp] = MaterialInstance::CreateMaterialInstance(s_ShadowDirectionalMaterial);
-            	}
-            	
+            glm::mat4 lightView = glm::lookAt(center + lightDir * radius, center, up);
+            glm::mat4 lightProj = glm::ortho(-radius, radius, -radius, radius, -s_CasterDistance, radius * 2.f);
 
-            	m_ShadowDirectionalMaterialInstances[comp]->SetBufferUniform("UBO", &m_UniformBuffers[comp]);
-                memcpy(m_UniformBuffers[comp].m_Mapped, &m_UniformBufferObjects[comp], sizeof(m_UniformBufferObjects[comp]));
+            // move in whole texels only, otherwise the shadow edges shimmer as the camera moves.
+            uint32_t tileSize = atlas.GetTileRect(m_FirstTile + cascade).extent.width;
+            if (tileSize > 0)
+            {
+                float halfTileSize = tileSize * 0.5f;
+                glm::vec4 origin = lightProj * lightView * glm::vec4(0.f, 0.f, 0.f, 1.f);
+                glm::vec2 texelOrigin = glm::vec2(origin) * halfTileSize;
+                glm::vec2 offset = (glm::round(texelOrigin) - texelOrigin) / halfTileSize;
+                lightProj[3][0] += offset.x;
+                lightProj[3][1] += offset.y;
+            }
 
-                vkDeviceWaitIdle(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice());
+            m_Cascades.m_CascadeViewProj[cascade] = lightProj * lightView;
+            splitStart = splitEnd;
+        }
 
-				for (Mesh* model : comp->GetModels())
-				{
-                    model->Render(m_CommandBuffer, m_ShadowDirectionalMaterialInstances[comp]);
-				}
+        for (uint32_t cascade = 0; cascade < s_CascadeCount; ++cascade)
+        {
+            if (m_Cascades.m_CascadeViewProj[cascade] != m_RenderedCascades.m_CascadeViewProj[cascade])
+            {
+                m_NeedsRender = true;
+                break;
             }
         }
-
-        m_CommandBuffer->EndRenderPass();
-        m_CommandBuffer->EndRecording();
     }
-    
-    void ShadowDirectional::Render(VkSemaphore waitSemaphore) 
+
+    void ShadowDirectional::Render(const CommandBufferRef& commandBuffer, ShadowAtlas& atlas)
     {
-        VkSubmitInfo submitInfo = {};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        uint32_t frameIndex = VulkanRenderer::Get()->GetCurrentFrameIndex();
+        memcpy(m_UniformBuffers[frameIndex].m_Mapped, &m_Cascades, sizeof(m_Cascades));
+        m_RenderedCascades = m_Cascades;
+
+        VkPipelineLayout pipelineLayout = s_ShadowDirectionalMaterial->GetPipelineLayout()->GetVulkanPipelineLayout();
+        BVH& bvh = BaseApplication::Get().GetScene()->GetBVH();
+        for (uint32_t cascade = 0; cascade < s_CascadeCount; ++cascade)
+        {
+            uint32_t tile = m_FirstTile + cascade;
+            const VkRect2D& rect = atlas.GetTileRect(tile);
+            if (rect.extent.width == 0)
+            {
+                continue;
+            }
 
-        VkSemaphore waitSemaphores[] = { waitSemaphore };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+            commandBuffer->ClearDepth(rect);
+            commandBuffer->SetViewport(rect);
+            commandBuffer->SetScissor(rect);
 
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &m_CommandBuffer->GetVulkanCommandBuffer();
+            const glm::mat4& viewProj = m_Cascades.m_CascadeViewProj[cascade];
+            atlas.SetTileViewProj(tile, viewProj);
 
-        VkSemaphore signalSemaphores[] = { m_Semaphore };
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
+            m_VisibleItems.clear();
+            bvh.QueryFrustum(Frustum(viewProj), BVHItemType_Mesh, m_VisibleItems);
 
-        CHECK_VK_RESULT(vkQueueSubmit(VulkanRenderer::Get()->GetDevice()->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE));
+            // group by component so each one's model matrix is pushed once.
+            std::sort(m_VisibleItems.begin(), m_VisibleItems.end(), [](void* lhs, void* rhs)
+            {
+                return static_cast<Mesh*>(lhs)->GetOwner() < static_cast<Mesh*>(rhs)->GetOwner();
+            });
+
+            PushConstants constants;
+            constants.m_Cascade = cascade;
+
+            components::ModelComponent* currentComp = nullptr;
+            for (void* item : m_VisibleItems)
+            {
+                Mesh* model = static_cast<Mesh*>(item);
+                if (model->GetOwner() != currentComp)
+                {
+                    currentComp = model->GetOwner();
+                    constants.m_Model = currentComp->GetModelMatrix();
+                    vkCmdPushConstants(
+                            commandBuffer->GetVulkanCommandBuffer(),
+                            pipelineLayout,
+                            VK_SHADER_STAGE_VERTEX_BIT,
+                            0,
+                            sizeof(PushConstants),
+                            &constants);
+                }
+
+                model->Render(commandBuffer, m_ShadowDirectionalMaterialInstance);
+            }
+        }
     }
 }
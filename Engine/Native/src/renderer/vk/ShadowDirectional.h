@@ -14,6 +14,14 @@ namespace plumbus::vk
     public:
         static ShadowDirectionalRef CreateShadowDirectional(Light* light);
 
+        // the view frustum up to s_MaxDistance is split into this many cascades, each with its own tile.
+        static constexpr uint32_t s_CascadeCount = 4;
+        static constexpr float s_MaxDistance = 100.f;
+        // blend between logarithmic (1) and even (0) split distances.
+        static constexpr float s_SplitLambda = 0.75f;
+        // how far towards the light casters are kept beyond the cascade's own bounds.
+        static constexpr float s_CasterDistance = 50.f;
+
         ShadowDirectional(Light* light)
 			: Shadow(light)
 		{
@@ -22,21 +30,39 @@ namespace plumbus::vk
     	virtual ~ShadowDirectional();
 
         virtual void Init() override;
-        virtual void BuildCommandBuffer();
-        virtual void Render(VkSemaphore waitSemaphore);
+        bool IsAffectedBy(const AABB& bounds) override;
+
+        uint32_t GetTileCount() const override { return s_CascadeCount; }
+        float GetImportance(const glm::vec3& cameraPos, float projectionScale, const Frustum& cameraFrustum) override;
+        void FitToCamera(const glm::mat4& view, const glm::mat4& proj, const ShadowAtlas& atlas) override;
+        void Render(const CommandBufferRef& commandBuffer, ShadowAtlas& atlas) override;
+
+    protected:
+        uint32_t GetMaxTileSize(uint32_t atlasSize) const override { return atlasSize / 4; }
 
     private:
         static MaterialRef s_ShadowDirectionalMaterial;
-        std::unordered_map<components::ModelComponent*, MaterialInstanceRef> m_ShadowDirectionalMaterialInstances;
+        static uint32_t s_InstanceCount;
+        MaterialInstanceRef m_ShadowDirectionalMaterialInstance;
 
         struct UniformBufferObject
 		{
-			glm::mat4 m_Model;
-			glm::mat4 m_View;
-			glm::mat4 m_Proj;
+			glm::mat4 m_CascadeViewProj[s_CascadeCount];
 		};
 
-        std::unordered_map<components::ModelComponent*, UniformBufferObject> m_UniformBufferObjects;
-        std::unordered_map<components::ModelComponent*, Buffer> m_UniformBuffers;
+        // casters are drawn with their model matrix pushed, the cascades' matrices live in the per frame uniform buffer.
+        struct PushConstants
+        {
+            glm::mat4 m_Model;
+            uint32_t m_Cascade;
+        };
+
+        // fitted to the current camera, and what the tiles were last rendered with.
+        UniformBufferObject m_Cascades;
+        UniformBufferObject m_RenderedCascades;
+
+        //one per frame in flight.
+        std::vector<Buffer> m_UniformBuffers;
+        std::vector<void*> m_VisibleItems;
     };
 }
@@ -1,6 +1,13 @@
 ﻿#include "ShadowManager.h"
 
 #include "VulkanRenderer.h"
+#include "ShadowDirectional.h"
+#include "ShadowOmniDirectional.h"
+#include "CommandBuffer.h"
+#include "BaseApplication.h"
+#include "Scene.h"
+#include "Camera.h"
+#include "JobSystem.h"
 
 namespace plumbus::vk
 {
@@ -8,8 +15,15 @@ namespace plumbus::vk
 
     ShadowManager::ShadowManager()
             : m_ShadowTexturesUpToDate(false)
+            , m_AtlasMemoryBudget(ShadowAtlas::s_DefaultMemoryBudget)
     {
 
+    }
+
+    ShadowManager::~ShadowManager()
+    {
+        m_Secondaries.clear();
+        delete m_Atlas;
     }
 	
 	ShadowManager* ShadowManager::Get()
@@ -28,28 +42,244 @@ namespace plumbus::vk
 		}
 	}
 
-	void ShadowManager::RegisterShadow(ShadowDirectional* shadow)
+	void ShadowManager::RegisterShadow(Shadow* shadow)
 	{
-		m_DirShadows.push_back(shadow);
-        m_ShadowTexturesUpToDate = false;
+		shadow->SetFirstTile(GetAtlas()->AllocateTiles(shadow->GetTileCount()));
+		m_Shadows.push_back(shadow);
 	}
 
-	void ShadowManager::UnregisterShadow(ShadowDirectional* shadow)
+	void ShadowManager::UnregisterShadow(Shadow* shadow)
 	{
-        m_DirShadows.erase(std::remove(m_DirShadows.begin(), m_DirShadows.end(), shadow), m_DirShadows.end());
-        m_ShadowTexturesUpToDate = false;
+        m_Shadows.erase(std::remove(m_Shadows.begin(), m_Shadows.end(), shadow), m_Shadows.end());
+        m_ScheduledShadows.erase(std::remove(m_ScheduledShadows.begin(), m_ScheduledShadows.end(), shadow), m_ScheduledShadows.end());
+        if (m_Atlas && shadow->GetFirstTile() != Shadow::s_InvalidTile)
+        {
+            m_Atlas->FreeTiles(shadow->GetFirstTile(), shadow->GetTileCount());
+            shadow->SetFirstTile(Shadow::s_InvalidTile);
+        }
 	}
 
-    void ShadowManager::RegisterShadow(ShadowOmniDirectional* shadow)
+    ShadowAtlas* ShadowManager::GetAtlas()
+    {
+        if (!m_Atlas)
+        {
+            m_Atlas = new ShadowAtlas(m_AtlasMemoryBudget);
+            m_ShadowTexturesUpToDate = false;
+        }
+        return m_Atlas;
+    }
+
+    void ShadowManager::SetAtlasMemoryBudget(VkDeviceSize memoryBudget)
     {
-        m_OmniDirShadows.push_back(shadow);
-        m_ShadowTexturesUpToDate = false;
+        m_AtlasMemoryBudget = memoryBudget;
+        if (m_Atlas && m_Atlas->GetMemoryBudget() != memoryBudget)
+        {
+            m_Atlas->SetMemoryBudget(memoryBudget);
+            m_ShadowTexturesUpToDate = false;
+            for (Shadow* shadow : m_Shadows)
+            {
+                shadow->SetNeedsRender(true);
+            }
+        }
     }
 
-    void ShadowManager::UnregisterShadow(ShadowOmniDirectional* shadow)
+    void ShadowManager::InvalidateRegion(const AABB& bounds)
     {
-        m_OmniDirShadows.erase(std::remove(m_OmniDirShadows.begin(), m_OmniDirShadows.end(), shadow), m_OmniDirShadows.end());
-        m_ShadowTexturesUpToDate = false;
+        if (!bounds.IsValid())
+        {
+            m_InvalidateAll = true;
+        }
+        else if (!m_InvalidateAll)
+        {
+            m_InvalidatedRegions.push_back(bounds);
+        }
+    }
+
+    void ShadowManager::Update()
+    {
+        auto invalidate = [this](Shadow* shadow)
+        {
+            if (shadow->NeedsRender())
+            {
+                return;
+            }
+
+            if (m_InvalidateAll)
+            {
+                shadow->SetNeedsRender(true);
+                return;
+            }
+
+            for (const AABB& region : m_InvalidatedRegions)
+            {
+                if (shadow->IsAffectedBy(region))
+                {
+                    shadow->SetNeedsRender(true);
+                    return;
+                }
+            }
+        };
+
+        if (m_InvalidateAll || !m_InvalidatedRegions.empty())
+        {
+            for (Shadow* shadow : m_Shadows)
+            {
+                invalidate(shadow);
+            }
+        }
+
+        m_InvalidatedRegions.clear();
+        m_InvalidateAll = false;
+
+        m_FrameCount++;
+        m_ScheduledShadows.clear();
+        m_UpdateStats = ShadowUpdateStats();
+        if (m_Shadows.empty())
+        {
+            return;
+        }
+
+        // size every shadow for the current view, anything that ends up somewhere new in the atlas has to be redrawn.
+        Camera* camera = BaseApplication::Get().GetScene()->GetCamera();
+        glm::mat4 view = camera->GetViewMatrix();
+        glm::mat4 proj = camera->GetProjectionMatrix();
+        Frustum cameraFrustum(proj * view);
+        glm::vec3 cameraPos = glm::vec3(glm::inverse(view)[3]);
+        float projectionScale = std::abs(proj[1][1]);
+
+        ShadowAtlas* atlas = GetAtlas();
+        m_TileRequests.clear();
+        for (Shadow* shadow : m_Shadows)
+        {
+            ShadowTileRequest request;
+            request.m_FirstTile = shadow->GetFirstTile();
+            request.m_TileCount = shadow->GetTileCount();
+            request.m_Importance = shadow->GetImportance(cameraPos, projectionScale, cameraFrustum);
+            request.m_TileSize = shadow->UpdateTileSize(request.m_Importance, atlas->GetSize());
+            m_TileRequests.push_back(request);
+        }
+
+        atlas->Pack(m_TileRequests);
+
+        for (size_t i = 0; i < m_Shadows.size(); ++i)
+        {
+            if (m_TileRequests[i].m_Moved)
+            {
+                m_Shadows[i]->SetNeedsRender(true);
+            }
+            m_Shadows[i]->FitToCamera(view, proj, *atlas);
+        }
+
+        ScheduleUpdates();
+    }
+
+    uint32_t ShadowManager::GetUpdateInterval(float importance)
+    {
+        // halve the rate each time the light's share of the screen halves, down to every eighth frame.
+        uint32_t interval = 1;
+        while (interval < 8 && importance < 0.25f / interval)
+        {
+            interval *= 2;
+        }
+        return interval;
+    }
+
+    void ShadowManager::ScheduleUpdates()
+    {
+        ShadowAtlas* atlas = GetAtlas();
+
+        struct Candidate
+        {
+            Shadow* m_Shadow;
+            uint32_t m_Passes;
+            float m_Priority;
+            bool m_Required;
+        };
+        std::vector<Candidate> candidates;
+
+        for (size_t i = 0; i < m_Shadows.size(); ++i)
+        {
+            Shadow* shadow = m_Shadows[i];
+            if (!shadow->NeedsRender())
+            {
+                continue;
+            }
+
+            // no room in the atlas this frame, the light is unshadowed so there's nothing to draw.
+            if (atlas->GetTileRect(shadow->GetFirstTile()).extent.width == 0)
+            {
+                shadow->SetNeedsRender(false);
+                continue;
+            }
+
+            m_UpdateStats.m_Pending++;
+
+            const ShadowTileRequest& request = m_TileRequests[i];
+            uint64_t framesSinceRender = m_FrameCount - shadow->GetLastRenderFrame();
+            bool required = request.m_Moved || shadow->GetLastRenderFrame() == 0;
+            if (!required && framesSinceRender < GetUpdateInterval(request.m_Importance))
+            {
+                m_UpdateStats.m_Deferred++;
+                continue;
+            }
+
+            // lights covering more of the screen go first, the longer one has been waiting the more it's worth.
+            float priority = (request.m_Importance + 0.01f) * static_cast<float>(std::min<uint64_t>(framesSinceRender, 1000));
+            candidates.push_back({ shadow, shadow->GetTileCount(), priority, required });
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& lhs, const Candidate& rhs)
+        {
+            if (lhs.m_Required != rhs.m_Required)
+            {
+                return lhs.m_Required;
+            }
+            return lhs.m_Priority > rhs.m_Priority;
+        });
+
+        for (const Candidate& candidate : candidates)
+        {
+            // the first one always goes so a budget smaller than a point light can't starve them forever.
+            bool fits = m_UpdateStats.m_Passes + candidate.m_Passes <= m_MaxPassesPerFrame || m_UpdateStats.m_Updated == 0;
+            if (!candidate.m_Required && !fits)
+            {
+                m_UpdateStats.m_Deferred++;
+                continue;
+            }
+
+            m_ScheduledShadows.push_back(candidate.m_Shadow);
+            m_UpdateStats.m_Updated++;
+            m_UpdateStats.m_Passes += candidate.m_Passes;
+        }
+    }
+
+    void ShadowManager::Render(const CommandBufferRef& commandBuffer)
+    {
+        // every shadow shares the one pass, each clears and draws only its own tiles. shadows don't share any recording
+        // state, so each one is recorded into its own secondary on a job thread.
+        ShadowAtlas* atlas = GetAtlas();
+        uint32_t frameIndex = VulkanRenderer::Get()->GetCurrentFrameIndex();
+        m_Secondaries.clear();
+        m_Secondaries.resize(m_ScheduledShadows.size());
+        JobSystem::Get()->ParallelFor(static_cast<uint32_t>(m_ScheduledShadows.size()), 1, [this, atlas, frameIndex](uint32_t start, uint32_t end)
+        {
+            for (uint32_t i = start; i < end; ++i)
+            {
+                CommandBufferRef secondary = VulkanRenderer::Get()->GetThreadCommandPools()->AcquireSecondary(frameIndex);
+                secondary->BeginSecondaryRecording(atlas->GetFrameBuffer());
+                m_ScheduledShadows[i]->Render(secondary, *atlas);
+                secondary->EndRecording();
+                m_Secondaries[i] = secondary;
+            }
+        });
+
+        for (Shadow* shadow : m_ScheduledShadows)
+        {
+            shadow->SetNeedsRender(false);
+            shadow->SetLastRenderFrame(m_FrameCount);
+        }
+
+        commandBuffer->ExecuteCommands(m_Secondaries);
     }
 
     bool ShadowManager::ShadowTexturesOutOfDate()
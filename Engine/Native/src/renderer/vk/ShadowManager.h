@@ -1,8 +1,18 @@
 ﻿#pragma once
 #include "Shadow.h"
+#include "Frustum.h"
+#include "ShadowAtlas.h"
 
 namespace plumbus::vk
 {
+	struct ShadowUpdateStats
+	{
+		uint32_t m_Pending = 0; // shadows that wanted re-rendering this frame.
+		uint32_t m_Updated = 0;
+		uint32_t m_Deferred = 0; // pending shadows pushed back to a later frame.
+		uint32_t m_Passes = 0; // tiles drawn, one per directional shadow and six per point light.
+	};
+
 	class ShadowManager
 	{
 	public:
@@ -10,22 +20,61 @@ namespace plumbus::vk
 		static void Destroy();
 
 		ShadowManager();
-		void RegisterShadow(ShadowDirectional* shadow);
-		void UnregisterShadow(ShadowDirectional* shadow);
-        void RegisterShadow(ShadowOmniDirectional* shadow);
-        void UnregisterShadow(ShadowOmniDirectional* shadow);
+		~ShadowManager();
+
+		// gives the shadow its tiles in the atlas.
+		void RegisterShadow(Shadow* shadow);
+		void UnregisterShadow(Shadow* shadow);
 
         bool ShadowTexturesOutOfDate();
         void SetShadowTexturesUpToDate();
 
-		std::vector<ShadowDirectional*>& GetDirectionalShadows() { return m_DirShadows; }
-        std::vector<ShadowOmniDirectional*>& GetOmniDirectionalShadows() { return m_OmniDirShadows; }
+        ShadowAtlas* GetAtlas();
+        // recreates the atlas at the new size, all shadows are re-rendered.
+        void SetAtlasMemoryBudget(VkDeviceSize memoryBudget);
+
+        // casters that moved, appeared or went away this frame. invalid bounds mean the caster could be anywhere.
+        void InvalidateRegion(const AABB& bounds);
+        // flags every shadow touched by this frame's invalidated regions for re-rendering, re-packs the atlas for the
+        // current camera and schedules which of the flagged shadows are rendered this frame.
+        void Update();
+        bool HasScheduledShadows() const { return !m_ScheduledShadows.empty(); }
+        // records this frame's scheduled shadows, inside a render pass on the atlas frame buffer begun for secondaries.
+        void Render(const CommandBufferRef& commandBuffer);
+
+        // how many tiles may be re-rendered in a frame, the rest wait for a later one. shadows whose tiles were moved or
+        // never drawn are always rendered since they have nothing valid to show.
+        void SetMaxPassesPerFrame(uint32_t maxPasses) { m_MaxPassesPerFrame = maxPasses; }
+        uint32_t GetMaxPassesPerFrame() const { return m_MaxPassesPerFrame; }
+        const ShadowUpdateStats& GetUpdateStats() const { return m_UpdateStats; }
+
+		const std::vector<Shadow*>& GetShadows() const { return m_Shadows; }
 	private:
 		static ShadowManager* s_Instance;
-		
-		std::vector<ShadowDirectional*> m_DirShadows;
-        std::vector<ShadowOmniDirectional*> m_OmniDirShadows;
+
+		// picks which of the shadows needing it are rendered this frame.
+		void ScheduleUpdates();
+		// frames a shadow of this importance can go between updates.
+		static uint32_t GetUpdateInterval(float importance);
+
+		std::vector<Shadow*> m_Shadows;
 
         bool m_ShadowTexturesUpToDate;
+
+        VkDeviceSize m_AtlasMemoryBudget;
+        ShadowAtlas* m_Atlas = nullptr;
+        std::vector<ShadowTileRequest> m_TileRequests;
+
+        static constexpr uint32_t s_DefaultMaxPassesPerFrame = 24;
+        uint32_t m_MaxPassesPerFrame = s_DefaultMaxPassesPerFrame;
+        uint64_t m_FrameCount = 0;
+        std::vector<Shadow*> m_ScheduledShadows;
+        ShadowUpdateStats m_UpdateStats;
+
+        // this frame's per shadow recordings, from the renderer's thread command pools.
+        std::vector<CommandBufferRef> m_Secondaries;
+
+        std::vector<AABB> m_InvalidatedRegions;
+        bool m_InvalidateAll = false;
 	};
 }
@@ -1,6 +1,5 @@
 #include <TranslationComponent.h>
 #include "ShadowOmniDirectional.h"
-#include "FrameBuffer.h"
 #include "VulkanRenderer.h"
 #include "CommandBuffer.h"
 #include "BaseApplication.h"
@@ -10,11 +9,13 @@
 #include "MaterialInstance.h"
 #include "ShadowManager.h"
 #include "PipelineLayout.h"
-#include "ImageHelpers.h"
+#include "ShadowAtlas.h"
+#include "Mesh.h"
 
 namespace plumbus::vk
 {
     MaterialRef ShadowOmniDirectional::s_ShadowOmniDirectionalMaterial = nullptr;
+    uint32_t ShadowOmniDirectional::s_InstanceCount = 0;
 
     ShadowOmniDirectionalRef ShadowOmniDirectional::CreateShadowOmniDirectional(Light* light)
     {
@@ -26,259 +27,219 @@ namespace plumbus::vk
 
     ShadowOmniDirectional::~ShadowOmniDirectional()
     {
-        m_FrameBuffer.reset();
-        s_ShadowOmniDirectionalMaterial.reset();
         m_ShadowOmniDirectionalMaterialInstance.reset();
-        m_UniformBuffer.Cleanup();
-        m_CubeMapTexture.Cleanup();
+        for (Buffer& uniformBuffer : m_UniformBuffers)
+        {
+            uniformBuffer.Cleanup();
+        }
+
+        if (--s_InstanceCount == 0)
+        {
+            s_ShadowOmniDirectionalMaterial.reset();
+        }
 
         ShadowManager::Get()->UnregisterShadow(this);
     }
 
     void ShadowOmniDirectional::Init()
     {
-        //create framebuffer
-        std::vector<FrameBuffer::FrameBufferAttachmentInfo> offscreenAttachmentInfo =
+        s_InstanceCount++;
+
+        VulkanRenderer* renderer = VulkanRenderer::Get();
+        if (!s_ShadowOmniDirectionalMaterial)
         {
-            FrameBuffer::FrameBufferAttachmentInfo(VK_FORMAT_R32_SFLOAT, FrameBuffer::FrameBufferAttachmentType::R32, "dist", true),
-            FrameBuffer::FrameBufferAttachmentInfo(VulkanRenderer::Get()->GetDepthFormat(), FrameBuffer::FrameBufferAttachmentType::Depth, "depth", false)
-        };
+            s_ShadowOmniDirectionalMaterial = std::make_shared<Material>("shaders/shadow_omni.vert", "shaders/shadow_omni.frag", ShadowManager::Get()->GetAtlas()->GetRenderPass());
+            s_ShadowOmniDirectionalMaterial->SetCullingMode(VK_CULL_MODE_BACK_BIT);
+            s_ShadowOmniDirectionalMaterial->Setup();
+        }
 
-        m_FrameBuffer = FrameBuffer::CreateFrameBuffer(512, 512, offscreenAttachmentInfo);
+        m_ShadowOmniDirectionalMaterialInstance = MaterialInstance::CreateMaterialInstance(s_ShadowOmniDirectionalMaterial);
 
-        if (m_CommandBuffer == VK_NULL_HANDLE)
+        m_UniformBuffers.resize(renderer->GetFramesInFlight());
+        m_UniformBufferLightSpheres.resize(m_UniformBuffers.size(), glm::vec4(FLT_MAX));
+        for (uint32_t i = 0; i < m_UniformBuffers.size(); ++i)
         {
-            m_CommandBuffer = CommandBuffer::CreateCommandBuffer();
-            m_CommandBuffer->SetFrameBuffer(m_FrameBuffer);
+            CHECK_VK_RESULT(renderer->GetDevice()->CreateBuffer(
+                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    &m_UniformBuffers[i],
+                    sizeof(UniformBufferObject)))
+
+            CHECK_VK_RESULT(m_UniformBuffers[i].Map())
+            m_ShadowOmniDirectionalMaterialInstance->SetBufferUniform("UBO", &m_UniformBuffers[i], i);
         }
+    }
 
-        if (m_Semaphore == VK_NULL_HANDLE)
+    glm::mat4 ShadowOmniDirectional::GetFaceView(uint32_t face, const glm::vec3& lightPos)
+    {
+        glm::mat4 translation = glm::translate(glm::mat4(1.0f), -lightPos);
+        glm::mat4 rotation = glm::mat4(1.f);
+        switch (face)
         {
-            VkSemaphoreCreateInfo semaphoreCreateInfo{ };
-            semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-            CHECK_VK_RESULT(vkCreateSemaphore(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), &semaphoreCreateInfo, nullptr, &m_Semaphore));
+            case 0: // POSITIVE_X
+                rotation = glm::rotate(rotation, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                rotation = glm::rotate(rotation, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+                break;
+            case 1:	// NEGATIVE_X
+                rotation = glm::rotate(rotation, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                rotation = glm::rotate(rotation, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+                break;
+            case 2:	// POSITIVE_Y
+                rotation = glm::rotate(rotation, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+                break;
+            case 3:	// NEGATIVE_Y
+                rotation = glm::rotate(rotation, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+                break;
+            case 4:	// POSITIVE_Z
+                rotation = glm::rotate(rotation, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+                break;
+            case 5:	// NEGATIVE_Z
+                rotation = glm::rotate(rotation, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+                break;
         }
 
-        if (!s_ShadowOmniDirectionalMaterial)
+        return rotation * translation;
+    }
+
+    void ShadowOmniDirectional::CollectCasters()
+    {
+        // a query per face frustum, casters seen by several faces are merged into one entry with a bit per face.
+        m_Casters.clear();
+        BVH& bvh = BaseApplication::Get().GetScene()->GetBVH();
+        for (uint32_t face = 0; face < 6; ++face)
         {
-            s_ShadowOmniDirectionalMaterial = std::make_shared<Material>("shaders/shadow_omni.vert", "shaders/shadow_omni.frag", GetFrameBuffer()->GetRenderPass());
-            s_ShadowOmniDirectionalMaterial->SetCullingMode(VK_CULL_MODE_BACK_BIT);
-            s_ShadowOmniDirectionalMaterial->Setup();
+            m_VisibleItems.clear();
+            bvh.QueryFrustum(Frustum(m_UniformBufferObject.m_FaceViewProj[face]), BVHItemType_Mesh, m_VisibleItems);
+            for (void* item : m_VisibleItems)
+            {
+                m_Casters.push_back({ static_cast<Mesh*>(item), 1u << face });
+            }
         }
 
-        m_ShadowOmniDirectionalMaterialInstance = MaterialInstance::CreateMaterialInstance(s_ShadowOmniDirectionalMaterial);
+        // group by component so the model matrix is pushed once per component.
+        std::sort(m_Casters.begin(), m_Casters.end(), [](const Caster& lhs, const Caster& rhs)
+        {
+            if (lhs.m_Mesh->GetOwner() != rhs.m_Mesh->GetOwner())
+            {
+                return lhs.m_Mesh->GetOwner() < rhs.m_Mesh->GetOwner();
+            }
+            return lhs.m_Mesh < rhs.m_Mesh;
+        });
 
-        SetupCubeMap();
+        size_t merged = 0;
+        for (size_t i = 0; i < m_Casters.size(); ++i)
+        {
+            if (merged > 0 && m_Casters[merged - 1].m_Mesh == m_Casters[i].m_Mesh)
+            {
+                m_Casters[merged - 1].m_FaceMask |= m_Casters[i].m_FaceMask;
+            }
+            else
+            {
+                m_Casters[merged++] = m_Casters[i];
+            }
+        }
+        m_Casters.resize(merged);
     }
 
-    void ShadowOmniDirectional::BuildCommandBuffer(int index)
+    void ShadowOmniDirectional::Render(const CommandBufferRef& commandBuffer, ShadowAtlas& atlas)
     {
-        //m_CommandBuffer->BeginRecording();
-        m_CommandBuffer->BeginRenderPass();
-        m_CommandBuffer->SetViewport((float)m_FrameBuffer->GetWidth(), (float)m_FrameBuffer->GetHeight(), 0.f, 1.f);
-        m_CommandBuffer->SetScissor(m_FrameBuffer->GetWidth(), m_FrameBuffer->GetHeight(), 0, 0);
-
-        for (GameObject* obj : BaseApplication::Get().GetScene()->GetObjects())
+        // all six tiles are the same size, so if one didn't fit none of them did.
+        if (atlas.GetTileRect(m_FirstTile).extent.width == 0)
         {
-            if (components::ModelComponent* comp = obj->GetComponent<components::ModelComponent>())
-            {
-                PushContants constants;
-                glm::vec3 pos = m_Light->GetParent()->GetOwner()->GetComponent<components::TranslationComponent>()->GetTranslation();
-                glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(-pos.x, -pos.y, -pos.z));
-                glm::mat4 rotation = glm::mat4(1.f);
-                switch (index)
-                {
-                    case 0: // POSITIVE_X
-                        rotation = glm::rotate(rotation, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-                        rotation = glm::rotate(rotation, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-                        break;
-                    case 1:	// NEGATIVE_X
-                        rotation = glm::rotate(rotation, glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-                        rotation = glm::rotate(rotation, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-                        break;
-                    case 2:	// POSITIVE_Y
-                        rotation = glm::rotate(rotation, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-                        break;
-                    case 3:	// NEGATIVE_Y
-                        rotation = glm::rotate(rotation, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-                        break;
-                    case 4:	// POSITIVE_Z
-                        rotation = glm::rotate(rotation, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-                        break;
-                    case 5:	// NEGATIVE_Z
-                        rotation = glm::rotate(rotation, glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-                        break;
-                }
+            return;
+        }
 
-                constants.view = rotation * translation;
-                constants.model = comp->GetModelMatrix();
+        VkPipelineLayout pipelineLayout = s_ShadowOmniDirectionalMaterial->GetPipelineLayout()->GetVulkanPipelineLayout();
 
-                vkCmdPushConstants(
-                        m_CommandBuffer->GetVulkanCommandBuffer(),
-                        m_ShadowOmniDirectionalMaterialInstance->GetMaterial()->GetPipelineLayout()->GetVulkanPipelineLayout(),
-                        VK_SHADER_STAGE_VERTEX_BIT,
-                        0,
-                        sizeof(PushContants),
-                        &constants);
+        UpdateUniformBuffer();
+        CollectCasters();
 
+        for (uint32_t face = 0; face < 6; ++face)
+        {
+            const VkRect2D& rect = atlas.GetTileRect(m_FirstTile + face);
+            commandBuffer->ClearDepth(rect);
+            commandBuffer->SetViewport(rect);
+            commandBuffer->SetScissor(rect);
+            atlas.SetTileViewProj(m_FirstTile + face, m_UniformBufferObject.m_FaceViewProj[face]);
+
+            PushConstants constants;
+            constants.m_Face = face;
 
-                vkDeviceWaitIdle(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice());
+            components::ModelComponent* currentComp = nullptr;
+            for (const Caster& caster : m_Casters)
+            {
+                if (!(caster.m_FaceMask & (1u << face)))
+                {
+                    continue;
+                }
 
-                for (Mesh* model : comp->GetModels())
+                if (caster.m_Mesh->GetOwner() != currentComp)
                 {
-                    model->Render(m_CommandBuffer, m_ShadowOmniDirectionalMaterialInstance);
+                    currentComp = caster.m_Mesh->GetOwner();
+                    constants.m_Model = currentComp->GetModelMatrix();
+
+                    vkCmdPushConstants(
+                            commandBuffer->GetVulkanCommandBuffer(),
+                            pipelineLayout,
+                            VK_SHADER_STAGE_VERTEX_BIT,
+                            0,
+                            sizeof(PushConstants),
+                            &constants);
                 }
+
+                caster.m_Mesh->Render(commandBuffer, m_ShadowOmniDirectionalMaterialInstance);
             }
         }
-
-        m_CommandBuffer->EndRenderPass();
-
-        ImageHelpers::SetImageLayout(m_CommandBuffer->GetVulkanCommandBuffer(),
-                                     m_FrameBuffer->GetAttachment("dist")->m_Image,
-                                     VK_IMAGE_ASPECT_COLOR_BIT,
-                                     VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-
-
-        VkImageSubresourceRange cubeFaceSubresourceRange = {};
-        cubeFaceSubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        cubeFaceSubresourceRange.baseMipLevel = 0;
-        cubeFaceSubresourceRange.levelCount = 1;
-        cubeFaceSubresourceRange.baseArrayLayer = index;
-        cubeFaceSubresourceRange.layerCount = 1;
-
-        ImageHelpers::SetImageLayout(m_CommandBuffer->GetVulkanCommandBuffer(),
-                                     m_CubeMapTexture.m_Image,
-                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                     cubeFaceSubresourceRange);
-
-        // Copy region for transfer from framebuffer to cube face
-        VkImageCopy copyRegion = {};
-
-        copyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        copyRegion.srcSubresource.baseArrayLayer = 0;
-        copyRegion.srcSubresource.mipLevel = 0;
-        copyRegion.srcSubresource.layerCount = 1;
-        copyRegion.srcOffset = { 0, 0, 0 };
-
-        copyRegion.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        copyRegion.dstSubresource.baseArrayLayer = index;
-        copyRegion.dstSubresource.mipLevel = 0;
-        copyRegion.dstSubresource.layerCount = 1;
-        copyRegion.dstOffset = { 0, 0, 0 };
-
-        copyRegion.extent.width = 512;
-        copyRegion.extent.height = 512;
-        copyRegion.extent.depth = 1;
-
-        // Put image copy into command buffer
-        vkCmdCopyImage(
-                m_CommandBuffer->GetVulkanCommandBuffer(),
-                m_FrameBuffer->GetAttachment("dist")->m_Image,
-                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                m_CubeMapTexture.m_Image,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                1,
-                &copyRegion);
-
-        // Transform framebuffer color attachment back
-        ImageHelpers::SetImageLayout(
-                m_CommandBuffer->GetVulkanCommandBuffer(),
-                m_FrameBuffer->GetAttachment("dist")->m_Image,
-                VK_IMAGE_ASPECT_COLOR_BIT,
-                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-        // Change image layout of copied face to shader read
-        ImageHelpers::SetImageLayout(
-                m_CommandBuffer->GetVulkanCommandBuffer(),
-                m_CubeMapTexture.m_Image,
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                cubeFaceSubresourceRange);
-        //m_CommandBuffer->EndRecording();
     }
 
-    void ShadowOmniDirectional::Render(VkSemaphore waitSemaphore)
+    float ShadowOmniDirectional::GetImportance(const glm::vec3& cameraPos, float projectionScale, const Frustum& cameraFrustum)
     {
-        VkSubmitInfo submitInfo = {};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-        VkSemaphore waitSemaphores[] = { waitSemaphore };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        BoundingSphere sphere;
+        sphere.m_Center = m_Light->GetParent()->GetOwner()->GetComponent<components::TranslationComponent>()->GetTranslation();
+        sphere.m_Radius = static_cast<PointLight*>(m_Light)->GetRadius();
+        if (!cameraFrustum.Intersects(sphere))
+        {
+            return 0.f;
+        }
 
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &m_CommandBuffer->GetVulkanCommandBuffer();
+        // roughly the fraction of the screen height the light's sphere covers.
+        float distance = glm::distance(cameraPos, sphere.m_Center);
+        if (distance <= sphere.m_Radius)
+        {
+            return 1.f;
+        }
 
-        VkSemaphore signalSemaphores[] = { m_Semaphore };
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
+        return glm::min(sphere.m_Radius * projectionScale / distance, 1.f);
+    }
 
-        CHECK_VK_RESULT(vkQueueSubmit(VulkanRenderer::Get()->GetDevice()->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE));
+    bool ShadowOmniDirectional::IsAffectedBy(const AABB& bounds)
+    {
+        // anything beyond the radius can't come between the light and a surface it lights.
+        BoundingSphere sphere;
+        sphere.m_Center = m_Light->GetParent()->GetOwner()->GetComponent<components::TranslationComponent>()->GetTranslation();
+        sphere.m_Radius = static_cast<PointLight*>(m_Light)->GetRadius();
+        return sphere.Overlaps(bounds);
     }
 
     void ShadowOmniDirectional::UpdateUniformBuffer()
     {
-        // only need to update if the light has moved.
-        const glm::vec4 pos = glm::vec4(m_Light->GetParent()->GetOwner()->GetComponent<components::TranslationComponent>()->GetTranslation(), 1.f);
-        if (pos != m_UniformBufferObject.m_LightPos)
-        {
-            if (!m_UniformBuffer.IsInitialised())
-            {
-                CHECK_VK_RESULT(VulkanRenderer::Get()->GetDevice()->CreateBuffer(
-                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                        &m_UniformBuffer,
-                        sizeof(UniformBufferObject)))
-
-                CHECK_VK_RESULT(m_UniformBuffer.Map())
-            }
-
-            m_UniformBufferObject.m_Proj = glm::perspective(glm::pi<float>() / 2.0f, 1.0f, 0.01f, 1024.f);
-            m_UniformBufferObject.m_LightPos = pos;
-
-            memcpy(m_UniformBuffer.m_Mapped, &m_UniformBufferObject, sizeof(m_UniformBufferObject));
+        const glm::vec3 pos = m_Light->GetParent()->GetOwner()->GetComponent<components::TranslationComponent>()->GetTranslation();
+        // the far plane is the light radius, deferred.frag uses the same value to rebuild the depth it compares against.
+        const float radius = glm::max(static_cast<PointLight*>(m_Light)->GetRadius(), s_NearPlane * 2.f);
 
-            m_ShadowOmniDirectionalMaterialInstance->SetBufferUniform("UBO", &m_UniformBuffer);
+        glm::mat4 proj = glm::perspective(glm::pi<float>() / 2.0f, 1.0f, s_NearPlane, radius);
+        for (uint32_t face = 0; face < 6; ++face)
+        {
+            m_UniformBufferObject.m_FaceViewProj[face] = proj * GetFaceView(face, pos);
         }
 
-    }
-
-    void ShadowOmniDirectional::SetupCubeMap()
-    {
-        ImageHelpers::CreateImage(512,
-                                  512,
-                                  VK_FORMAT_R32_SFLOAT,
-                                  VK_IMAGE_TILING_OPTIMAL,
-                                  VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                  m_CubeMapTexture.m_Image,
-                                  m_CubeMapTexture.m_ImageMemory,
-                                  true);
-
-        CommandBufferRef cmdBuffer = CommandBuffer::CreateCommandBuffer();
-        cmdBuffer->BeginRecording();
-        // Image barrier for optimal image (target)
-        VkImageSubresourceRange subresourceRange = {};
-        subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        subresourceRange.baseMipLevel = 0;
-        subresourceRange.levelCount = 1;
-        subresourceRange.layerCount = 6;
-        ImageHelpers::SetImageLayout(
-                cmdBuffer->GetVulkanCommandBuffer(),
-                m_CubeMapTexture.m_Image,
-                VK_IMAGE_LAYOUT_UNDEFINED,
-                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                subresourceRange);
-
-        cmdBuffer->Flush();
-
-        m_CubeMapTexture.m_ImageView = ImageHelpers::CreateImageView(m_CubeMapTexture.m_Image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_VIEW_TYPE_CUBE, VK_IMAGE_ASPECT_COLOR_BIT);
-        m_CubeMapTexture.CreateTextureSampler();
-
+        // only need to upload if the light has moved or resized since this frames buffer was last written.
+        const glm::vec4 sphere = glm::vec4(pos, radius);
+        uint32_t frameIndex = VulkanRenderer::Get()->GetCurrentFrameIndex();
+        if (sphere != m_UniformBufferLightSpheres[frameIndex])
+        {
+            memcpy(m_UniformBuffers[frameIndex].m_Mapped, &m_UniformBufferObject, sizeof(m_UniformBufferObject));
+            m_UniformBufferLightSpheres[frameIndex] = sphere;
+        }
     }
 }
@@ -1,14 +1,17 @@
 #pragma once
 
 #include "Shadow.h"
-#include "Texture.h"
 namespace plumbus::vk
 {
+    class Mesh;
+
     class ShadowOmniDirectional : public Shadow
     {
     public:
         static ShadowOmniDirectionalRef CreateShadowOmniDirectional(Light* light);
 
+        static constexpr float s_NearPlane = 0.05f;
+
         ShadowOmniDirectional(Light* light)
         : Shadow(light)
                 {
@@ -18,32 +21,48 @@ namespace plumbus::vk
 
         virtual void Init() override;
 
-        int GetRenderPassCount() { return 6; }
-        void UpdateUniformBuffer();
-        void BuildCommandBuffer(int index);
-        void Render(VkSemaphore waitSemaphore);
-        const Texture& GetCubeMap() const { return m_CubeMapTexture; }
+        bool IsAffectedBy(const AABB& bounds) override;
+
+        // one tile per cube face, in the usual +x, -x, +y, -y, +z, -z order.
+        uint32_t GetTileCount() const override { return 6; }
+        float GetImportance(const glm::vec3& cameraPos, float projectionScale, const Frustum& cameraFrustum) override;
+        void Render(const CommandBufferRef& commandBuffer, ShadowAtlas& atlas) override;
+
+    protected:
+        uint32_t GetMaxTileSize(uint32_t atlasSize) const override { return atlasSize / 4; }
 
     private:
-        void SetupCubeMap();
+        static glm::mat4 GetFaceView(uint32_t face, const glm::vec3& lightPos);
+        void UpdateUniformBuffer();
+        void CollectCasters();
 
         static MaterialRef s_ShadowOmniDirectionalMaterial;
+        static uint32_t s_InstanceCount;
         MaterialInstanceRef m_ShadowOmniDirectionalMaterialInstance;
 
         struct UniformBufferObject
         {
-            glm::mat4 m_Proj;
-            glm::vec4 m_LightPos;
+            glm::mat4 m_FaceViewProj[6];
+        };
+
+        struct PushConstants
+        {
+            glm::mat4 m_Model;
+            uint32_t m_Face;
         };
 
-        struct PushContants
+        // a mesh and the faces whose frustum it's in.
+        struct Caster
         {
-            glm::mat4 view;
-            glm::mat4 model;
+            Mesh* m_Mesh;
+            uint32_t m_FaceMask;
         };
 
         UniformBufferObject m_UniformBufferObject;
-        Buffer m_UniformBuffer;
-        Texture m_CubeMapTexture;
+        //one per frame in flight, each is only rewritten when its copy of the light position or radius is stale.
+        std::vector<Buffer> m_UniformBuffers;
+        std::vector<glm::vec4> m_UniformBufferLightSpheres;
+        std::vector<void*> m_VisibleItems;
+        std::vector<Caster> m_Casters;
     };
 }
@@ -2,7 +2,6 @@
 #include "Device.h"
 #include "VulkanRenderer.h"
 #include "ImageHelpers.h"
-#include "CommandBuffer.h"
 
 namespace plumbus::vk
 {
@@ -25,12 +24,6 @@ namespace plumbus::vk
 	{
 		CreateVulkanSwapChain();
 		CreateImageViews();
-
-		for (int i = 0; i < m_ImageViews.size(); ++i)
-		{
-			m_CommandBuffers.push_back(CommandBuffer::CreateCommandBuffer());
-		}
-
 		CreateRenderPass();
 		CreateDepthTexture();
 		CreateFrameBuffers();
@@ -50,15 +43,19 @@ namespace plumbus::vk
 
 		vkDestroyImageView(device->GetVulkanDevice(), m_DepthImageView, nullptr);
 		vkDestroyImage(device->GetVulkanDevice(), m_DepthImage, nullptr);
-		vkFreeMemory(device->GetVulkanDevice(), m_DepthImageMemory, nullptr);
+		device->GetMemoryAllocator()->Free(m_DepthImageAllocation);
 
 		m_Framebuffers.clear();
-		m_CommandBuffers.clear();
 
 		vkDestroyRenderPass(device->GetVulkanDevice(), m_RenderPass, nullptr);
 
-		vkDestroySemaphore(device->GetVulkanDevice(), m_RenderFinishedSemaphore, nullptr);
-		vkDestroySemaphore(device->GetVulkanDevice(), m_ImageAvailableSemaphore, nullptr);
+		for (size_t i = 0; i < m_ImageAvailableSemaphores.size(); i++)
+		{
+			vkDestroySemaphore(device->GetVulkanDevice(), m_RenderFinishedSemaphores[i], nullptr);
+			vkDestroySemaphore(device->GetVulkanDevice(), m_ImageAvailableSemaphores[i], nullptr);
+		}
+		m_RenderFinishedSemaphores.clear();
+		m_ImageAvailableSemaphores.clear();
 	}
 
 	void SwapChain::Recreate()
@@ -281,7 +278,7 @@ namespace plumbus::vk
 			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			m_DepthImage,
-			m_DepthImageMemory,
+			m_DepthImageAllocation,
 			false);
 
 		m_DepthImageView = ImageHelpers::CreateImageView(m_DepthImage, depthFormat, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_DEPTH_BIT);
@@ -297,7 +294,6 @@ namespace plumbus::vk
 			std::vector<VkImageView> attachments = { m_ImageViews[i], m_DepthImageView };
 			std::vector<VkFormat> attachmentFormats = { m_ImageFormat, VulkanRenderer::Get()->GetDepthFormat() };
 			m_Framebuffers[i] = FrameBuffer::CreateFrameBuffer(GetExtents().width, GetExtents().height, m_RenderPass, attachments, attachmentFormats);
-			m_CommandBuffers[i]->SetFrameBuffer(m_Framebuffers[i]);
 		}
 	}
 
@@ -308,11 +304,17 @@ namespace plumbus::vk
 
 		VkDevice device = VulkanRenderer::Get()->GetDevice()->GetVulkanDevice();
 
-		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_ImageAvailableSemaphore) != VK_SUCCESS ||
-			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_RenderFinishedSemaphore) != VK_SUCCESS)
-		{
+		uint32_t framesInFlight = VulkanRenderer::Get()->GetFramesInFlight();
+		m_ImageAvailableSemaphores.resize(framesInFlight);
+		m_RenderFinishedSemaphores.resize(framesInFlight);
 
-			Log::Fatal("failed to create semaphores!");
+		for (uint32_t i = 0; i < framesInFlight; ++i)
+		{
+			if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_ImageAvailableSemaphores[i]) != VK_SUCCESS ||
+				vkCreateSemaphore(device, &semaphoreInfo, nullptr, &m_RenderFinishedSemaphores[i]) != VK_SUCCESS)
+			{
+				Log::Fatal("failed to create semaphores!");
+			}
 		}
 	}
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "plumbus.h"
+#include "MemoryAllocator.h"
 
 namespace plumbus::vk
 {
@@ -19,10 +20,14 @@ namespace plumbus::vk
 		VkExtent2D& GetExtents() { return m_Extents; }
 		VkSwapchainKHR GetVulkanSwapChain() { return m_SwapChain; }
 
-		const VkSemaphore& GetImageAvailableSemaphore() const { return m_ImageAvailableSemaphore; }
-		const VkSemaphore& GetRenderFinishedSemaphore() const { return m_RenderFinishedSemaphore; }
+		const VkSemaphore& GetImageAvailableSemaphore(uint32_t frameIndex) const { return m_ImageAvailableSemaphores[frameIndex]; }
+		const VkSemaphore& GetRenderFinishedSemaphore(uint32_t frameIndex) const { return m_RenderFinishedSemaphores[frameIndex]; }
 
-		const CommandBufferRef& GetCommandBuffer(int index) const { return m_CommandBuffers[index]; }
+		uint32_t GetImageCount() const { return (uint32_t)m_Images.size(); }
+
+		VkImage GetImage(uint32_t index) const { return m_Images[index]; }
+		VkFormat GetImageFormat() const { return m_ImageFormat; }
+		const FrameBufferRef& GetFrameBuffer(uint32_t index) const { return m_Framebuffers[index]; }
 		const VkRenderPass& GetRenderPass() const { return m_RenderPass; }
 
 	private:
@@ -46,15 +51,15 @@ namespace plumbus::vk
 		std::vector<VkImageView> m_ImageViews;
 
 		VkImage m_DepthImage;
-		VkDeviceMemory m_DepthImageMemory;
+		MemoryAllocation m_DepthImageAllocation;
 		VkImageView m_DepthImageView;
 
 		std::vector<FrameBufferRef> m_Framebuffers;
-		std::vector<CommandBufferRef> m_CommandBuffers;
 
 		VkRenderPass m_RenderPass;
-		VkSemaphore m_ImageAvailableSemaphore;
-		VkSemaphore m_RenderFinishedSemaphore;
+		//one pair per frame in flight.
+		std::vector<VkSemaphore> m_ImageAvailableSemaphores;
+		std::vector<VkSemaphore> m_RenderFinishedSemaphores;
 	};
 };
 
@@ -4,6 +4,8 @@
 #include "BaseApplication.h"
 #include "gli/gli.hpp"
 #include "renderer/vk/ImageHelpers.h"
+#include "renderer/vk/Buffer.h"
+#include "renderer/vk/SamplerCache.h"
 
 namespace plumbus::vk
 {
@@ -33,10 +35,8 @@ namespace plumbus::vk
 		samplerInfo.minLod = 0.0f;
 		samplerInfo.maxLod = 0.0f;
 
-		if (vkCreateSampler(VulkanRenderer::Get()->GetDevice()->GetVulkanDevice(), &samplerInfo, nullptr, &m_TextureSampler) != VK_SUCCESS)
-		{
-			Log::Error("failed to create texture sampler!");
-		}
+		// every loaded texture asks for the same state, so they all end up with the same sampler.
+		m_TextureSampler = VulkanRenderer::Get()->GetDevice()->GetSamplerCache()->GetSampler(samplerInfo);
 	}
 
 	struct ASTCHeader
@@ -159,35 +159,15 @@ namespace plumbus::vk
 		uint32_t mipLevels = static_cast<uint32_t>(tex2D.levels());
 #endif
 
-		VkMemoryAllocateInfo memAllocInfo{};
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		VkMemoryRequirements memReqs;
-
 		VkCommandBuffer copyCmd = device->CreateCommandBuffer();
 
 		// Create a staging buffer for the image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo{};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.size = tex2D.size();
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		CHECK_VK_RESULT(vkCreateBuffer(device->GetVulkanDevice(), &bufferCreateInfo, nullptr, &stagingBuffer));
-		vkGetBufferMemoryRequirements(device->GetVulkanDevice(), stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->FindMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		CHECK_VK_RESULT(vkAllocateMemory(device->GetVulkanDevice(), &memAllocInfo, nullptr, &stagingMemory));
-		CHECK_VK_RESULT(vkBindBufferMemory(device->GetVulkanDevice(), stagingBuffer, stagingMemory, 0));
-
-		// Copy texture data into staging buffer
-		uint8_t *data;
-		CHECK_VK_RESULT(vkMapMemory(device->GetVulkanDevice(), stagingMemory, 0, memReqs.size, 0, (void **)&data));
-		memcpy(data, tex2D.data(), tex2D.size());
-		vkUnmapMemory(device->GetVulkanDevice(), stagingMemory);
+		Buffer stagingBuffer;
+		CHECK_VK_RESULT(device->CreateBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+											 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+											 &stagingBuffer,
+											 tex2D.size(),
+											 (void*)tex2D.data()));
 
 		// Setup copy regions for mip levels
 		std::vector<VkBufferImageCopy> bufferCopyRegions;
@@ -239,13 +219,7 @@ namespace plumbus::vk
 		}
 		CHECK_VK_RESULT(vkCreateImage(device->GetVulkanDevice(), &imageCreateInfo, nullptr, &m_Image));
 
-		vkGetImageMemoryRequirements(device->GetVulkanDevice(), m_Image, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-
-		memAllocInfo.memoryTypeIndex = device->FindMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		CHECK_VK_RESULT(vkAllocateMemory(device->GetVulkanDevice(), &memAllocInfo, nullptr, &m_ImageMemory));
-		CHECK_VK_RESULT(vkBindImageMemory(device->GetVulkanDevice(), m_Image, m_ImageMemory, 0));
+		CHECK_VK_RESULT(device->GetMemoryAllocator()->AllocateImageMemory(m_Image, imageCreateInfo.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_ImageAllocation));
 
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -257,7 +231,7 @@ namespace plumbus::vk
 
 		vkCmdCopyBufferToImage(
 			copyCmd,
-			stagingBuffer,
+			stagingBuffer.m_Buffer,
 			m_Image,
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			static_cast<uint32_t>(bufferCopyRegions.size()),
@@ -267,8 +241,7 @@ namespace plumbus::vk
 		ImageHelpers::SetImageLayout(copyCmd, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout, subresourceRange);
 
 		device->FlushCommandBuffer(copyCmd, queue);
-		vkFreeMemory(device->GetVulkanDevice(), stagingMemory, nullptr);
-		vkDestroyBuffer(device->GetVulkanDevice(), stagingBuffer, nullptr);
+		stagingBuffer.Cleanup();
 
 		m_ImageView = ImageHelpers::CreateImageView(m_Image, format, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT);
 		CreateTextureSampler();
@@ -276,16 +249,15 @@ namespace plumbus::vk
 
 	void Texture::Cleanup()
 	{
-		VkDevice device = VulkanRenderer::Get()->GetDevice()->GetVulkanDevice();
+		DeviceRef deviceRef = VulkanRenderer::Get()->GetDevice();
+		VkDevice device = deviceRef->GetVulkanDevice();
 
 		if(m_ImageView)
 			vkDestroyImageView(device, m_ImageView, nullptr);
 		if(m_Image)
 			vkDestroyImage(device, m_Image, nullptr);
-		if(m_TextureSampler)
-			vkDestroySampler(device, m_TextureSampler, nullptr);
-		if(m_ImageMemory)
-			vkFreeMemory(device, m_ImageMemory, nullptr);
+		if(m_ImageAllocation.IsValid())
+			deviceRef->GetMemoryAllocator()->Free(m_ImageAllocation);
 	}
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "plumbus.h"
 #include "vulkan/vulkan.h"
+#include "MemoryAllocator.h"
 
 namespace plumbus::vk
 {
@@ -30,12 +31,13 @@ namespace plumbus::vk
 	{
 	public:
 		void LoadTexture(std::string filename);
+		// the sampler comes from the device's SamplerCache and is left alone.
 		void Cleanup();
 
 		void CreateTextureSampler();
 
 		VkImage m_Image = VK_NULL_HANDLE;
-		VkDeviceMemory m_ImageMemory = VK_NULL_HANDLE;
+		MemoryAllocation m_ImageAllocation;
 		VkImageView m_ImageView = VK_NULL_HANDLE;
 		VkSampler m_TextureSampler = VK_NULL_HANDLE;
 	};
@@ -0,0 +1,69 @@
+#include "plumbus.h"
+
+#include "renderer/vk/TextureCache.h"
+#include "renderer/vk/Texture.h"
+
+namespace plumbus::vk
+{
+	TextureCache* TextureCache::s_Instance = nullptr;
+
+	TextureCache* TextureCache::Get()
+	{
+		if (s_Instance == nullptr)
+			s_Instance = new TextureCache();
+		return s_Instance;
+	}
+
+	void TextureCache::Destroy()
+	{
+		if (s_Instance)
+		{
+			delete s_Instance;
+			s_Instance = nullptr;
+		}
+	}
+
+	TextureRef TextureCache::GetTexture(const std::string& fileName)
+	{
+		m_Stats.m_Requests++;
+
+		auto it = m_Textures.find(fileName);
+		if (it != m_Textures.end())
+		{
+			if (TextureRef texture = it->second.lock())
+			{
+				return texture;
+			}
+		}
+
+		// the gpu resources go with the last reference.
+		TextureRef texture(new Texture(), [](Texture* texture)
+		{
+			texture->Cleanup();
+			delete texture;
+		});
+		texture->LoadTexture(fileName);
+		m_Stats.m_Loads++;
+
+		m_Textures[fileName] = texture;
+		return texture;
+	}
+
+	const TextureCacheStats& TextureCache::GetStats()
+	{
+		m_Stats.m_LoadedTextures = 0;
+		for (auto it = m_Textures.begin(); it != m_Textures.end();)
+		{
+			if (it->second.expired())
+			{
+				it = m_Textures.erase(it);
+			}
+			else
+			{
+				m_Stats.m_LoadedTextures++;
+				++it;
+			}
+		}
+		return m_Stats;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "plumbus.h"
+
+namespace plumbus::vk
+{
+	struct TextureCacheStats
+	{
+		uint32_t m_Requests = 0;
+		uint32_t m_Loads = 0; // requests that had to read the file, the rest shared a texture already loaded.
+		uint32_t m_LoadedTextures = 0;
+	};
+
+	// loads each texture file once and shares it. like the ModelCache it only holds weak references, a texture is
+	// freed when the last holder lets go.
+	class TextureCache
+	{
+	public:
+		static TextureCache* Get();
+		static void Destroy();
+
+		TextureRef GetTexture(const std::string& fileName);
+
+		const TextureCacheStats& GetStats();
+
+	private:
+		static TextureCache* s_Instance;
+
+		std::unordered_map<std::string, std::weak_ptr<Texture>> m_Textures;
+		TextureCacheStats m_Stats;
+	};
+}
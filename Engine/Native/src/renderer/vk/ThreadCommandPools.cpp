@@ -0,0 +1,73 @@
+#include "ThreadCommandPools.h"
+#include "CommandBuffer.h"
+#include "VulkanRenderer.h"
+#include "Device.h"
+#include "JobSystem.h"
+
+namespace plumbus::vk
+{
+	ThreadCommandPoolsRef ThreadCommandPools::CreateThreadCommandPools(uint32_t frameCount, uint32_t threadCount)
+	{
+		return std::make_shared<ThreadCommandPools>(frameCount, threadCount);
+	}
+
+	ThreadCommandPools::ThreadCommandPools(uint32_t frameCount, uint32_t threadCount)
+		: m_ThreadCount(threadCount)
+	{
+		DeviceRef device = VulkanRenderer::Get()->GetDevice();
+		m_Pools.resize(frameCount * threadCount);
+		for (Pool& pool : m_Pools)
+		{
+			// reset as a whole, so the buffers don't need to be individually resettable.
+			pool.m_CommandPool = device->CreateCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+		}
+	}
+
+	ThreadCommandPools::~ThreadCommandPools()
+	{
+		VkDevice device = VulkanRenderer::Get()->GetDevice()->GetVulkanDevice();
+		for (Pool& pool : m_Pools)
+		{
+			pool.m_CommandBuffers.clear();
+			vkDestroyCommandPool(device, pool.m_CommandPool, nullptr);
+		}
+	}
+
+	void ThreadCommandPools::Reset(uint32_t frame)
+	{
+		VkDevice device = VulkanRenderer::Get()->GetDevice()->GetVulkanDevice();
+		for (uint32_t thread = 0; thread < m_ThreadCount; ++thread)
+		{
+			Pool& pool = GetPool(frame, thread);
+			if (pool.m_Used > 0)
+			{
+				CHECK_VK_RESULT(vkResetCommandPool(device, pool.m_CommandPool, 0));
+				pool.m_Used = 0;
+			}
+		}
+	}
+
+	const CommandBufferRef& ThreadCommandPools::AcquireSecondary(uint32_t frame)
+	{
+		uint32_t thread = JobSystem::Get()->GetThreadIndex();
+		PL_ASSERT(thread < m_ThreadCount);
+
+		Pool& pool = GetPool(frame, thread);
+		if (pool.m_Used == pool.m_CommandBuffers.size())
+		{
+			pool.m_CommandBuffers.push_back(CommandBuffer::CreateCommandBuffer(pool.m_CommandPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+		}
+
+		return pool.m_CommandBuffers[pool.m_Used++];
+	}
+
+	uint32_t ThreadCommandPools::GetAllocatedCount() const
+	{
+		uint32_t count = 0;
+		for (const Pool& pool : m_Pools)
+		{
+			count += static_cast<uint32_t>(pool.m_CommandBuffers.size());
+		}
+		return count;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "plumbus.h"
+
+namespace plumbus::vk
+{
+	// a command pool per recording thread per frame in flight. pools can't be used from two threads at once, so each job
+	// thread gets its own and no locking is needed while recording. a frame's pools are reset in one go once its fence
+	// has signalled, which is far cheaper than resetting every command buffer on its own.
+	class ThreadCommandPools
+	{
+	public:
+		static ThreadCommandPoolsRef CreateThreadCommandPools(uint32_t frameCount, uint32_t threadCount);
+
+		ThreadCommandPools(uint32_t frameCount, uint32_t threadCount);
+		~ThreadCommandPools();
+
+		// only once the gpu is done with the frame, every secondary handed out for it is recycled.
+		void Reset(uint32_t frame);
+		// a secondary command buffer from the calling thread's pool, valid until the frame is next reset.
+		const CommandBufferRef& AcquireSecondary(uint32_t frame);
+
+		uint32_t GetAllocatedCount() const;
+
+	private:
+		struct Pool
+		{
+			VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+			std::vector<CommandBufferRef> m_CommandBuffers;
+			uint32_t m_Used = 0;
+		};
+
+		Pool& GetPool(uint32_t frame, uint32_t thread) { return m_Pools[frame * m_ThreadCount + thread]; }
+
+		uint32_t m_ThreadCount;
+		std::vector<Pool> m_Pools;
+	};
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+namespace plumbus::vk
+{
+	// kept free of engine includes, the cooker bakes vertex data in these layouts too.
+	enum class VertexLayoutComponent : uint8_t
+	{
+		Position = 0x0,
+		Normal = 0x1,
+		Colour = 0x2,
+		UV = 0x3,
+		Tangent = 0x4,
+		Bitangent = 0x5,
+		DummyFloat = 0x6,
+		DummyVec4 = 0x7
+	};
+
+	// in floats.
+	inline uint32_t GetComponentSize(VertexLayoutComponent component)
+	{
+		switch (component)
+		{
+			case VertexLayoutComponent::UV:
+				return 2;
+			case VertexLayoutComponent::DummyFloat:
+				return 1;
+			case VertexLayoutComponent::DummyVec4:
+				return 4;
+			default:
+				return 3;
+		}
+	}
+}
@@ -36,9 +36,12 @@
 #include "glslang/StandAlone/DirStackFileIncluder.h"
 #include "shader_compiler/ShaderCompiler.h"
 #include "shader_compiler/ShaderSettings.h"
+#include "shader_compiler/ShaderCache.h"
+#include "LightManager.h"
 #include "ShadowManager.h"
-#include "ShadowDirectional.h"
-#include "ShadowOmniDirectional.h"
+#include "ShadowAtlas.h"
+#include "ThreadCommandPools.h"
+#include "JobSystem.h"
 
 static uint32_t s_Width, s_Height;
 
@@ -95,34 +98,17 @@ namespace plumbus::vk
 		m_Window->CreateSurface();
         m_Device = Device::CreateDevice();
         m_PipelineCache = PipelineCache::CreatePipelineCache();
+        m_ThreadCommandPools = ThreadCommandPools::CreateThreadCommandPools(m_FramesInFlight, JobSystem::Get()->GetWorkerCount() + 1);
         m_SwapChain = SwapChain::CreateSwapChain();
 
         GenerateFullscreenQuad();
+        CreateRenderGraph();
 
-        std::vector<FrameBuffer::FrameBufferAttachmentInfo> offscreenAttachmentInfo =
-        {
-            FrameBuffer::FrameBufferAttachmentInfo(VK_FORMAT_R16G16B16A16_SFLOAT, FrameBuffer::FrameBufferAttachmentType::Colour, "position"),
-            FrameBuffer::FrameBufferAttachmentInfo(VK_FORMAT_R16G16B16A16_SFLOAT, FrameBuffer::FrameBufferAttachmentType::Colour, "normal"),
-            FrameBuffer::FrameBufferAttachmentInfo(VK_FORMAT_R8G8B8A8_UNORM, FrameBuffer::FrameBufferAttachmentType::Colour, "colour"),
-            FrameBuffer::FrameBufferAttachmentInfo(GetDepthFormat(), FrameBuffer::FrameBufferAttachmentType::Depth, "depth")
-        };
-
-        m_DeferredFrameBuffer = FrameBuffer::CreateFrameBuffer(m_SwapChain->GetExtents().width, m_SwapChain->GetExtents().height, offscreenAttachmentInfo);
-
-
-#if ENABLE_IMGUI
-		std::vector<FrameBuffer::FrameBufferAttachmentInfo> outputAttachmentInfo =
-		{
-			FrameBuffer::FrameBufferAttachmentInfo(VK_FORMAT_R8G8B8A8_UNORM, FrameBuffer::FrameBufferAttachmentType::Colour, "colour"),
-			FrameBuffer::FrameBufferAttachmentInfo(GetDepthFormat(), FrameBuffer::FrameBufferAttachmentType::Depth, "depth")
-		};
-
-        m_DeferredOutputFrameBuffer = FrameBuffer::CreateFrameBuffer(m_SwapChain->GetExtents().width, m_SwapChain->GetExtents().height, outputAttachmentInfo);
-#endif
-
-        m_DescriptorPool = DescriptorPool::CreateDescriptorPool(100, 100, 100);
+        m_DescriptorPool = DescriptorPool::CreateDescriptorPool(100 * m_FramesInFlight, 100 * m_FramesInFlight, 100 * m_FramesInFlight);
 
-        CreateLightsUniformBuffers();
+        CreateFrameResources();
+        CreateLightBuffers();
+        LightManager::Get()->SetFrameCount(m_FramesInFlight);
 
 #if ENABLE_IMGUI
         SetupImGui();
@@ -142,22 +128,100 @@ namespace plumbus::vk
 #endif
 
 
+    void VulkanRenderer::CreateRenderGraph()
+    {
+        m_RenderGraph = RenderGraph::CreateRenderGraph();
+
+        uint32_t width = m_SwapChain->GetExtents().width;
+        uint32_t height = m_SwapChain->GetExtents().height;
+        RenderGraphResource position = m_RenderGraph->CreateAttachment("position", { VK_FORMAT_R16G16B16A16_SFLOAT, width, height });
+        RenderGraphResource normal = m_RenderGraph->CreateAttachment("normal", { VK_FORMAT_R16G16B16A16_SFLOAT, width, height });
+        RenderGraphResource albedo = m_RenderGraph->CreateAttachment("colour", { VK_FORMAT_R8G8B8A8_UNORM, width, height });
+        RenderGraphResource depth = m_RenderGraph->CreateAttachment("depth", { GetDepthFormat(), width, height });
+
+        // the atlas keeps its contents between frames and the swap chain image changes every frame, both come from outside.
+        ShadowAtlas* atlas = ShadowManager::Get()->GetAtlas();
+        m_ShadowAtlasResource = m_RenderGraph->ImportImage("shadowAtlas", atlas->GetTexture().m_Image, GetSampledDepthFormat(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+        m_SwapChainResource = m_RenderGraph->ImportImage("swapchain", m_SwapChain->GetImage(0), m_SwapChain->GetImageFormat(), VK_IMAGE_LAYOUT_UNDEFINED);
+
+        m_ShadowPass = m_RenderGraph->AddPass("Shadows");
+        m_ShadowPass->WriteExternal(m_ShadowAtlasResource, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+        m_ShadowPass->SetSecondaryCommandBuffers(true);
+        m_ShadowPass->SetCondition([]() { return ShadowManager::Get()->HasScheduledShadows(); });
+        m_ShadowPass->SetRecordFunction([](const CommandBufferRef& commandBuffer) { ShadowManager::Get()->Render(commandBuffer); });
+
+        RenderGraphPass* gBufferPass = m_RenderGraph->AddPass("G-Buffer");
+        gBufferPass->WriteColour(position);
+        gBufferPass->WriteColour(normal);
+        gBufferPass->WriteColour(albedo);
+        gBufferPass->WriteDepth(depth);
+        gBufferPass->SetSecondaryCommandBuffers(true);
+        gBufferPass->SetRecordFunction([this](const CommandBufferRef& commandBuffer) { RecordGBuffer(commandBuffer); });
+
+#if ENABLE_IMGUI
+        // the debug views sample the g-buffer while the ui draws.
+        m_RenderGraph->Export(position);
+        m_RenderGraph->Export(normal);
+        m_RenderGraph->Export(albedo);
+
+        // lit into its own target so the ui can show it as the game view.
+        RenderGraphResource output = m_RenderGraph->CreateAttachment("colour", { VK_FORMAT_R8G8B8A8_UNORM, width, height });
+        RenderGraphResource outputDepth = m_RenderGraph->CreateAttachment("depth", { GetDepthFormat(), width, height });
+
+        RenderGraphPass* outputPass = m_RenderGraph->AddPass("Deferred Output");
+        outputPass->Read(position);
+        outputPass->Read(normal);
+        outputPass->Read(albedo);
+        outputPass->Read(m_ShadowAtlasResource);
+        outputPass->WriteColour(output);
+        outputPass->WriteDepth(outputDepth);
+        outputPass->SetRecordFunction([this](const CommandBufferRef& commandBuffer) { RecordLighting(commandBuffer); });
+
+        m_PresentPass = m_RenderGraph->AddPass("Present");
+        m_PresentPass->WriteExternal(m_SwapChainResource, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        m_PresentPass->Read(output);
+        m_PresentPass->SetRecordFunction([this](const CommandBufferRef& commandBuffer) { m_ImGui->DrawFrame(commandBuffer); });
+#else
+        m_PresentPass = m_RenderGraph->AddPass("Present");
+        m_PresentPass->WriteExternal(m_SwapChainResource, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        m_PresentPass->Read(position);
+        m_PresentPass->Read(normal);
+        m_PresentPass->Read(albedo);
+        m_PresentPass->Read(m_ShadowAtlasResource);
+        m_PresentPass->SetRecordFunction([this](const CommandBufferRef& commandBuffer) { RecordLighting(commandBuffer); });
+#endif
+
+        m_RenderGraph->Compile();
+
+        m_DeferredFrameBuffer = gBufferPass->GetFrameBuffer();
+#if ENABLE_IMGUI
+        m_DeferredOutputFrameBuffer = outputPass->GetFrameBuffer();
+#endif
+    }
+
     bool VulkanRenderer::WindowShouldClose()
     {
 		return static_cast<vk::Window*>(m_Window)->ShouldClose();
     }
 
+    void VulkanRenderer::BeginFrame()
+    {
+        // wait until the gpu has finished with this frames resources before the scene starts writing to them again.
+        WaitForFrame(m_CurrentFrame);
+        m_ThreadCommandPools->Reset(m_CurrentFrame);
+    }
+
     void VulkanRenderer::DrawFrame()
     {
-        // keep in list so pointers retain their target until the present call.
-        // the last element is always the next semaphore to use.
-        std::vector<VkSemaphore_T*> activeSemaphores = { m_SwapChain->GetImageAvailableSemaphore() };
+        FrameResources& frame = m_Frames[m_CurrentFrame];
+        VkSemaphore imageAvailableSemaphore = m_SwapChain->GetImageAvailableSemaphore(m_CurrentFrame);
 
         UpdateOutputMaterial();
+        m_PipelineCache->Update();
         UpdateLightsUniformBuffer();
 
         uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(m_Device->GetVulkanDevice(), m_SwapChain->GetVulkanSwapChain(), std::numeric_limits<uint64_t>::max(), activeSemaphores.back(), VK_NULL_HANDLE, &imageIndex);
+        VkResult result = vkAcquireNextImageKHR(m_Device->GetVulkanDevice(), m_SwapChain->GetVulkanSwapChain(), std::numeric_limits<uint64_t>::max(), imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR)
         {
@@ -169,97 +233,93 @@ namespace plumbus::vk
             Log::Fatal("failed to acquire swap chain image!");
         }
 
-    	std::vector<ShadowDirectional*> dirShadows = ShadowManager::Get()->GetDirectionalShadows();
-        std::vector<DescriptorSet::TextureUniform> dirShadowTextures;
-    	for (int i = 0; i < dirShadows.size(); ++i)
-    	{
-            dirShadows[i]->BuildCommandBuffer();
-            dirShadows[i]->Render(activeSemaphores.back());
-    		dirShadowTextures.push_back({ dirShadows[i]->GetFrameBuffer()->GetSampler(), dirShadows[i]->GetFrameBuffer()->GetAttachment("depth")->m_ImageView });
-    		activeSemaphores.push_back(dirShadows[i]->GetSemaphore());
-    	}
-
-    	if (!dirShadowTextures.empty() && ShadowManager::Get()->ShadowTexturesOutOfDate())
-    	{
-            m_DeferredOutputMaterialInstance->SetTextureUniform("samplerDirShadows", dirShadowTextures, true);
+        // the image may have been acquired out of order, make sure whichever frame last used it is done.
+        if (m_ImagesInFlight[imageIndex] != UINT32_MAX)
+        {
+            WaitForFrame(m_ImagesInFlight[imageIndex]);
         }
+        m_ImagesInFlight[imageIndex] = m_CurrentFrame;
 
-        std::vector<ShadowOmniDirectional*> omniDirShadows = ShadowManager::Get()->GetOmniDirectionalShadows();
-        std::vector<DescriptorSet::TextureUniform> omniDirShadowTextures;
-        for (int i = 0; i < omniDirShadows.size(); ++i)
-        {
-            omniDirShadows[i]->UpdateUniformBuffer();
+        // shadow maps keep their contents between frames, only the ones whose light or casters changed are redrawn.
+        ShadowManager* shadowManager = ShadowManager::Get();
+        shadowManager->Update();
 
-            static bool hasRecorded = false;
-            if (!hasRecorded)
-            {
-                omniDirShadows[i]->GetCommandBuffer()->BeginRecording();
-                for (int j = 0; j < omniDirShadows[i]->GetRenderPassCount(); ++j)
-                {
-                    omniDirShadows[i]->BuildCommandBuffer(j);
-                }
-                omniDirShadows[i]->GetCommandBuffer()->EndRecording();
-            }
+#if ENABLE_IMGUI
+        m_ImGui->UpdateBuffers();
+#endif
 
-            omniDirShadows[i]->Render(activeSemaphores.back());
-            omniDirShadowTextures.push_back({ omniDirShadows[i]->GetCubeMap().m_TextureSampler, omniDirShadows[i]->GetCubeMap().m_ImageView });
-            activeSemaphores.push_back(omniDirShadows[i]->GetSemaphore());
+        // the atlas is recreated when its budget changes and grows when shadows are added, the lighting pass's
+        // descriptors have to point at the current ones before anything records.
+        ShadowAtlas* atlas = shadowManager->GetAtlas();
+        if (shadowManager->ShadowTexturesOutOfDate())
+        {
+            const Texture& atlasTexture = atlas->GetTexture();
+            m_DeferredOutputMaterialInstance->SetTextureUniform("shadowAtlas", { { atlasTexture.m_TextureSampler, atlasTexture.m_ImageView } }, true);
+            shadowManager->SetShadowTexturesUpToDate();
         }
-
-        if (!omniDirShadowTextures.empty() && ShadowManager::Get()->ShadowTexturesOutOfDate())
+        if (ReserveStorageBuffer(frame.m_ShadowTilesVulkanBuffer, sizeof(ShadowTileInfo) * atlas->GetTileCount(), "ShadowTiles"))
         {
-            static bool hasUploaded = false;
-            if(!hasUploaded)
-            {
-                m_DeferredOutputMaterialInstance->SetTextureUniform("samplerOmniDirShadows", omniDirShadowTextures, false);
-                hasUploaded = true;
-            }
+            atlas->MarkAllDirty(m_CurrentFrame);
         }
-    	
-        BuildPresentCommandBuffer(imageIndex);
-        BuildDefferedCommandBuffer();
-#if ENABLE_IMGUI
-        BuildDeferredOutputCommandBuffer();
-#endif
 
+        // the swap chain image is whichever was acquired.
+        m_RenderGraph->SetImportedImage(m_ShadowAtlasResource, atlas->GetTexture().m_Image);
+        m_ShadowPass->SetFrameBuffer(atlas->GetFrameBuffer());
+        m_RenderGraph->SetImportedImage(m_SwapChainResource, m_SwapChain->GetImage(imageIndex));
+        m_PresentPass->SetFrameBuffer(m_SwapChain->GetFrameBuffer(imageIndex));
+
+        // the passes record on the worker threads, which only bind the sets.
+        MaterialInstance::BuildDirtyDescriptorSets(m_CurrentFrame);
+
+        frame.m_CommandBuffer->BeginRecording();
+        m_RenderGraph->Execute(frame.m_CommandBuffer);
+        frame.m_CommandBuffer->EndRecording();
+
+        // the whole frame is one submission, only the swap chain image has to wait for anything.
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
         submitInfo.waitSemaphoreCount = 1;
-        VkSemaphore waitSemaphores[] = { activeSemaphores.back() };
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        submitInfo.pWaitSemaphores = &imageAvailableSemaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
 
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &m_DeferredCommandBuffer->GetVulkanCommandBuffer();
-
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = &m_DeferredSemaphore;
-        activeSemaphores.push_back(m_DeferredSemaphore);
-        CHECK_VK_RESULT(vkQueueSubmit(GetDevice()->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE));
+        submitInfo.pCommandBuffers = &frame.m_CommandBuffer->GetVulkanCommandBuffer();
 
-#if ENABLE_IMGUI
-        VkSemaphore imguiWaitSemaphores[] = { activeSemaphores.back() };
-        submitInfo.pWaitSemaphores = imguiWaitSemaphores;
-        submitInfo.pSignalSemaphores = &m_DeferredOutputSemaphore;
-        activeSemaphores.push_back(m_DeferredOutputSemaphore);
-
-        submitInfo.pCommandBuffers = &m_DeferredOutputCommandBuffer->GetVulkanCommandBuffer();
-        CHECK_VK_RESULT(vkQueueSubmit(GetDevice()->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE));
-#endif
-        VkSemaphore presentWaitSemaphores[] = { activeSemaphores.back() };
-        submitInfo.pWaitSemaphores = presentWaitSemaphores;
-        submitInfo.pSignalSemaphores = &m_SwapChain->GetRenderFinishedSemaphore();
+        frame.m_TimelineValue = ++m_SubmittedFrames;
+        if (m_FrameTimeline != VK_NULL_HANDLE)
+        {
+            // the binary semaphores ignore their values.
+            VkSemaphore signalSemaphores[] = { m_SwapChain->GetRenderFinishedSemaphore(m_CurrentFrame), m_FrameTimeline };
+            uint64_t signalValues[] = { 0, frame.m_TimelineValue };
+            uint64_t waitValue = 0;
+
+            VkTimelineSemaphoreSubmitInfoKHR timelineSubmitInfo = {};
+            timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+            timelineSubmitInfo.waitSemaphoreValueCount = 1;
+            timelineSubmitInfo.pWaitSemaphoreValues = &waitValue;
+            timelineSubmitInfo.signalSemaphoreValueCount = 2;
+            timelineSubmitInfo.pSignalSemaphoreValues = signalValues;
+
+            submitInfo.pNext = &timelineSubmitInfo;
+            submitInfo.signalSemaphoreCount = 2;
+            submitInfo.pSignalSemaphores = signalSemaphores;
+            CHECK_VK_RESULT(vkQueueSubmit(GetDevice()->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE));
+        }
+        else
+        {
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &m_SwapChain->GetRenderFinishedSemaphore(m_CurrentFrame);
 
-        submitInfo.pCommandBuffers = &m_SwapChain->GetCommandBuffer(imageIndex)->GetVulkanCommandBuffer();
-        CHECK_VK_RESULT(vkQueueSubmit(GetDevice()->GetGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE));
-        activeSemaphores.push_back(m_SwapChain->GetRenderFinishedSemaphore());
+            CHECK_VK_RESULT(vkResetFences(m_Device->GetVulkanDevice(), 1, &frame.m_InFlightFence));
+            CHECK_VK_RESULT(vkQueueSubmit(GetDevice()->GetGraphicsQueue(), 1, &submitInfo, frame.m_InFlightFence));
+        }
 
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = &activeSemaphores.back();
+        presentInfo.pWaitSemaphores = &m_SwapChain->GetRenderFinishedSemaphore(m_CurrentFrame);
 
         VkSwapchainKHR swapChains[] = { m_SwapChain->GetVulkanSwapChain() };
         presentInfo.swapchainCount = 1;
@@ -278,7 +338,7 @@ namespace plumbus::vk
             Log::Fatal("failed to present swap chain image!");
         }
 
-		vkQueueWaitIdle(GetDevice()->GetPresentQueue());
+        m_CurrentFrame = (m_CurrentFrame + 1) % m_FramesInFlight;
     }
 
     void VulkanRenderer::AwaitIdle()
@@ -286,6 +346,13 @@ namespace plumbus::vk
         vkDeviceWaitIdle(m_Device->GetVulkanDevice());
     }
 
+    void VulkanRenderer::SetFramesInFlight(uint32_t framesInFlight)
+    {
+        PL_ASSERT(!m_Device, "frames in flight must be set before the renderer is initialised.");
+        PL_ASSERT(framesInFlight > 0);
+        m_FramesInFlight = framesInFlight;
+    }
+
     void VulkanRenderer::Init(std::string appName)
     {
 		m_Window = new vk::Window();
@@ -298,29 +365,38 @@ namespace plumbus::vk
 
     void VulkanRenderer::Cleanup()
     {
-    	ShadowManager::Destroy();
+    	shaders::ShaderCache::LogStats();
     	
         m_DeferredFrameBuffer.reset();
 #if ENABLE_IMGUI
         m_DeferredOutputFrameBuffer.reset();
 #endif
-        for (GameObject* obj : BaseApplication::Get().GetScene()->GetObjects())
+        m_ShadowPass = nullptr;
+        m_PresentPass = nullptr;
+        m_RenderGraph.reset();
+
+        for (components::ModelComponent* modelComp : ComponentRegistry::Get()->GetComponents<components::ModelComponent>())
         {
-            if (components::ModelComponent* modelComp = obj->GetComponent<components::ModelComponent>())
-            {
-                modelComp->Cleanup();
-            }
+            modelComp->Cleanup();
         }
 
         m_FullscreenQuad.Cleanup();
-        m_ViewPosVulkanBuffer.Cleanup();
-        m_DirLightsVulkanBuffer.Cleanup();
-        m_PointLightsVulkanBuffer.Cleanup();
+        for (FrameResources& frame : m_Frames)
+        {
+            frame.m_ViewPosVulkanBuffer.Cleanup();
+            frame.m_LightCountsVulkanBuffer.Cleanup();
+            frame.m_DirLightsVulkanBuffer.Cleanup();
+            frame.m_PointLightsVulkanBuffer.Cleanup();
+            frame.m_ClusterInfoVulkanBuffer.Cleanup();
+            frame.m_LightClustersVulkanBuffer.Cleanup();
+            frame.m_LightIndicesVulkanBuffer.Cleanup();
+            frame.m_ShadowTilesVulkanBuffer.Cleanup();
+            frame.m_InstanceVulkanBuffer.Cleanup();
+            frame.m_CommandBuffer.reset();
+        }
 
-        m_DeferredCommandBuffer.reset();
 #if ENABLE_IMGUI
         delete m_ImGui;
-        m_DeferredOutputCommandBuffer.reset();
 #endif
 
         m_SwapChain->Cleanup();
@@ -331,6 +407,11 @@ namespace plumbus::vk
 
         m_DescriptorPool.reset();
 
+        // the atlas and its command buffers have to go before the device and command pool do.
+        ShadowManager::Destroy();
+        m_GBufferSecondaries.clear();
+        m_ThreadCommandPools.reset();
+
         for (auto& shaderModule : m_ShaderModules)
         {
             vkDestroyShaderModule(m_Device->GetVulkanDevice(), shaderModule, nullptr);
@@ -339,15 +420,15 @@ namespace plumbus::vk
         m_PipelineCache.reset();
         vkDestroyCommandPool(m_Device->GetVulkanDevice(), m_Device->GetCommandPool(), nullptr);
 
+        for (FrameResources& frame : m_Frames)
+        {
+            vkDestroyFence(m_Device->GetVulkanDevice(), frame.m_InFlightFence, nullptr);
+        }
+        vkDestroySemaphore(m_Device->GetVulkanDevice(), m_FrameTimeline, nullptr);
+        m_Frames.clear();
+        m_ImagesInFlight.clear();
 
-            vkDestroySemaphore(m_Device->GetVulkanDevice(), m_DeferredSemaphore, nullptr);
-
-#if ENABLE_IMGUI
-
-            vkDestroySemaphore(m_Device->GetVulkanDevice(), m_DeferredOutputSemaphore, nullptr);
-      #endif
-
-      m_Device.reset();
+        m_Device.reset();
 
 #if !PL_DIST
         DestroyDebugReportCallbackEXT(m_Instance->GetVulkanInstance(), m_Callback, nullptr);
@@ -365,6 +446,14 @@ namespace plumbus::vk
         );
     }
 
+    VkFormat VulkanRenderer::GetSampledDepthFormat()
+    {
+        return FindSupportedFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+        );
+    }
+
     VkFormat VulkanRenderer::FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
     {
         for (VkFormat format : candidates)
@@ -401,6 +490,12 @@ namespace plumbus::vk
 #endif
         extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 
+        // optional, the device extensions it unlocks (timeline semaphores) are only enabled when it's there.
+        if (Instance::IsExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+        {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        }
+
         return extensions;
     }
 
@@ -440,205 +535,316 @@ namespace plumbus::vk
             indexBuffer.data()));
     }
 
-    void VulkanRenderer::CreateLightsUniformBuffers()
+    void VulkanRenderer::CreateFrameResources()
     {
-        if (!m_ViewPosVulkanBuffer.IsInitialised())
+        // starts at zero, which every frame's value starts at too, so the first wait on each frame returns straight away.
+        if (m_Device->IsTimelineSemaphoreSupported())
         {
-            CHECK_VK_RESULT(m_Device->CreateBuffer(
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                    &m_ViewPosVulkanBuffer,
-                    sizeof(m_ViewPos)));
-
-            CHECK_VK_RESULT(m_ViewPosVulkanBuffer.Map());
+            m_FrameTimeline = m_Device->CreateTimelineSemaphore(0);
         }
 
-        if (m_DirectionalLights.size() > 0)
+        // start signalled for the same reason.
+        VkFenceCreateInfo fenceCreateInfo{};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        m_Frames.resize(m_FramesInFlight);
+        for (FrameResources& frame : m_Frames)
         {
+            if (m_FrameTimeline == VK_NULL_HANDLE)
+            {
+                CHECK_VK_RESULT(vkCreateFence(m_Device->GetVulkanDevice(), &fenceCreateInfo, nullptr, &frame.m_InFlightFence));
+            }
+            frame.m_CommandBuffer = CommandBuffer::CreateCommandBuffer();
+
+            // grown by ReserveStorageBuffer when a frame has more instances, the whole used range is rewritten every frame.
             CHECK_VK_RESULT(m_Device->CreateBuffer(
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                    &m_DirLightsVulkanBuffer,
-                    sizeof(DirectionalLightBufferInfo) * m_DirectionalLights.size()));
+                    &frame.m_InstanceVulkanBuffer,
+                    sizeof(glm::mat4) * s_InitialInstanceCapacity));
 
-            CHECK_VK_RESULT(m_DirLightsVulkanBuffer.Map());
+            CHECK_VK_RESULT(frame.m_InstanceVulkanBuffer.Map());
         }
 
-        if (m_PointLights.size() > 0)
-        {
-            CHECK_VK_RESULT(m_Device->CreateBuffer(
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                    &m_PointLightsVulkanBuffer,
-                    sizeof(PointLightBufferInfo) * m_PointLights.size()));
+        m_ImagesInFlight.assign(m_SwapChain->GetImageCount(), UINT32_MAX);
+    }
 
-            CHECK_VK_RESULT(m_PointLightsVulkanBuffer.Map());
+    void VulkanRenderer::WaitForFrame(uint32_t frameIndex)
+    {
+        const FrameResources& frame = m_Frames[frameIndex];
+        if (m_FrameTimeline != VK_NULL_HANDLE)
+        {
+            m_Device->WaitForTimelineValue(m_FrameTimeline, frame.m_TimelineValue);
+        }
+        else
+        {
+            CHECK_VK_RESULT(vkWaitForFences(m_Device->GetVulkanDevice(), 1, &frame.m_InFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max()));
         }
-
-        UpdateLightsUniformBuffer();
     }
 
-    void VulkanRenderer::BuildPresentCommandBuffer(uint32_t imageIndex)
+    void VulkanRenderer::CreateLightBuffers()
     {
-#if ENABLE_IMGUI
-        m_ImGui->UpdateBuffers();
-#endif
+        for (FrameResources& frame : m_Frames)
+        {
+            if (!frame.m_ViewPosVulkanBuffer.IsInitialised())
+            {
+                CHECK_VK_RESULT(m_Device->CreateBuffer(
+                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        &frame.m_ViewPosVulkanBuffer,
+                        sizeof(m_ViewPos)));
 
-        // Set target frame buffer
-        m_SwapChain->GetCommandBuffer(imageIndex)->BeginRecording();
-        m_SwapChain->GetCommandBuffer(imageIndex)->BeginRenderPass();
+                CHECK_VK_RESULT(frame.m_ViewPosVulkanBuffer.Map());
 
-#if ENABLE_IMGUI
-        m_ImGui->DrawFrame(m_SwapChain->GetCommandBuffer(imageIndex));
-#else
-        m_SwapChain->GetCommandBuffer(imageIndex)->SetViewport((float)m_SwapChain->GetExtents().width, (float)m_SwapChain->GetExtents().height, 0.f, 1.f);
-        m_SwapChain->GetCommandBuffer(imageIndex)->SetScissor(m_SwapChain->GetExtents().width, m_SwapChain->GetExtents().height, 0, 0);
+                CHECK_VK_RESULT(m_Device->CreateBuffer(
+                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        &frame.m_LightCountsVulkanBuffer,
+                        sizeof(glm::uvec4)));
 
-        m_DeferredOutputMaterialInstance->Bind(m_SwapChain->GetCommandBuffer(imageIndex));
-        m_SwapChain->GetCommandBuffer(imageIndex)->BindVertexBuffer(m_FullscreenQuad.GetVertexBuffer());
-        m_SwapChain->GetCommandBuffer(imageIndex)->BindIndexBuffer(m_FullscreenQuad.GetIndexBuffer());
-        m_SwapChain->GetCommandBuffer(imageIndex)->RecordDraw(6);
-#endif
-        m_SwapChain->GetCommandBuffer(imageIndex)->EndRenderPass();
-        m_SwapChain->GetCommandBuffer(imageIndex)->EndRecording();
-    }
+                CHECK_VK_RESULT(frame.m_LightCountsVulkanBuffer.Map());
+            }
 
-    void VulkanRenderer::BuildDefferedCommandBuffer()
-    {
-        if (m_DeferredCommandBuffer == VK_NULL_HANDLE)
-        {
-            m_DeferredCommandBuffer = CommandBuffer::CreateCommandBuffer();
-            m_DeferredCommandBuffer->SetFrameBuffer(m_DeferredFrameBuffer);
-        }
+            // the light storage buffers start with some headroom, ReserveStorageBuffer grows them when a frame needs more.
+            // only the lights that changed are written, so they don't need coherent memory, each range is flushed instead.
+            if (!frame.m_PointLightsVulkanBuffer.IsInitialised())
+            {
+                CHECK_VK_RESULT(m_Device->CreateBuffer(
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                        &frame.m_PointLightsVulkanBuffer,
+                        sizeof(PointLightBufferInfo) * s_InitialPointLightCapacity));
 
-        if (m_DeferredSemaphore == VK_NULL_HANDLE)
-        {
-            VkSemaphoreCreateInfo semaphoreCreateInfo{};
-            semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-            CHECK_VK_RESULT(vkCreateSemaphore(m_Device->GetVulkanDevice(), &semaphoreCreateInfo, nullptr, &m_DeferredSemaphore));
+                CHECK_VK_RESULT(frame.m_PointLightsVulkanBuffer.Map());
+            }
 
-        }
+            if (!frame.m_DirLightsVulkanBuffer.IsInitialised())
+            {
+                CHECK_VK_RESULT(m_Device->CreateBuffer(
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                        &frame.m_DirLightsVulkanBuffer,
+                        sizeof(DirectionalLightBufferInfo) * s_InitialDirLightCapacity));
 
-        m_DeferredCommandBuffer->BeginRecording();
-        m_DeferredCommandBuffer->BeginRenderPass();
-        m_DeferredCommandBuffer->SetViewport((float)m_DeferredFrameBuffer->GetWidth(), (float)m_DeferredFrameBuffer->GetHeight(), 0.f, 1.f);
-        m_DeferredCommandBuffer->SetScissor(m_DeferredFrameBuffer->GetWidth(), m_DeferredFrameBuffer->GetHeight(), 0, 0);
+                CHECK_VK_RESULT(frame.m_DirLightsVulkanBuffer.Map());
+            }
 
-        for (GameObject* obj : BaseApplication::Get().GetScene()->GetObjects())
-        {
-            if (components::ModelComponent* comp = obj->GetComponent<components::ModelComponent>())
+            if (!frame.m_ShadowTilesVulkanBuffer.IsInitialised())
             {
-				for (Mesh* model : comp->GetModels())
-				{
-                    model->Render(m_DeferredCommandBuffer);
-				}
+                CHECK_VK_RESULT(m_Device->CreateBuffer(
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                        &frame.m_ShadowTilesVulkanBuffer,
+                        sizeof(ShadowTileInfo) * s_InitialShadowTileCapacity));
+
+                CHECK_VK_RESULT(frame.m_ShadowTilesVulkanBuffer.Map());
             }
-        }
 
-        m_DeferredCommandBuffer->EndRenderPass();
-        m_DeferredCommandBuffer->EndRecording();
+            if (!frame.m_ClusterInfoVulkanBuffer.IsInitialised())
+            {
+                CHECK_VK_RESULT(m_Device->CreateBuffer(
+                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        &frame.m_ClusterInfoVulkanBuffer,
+                        sizeof(LightClusterInfo)));
+
+                CHECK_VK_RESULT(frame.m_ClusterInfoVulkanBuffer.Map());
+
+                CHECK_VK_RESULT(m_Device->CreateBuffer(
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        &frame.m_LightClustersVulkanBuffer,
+                        sizeof(LightCluster) * LightClusterGrid::s_ClusterCount));
+
+                CHECK_VK_RESULT(frame.m_LightClustersVulkanBuffer.Map());
+
+                // room for a few lights per cluster to start with.
+                CHECK_VK_RESULT(m_Device->CreateBuffer(
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        &frame.m_LightIndicesVulkanBuffer,
+                        sizeof(uint32_t) * LightClusterGrid::s_ClusterCount * 4));
+
+                CHECK_VK_RESULT(frame.m_LightIndicesVulkanBuffer.Map());
+            }
+        }
     }
 
-#if ENABLE_IMGUI
-    void VulkanRenderer::BuildDeferredOutputCommandBuffer()
+    bool VulkanRenderer::ReserveStorageBuffer(vk::Buffer& buffer, VkDeviceSize size, const char* uniformName)
     {
-        if (m_DeferredOutputCommandBuffer == VK_NULL_HANDLE)
+        if (size <= buffer.m_Size)
         {
-            m_DeferredOutputCommandBuffer = CommandBuffer::CreateCommandBuffer();
-            m_DeferredOutputCommandBuffer->SetFrameBuffer(m_DeferredOutputFrameBuffer);
+            return false;
         }
 
-        if (m_DeferredOutputSemaphore == VK_NULL_HANDLE)
+        // this frame's fence has already been waited on so the gpu is done with the old buffer. doubling keeps a
+        // steadily growing scene down to a handful of reallocations.
+        VkDeviceSize newSize = std::max(size, buffer.m_Size * 2);
+        VkBufferUsageFlags usageFlags = buffer.m_UsageFlags;
+        VkMemoryPropertyFlags memoryPropertyFlags = buffer.m_MemoryPropertyFlags;
+        buffer.Cleanup();
+        CHECK_VK_RESULT(m_Device->CreateBuffer(
+                usageFlags,
+                memoryPropertyFlags,
+                &buffer,
+                newSize));
+
+        CHECK_VK_RESULT(buffer.Map());
+
+        // only this frame's descriptor set points at the buffer, the others keep their own.
+        if (m_DeferredOutputMaterialInstance && uniformName)
         {
-            VkSemaphoreCreateInfo semaphoreCreateInfo{};
-            semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-            CHECK_VK_RESULT(vkCreateSemaphore(m_Device->GetVulkanDevice(), &semaphoreCreateInfo, nullptr, &m_DeferredOutputSemaphore));
+            m_DeferredOutputMaterialInstance->SetBufferUniform(uniformName, &buffer, m_CurrentFrame);
         }
 
-        m_DeferredOutputCommandBuffer->BeginRecording();
-        m_DeferredOutputCommandBuffer->BeginRenderPass();
-        m_DeferredOutputCommandBuffer->SetViewport((float)m_DeferredOutputFrameBuffer->GetWidth(), (float)m_DeferredOutputFrameBuffer->GetHeight(), 0.f, 1.f);
-        m_DeferredOutputCommandBuffer->SetScissor(m_DeferredOutputFrameBuffer->GetWidth(), m_DeferredOutputFrameBuffer->GetHeight(), 0, 0);
-
-        m_DeferredOutputMaterialInstance->Bind(m_DeferredOutputCommandBuffer);
-        m_DeferredOutputCommandBuffer->BindVertexBuffer(m_FullscreenQuad.GetVertexBuffer());
-        m_DeferredOutputCommandBuffer->BindIndexBuffer(m_FullscreenQuad.GetIndexBuffer());
-        m_DeferredOutputCommandBuffer->RecordDraw(6);
-        m_DeferredOutputCommandBuffer->EndRenderPass();
-        m_DeferredOutputCommandBuffer->EndRecording();
+        return true;
     }
-#endif
 
-    void VulkanRenderer::GetNumLights(int& numPointLights, int& numDirLights)
+    void VulkanRenderer::RecordGBuffer(const CommandBufferRef& commandBuffer)
     {
-        numPointLights = 0;
-        numDirLights = 0;
+        Camera* camera = BaseApplication::Get().GetScene()->GetCamera();
+        Frustum frustum(camera->GetProjectionMatrix() * camera->GetViewMatrix());
+
+        BVH& bvh = BaseApplication::Get().GetScene()->GetBVH();
+        m_VisibleItems.clear();
+        bvh.QueryFrustum(frustum, BVHItemType_Mesh, m_VisibleItems);
+
+        m_GBufferCullingStats.m_Visible = static_cast<uint32_t>(m_VisibleItems.size());
+        m_GBufferCullingStats.m_Culled = bvh.GetItemCount(BVHItemType_Mesh) - m_GBufferCullingStats.m_Visible;
 
-        for (GameObject* obj : BaseApplication::Get().GetScene()->GetObjects())
+        // sorted so draws sharing a pipeline, material and mesh are recorded back to back.
+        glm::mat4 view = camera->GetViewMatrix();
+        m_GBufferQueue.Clear();
+        for (void* item : m_VisibleItems)
         {
-            if (components::LightComponent* lightComp = obj->GetComponent<components::LightComponent>())
+            Mesh* mesh = static_cast<Mesh*>(item);
+            float viewDepth = -(view * glm::vec4(mesh->GetWorldSphere().m_Center, 1.f)).z;
+            m_GBufferQueue.Add(0, mesh, viewDepth);
+        }
+        m_GBufferQueue.Sort();
+        m_GBufferQueue.BuildBatches();
+
+        FrameResources& frame = m_Frames[m_CurrentFrame];
+        const std::vector<glm::mat4>& instanceData = m_GBufferQueue.GetInstanceData();
+        if (!instanceData.empty())
+        {
+            ReserveStorageBuffer(frame.m_InstanceVulkanBuffer, sizeof(glm::mat4) * instanceData.size(), nullptr);
+            memcpy(frame.m_InstanceVulkanBuffer.m_Mapped, instanceData.data(), sizeof(glm::mat4) * instanceData.size());
+        }
+
+        // the draws are split into ranges and each range is recorded into its own secondary on a job thread.
+        const std::vector<DrawBatch>& batches = m_GBufferQueue.GetBatches();
+        uint32_t batchCount = static_cast<uint32_t>(batches.size());
+        m_GBufferSecondaries.clear();
+        m_GBufferSecondaries.resize((batchCount + s_DrawsPerRecordingJob - 1) / s_DrawsPerRecordingJob);
+        JobSystem::Get()->ParallelFor(batchCount, s_DrawsPerRecordingJob, [this, &batches, &frame](uint32_t start, uint32_t end)
+        {
+            CommandBufferRef secondary = m_ThreadCommandPools->AcquireSecondary(m_CurrentFrame);
+            secondary->BeginSecondaryRecording(m_DeferredFrameBuffer);
+            // dynamic state isn't inherited from the primary.
+            secondary->SetViewport((float)m_DeferredFrameBuffer->GetWidth(), (float)m_DeferredFrameBuffer->GetHeight(), 0.f, 1.f);
+            secondary->SetScissor(m_DeferredFrameBuffer->GetWidth(), m_DeferredFrameBuffer->GetHeight(), 0, 0);
+            for (uint32_t i = start; i < end; ++i)
             {
-                for (Light* light : lightComp->GetLights())
+                const DrawBatch& batch = batches[i];
+                if (batch.m_InstanceCount > 0)
                 {
-                    if (light->GetType() == LightType::Point)
-                    {
-                        numPointLights++;
-                    }
-                    else if (light->GetType() == LightType::Directional)
-                    {
-                        numDirLights++;
-                    }
+                    batch.m_Mesh->RenderInstanced(secondary, frame.m_InstanceVulkanBuffer, batch.m_FirstInstance, batch.m_InstanceCount);
+                }
+                else
+                {
+                    batch.m_Mesh->Render(secondary);
                 }
             }
+            secondary->EndRecording();
+
+            m_GBufferSecondaries[start / s_DrawsPerRecordingJob] = secondary;
+        });
+
+        m_GBufferBindStats = BindStats();
+        for (const CommandBufferRef& secondary : m_GBufferSecondaries)
+        {
+            m_GBufferBindStats += secondary->GetBindStats();
         }
+
+        commandBuffer->ExecuteCommands(m_GBufferSecondaries);
+    }
+
+    void VulkanRenderer::RecordLighting(const CommandBufferRef& commandBuffer)
+    {
+        // the tiles' view projections are written while the shadows record, which the graph has done by now.
+        UpdateShadowTilesBuffer();
+
+        const FrameBufferRef& frameBuffer = commandBuffer->GetFrameBuffer();
+        commandBuffer->SetViewport((float)frameBuffer->GetWidth(), (float)frameBuffer->GetHeight(), 0.f, 1.f);
+        commandBuffer->SetScissor(frameBuffer->GetWidth(), frameBuffer->GetHeight(), 0, 0);
+
+        m_DeferredOutputMaterialInstance->Bind(commandBuffer);
+        commandBuffer->BindVertexBuffer(m_FullscreenQuad.GetVertexBuffer());
+        commandBuffer->BindIndexBuffer(m_FullscreenQuad.GetIndexBuffer());
+        commandBuffer->RecordDraw(6);
     }
 
     void VulkanRenderer::UpdateLightsUniformBuffer()
     {
-        //TODO surely there is a way of only copying the lights that have changed.
-		int pointLightIndex = 0;
-        int dirLightIndex = 0;
-        for (GameObject* obj : BaseApplication::Get().GetScene()->GetObjects())
-        {
-            if (components::LightComponent* lightComp = obj->GetComponent<components::LightComponent>())
-            {
-                for (Light* light : lightComp->GetLights())
-                {
-                    if (light->GetType() == LightType::Point)
-                    {
-                        PointLight* pointLight = static_cast<PointLight*>(light);
-                        if (components::TranslationComponent* translationComp = obj->GetComponent<components::TranslationComponent>())
-                        {
-                            m_PointLights[pointLightIndex].m_Position = glm::vec4(translationComp->GetTranslation(), 0.f);
-                            m_PointLights[pointLightIndex].m_Colour = glm::vec4(pointLight->GetColour(), 1.0f);
-                            m_PointLights[pointLightIndex].m_Radius = pointLight->GetRadius();
-                            pointLightIndex++;
-                        }
-                    }
-                    else if (light->GetType() == LightType::Directional)
-                    {
-                        DirectionalLight* directionalLight = static_cast<DirectionalLight*>(light);
-                        m_DirectionalLights[dirLightIndex].m_Direction = glm::vec4(directionalLight->GetDirection(), 1);
-                        m_DirectionalLights[dirLightIndex].m_Colour = glm::vec4(directionalLight->GetColour(), 1);
-                        m_DirectionalLights[dirLightIndex].m_Mvp = directionalLight->GetMVP();
-                        dirLightIndex++;
-                    }
-                }
-            }
-        }
+        LightManager* lightManager = LightManager::Get();
+        lightManager->Update();
 
         // Current view position
         m_ViewPos = glm::vec4(BaseApplication::Get().GetScene()->GetCamera()->GetPosition(), 0.0f) * glm::vec4(-1.0f, 1.0f, -1.0f, 1.0f);
 
-        memcpy(m_ViewPosVulkanBuffer.m_Mapped, &m_ViewPos, sizeof(m_ViewPos));
-        if (m_DirectionalLights.size() > 0)
+        FrameResources& frame = m_Frames[m_CurrentFrame];
+        memcpy(frame.m_ViewPosVulkanBuffer.m_Mapped, &m_ViewPos, sizeof(m_ViewPos));
+
+        LightArray<PointLightBufferInfo>& pointLights = lightManager->GetPointLights();
+        LightArray<DirectionalLightBufferInfo>& dirLights = lightManager->GetDirectionalLights();
+        glm::uvec4 lightCounts(pointLights.GetCount(), dirLights.GetCount(), 0, 0);
+        memcpy(frame.m_LightCountsVulkanBuffer.m_Mapped, &lightCounts, sizeof(lightCounts));
+
+        // a reallocated buffer starts out empty, so every light has to go back in.
+        if (ReserveStorageBuffer(frame.m_PointLightsVulkanBuffer, sizeof(PointLightBufferInfo) * pointLights.GetCount(), "PointLights"))
         {
-            memcpy(m_DirLightsVulkanBuffer.m_Mapped, m_DirectionalLights.data(), sizeof(DirectionalLightBufferInfo) * m_DirectionalLights.size());
+            pointLights.MarkAllDirty(m_CurrentFrame);
         }
-        if(m_PointLights.size() > 0)
+        if (ReserveStorageBuffer(frame.m_DirLightsVulkanBuffer, sizeof(DirectionalLightBufferInfo) * dirLights.GetCount(), "DirectionalLights"))
         {
-            memcpy(m_PointLightsVulkanBuffer.m_Mapped, m_PointLights.data(), sizeof(PointLightBufferInfo) * m_PointLights.size());
+            dirLights.MarkAllDirty(m_CurrentFrame);
         }
+
+        pointLights.Upload(m_CurrentFrame, frame.m_PointLightsVulkanBuffer, lightManager->GetStats());
+        dirLights.Upload(m_CurrentFrame, frame.m_DirLightsVulkanBuffer, lightManager->GetStats());
+
+        UpdateLightClusters();
+    }
+
+    void VulkanRenderer::UpdateLightClusters()
+    {
+        // still built with no point lights so the shader sees empty clusters rather than last frame's.
+        Camera* camera = BaseApplication::Get().GetScene()->GetCamera();
+        m_LightClusterGrid.Build(camera->GetViewMatrix(), camera->GetProjectionMatrix(), LightManager::Get()->GetPointLightSpheres());
+
+        FrameResources& frame = m_Frames[m_CurrentFrame];
+        memcpy(frame.m_ClusterInfoVulkanBuffer.m_Mapped, &m_LightClusterGrid.GetInfo(), sizeof(LightClusterInfo));
+        memcpy(frame.m_LightClustersVulkanBuffer.m_Mapped, m_LightClusterGrid.GetClusters().data(), sizeof(LightCluster) * LightClusterGrid::s_ClusterCount);
+
+        const std::vector<uint32_t>& lightIndices = m_LightClusterGrid.GetLightIndices();
+        VkDeviceSize indicesSize = sizeof(uint32_t) * lightIndices.size();
+        ReserveStorageBuffer(frame.m_LightIndicesVulkanBuffer, indicesSize, "LightIndices");
+
+        if (!lightIndices.empty())
+        {
+            memcpy(frame.m_LightIndicesVulkanBuffer.m_Mapped, lightIndices.data(), indicesSize);
+        }
+    }
+
+    void VulkanRenderer::UpdateShadowTilesBuffer()
+    {
+        // the tiles' view projections are only known once the shadows have been recorded, so this runs after them.
+        // the buffer was already sized in DrawFrame, its descriptor can't change once recording has started.
+        FrameResources& frame = m_Frames[m_CurrentFrame];
+        ShadowAtlas* atlas = ShadowManager::Get()->GetAtlas();
+        atlas->Upload(m_CurrentFrame, frame.m_ShadowTilesVulkanBuffer);
     }
 
 #if ENABLE_IMGUI
@@ -659,14 +865,25 @@ namespace plumbus::vk
 		glslText = shaders::ShaderCompiler::ApplyShaderSettings(glslText, settings);
 
     	std::vector<unsigned int> SpirV;
-    	Log::Info("Compiling Shader: %s", fileName.c_str());
-		if(!shaders::ShaderCompiler::CompileShader(glslText, stage, SpirV))
-		{
-			Log::Error("Failed to compile shader %s", fileName.c_str());
-		}
+    	ShaderReflectionObject stageReflection;
+    	uint64_t cacheKey = shaders::ShaderCache::ComputeKey(glslText, stage);
+    	if (shaders::ShaderCache::Load(cacheKey, SpirV, stageReflection))
+    	{
+    		Log::Info("Loaded cached shader: %s", fileName.c_str());
+    	}
     	else
     	{
-    		Log::Info("Compile success: %s", fileName.c_str());
+    		Log::Info("Compiling Shader: %s", fileName.c_str());
+    		if(!shaders::ShaderCompiler::CompileShader(glslText, stage, SpirV))
+    		{
+    			Log::Error("Failed to compile shader %s", fileName.c_str());
+    		}
+    		else
+    		{
+    			Log::Info("Compile success: %s", fileName.c_str());
+    			ReflectShader(SpirV, stage, stageReflection);
+    			shaders::ShaderCache::Store(cacheKey, SpirV, stageReflection);
+    		}
     	}
 
         VkPipelineShaderStageCreateInfo shaderStage = {};
@@ -677,7 +894,23 @@ namespace plumbus::vk
         PL_ASSERT(shaderStage.module != VK_NULL_HANDLE);
         m_ShaderModules.push_back(shaderStage.module);
 
-        spirv_cross::Compiler spirv(reinterpret_cast<uint32_t*>(SpirV.data()), SpirV.size());
+    	//vert and frag reflection accumulate into the same object for the material.
+    	shaderReflection.m_VertexStageInputs.insert(shaderReflection.m_VertexStageInputs.end(), stageReflection.m_VertexStageInputs.begin(), stageReflection.m_VertexStageInputs.end());
+    	shaderReflection.m_FragmentStageInputs.insert(shaderReflection.m_FragmentStageInputs.end(), stageReflection.m_FragmentStageInputs.begin(), stageReflection.m_FragmentStageInputs.end());
+    	shaderReflection.m_VertexStageOutputCount += stageReflection.m_VertexStageOutputCount;
+    	shaderReflection.m_FragmentStageOutputCount += stageReflection.m_FragmentStageOutputCount;
+    	shaderReflection.m_Bindings.insert(shaderReflection.m_Bindings.end(), stageReflection.m_Bindings.begin(), stageReflection.m_Bindings.end());
+    	shaderReflection.m_PushConstants.insert(shaderReflection.m_PushConstants.end(), stageReflection.m_PushConstants.begin(), stageReflection.m_PushConstants.end());
+
+    	std::sort(shaderReflection.m_VertexStageInputs.begin(), shaderReflection.m_VertexStageInputs.end(), [](const StageInput& lhs, const StageInput& rhs){ return lhs.m_Location < rhs.m_Location;});
+    	std::sort(shaderReflection.m_FragmentStageInputs.begin(), shaderReflection.m_FragmentStageInputs.end(), [](const StageInput& lhs, const StageInput& rhs){ return lhs.m_Location < rhs.m_Location;});
+
+        return shaderStage;
+    }
+
+    void VulkanRenderer::ReflectShader(const std::vector<unsigned int>& spirV, VkShaderStageFlagBits stage, ShaderReflectionObject& outReflection)
+    {
+        spirv_cross::Compiler spirv(reinterpret_cast<const uint32_t*>(spirV.data()), spirV.size());
         spirv_cross::ShaderResources resources = spirv.get_shader_resources();
 
 		for (auto& resource : resources.push_constant_buffers)
@@ -693,7 +926,7 @@ namespace plumbus::vk
 			pushConstant.m_Offset = spirv.get_decoration(resource.id, spv::DecorationOffset);
 			pushConstant.m_Usage = stage == VK_SHADER_STAGE_VERTEX_BIT ? PushConstantUsage::VertexShader : PushConstantUsage::FragmentShader;
 			pushConstant.m_Size = size;
-			shaderReflection.m_PushConstants.push_back(pushConstant);
+			outReflection.m_PushConstants.push_back(pushConstant);
 		}
     	
         for (auto& resource : resources.sampled_images)
@@ -709,7 +942,7 @@ namespace plumbus::vk
             {
                 binding.m_Count = 1;
             }
-            shaderReflection.m_Bindings.push_back(binding);
+            outReflection.m_Bindings.push_back(binding);
         }
 
         for (auto &resource : resources.uniform_buffers)
@@ -725,7 +958,19 @@ namespace plumbus::vk
             {
                 binding.m_Count = 1;
             }
-            shaderReflection.m_Bindings.push_back(binding);
+            outReflection.m_Bindings.push_back(binding);
+        }
+
+        for (auto &resource : resources.storage_buffers)
+        {
+            DescriptorBinding binding;
+
+            binding.m_Name = resource.name;
+            binding.m_Location = spirv.get_decoration(resource.id, spv::DecorationBinding);
+            binding.m_Type = DescriptorBindingType::StorageBuffer;
+            binding.m_Usage = stage == VK_SHADER_STAGE_VERTEX_BIT ? DescriptorBindingUsage::VertexShader : DescriptorBindingUsage::FragmentShader;
+            binding.m_Count = 1;
+            outReflection.m_Bindings.push_back(binding);
         }
 
     	auto getResourceTypeSize = [](spirv_cross::SPIRType type) 
@@ -739,6 +984,7 @@ namespace plumbus::vk
     	for (auto& resource : resources.stage_inputs)
     	{    		
     		StageInput stageInput;
+			stageInput.m_Name = resource.name;
 			stageInput.m_Location = spirv.get_decoration(resource.id, spv::DecorationLocation);
 			stageInput.m_Binding = spirv.get_decoration(resource.id, spv::DecorationBinding);
     		stageInput.m_Size = getResourceTypeSize(spirv.get_type(resource.type_id));
@@ -752,38 +998,38 @@ namespace plumbus::vk
 					stageInput.m_Format = VK_FORMAT_R32G32B32A32_UINT;
     				break;
 				case spirv_cross::SPIRType::Float:
-					stageInput.m_Format = VK_FORMAT_R32G32B32_SFLOAT;
+				{
+					// instance data needs the w of a vec4, a vec3 format would read it back as 1.
+					static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+					uint32_t vecSize = spirv.get_type(resource.type_id).vecsize;
+					stageInput.m_Format = floatFormats[std::clamp(vecSize, 1u, 4u) - 1];
 					break;
+				}
 				default: ;
 			}
 
     		if (stage == VK_SHADER_STAGE_VERTEX_BIT)
     		{
-    			shaderReflection.m_VertexStageInputs.push_back(stageInput);
+    			outReflection.m_VertexStageInputs.push_back(stageInput);
     		}
     		else
     		{
-    			shaderReflection.m_FragmentStageInputs.push_back(stageInput);
+    			outReflection.m_FragmentStageInputs.push_back(stageInput);
     		}
     	}
 
-    	std::sort(shaderReflection.m_VertexStageInputs.begin(), shaderReflection.m_VertexStageInputs.end(), [](const StageInput& lhs, const StageInput& rhs){ return lhs.m_Location < rhs.m_Location;});
-    	std::sort(shaderReflection.m_FragmentStageInputs.begin(), shaderReflection.m_FragmentStageInputs.end(), [](const StageInput& lhs, const StageInput& rhs){ return lhs.m_Location < rhs.m_Location;});
-
         //get outputs for material
         for (auto& resource : resources.stage_outputs)
         {
         	if (stage == VK_SHADER_STAGE_VERTEX_BIT)
         	{
-        		shaderReflection.m_VertexStageOutputCount++;
+        		outReflection.m_VertexStageOutputCount++;
         	}
         	else
         	{
-        		shaderReflection.m_FragmentStageOutputCount++;
+        		outReflection.m_FragmentStageOutputCount++;
         	}
         }
-
-        return shaderStage;
     }
 
     VkShaderModule VulkanRenderer::CreateShaderModule(const std::vector<unsigned int>& code)
@@ -841,75 +1087,37 @@ namespace plumbus::vk
 
 	void VulkanRenderer::UpdateOutputMaterial()
 	{
-        bool outputMaterialNeedsRebuild = !m_DeferredOutputMaterial.get();
-        int numDirShadows = ShadowManager::Get()->GetDirectionalShadows().size();
-        int numOmniDirShadows = ShadowManager::Get()->GetOmniDirectionalShadows().size();
-        int numPointLights, numDirLights;
-        GetNumLights(numPointLights, numDirLights);
-
-        if (numDirShadows != m_CachedDirShadowCount ||
-            numOmniDirShadows != m_CachedOmniDirShadowCount ||
-            numPointLights != m_PointLights.size() ||
-            numDirLights != m_DirectionalLights.size())
-        {
-            m_CachedDirShadowCount = numDirShadows;
-            m_CachedOmniDirShadowCount = numOmniDirShadows;
-            outputMaterialNeedsRebuild = true;
-        }
-
-        if (!outputMaterialNeedsRebuild)
+        // every shadow lives in the one atlas and light counts come from uniforms, so nothing the shader depends on
+        // changes after the first build.
+        if (m_DeferredOutputMaterial)
         {
             return;
         }
 
-        m_DeferredOutputMaterialInstance.reset();
-        m_DeferredOutputMaterial.reset();
-
 #if ENABLE_IMGUI
         m_DeferredOutputMaterial = std::make_shared<Material>("shaders/deferred.vert", "shaders/deferred.frag", m_DeferredOutputFrameBuffer->GetRenderPass());
 #else
         m_DeferredOutputMaterial = std::make_shared<Material>("shaders/deferred.vert", "shaders/deferred.frag", m_SwapChain->GetRenderPass());
 #endif
 
-        shaders::ShaderSettings& settings = m_DeferredOutputMaterial->GetShaderSettings();
-        settings.SetValue("NUM_DIR_SHADOWS", numDirShadows);
-        settings.SetValue("NUM_OMNIDIR_SHADOWS", numOmniDirShadows);
-        settings.SetValue("NUM_DIR_LIGHTS", numDirLights);
-        settings.SetValue("NUM_POINT_LIGHTS", numPointLights);
-
-        bool lightsChanged = false;
-        if (m_PointLights.size() != numPointLights)
-        {
-            m_PointLights.resize(numPointLights);
-            lightsChanged = true;
-        }
-        if (m_DirectionalLights.size() != numDirLights)
-        {
-            m_DirectionalLights.resize(numDirLights);
-            lightsChanged = true;
-        }
-
-        if (lightsChanged)
-        {
-            m_PointLightsVulkanBuffer.Cleanup();
-            m_DirLightsVulkanBuffer.Cleanup();
-            CreateLightsUniformBuffers();
-        }
-
         m_DeferredOutputMaterial->Setup();
 
         m_DeferredOutputMaterialInstance = MaterialInstance::CreateMaterialInstance(m_DeferredOutputMaterial);
         m_DeferredOutputMaterialInstance->SetTextureUniform("samplerposition", {{ m_DeferredFrameBuffer->GetSampler(), m_DeferredFrameBuffer->GetAttachment("position")->m_ImageView }}, false);
         m_DeferredOutputMaterialInstance->SetTextureUniform("samplerNormal", {{ m_DeferredFrameBuffer->GetSampler(), m_DeferredFrameBuffer->GetAttachment("normal")->m_ImageView }}, false);
         m_DeferredOutputMaterialInstance->SetTextureUniform("samplerAlbedo", {{ m_DeferredFrameBuffer->GetSampler(), m_DeferredFrameBuffer->GetAttachment("colour")->m_ImageView }}, false);
-        m_DeferredOutputMaterialInstance->SetBufferUniform("ViewPos", &m_ViewPosVulkanBuffer);
-        if (m_PointLights.size() > 0)
-        {
-            m_DeferredOutputMaterialInstance->SetBufferUniform("PointLights", &m_PointLightsVulkanBuffer);
-        }
-        if (m_DirectionalLights.size() > 0)
+        const Texture& atlasTexture = ShadowManager::Get()->GetAtlas()->GetTexture();
+        m_DeferredOutputMaterialInstance->SetTextureUniform("shadowAtlas", {{ atlasTexture.m_TextureSampler, atlasTexture.m_ImageView }}, true);
+        for (uint32_t i = 0; i < m_FramesInFlight; ++i)
         {
-            m_DeferredOutputMaterialInstance->SetBufferUniform("DirectionalLights", &m_DirLightsVulkanBuffer);
+            m_DeferredOutputMaterialInstance->SetBufferUniform("ViewPos", &m_Frames[i].m_ViewPosVulkanBuffer, i);
+            m_DeferredOutputMaterialInstance->SetBufferUniform("LightCounts", &m_Frames[i].m_LightCountsVulkanBuffer, i);
+            m_DeferredOutputMaterialInstance->SetBufferUniform("PointLights", &m_Frames[i].m_PointLightsVulkanBuffer, i);
+            m_DeferredOutputMaterialInstance->SetBufferUniform("DirectionalLights", &m_Frames[i].m_DirLightsVulkanBuffer, i);
+            m_DeferredOutputMaterialInstance->SetBufferUniform("ClusterInfo", &m_Frames[i].m_ClusterInfoVulkanBuffer, i);
+            m_DeferredOutputMaterialInstance->SetBufferUniform("LightClusters", &m_Frames[i].m_LightClustersVulkanBuffer, i);
+            m_DeferredOutputMaterialInstance->SetBufferUniform("LightIndices", &m_Frames[i].m_LightIndicesVulkanBuffer, i);
+            m_DeferredOutputMaterialInstance->SetBufferUniform("ShadowTiles", &m_Frames[i].m_ShadowTilesVulkanBuffer, i);
         }
 	}
 
@@ -918,6 +1126,7 @@ namespace plumbus::vk
         vkDeviceWaitIdle(m_Device->GetVulkanDevice());
 
         m_SwapChain->Recreate();
+        m_ImagesInFlight.assign(m_SwapChain->GetImageCount(), UINT32_MAX);
 
 #if ENABLE_IMGUI
 		ImGuiIO& io = ImGui::GetIO();
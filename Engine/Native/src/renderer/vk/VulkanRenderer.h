@@ -7,6 +7,10 @@
 #include "renderer/vk/Window.h"
 #include "renderer/vk/SwapChain.h"
 #include "DescriptorSetLayout.h"
+#include "LightClusterGrid.h"
+#include "RenderGraph.h"
+#include "RenderQueue.h"
+#include "CommandBuffer.h"
 
 namespace plumbus
 {
@@ -43,9 +47,15 @@ namespace plumbus
 			void Init(std::string appName);
 			void Cleanup();
 
+			void BeginFrame();
 			void DrawFrame();
 			void AwaitIdle();
 
+			//must be set before Init.
+			void SetFramesInFlight(uint32_t framesInFlight);
+			uint32_t GetFramesInFlight() const { return m_FramesInFlight; }
+			uint32_t GetCurrentFrameIndex() const { return m_CurrentFrame; }
+
 			bool WindowShouldClose();
 
 			VkPipelineShaderStageCreateInfo LoadShader(std::string fileName, VkShaderStageFlagBits stage,  shaders::ShaderSettings settings, ShaderReflectionObject& shaderReflection);
@@ -57,19 +67,23 @@ namespace plumbus
 			const DescriptorPoolRef& GetDescriptorPool() { return m_DescriptorPool; }
 			const PipelineCacheRef& GetPipelineCache() { return m_PipelineCache; }
 			VkFormat GetDepthFormat();
+			//depth only, so one image can be both rendered to and sampled through the same aspect.
+			VkFormat GetSampledDepthFormat();
 
 			FrameBufferRef GetDeferredFramebuffer() { return m_DeferredFrameBuffer; }
-			const CommandBufferRef& GetDeferredCommandBuffer() { return m_DeferredCommandBuffer; }
 #if ENABLE_IMGUI
 			FrameBufferRef GetDeferredOutputFramebuffer() { return m_DeferredOutputFrameBuffer; }
-			const CommandBufferRef& GetDeferredOutputCommandBuffer() { return m_DeferredOutputCommandBuffer; }
 
 			ImGUIImpl* GetImGui() { return m_ImGui; }
 #endif
 
-            //this could be expanded on greatly, but as a minor optimization, dont bind a material if it is already bound.
-            void SetBoundMaterial(const MaterialInstance* materialInstance) { m_BoundMaterialInstance = materialInstance; }
-            const MaterialInstance* GetBoundMaterialInstance() { return m_BoundMaterialInstance; }
+			const ThreadCommandPoolsRef& GetThreadCommandPools() { return m_ThreadCommandPools; }
+			const RenderGraphRef& GetRenderGraph() { return m_RenderGraph; }
+
+			const CullingStats& GetGBufferCullingStats() { return m_GBufferCullingStats; }
+			const RenderQueueStats& GetGBufferQueueStats() { return m_GBufferQueue.GetStats(); }
+			const BindStats& GetGBufferBindStats() { return m_GBufferBindStats; }
+			LightClusterGrid& GetLightClusterGrid() { return m_LightClusterGrid; }
 
 			std::vector<const char*> GetRequiredDeviceExtensions();
 			std::vector<const char*> GetRequiredInstanceExtensions();
@@ -81,19 +95,27 @@ namespace plumbus
 			void SetupDebugCallback();
 #endif
 			void GenerateFullscreenQuad();
-			void CreateLightsUniformBuffers();
-			void BuildPresentCommandBuffer(uint32_t imageIndex);
-			void BuildDefferedCommandBuffer();
+			void CreateFrameResources();
+			// blocks until the gpu has finished the last submission made with this frame's resources.
+			void WaitForFrame(uint32_t frameIndex);
+			void CreateRenderGraph();
+			void CreateLightBuffers();
+			// grows a per frame storage buffer to at least size and points this frame's deferred output descriptor at it,
+			// unless uniformName is null. returns true if the buffer was reallocated, its previous contents are lost.
+			bool ReserveStorageBuffer(vk::Buffer& buffer, VkDeviceSize size, const char* uniformName);
+			void RecordGBuffer(const CommandBufferRef& commandBuffer);
+			void RecordLighting(const CommandBufferRef& commandBuffer);
 #if ENABLE_IMGUI
 			void SetupImGui();
-			void BuildDeferredOutputCommandBuffer();
 #endif
 			void RecreateSwapChain();
 			void UpdateLightsUniformBuffer();
-            void GetNumLights(int& numPointLights, int& numDirLights);
+			void UpdateShadowTilesBuffer();
+			void UpdateLightClusters();
             void UpdateOutputMaterial();
 
 			VkShaderModule CreateShaderModule(const std::vector<unsigned int>& code);
+			void ReflectShader(const std::vector<unsigned int>& spirV, VkShaderStageFlagBits stage, ShaderReflectionObject& outReflection);
 
 			VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
@@ -107,50 +129,76 @@ namespace plumbus
 			
 			DescriptorPoolRef m_DescriptorPool;
 			PipelineCacheRef m_PipelineCache;
+			ThreadCommandPoolsRef m_ThreadCommandPools;
+
+			// the whole frame, shadows through to present. the g-buffer and output frame buffers belong to its passes.
+			RenderGraphRef m_RenderGraph;
+			RenderGraphResource m_ShadowAtlasResource;
+			RenderGraphResource m_SwapChainResource;
+			RenderGraphPass* m_ShadowPass = nullptr;
+			RenderGraphPass* m_PresentPass = nullptr;
 
 			MaterialRef m_DeferredOutputMaterial;
 			MaterialInstanceRef m_DeferredOutputMaterialInstance;
 
-			VkSemaphore m_DeferredSemaphore;
-			CommandBufferRef m_DeferredCommandBuffer;
 			FrameBufferRef m_DeferredFrameBuffer;
-			
+			CullingStats m_GBufferCullingStats;
+			// reused between frames so the bvh query doesn't allocate.
+			std::vector<void*> m_VisibleItems;
+			RenderQueue m_GBufferQueue;
+			BindStats m_GBufferBindStats;
+			// one per recording job, executed in order so the draw order matches a single threaded recording.
+			std::vector<CommandBufferRef> m_GBufferSecondaries;
+			static constexpr uint32_t s_DrawsPerRecordingJob = 256;
 #if !PL_DIST
-			VkSemaphore m_DeferredOutputSemaphore;
-			CommandBufferRef m_DeferredOutputCommandBuffer;
 			FrameBufferRef m_DeferredOutputFrameBuffer;
 #endif
 
+			// everything the cpu writes to while recording a frame, duplicated per frame in flight
+			// so we never touch memory the gpu is still reading from.
+			struct FrameResources
+			{
+				// only created when timeline semaphores aren't supported.
+				VkFence m_InFlightFence = VK_NULL_HANDLE;
+				// the frame timeline's value once this frame's last submission has finished.
+				uint64_t m_TimelineValue = 0;
+				// every pass of the frame is recorded into this and submitted once.
+				CommandBufferRef m_CommandBuffer;
+
+				vk::Buffer m_ViewPosVulkanBuffer;
+				vk::Buffer m_LightCountsVulkanBuffer;
+				// light and light index storage grows to fit the busiest frame so far.
+				vk::Buffer m_PointLightsVulkanBuffer;
+				vk::Buffer m_DirLightsVulkanBuffer;
+				vk::Buffer m_ClusterInfoVulkanBuffer;
+				vk::Buffer m_LightClustersVulkanBuffer;
+				vk::Buffer m_LightIndicesVulkanBuffer;
+				vk::Buffer m_ShadowTilesVulkanBuffer;
+				// model matrices for the g-buffer's instanced draws, read as a per instance vertex stream.
+				vk::Buffer m_InstanceVulkanBuffer;
+			};
+
+			uint32_t m_FramesInFlight = 2;
+			uint32_t m_CurrentFrame = 0;
+			std::vector<FrameResources> m_Frames;
+			//frame last rendered to each swap chain image, UINT32_MAX if none has been yet.
+			std::vector<uint32_t> m_ImagesInFlight;
+			//counts submitted frames, one semaphore paces every frame in flight instead of a fence each.
+			VkSemaphore m_FrameTimeline = VK_NULL_HANDLE;
+			uint64_t m_SubmittedFrames = 0;
+
 			std::vector<VkShaderModule> m_ShaderModules;
-			const MaterialInstance* m_BoundMaterialInstance = nullptr;
 
 			plumbus::ImGUIImpl* m_ImGui = nullptr;
 
 			//Lights
-			struct PointLightBufferInfo
-			{
-				glm::vec4 m_Position;
-				glm::vec4 m_Colour;
-				float m_Radius;
-				glm::vec3 dummyValue; //TODO why do i need this?
-			};
-
-			struct DirectionalLightBufferInfo
-			{
-				glm::vec4 m_Direction;
-				glm::vec4 m_Colour;
-				glm::mat4 m_Mvp;
-			};
+			static constexpr uint32_t s_InitialPointLightCapacity = 64;
+			static constexpr uint32_t s_InitialDirLightCapacity = 4;
+			static constexpr uint32_t s_InitialShadowTileCapacity = 64;
+			static constexpr uint32_t s_InitialInstanceCapacity = 256;
 
             glm::vec4 m_ViewPos;
-            std::vector<PointLightBufferInfo> m_PointLights;
-            std::vector<DirectionalLightBufferInfo> m_DirectionalLights;
-			vk::Buffer m_ViewPosVulkanBuffer;
-            vk::Buffer m_PointLightsVulkanBuffer;
-            vk::Buffer m_DirLightsVulkanBuffer;
-
-			int m_CachedDirShadowCount;
-            int m_CachedOmniDirShadowCount;
+            LightClusterGrid m_LightClusterGrid;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "plumbus.h"
+#include "ShaderCache.h"
+
+#include "Helpers.h"
+#include "renderer/vk/VulkanRenderer.h"
+#include "renderer/vk/Pipeline.h"
+#include "renderer/vk/PipelineLayout.h"
+#include "glslang/glslang/Public/ShaderLang.h"
+#include "glslang/SPIRV/GlslangToSpv.h"
+
+namespace plumbus::vk::shaders
+{
+	// bump whenever the compile options or the serialised layout below change.
+	constexpr uint32_t s_CacheVersion = 2;
+	constexpr uint32_t s_CacheMagic = 0x43534c50; // "PLSC"
+
+	std::unordered_map<uint64_t, std::vector<char>> ShaderCache::s_Entries;
+	uint32_t ShaderCache::s_Hits = 0;
+	uint32_t ShaderCache::s_Misses = 0;
+
+	static uint64_t HashFNV1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	class CacheWriter
+	{
+	public:
+		template <typename T>
+		void Write(const T& value)
+		{
+			const char* bytes = reinterpret_cast<const char*>(&value);
+			m_Data.insert(m_Data.end(), bytes, bytes + sizeof(T));
+		}
+
+		void Write(const std::string& value)
+		{
+			Write((uint32_t)value.size());
+			m_Data.insert(m_Data.end(), value.begin(), value.end());
+		}
+
+		void Write(const void* data, size_t size)
+		{
+			const char* bytes = static_cast<const char*>(data);
+			m_Data.insert(m_Data.end(), bytes, bytes + size);
+		}
+
+		std::vector<char> m_Data;
+	};
+
+	class CacheReader
+	{
+	public:
+		CacheReader(const std::vector<char>& data) : m_Data(data) {}
+
+		template <typename T>
+		bool Read(T& value)
+		{
+			return Read(&value, sizeof(T));
+		}
+
+		bool Read(std::string& value)
+		{
+			uint32_t size;
+			if (!Read(size) || m_Offset + size > m_Data.size())
+			{
+				return false;
+			}
+
+			value.assign(m_Data.data() + m_Offset, size);
+			m_Offset += size;
+			return true;
+		}
+
+		bool Read(void* data, size_t size)
+		{
+			if (m_Offset + size > m_Data.size())
+			{
+				return false;
+			}
+
+			memcpy(data, m_Data.data() + m_Offset, size);
+			m_Offset += size;
+			return true;
+		}
+
+	private:
+		const std::vector<char>& m_Data;
+		size_t m_Offset = 0;
+	};
+
+	uint64_t ShaderCache::ComputeKey(const std::string& glslShader, VkShaderStageFlagBits shaderStage)
+	{
+		uint32_t compilerVersion[] = { s_CacheVersion, (uint32_t)glslang::GetKhronosToolId(), (uint32_t)glslang::GetSpirvGeneratorVersion(), (uint32_t)shaderStage };
+
+		uint64_t hash = HashFNV1a(compilerVersion, sizeof(compilerVersion));
+		return HashFNV1a(glslShader.data(), glslShader.size(), hash);
+	}
+
+	std::string ShaderCache::GetCacheFileName(uint64_t key)
+	{
+		return Helpers::FormatStr("shaders/%016llx.spvc", (unsigned long long)key);
+	}
+
+	bool ShaderCache::Load(uint64_t key, std::vector<unsigned int>& outSpirv, ShaderReflectionObject& outReflection)
+	{
+		auto it = s_Entries.find(key);
+		if (it == s_Entries.end())
+		{
+			std::vector<char> data;
+			if (Helpers::ReadCacheFile(GetCacheFileName(key), data))
+			{
+				it = s_Entries.emplace(key, std::move(data)).first;
+			}
+		}
+
+		if (it != s_Entries.end())
+		{
+			if (Deserialise(key, it->second, outSpirv, outReflection))
+			{
+				s_Hits++;
+				return true;
+			}
+
+			Log::Warn("ShaderCache: discarding invalid entry %s", GetCacheFileName(key).c_str());
+			s_Entries.erase(it);
+			outSpirv.clear();
+			outReflection = ShaderReflectionObject();
+		}
+
+		s_Misses++;
+		return false;
+	}
+
+	void ShaderCache::Store(uint64_t key, const std::vector<unsigned int>& spirv, const ShaderReflectionObject& reflection)
+	{
+		std::vector<char> data = Serialise(key, spirv, reflection);
+		Helpers::WriteCacheFile(GetCacheFileName(key), data.data(), data.size());
+		s_Entries[key] = std::move(data);
+	}
+
+	void ShaderCache::LogStats()
+	{
+		Log::Info("ShaderCache: %u hit(s), %u miss(es)", s_Hits, s_Misses);
+	}
+
+	std::vector<char> ShaderCache::Serialise(uint64_t key, const std::vector<unsigned int>& spirv, const ShaderReflectionObject& reflection)
+	{
+		CacheWriter writer;
+		writer.Write(s_CacheMagic);
+		writer.Write(s_CacheVersion);
+		writer.Write(key);
+
+		writer.Write((uint32_t)spirv.size());
+		writer.Write(spirv.data(), spirv.size() * sizeof(unsigned int));
+
+		auto writeStageInputs = [&writer](const std::vector<StageInput>& inputs)
+		{
+			writer.Write((uint32_t)inputs.size());
+			for (const StageInput& input : inputs)
+			{
+				writer.Write(input.m_Name);
+				writer.Write(input.m_Location);
+				writer.Write(input.m_Binding);
+				writer.Write(input.m_Size);
+				writer.Write((uint32_t)input.m_Format);
+			}
+		};
+		writeStageInputs(reflection.m_VertexStageInputs);
+		writeStageInputs(reflection.m_FragmentStageInputs);
+
+		writer.Write((int32_t)reflection.m_VertexStageOutputCount);
+		writer.Write((int32_t)reflection.m_FragmentStageOutputCount);
+
+		writer.Write((uint32_t)reflection.m_Bindings.size());
+		for (const DescriptorBinding& binding : reflection.m_Bindings)
+		{
+			writer.Write((uint32_t)binding.m_Type);
+			writer.Write((uint32_t)binding.m_Usage);
+			writer.Write((int32_t)binding.m_Location);
+			writer.Write((int32_t)binding.m_Count);
+			writer.Write(binding.m_Name);
+		}
+
+		writer.Write((uint32_t)reflection.m_PushConstants.size());
+		for (const PushConstant& pushConstant : reflection.m_PushConstants)
+		{
+			writer.Write((uint32_t)pushConstant.m_Usage);
+			writer.Write(pushConstant.m_Offset);
+			writer.Write(pushConstant.m_Size);
+		}
+
+		uint64_t checksum = HashFNV1a(writer.m_Data.data(), writer.m_Data.size());
+		writer.Write(checksum);
+
+		return writer.m_Data;
+	}
+
+	bool ShaderCache::Deserialise(uint64_t key, const std::vector<char>& data, std::vector<unsigned int>& outSpirv, ShaderReflectionObject& outReflection)
+	{
+		if (data.size() < sizeof(uint64_t))
+		{
+			return false;
+		}
+
+		uint64_t checksum;
+		memcpy(&checksum, data.data() + data.size() - sizeof(uint64_t), sizeof(uint64_t));
+		if (checksum != HashFNV1a(data.data(), data.size() - sizeof(uint64_t)))
+		{
+			return false;
+		}
+
+		CacheReader reader(data);
+
+		uint32_t magic, version;
+		uint64_t storedKey;
+		if (!reader.Read(magic) || magic != s_CacheMagic ||
+			!reader.Read(version) || version != s_CacheVersion ||
+			!reader.Read(storedKey) || storedKey != key)
+		{
+			return false;
+		}
+
+		uint32_t spirvSize;
+		if (!reader.Read(spirvSize))
+		{
+			return false;
+		}
+		outSpirv.resize(spirvSize);
+		if (!reader.Read(outSpirv.data(), spirvSize * sizeof(unsigned int)))
+		{
+			return false;
+		}
+
+		auto readStageInputs = [&reader](std::vector<StageInput>& inputs)
+		{
+			uint32_t count;
+			if (!reader.Read(count))
+			{
+				return false;
+			}
+
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				StageInput input;
+				uint32_t format;
+				if (!reader.Read(input.m_Name) || !reader.Read(input.m_Location) || !reader.Read(input.m_Binding) || !reader.Read(input.m_Size) || !reader.Read(format))
+				{
+					return false;
+				}
+				input.m_Format = (VkFormat)format;
+				inputs.push_back(input);
+			}
+
+			return true;
+		};
+		if (!readStageInputs(outReflection.m_VertexStageInputs) || !readStageInputs(outReflection.m_FragmentStageInputs))
+		{
+			return false;
+		}
+
+		int32_t vertexOutputCount, fragmentOutputCount;
+		if (!reader.Read(vertexOutputCount) || !reader.Read(fragmentOutputCount))
+		{
+			return false;
+		}
+		outReflection.m_VertexStageOutputCount = vertexOutputCount;
+		outReflection.m_FragmentStageOutputCount = fragmentOutputCount;
+
+		uint32_t bindingCount;
+		if (!reader.Read(bindingCount))
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < bindingCount; ++i)
+		{
+			DescriptorBinding binding;
+			uint32_t type, usage;
+			int32_t location, count;
+			if (!reader.Read(type) || !reader.Read(usage) || !reader.Read(location) || !reader.Read(count) || !reader.Read(binding.m_Name))
+			{
+				return false;
+			}
+			binding.m_Type = (DescriptorBindingType)type;
+			binding.m_Usage = (DescriptorBindingUsage)usage;
+			binding.m_Location = location;
+			binding.m_Count = count;
+			outReflection.m_Bindings.push_back(binding);
+		}
+
+		uint32_t pushConstantCount;
+		if (!reader.Read(pushConstantCount))
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < pushConstantCount; ++i)
+		{
+			PushConstant pushConstant;
+			uint32_t usage;
+			if (!reader.Read(usage) || !reader.Read(pushConstant.m_Offset) || !reader.Read(pushConstant.m_Size))
+			{
+				return false;
+			}
+			pushConstant.m_Usage = (PushConstantUsage)usage;
+			outReflection.m_PushConstants.push_back(pushConstant);
+		}
+
+		return true;
+	}
+}
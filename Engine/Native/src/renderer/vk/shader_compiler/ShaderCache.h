@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <vulkan/vulkan_core.h>
+
+namespace plumbus::vk
+{
+	struct ShaderReflectionObject;
+}
+
+namespace plumbus::vk::shaders
+{
+	// content addressed cache of compiled SPIR-V + its reflection data.
+	// keyed on the final glsl (settings preamble included), the stage and the compiler version, so a hit
+	// means neither glslang nor SPIRV-Cross have to run. entries are kept in memory and mirrored to disk.
+	class ShaderCache
+	{
+	public:
+		static uint64_t ComputeKey(const std::string& glslShader, VkShaderStageFlagBits shaderStage);
+
+		static bool Load(uint64_t key, std::vector<unsigned int>& outSpirv, ShaderReflectionObject& outReflection);
+		static void Store(uint64_t key, const std::vector<unsigned int>& spirv, const ShaderReflectionObject& reflection);
+
+		static uint32_t GetHitCount() { return s_Hits; }
+		static uint32_t GetMissCount() { return s_Misses; }
+		static void LogStats();
+
+	private:
+		static std::string GetCacheFileName(uint64_t key);
+		static std::vector<char> Serialise(uint64_t key, const std::vector<unsigned int>& spirv, const ShaderReflectionObject& reflection);
+		static bool Deserialise(uint64_t key, const std::vector<char>& data, std::vector<unsigned int>& outSpirv, ShaderReflectionObject& outReflection);
+
+		static std::unordered_map<uint64_t, std::vector<char>> s_Entries;
+		static uint32_t s_Hits;
+		static uint32_t s_Misses;
+	};
+}
@@ -9,6 +9,9 @@ namespace plumbus::vk
     class Device;
     typedef std::shared_ptr<Device> DeviceRef;
 
+    class MemoryAllocator;
+    typedef std::shared_ptr<MemoryAllocator> MemoryAllocatorRef;
+
     class SwapChain;
     typedef std::shared_ptr<SwapChain> SwapChainRef;
 
@@ -30,12 +33,27 @@ namespace plumbus::vk
 	class PipelineCache;
 	typedef std::shared_ptr<PipelineCache> PipelineCacheRef;
 
+	class ThreadCommandPools;
+	typedef std::shared_ptr<ThreadCommandPools> ThreadCommandPoolsRef;
+
+	class RenderGraph;
+	typedef std::shared_ptr<RenderGraph> RenderGraphRef;
+
     class PipelineLayout;
     typedef std::shared_ptr<PipelineLayout> PipelineLayoutRef;
 
     class Pipeline;
     typedef std::shared_ptr<Pipeline> PipelineRef;
 
+    class SamplerCache;
+    typedef std::shared_ptr<SamplerCache> SamplerCacheRef;
+
+    class Texture;
+    typedef std::shared_ptr<Texture> TextureRef;
+
+    class MeshGeometry;
+    typedef std::shared_ptr<MeshGeometry> MeshGeometryRef;
+
     class Material;
     typedef std::shared_ptr<Material> MaterialRef;
 
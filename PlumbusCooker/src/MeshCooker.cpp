@@ -0,0 +1,419 @@
+#include "MeshCooker.h"
+
+#include "assimp/Importer.hpp"
+#include "assimp/scene.h"
+#include "assimp/postprocess.h"
+
+#include "renderer/vk/PMesh.h"
+
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define PL_COOKER_SSE 1
+#include <xmmintrin.h>
+#else
+#define PL_COOKER_SSE 0
+#endif
+
+namespace plumbus::cooker
+{
+	using vk::VertexLayoutComponent;
+
+	static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "the interleave kernels expect float precision assimp");
+	static_assert(std::size(vk::s_PMeshModelLayout) <= vk::PMeshHeader::s_MaxVertexComponents, "too many vertex components for a .pmesh");
+
+	namespace
+	{
+		// where one layout component sits in the interleaved vertex, worked out once per import.
+		struct LayoutEntry
+		{
+			VertexLayoutComponent m_Component;
+			uint32_t m_Offset; // floats
+			uint32_t m_Size; // floats
+		};
+
+		struct CompiledLayout
+		{
+			std::vector<LayoutEntry> m_Entries; // in offset order.
+			uint32_t m_Stride = 0; // floats
+		};
+
+		CompiledLayout CompileLayout()
+		{
+			CompiledLayout layout;
+			for (VertexLayoutComponent component : vk::s_PMeshModelLayout)
+			{
+				uint32_t size = vk::GetComponentSize(component);
+				layout.m_Entries.push_back({ component, layout.m_Stride, size });
+				layout.m_Stride += size;
+			}
+			return layout;
+		}
+
+		// a layout entry bound to the submesh it's filled from. every source has at least 4 readable floats per
+		// vertex, constants have a stride of 0 so every vertex reads the same ones.
+		struct ComponentStream
+		{
+			const float* m_Source;
+			uint32_t m_SourceStride; // floats
+			uint32_t m_Offset;
+			uint32_t m_Size;
+			float m_Scale[4]; // flips y on the way through.
+			bool m_Bounds; // the positions, tracked for the submesh bounds.
+		};
+
+		void InterleaveScalar(const std::vector<ComponentStream>& streams, uint32_t stride, uint32_t begin, uint32_t end, float* vertices, float* boundsMin, float* boundsMax)
+		{
+			for (uint32_t v = begin; v < end; ++v)
+			{
+				float* vertex = vertices + static_cast<size_t>(v) * stride;
+				for (const ComponentStream& stream : streams)
+				{
+					const float* source = stream.m_Source + static_cast<size_t>(v) * stream.m_SourceStride;
+					for (uint32_t i = 0; i < stream.m_Size; ++i)
+					{
+						vertex[stream.m_Offset + i] = source[i] * stream.m_Scale[i];
+					}
+
+					if (stream.m_Bounds)
+					{
+						for (uint32_t axis = 0; axis < 3; ++axis)
+						{
+							boundsMin[axis] = fmin(vertex[stream.m_Offset + axis], boundsMin[axis]);
+							boundsMax[axis] = fmax(vertex[stream.m_Offset + axis], boundsMax[axis]);
+						}
+					}
+				}
+			}
+		}
+
+#if PL_COOKER_SSE
+		// every component is moved with one unaligned 4 wide load and store. the spare lanes spill into whatever comes
+		// next in the vertex, or the start of the next vertex, which is always written afterwards. the last vertex has
+		// nothing after it to absorb the spill (and its sources nothing to over read), so it's left to the scalar path.
+		void InterleaveSSE(const std::vector<ComponentStream>& streams, uint32_t stride, uint32_t begin, uint32_t end, float* vertices, float* boundsMin, float* boundsMax)
+		{
+			__m128 scales[vk::PMeshHeader::s_MaxVertexComponents];
+			for (size_t i = 0; i < streams.size(); ++i)
+			{
+				scales[i] = _mm_loadu_ps(streams[i].m_Scale);
+			}
+
+			__m128 min = _mm_set1_ps(FLT_MAX);
+			__m128 max = _mm_set1_ps(-FLT_MAX);
+			for (uint32_t v = begin; v < end; ++v)
+			{
+				float* vertex = vertices + static_cast<size_t>(v) * stride;
+				for (size_t i = 0; i < streams.size(); ++i)
+				{
+					const ComponentStream& stream = streams[i];
+					__m128 value = _mm_mul_ps(_mm_loadu_ps(stream.m_Source + static_cast<size_t>(v) * stream.m_SourceStride), scales[i]);
+					_mm_storeu_ps(vertex + stream.m_Offset, value);
+
+					if (stream.m_Bounds)
+					{
+						min = _mm_min_ps(min, value);
+						max = _mm_max_ps(max, value);
+					}
+				}
+			}
+
+			float laneMin[4];
+			float laneMax[4];
+			_mm_storeu_ps(laneMin, min);
+			_mm_storeu_ps(laneMax, max);
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				boundsMin[axis] = fmin(laneMin[axis], boundsMin[axis]);
+				boundsMax[axis] = fmax(laneMax[axis], boundsMax[axis]);
+			}
+		}
+#endif
+	}
+
+	bool MeshCooker::Import(const std::string& fileName)
+	{
+		auto importStart = std::chrono::high_resolution_clock::now();
+
+		m_Submeshes.clear();
+
+		const int flags = aiProcess_FlipWindingOrder | aiProcess_Triangulate | aiProcess_PreTransformVertices | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals;
+
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(fileName, flags);
+		if (!scene)
+		{
+			fprintf(stderr, "MeshCooker::Import: failed to import %s: %s\n", fileName.c_str(), importer.GetErrorString());
+			return false;
+		}
+
+		auto interleaveStart = std::chrono::high_resolution_clock::now();
+
+		const CompiledLayout layout = CompileLayout();
+
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+		{
+			const aiMesh* paiMesh = scene->mMeshes[i];
+			if (paiMesh->mNumVertices == 0 || paiMesh->mNumFaces == 0)
+			{
+				printf("Warning: skipping empty submesh: %u, in file: %s\n", i, fileName.c_str());
+				continue;
+			}
+
+			m_Submeshes.push_back(CookedSubmesh());
+			CookedSubmesh& submesh = m_Submeshes.back();
+
+			aiString diffusePath;
+			if (scene->mMaterials[paiMesh->mMaterialIndex]->Get(_AI_MATKEY_TEXTURE_BASE, aiTextureType_DIFFUSE, 0, diffusePath) == AI_SUCCESS)
+			{
+				submesh.m_DiffuseTexture = diffusePath.C_Str();
+			}
+			else
+			{
+				printf("Warning: no diffuse texture defined for submesh: %u, in file: %s\n", i, fileName.c_str());
+			}
+
+			aiString normalPath;
+			if (scene->mMaterials[paiMesh->mMaterialIndex]->Get(_AI_MATKEY_TEXTURE_BASE, aiTextureType_NORMALS, 0, normalPath) == AI_SUCCESS)
+			{
+				submesh.m_NormalTexture = normalPath.C_Str();
+			}
+			else
+			{
+				printf("Warning: no normal texture defined for submesh: %u, in file: %s\n", i, fileName.c_str());
+			}
+
+			aiColor3D pColor(0.f, 0.f, 0.f);
+			scene->mMaterials[paiMesh->mMaterialIndex]->Get(AI_MATKEY_COLOR_DIFFUSE, pColor);
+
+			// constant sources, padded out so the 4 wide loads stay in bounds.
+			const float colour[4] = { pColor.r, pColor.g, pColor.b, 0.0f };
+			const float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			const float one[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+
+			auto vectorStream = [](const aiVector3D* source) { return source ? reinterpret_cast<const float*>(source) : nullptr; };
+			const float* texCoords = paiMesh->HasTextureCoords(0) ? vectorStream(paiMesh->mTextureCoords[0]) : nullptr;
+			const float* normals = paiMesh->HasNormals() ? vectorStream(paiMesh->mNormals) : nullptr;
+			const float* tangents = paiMesh->HasTangentsAndBitangents() ? vectorStream(paiMesh->mTangents) : nullptr;
+			const float* bitangents = paiMesh->HasTangentsAndBitangents() ? vectorStream(paiMesh->mBitangents) : nullptr;
+
+			std::vector<ComponentStream> streams;
+			for (const LayoutEntry& entry : layout.m_Entries)
+			{
+				ComponentStream stream = { zero, 0, entry.m_Offset, entry.m_Size, { 1.0f, 1.0f, 1.0f, 1.0f }, false };
+				auto fromVectors = [&stream](const float* source)
+				{
+					if (source)
+					{
+						stream.m_Source = source;
+						stream.m_SourceStride = 3;
+					}
+				};
+
+				switch (entry.m_Component)
+				{
+					case VertexLayoutComponent::Position:
+						fromVectors(vectorStream(paiMesh->mVertices));
+						stream.m_Scale[1] = -1.0f;
+						stream.m_Bounds = true;
+						break;
+					case VertexLayoutComponent::Normal:
+						fromVectors(normals);
+						stream.m_Scale[1] = -1.0f;
+						break;
+					case VertexLayoutComponent::UV:
+						fromVectors(texCoords);
+						break;
+					case VertexLayoutComponent::Colour:
+						stream.m_Source = colour;
+						break;
+					case VertexLayoutComponent::Tangent:
+						fromVectors(tangents);
+						break;
+					case VertexLayoutComponent::Bitangent:
+						fromVectors(bitangents);
+						break;
+					case VertexLayoutComponent::DummyFloat:
+						stream.m_Source = one;
+						break;
+					case VertexLayoutComponent::DummyVec4:
+						break;
+				};
+				streams.push_back(stream);
+			}
+
+			const uint32_t vertexCount = paiMesh->mNumVertices;
+			submesh.m_VertexCount = vertexCount;
+			submesh.m_Vertices.resize(static_cast<size_t>(vertexCount) * layout.m_Stride);
+
+			// positions are baked with y flipped, the bounds are taken from the baked values so they match.
+			float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			uint32_t scalarBegin = 0;
+#if PL_COOKER_SSE
+			// a spill can run up to 3 floats past the component, narrower vertices would spill past the next one.
+			scalarBegin = layout.m_Stride >= 3 ? vertexCount - 1 : 0;
+			InterleaveSSE(streams, layout.m_Stride, 0, scalarBegin, submesh.m_Vertices.data(), boundsMin, boundsMax);
+#endif
+			InterleaveScalar(streams, layout.m_Stride, scalarBegin, vertexCount, submesh.m_Vertices.data(), boundsMin, boundsMax);
+
+			memcpy(submesh.m_BoundsMin, boundsMin, sizeof(boundsMin));
+			memcpy(submesh.m_BoundsMax, boundsMax, sizeof(boundsMax));
+
+			submesh.m_Indices.resize(static_cast<size_t>(paiMesh->mNumFaces) * 3);
+			uint32_t* indices = submesh.m_Indices.data();
+			for (unsigned int j = 0; j < paiMesh->mNumFaces; j++)
+			{
+				const aiFace& Face = paiMesh->mFaces[j];
+				if (Face.mNumIndices != 3)
+					continue;
+				indices[0] = Face.mIndices[0];
+				indices[1] = Face.mIndices[1];
+				indices[2] = Face.mIndices[2];
+				indices += 3;
+			}
+			submesh.m_Indices.resize(indices - submesh.m_Indices.data());
+
+			// points and lines are dropped by the triangulation, nothing left to draw.
+			if (submesh.m_Indices.empty())
+			{
+				printf("Warning: skipping submesh without triangles: %u, in file: %s\n", i, fileName.c_str());
+				m_Submeshes.pop_back();
+				continue;
+			}
+
+			m_Stats.m_Vertices += vertexCount;
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		m_Stats.m_InterleaveSeconds += std::chrono::duration<double>(end - interleaveStart).count();
+		m_Stats.m_ImportSeconds += std::chrono::duration<double>(end - importStart).count();
+
+		return true;
+	}
+
+	bool MeshCooker::Write(const std::string& fileName) const
+	{
+		auto align = [](uint64_t offset) { return (offset + vk::PMeshHeader::s_BlobAlignment - 1) & ~static_cast<uint64_t>(vk::PMeshHeader::s_BlobAlignment - 1); };
+
+		vk::PMeshHeader header = {};
+		header.m_Magic = vk::PMeshHeader::s_Magic;
+		header.m_Version = vk::PMeshHeader::s_Version;
+		header.m_SubmeshCount = static_cast<uint32_t>(m_Submeshes.size());
+		header.m_VertexComponentCount = static_cast<uint32_t>(std::size(vk::s_PMeshModelLayout));
+		for (uint32_t i = 0; i < header.m_VertexComponentCount; ++i)
+		{
+			header.m_VertexComponents[i] = static_cast<uint8_t>(vk::s_PMeshModelLayout[i]);
+			header.m_VertexStride += vk::GetComponentSize(vk::s_PMeshModelLayout[i]) * sizeof(float);
+		}
+
+		// texture names are shared by submeshes using the same material.
+		std::string stringTable;
+		std::unordered_map<std::string, uint32_t> stringOffsets;
+		auto addString = [&stringTable, &stringOffsets](const std::string& string)
+		{
+			if (string.empty())
+			{
+				return vk::PMeshSubmesh::s_NoString;
+			}
+
+			auto it = stringOffsets.find(string);
+			if (it != stringOffsets.end())
+			{
+				return it->second;
+			}
+
+			uint32_t offset = static_cast<uint32_t>(stringTable.size());
+			stringTable.append(string);
+			stringTable.push_back('\0');
+			stringOffsets[string] = offset;
+			return offset;
+		};
+
+		std::vector<vk::PMeshSubmesh> submeshTable(m_Submeshes.size());
+		for (size_t i = 0; i < m_Submeshes.size(); ++i)
+		{
+			submeshTable[i].m_DiffuseTexture = addString(m_Submeshes[i].m_DiffuseTexture);
+			submeshTable[i].m_NormalTexture = addString(m_Submeshes[i].m_NormalTexture);
+		}
+
+		header.m_StringTableOffset = static_cast<uint32_t>(sizeof(vk::PMeshHeader) + submeshTable.size() * sizeof(vk::PMeshSubmesh));
+		header.m_StringTableSize = static_cast<uint32_t>(stringTable.size());
+
+		uint64_t offset = header.m_StringTableOffset + header.m_StringTableSize;
+		for (size_t i = 0; i < m_Submeshes.size(); ++i)
+		{
+			const CookedSubmesh& submesh = m_Submeshes[i];
+			vk::PMeshSubmesh& entry = submeshTable[i];
+
+			entry.m_VertexCount = submesh.m_VertexCount;
+			entry.m_IndexCount = static_cast<uint32_t>(submesh.m_Indices.size());
+			memcpy(entry.m_BoundsMin, submesh.m_BoundsMin, sizeof(entry.m_BoundsMin));
+			memcpy(entry.m_BoundsMax, submesh.m_BoundsMax, sizeof(entry.m_BoundsMax));
+
+			entry.m_VertexOffset = align(offset);
+			offset = entry.m_VertexOffset + submesh.m_Vertices.size() * sizeof(float);
+			entry.m_IndexOffset = align(offset);
+			offset = entry.m_IndexOffset + submesh.m_Indices.size() * sizeof(uint32_t);
+		}
+		header.m_FileSize = offset;
+
+		std::vector<char> data(header.m_FileSize, 0);
+		memcpy(data.data(), &header, sizeof(header));
+		if (!submeshTable.empty())
+		{
+			memcpy(data.data() + sizeof(header), submeshTable.data(), submeshTable.size() * sizeof(vk::PMeshSubmesh));
+		}
+		memcpy(data.data() + header.m_StringTableOffset, stringTable.data(), stringTable.size());
+		for (size_t i = 0; i < m_Submeshes.size(); ++i)
+		{
+			const CookedSubmesh& submesh = m_Submeshes[i];
+			memcpy(data.data() + submeshTable[i].m_VertexOffset, submesh.m_Vertices.data(), submesh.m_Vertices.size() * sizeof(float));
+			memcpy(data.data() + submeshTable[i].m_IndexOffset, submesh.m_Indices.data(), submesh.m_Indices.size() * sizeof(uint32_t));
+		}
+
+		std::filesystem::path path = fileName;
+		if (path.has_parent_path())
+		{
+			std::error_code error;
+			std::filesystem::create_directories(path.parent_path(), error);
+		}
+
+		// write to a temp file and rename so a failed cook never leaves a truncated .pmesh behind for the runtime to find.
+		std::filesystem::path tempPath = path;
+		tempPath += ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				fprintf(stderr, "MeshCooker::Write: failed to open file %s!\n", tempPath.string().c_str());
+				return false;
+			}
+
+			file.write(data.data(), data.size());
+			if (!file.good())
+			{
+				fprintf(stderr, "MeshCooker::Write: failed to write file %s!\n", tempPath.string().c_str());
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, path, error);
+		if (error)
+		{
+			fprintf(stderr, "MeshCooker::Write: failed to write %s: %s\n", path.string().c_str(), error.message().c_str());
+			return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace plumbus::cooker
+{
+	// one submesh of the source model, ready to be written out as it will be uploaded.
+	struct CookedSubmesh
+	{
+		std::vector<float> m_Vertices; // interleaved in s_PMeshModelLayout order.
+		std::vector<uint32_t> m_Indices;
+		uint32_t m_VertexCount = 0;
+		float m_BoundsMin[3];
+		float m_BoundsMax[3];
+		// relative to the texture directory, empty when the material doesn't name one.
+		std::string m_DiffuseTexture;
+		std::string m_NormalTexture;
+	};
+
+	struct CookStats
+	{
+		uint64_t m_Vertices = 0;
+		double m_ImportSeconds = 0.0; // everything Import does, assimp included.
+		double m_InterleaveSeconds = 0.0; // just building the vertex and index blobs from the imported scene.
+	};
+
+	// turns an OBJ/DAE model into a .pmesh, doing all of the import work the runtime used to do at load time.
+	class MeshCooker
+	{
+	public:
+		bool Import(const std::string& fileName);
+		bool Write(const std::string& fileName) const;
+
+		const std::vector<CookedSubmesh>& GetSubmeshes() const { return m_Submeshes; }
+		// accumulated over every Import.
+		const CookStats& GetStats() const { return m_Stats; }
+
+	private:
+		std::vector<CookedSubmesh> m_Submeshes;
+		CookStats m_Stats;
+	};
+}
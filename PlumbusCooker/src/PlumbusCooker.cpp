@@ -0,0 +1,77 @@
+#include "MeshCooker.h"
+
+#include "renderer/vk/PMesh.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+// PlumbusCooker <model.obj|model.dae> [output.pmesh]
+// cooks a source model into the binary format Mesh::LoadModel maps at runtime. the output defaults to the input with
+// its extension swapped, which is where the runtime looks for it.
+//
+// PlumbusCooker --benchmark <iterations> <model.obj|model.dae>
+// imports the model repeatedly without writing anything and reports the throughput.
+int main(int argc, char** argv)
+{
+	int iterations = 0;
+	if (argc > 2 && strcmp(argv[1], "--benchmark") == 0)
+	{
+		iterations = atoi(argv[2]);
+		argv += 2;
+		argc -= 2;
+	}
+
+	if (argc < 2 || argc > 3 || iterations < 0 || (iterations > 0 && argc > 2))
+	{
+		fprintf(stderr, "usage: %s <model.obj|model.dae> [output%s]\n", argv[0], plumbus::vk::s_PMeshExtension);
+		fprintf(stderr, "       %s --benchmark <iterations> <model.obj|model.dae>\n", argv[0]);
+		return 1;
+	}
+
+	std::string input = argv[1];
+	plumbus::cooker::MeshCooker cooker;
+
+	if (iterations > 0)
+	{
+		for (int i = 0; i < iterations; ++i)
+		{
+			if (!cooker.Import(input))
+			{
+				return 1;
+			}
+		}
+
+		const plumbus::cooker::CookStats& stats = cooker.GetStats();
+		printf("%s: %d imports, %llu vertices\n", input.c_str(), iterations, static_cast<unsigned long long>(stats.m_Vertices));
+		printf("  import:     %8.2fms per import, %12.0f vertices/sec\n", stats.m_ImportSeconds * 1000.0 / iterations, stats.m_Vertices / stats.m_ImportSeconds);
+		printf("  interleave: %8.2fms per import, %12.0f vertices/sec\n", stats.m_InterleaveSeconds * 1000.0 / iterations, stats.m_Vertices / stats.m_InterleaveSeconds);
+		return 0;
+	}
+
+	std::string output = argc > 2 ? argv[2] : std::filesystem::path(input).replace_extension(plumbus::vk::s_PMeshExtension).string();
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (!cooker.Import(input) || !cooker.Write(output))
+	{
+		return 1;
+	}
+
+	float ms = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (const plumbus::cooker::CookedSubmesh& submesh : cooker.GetSubmeshes())
+	{
+		vertexCount += submesh.m_VertexCount;
+		indexCount += submesh.m_Indices.size();
+	}
+
+	printf("cooked %s -> %s: %zu submeshes, %zu vertices, %zu indices in %.2fms\n",
+		input.c_str(), output.c_str(), cooker.GetSubmeshes().size(), vertexCount, indexCount, ms);
+
+	return 0;
+}
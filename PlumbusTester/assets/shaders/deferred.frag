@@ -6,12 +6,8 @@
 layout (binding = 0) uniform sampler2D samplerposition;
 layout (binding = 1) uniform sampler2D samplerNormal;
 layout (binding = 2) uniform sampler2D samplerAlbedo;
-#if NUM_DIR_SHADOWS
-layout (binding = 3) uniform sampler2D samplerDirShadows[NUM_DIR_SHADOWS];
-#endif
-#if NUM_OMNIDIR_SHADOWS
-layout (binding = 4) uniform samplerCube samplerOmniDirShadows[NUM_OMNIDIR_SHADOWS];
-#endif
+// every shadow map is a tile in one depth texture, see ShadowAtlas.
+layout (binding = 3) uniform sampler2DShadow shadowAtlas;
 
 layout (location = 0) in vec2 inUV;
 
@@ -21,23 +17,38 @@ struct PointLight {
 	vec4 position;
 	vec4 color;
 	float radius;
+	int shadowTile; // first of six cube face tiles, -1 for no shadow.
 };
 
 struct DirectionalLight {
 	vec4 direction;
 	vec4 color;
-	mat4 mvp;
+	int shadowTile; // first cascade's tile, -1 for no shadow.
+	int shadowTileCount;
+};
+
+struct ShadowTile {
+	mat4 viewProj;
+	vec4 rect; // uv offset xy, uv scale zw. zero scale means the tile didn't fit in the atlas this frame.
 };
 
 layout (binding = 5) uniform ViewPos { vec4 value; } viewPos;
-#if NUM_POINT_LIGHTS
-layout (binding = 6) uniform PointLights { PointLight lights[NUM_POINT_LIGHTS]; } pointLights;
-#endif
-#if NUM_DIR_LIGHTS
-layout (binding = 7) uniform DirectionalLights { DirectionalLight lights[NUM_DIR_LIGHTS]; } dirLights;
-#endif
-
-#if NUM_DIR_SHADOWS && NUM_DIR_LIGHTS
+// lights live in storage buffers sized by the renderer, so adding or removing one never changes this shader.
+layout (binding = 11) uniform LightCounts { uvec4 value; } lightCounts; // x = point lights, y = directional lights
+layout (std430, binding = 6) readonly buffer PointLights { PointLight lights[]; } pointLights;
+layout (std430, binding = 7) readonly buffer DirectionalLights { DirectionalLight lights[]; } dirLights;
+
+// froxel grid built on the cpu each frame, see LightClusterGrid.
+layout (binding = 8) uniform ClusterInfo
+{
+	mat4 view;
+	uvec4 gridSize; // tiles x, tiles y, depth slices, w = heat map
+	vec4 depthParams; // slice = log(depth) * x + y
+} clusterInfo;
+layout (std430, binding = 9) readonly buffer LightClusters { uvec2 clusters[]; } lightClusters; // offset, count
+layout (std430, binding = 10) readonly buffer LightIndices { uint indices[]; } lightIndices;
+layout (std430, binding = 12) readonly buffer ShadowTiles { ShadowTile tiles[]; } shadowTiles;
+
 vec2 poissonDisk[4] = vec2[](
 vec2( -0.94201624, -0.39906216 ),
 vec2( 0.94558609, -0.76890725 ),
@@ -45,33 +56,102 @@ vec2( -0.094184101, -0.92938870 ),
 vec2( 0.34495938, 0.29387760 )
 );
 
-float shadowProj(vec4 P, vec2 offset, int index, float NdotL)
+// compares against the tile's depth at a uv inside it, clamped half a texel in so filtering never reads a neighbour.
+float sampleShadowTile(vec4 rect, vec2 uv, float depth)
 {
-	float shadow = 1.0;
-	vec4 shadowCoord = P / P.w;
-	shadowCoord.st = shadowCoord.st * 0.5 + 0.5;
-
-	float bias = 0.005 * tan(acos(NdotL));
-	bias = clamp(bias, 0, 0.01);
+	vec2 halfTexel = 0.5 / vec2(textureSize(shadowAtlas, 0));
+	vec2 atlasUV = clamp(rect.xy + uv * rect.zw, rect.xy + halfTexel, rect.xy + rect.zw - halfTexel);
+	return texture(shadowAtlas, vec3(atlasUV, depth));
+}
 
-	for (int i = 0; i < 4; i++)
+float dirShadow(vec3 fragpos, vec3 N, int firstTile, int tileCount, float NdotL)
+{
+	// cascades get coarser further from the camera, use the first one the point falls inside. the shadow manager can
+	// leave a cascade a frame or two behind the camera, so its own bounds are checked rather than split distances.
+	for (int tile = firstTile; tile < firstTile + tileCount; ++tile)
 	{
-		if (texture(samplerDirShadows[index],shadowCoord.st + poissonDisk[i] / 700.0 ).r  < shadowCoord.z - bias)
+		vec4 rect = shadowTiles.tiles[tile].rect;
+		if (rect.z == 0.0)
+		{
+			continue;
+		}
+
+		// push the point out along the normal by about a texel of this cascade, so surfaces don't shadow themselves.
+		mat4 viewProj = shadowTiles.tiles[tile].viewProj;
+		float tileSize = rect.z * float(textureSize(shadowAtlas, 0).x);
+		float texelWorldSize = 2.0 / (length(vec3(viewProj[0][0], viewProj[1][0], viewProj[2][0])) * tileSize);
+
+		vec4 shadowCoord = viewProj * vec4(fragpos + N * texelWorldSize * 1.5, 1.0);
+		shadowCoord /= shadowCoord.w;
+		shadowCoord.st = shadowCoord.st * 0.5 + 0.5;
+		if (any(lessThan(shadowCoord.stp, vec3(0.01, 0.01, 0.0))) || any(greaterThan(shadowCoord.stp, vec3(0.99, 0.99, 1.0))))
 		{
-			shadow -= 0.25;
+			continue;
 		}
+
+		float bias = 0.0005 * tan(acos(NdotL));
+		bias = clamp(bias, 0, 0.002);
+
+		float shadow = 0.0;
+		for (int i = 0; i < 4; i++)
+		{
+			shadow += 0.25 * sampleShadowTile(rect, shadowCoord.st + poissonDisk[i] / (tileSize * 1.5), shadowCoord.z - bias);
+		}
+
+		return shadow;
+	}
+
+	// past the last cascade.
+	return 1.0;
+}
+
+float omniShadow(vec3 fragPos, vec3 lightPos, int firstTile)
+{
+	// the cube face is picked by the major axis, in +x, -x, +y, -y, +z, -z order.
+	vec3 lightToFrag = fragPos - lightPos;
+	vec3 axisDist = abs(lightToFrag);
+	int face;
+	if (axisDist.x >= axisDist.y && axisDist.x >= axisDist.z)
+	{
+		face = lightToFrag.x > 0.0 ? 0 : 1;
+	}
+	else if (axisDist.y >= axisDist.z)
+	{
+		face = lightToFrag.y > 0.0 ? 2 : 3;
+	}
+	else
+	{
+		face = lightToFrag.z > 0.0 ? 4 : 5;
 	}
 
-	return shadow;
+	int tile = firstTile + face;
+	vec4 rect = shadowTiles.tiles[tile].rect;
+	if (rect.z == 0.0)
+	{
+		return 1.0;
+	}
+
+	// pulled towards the light a little so surfaces don't shadow themselves.
+	float dist = max(max(axisDist.x, axisDist.y), axisDist.z);
+	vec3 biasedPos = lightPos + lightToFrag * (max(dist - EPSILON, 0.0) / max(dist, 1e-5));
+	vec4 shadowCoord = shadowTiles.tiles[tile].viewProj * vec4(biasedPos, 1.0);
+	shadowCoord /= shadowCoord.w;
+	return sampleShadowTile(rect, shadowCoord.st * 0.5 + 0.5, shadowCoord.z);
 }
 
-float shadow(vec3 fragpos, int index, float NdotL)
+uint clusterIndex(vec3 fragPos)
 {
-	vec4 shadowClip	= dirLights.lights[index].mvp * vec4(fragpos, 1.0);
-	float shadowFactor = shadowProj(shadowClip, vec2(0.0), index, NdotL);
-	return shadowFactor;
+	float depth = -(clusterInfo.view * vec4(fragPos, 1.0)).z;
+	uint slice = min(uint(max(log(depth) * clusterInfo.depthParams.x + clusterInfo.depthParams.y, 0.0)), clusterInfo.gridSize.z - 1u);
+	uvec2 tile = min(uvec2(inUV * vec2(clusterInfo.gridSize.xy)), clusterInfo.gridSize.xy - 1u);
+	return tile.x + clusterInfo.gridSize.x * (tile.y + clusterInfo.gridSize.y * slice);
+}
+
+vec3 heatMap(uint count)
+{
+	float t = clamp(float(count) / 32.0, 0.0, 1.0);
+	return mix(mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), clamp(t * 2.0, 0.0, 1.0)), vec3(1.0, 0.0, 0.0), clamp(t * 2.0 - 1.0, 0.0, 1.0));
 }
-#endif
 
 void main()
 {
@@ -83,9 +163,10 @@ void main()
 	// Ambient part
 	vec3 fragcolor = vec3(0);
 
-#if NUM_POINT_LIGHTS
-	for (int i = 0; i < NUM_POINT_LIGHTS; ++i)
+	uvec2 cluster = lightClusters.clusters[clusterIndex(fragPos)];
+	for (uint c = 0u; c < cluster.y; ++c)
 	{
+		uint i = lightIndices.indices[cluster.x + c];
 		vec3 worldPos =  pointLights.lights[i].position.xyz;
 
 		// Vector to light
@@ -100,8 +181,10 @@ void main()
 		// Light to fragment
 		L = normalize(L);
 
-		// Attenuation
-		float atten = pointLights.lights[i].radius / (pow(dist, 2.0) + 1.0);
+		// Attenuation, windowed so it reaches zero at the radius the light was clustered with.
+		float radius = pointLights.lights[i].radius;
+		float window = clamp(1.0 - pow(dist / radius, 4.0), 0.0, 1.0);
+		float atten = radius / (pow(dist, 2.0) + 1.0) * window * window;
 
 		// Diffuse part
 		vec3 N = normalize(normal);
@@ -113,19 +196,13 @@ void main()
 		vec3 R = reflect(-L, N);
 		float NdotR = max(0.0, dot(R, V));
 		vec3 spec = pointLights.lights[i].color.xyz * albedo.a * pow(NdotR, 16.0) * atten;
-#if NUM_OMNIDIR_SHADOWS
 		// Shadow
-		vec3 shadowVector = vec3(fragPos.x, fragPos.y, fragPos.z) - worldPos.xyz;
-		float sampledDist = texture(samplerOmniDirShadows[i], shadowVector).r;
-		float shadow = (length(shadowVector) <= sampledDist + EPSILON) ? 1.0 : 0.0;
+		int shadowTile = pointLights.lights[i].shadowTile;
+		float shadow = shadowTile >= 0 ? omniShadow(fragPos, worldPos, shadowTile) : 1.0;
 		fragcolor += (diff + spec) * shadow;
-#else
-		fragcolor += diff + spec;
-#endif
 	}
-#endif
-#if NUM_DIR_LIGHTS
-	for (int i = 0; i < NUM_DIR_LIGHTS; ++i)
+
+	for (uint i = 0u; i < lightCounts.value.y; ++i)
 	{
 		vec3 lightDir = dirLights.lights[i].direction.xyz;
 		vec3 L = normalize(lightDir);
@@ -143,13 +220,14 @@ void main()
 		float NdotR = max(0.0, dot(R, V));
 		vec3 spec = dirLights.lights[i].color.xyz * albedo.a * pow(NdotR, 16.0);
 
-#if NUM_DIR_SHADOWS
-		fragcolor += (diff + spec) * shadow(fragPos, i, NdotL);
-#else
-		fragcolor += (diff + spec);
-#endif
+		int shadowTile = dirLights.lights[i].shadowTile;
+		float shadowFactor = shadowTile >= 0 ? dirShadow(fragPos, N, shadowTile, dirLights.lights[i].shadowTileCount, NdotL) : 1.0;
+		fragcolor += (diff + spec) * shadowFactor;
 	}
-#endif
 	#define ambient 0.2f
 	outFragcolor = vec4(albedo.rgb * (vec3(ambient, ambient, ambient) + fragcolor), 1.0);
+	if (clusterInfo.gridSize.w != 0u)
+	{
+		outFragcolor.rgb = mix(outFragcolor.rgb, heatMap(cluster.y), 0.6);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec2 inUV;
+layout (location = 2) in vec3 inColor;
+layout (location = 3) in vec3 inNormal;
+layout (location = 4) in vec3 inTangent;
+
+// one model matrix per instance, a column per location.
+layout (location = 5) in vec4 inInstanceModel0;
+layout (location = 6) in vec4 inInstanceModel1;
+layout (location = 7) in vec4 inInstanceModel2;
+layout (location = 8) in vec4 inInstanceModel3;
+
+// the model matrix is ignored, it belongs to whichever instance the batch was built from.
+layout (binding = 0) uniform UBO 
+{
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+} ubo;
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec2 outUV;
+layout (location = 2) out vec3 outColor;
+layout (location = 3) out vec3 outWorldPos;
+layout (location = 4) out vec3 outTangent;
+
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+void main() 
+{
+	mat4 model = mat4(inInstanceModel0, inInstanceModel1, inInstanceModel2, inInstanceModel3);
+	vec4 tmpPos = vec4(inPos, 1.0f);
+
+	gl_Position = ubo.projection * ubo.view * model * tmpPos;
+	
+	outUV = inUV;
+	outUV.t = 1.0 - outUV.t;
+
+	// Vertex position in world space
+	outWorldPos = vec3(model * tmpPos);
+	
+	// Normal in world space
+	mat3 mNormal = transpose(inverse(mat3(model)));
+	outNormal = mNormal * normalize(inNormal);
+	outNormal.y = -outNormal.y;
+	outTangent = mNormal * normalize(inTangent);
+	
+	// Currently just vertex color
+	outColor = inColor;
+}
@@ -9,11 +9,15 @@ layout (location = 4) in vec3 inTangent;
 
 layout (binding = 0) uniform UBO 
 {
-	mat4 model;
-	mat4 view;
-	mat4 projection;
+	mat4 cascadeViewProjection[CASCADE_COUNT];
 } ubo;
 
+layout(push_constant) uniform PushConsts
+{
+	mat4 model;
+	uint cascade;
+} pushConsts;
+
 out gl_PerVertex
 {
 	vec4 gl_Position;
@@ -23,5 +27,5 @@ void main()
 {
 	//vec4 tmpPos = vec4(inPos.x, inPos.z, -inPos.y, 1.0f);
 
-	gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPos, 1.0f);	
+	gl_Position = ubo.cascadeViewProjection[pushConsts.cascade] * pushConsts.model * vec4(inPos, 1.0f);
 }
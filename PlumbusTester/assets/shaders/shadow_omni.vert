@@ -4,19 +4,15 @@ layout (location = 2) in vec3 inColor;
 layout (location = 3) in vec3 inNormal;
 layout (location = 4) in vec3 inTangent;
 
-layout (location = 0) out vec4 outPos;
-layout (location = 1) out vec3 outLightPos;
-
 layout (binding = 0) uniform UBO
 {
-    mat4 projection;
-    vec4 lightPos;
+    mat4 faceViewProjection[6];
 } ubo;
 
 layout(push_constant) uniform PushConsts
 {
-    mat4 view;
     mat4 model;
+    uint face;
 } pushConsts;
 
 out gl_PerVertex
@@ -26,9 +22,8 @@ out gl_PerVertex
 
 void main()
 {
-    gl_Position = ubo.projection * pushConsts.view * pushConsts.model * vec4(inPos.x, inPos.y, inPos.z, 1.0);
-
-    outPos = pushConsts.model * vec4(inPos.x, inPos.y, inPos.z, 1.0f);
+    // each face is its own tile in the shadow atlas, drawn with its own viewport.
+    uint face = pushConsts.face;
 
-    outLightPos = ubo.lightPos.xyz;
-}
\ No newline at end of file
+    gl_Position = ubo.faceViewProjection[face] * pushConsts.model * vec4(inPos.x, inPos.y, inPos.z, 1.0);
+}
@@ -7,6 +7,7 @@
 #include "tests/Shadows/Shadows.h"
 #include "tests/OmniDirShadows/OmniDirShadows.h"
 #include "tests/Scripts/Scripts.h"
+#include "tests/ManyLights/ManyLights.h"
 
 namespace plumbus::tester
 {
@@ -77,6 +78,11 @@ namespace plumbus::tester
 				{
 					BeginTest<tests::Scripts>();
 				}
+
+				if (ImGui::Button("Many Lights"))
+				{
+					BeginTest<tests::ManyLights>();
+				}
 			}
 			else
 			{
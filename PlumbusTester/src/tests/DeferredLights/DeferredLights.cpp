@@ -30,6 +30,7 @@ namespace plumbus::tester::tests
 		, m_LightsDistanceFromCenter(7.f)
 		, m_DeferredLightMaterial(new vk::Material("shaders/shader.vert", "shaders/shader.frag"))
 	{
+		m_DeferredLightMaterial->SetInstancedVertShader("shaders/shader_instanced.vert");
 		m_DeferredLightMaterial->Setup();
 	}
 
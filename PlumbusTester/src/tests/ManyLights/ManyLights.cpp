@@ -0,0 +1,133 @@
+#include "plumbus.h"
+#include "tests/ManyLights/ManyLights.h"
+#include "BaseApplication.h"
+#include "components/ModelComponent.h"
+#include "components/TranslationComponent.h"
+#include "components/LightComponent.h"
+#include "GameObject.h"
+
+#include "Application.h"
+#include "TesterScene.h"
+#include "renderer/vk/Material.h"
+#include "renderer/vk/VulkanRenderer.h"
+#include "imgui_impl/ImGuiImpl.h"
+
+namespace plumbus::tester::tests 
+{
+	ManyLights::ManyLights()
+		: Test()
+		, m_LightTime(0)
+		, m_LightsPaused(false)
+		, m_LightRadius(2.5f)
+		, m_LightSpacing(1.5f)
+		, m_DeferredLightMaterial(new vk::Material("shaders/shader.vert", "shaders/shader.frag"))
+	{
+		m_DeferredLightMaterial->SetInstancedVertShader("shaders/shader_instanced.vert");
+		m_DeferredLightMaterial->Setup();
+	}
+
+	ManyLights::~ManyLights()
+	{
+	}
+
+	void ManyLights::Init()
+	{
+		TesterScene* scene = static_cast<TesterScene*>(Application::Get().GetScene());
+
+		if (Camera* camera = scene->GetCamera())
+		{
+			camera->SetPosition(glm::vec3(0.f, 20.f, -45.f));
+			camera->SetRotation(glm::vec3(-25.f, 0.f, 0.0f));
+		}
+
+		GameObject* plane = new GameObject("plane");
+		scene->AddGameObject(plane->
+			AddComponent<components::ModelComponent>(new components::ModelComponent("models/plane.obj", "stonefloor_color", "stonefloor_normal"))->
+			AddComponent<components::TranslationComponent>(new components::TranslationComponent())
+		);
+		plane->GetComponent<components::ModelComponent>()->SetMaterial(m_DeferredLightMaterial);
+		plane->GetComponent<components::TranslationComponent>()->SetScale(glm::vec3(3.f, 1.f, 3.f));
+
+		GameObject* knight = new GameObject("Knight");
+		scene->AddGameObject(knight->
+			AddComponent<components::ModelComponent>(new components::ModelComponent("models/armor.dae", "color", "normal"))->
+			AddComponent<components::TranslationComponent>(new components::TranslationComponent())
+		);
+		knight->GetComponent<components::TranslationComponent>()->SetTranslation(glm::vec3(0, -2.4f, 0));
+		knight->GetComponent<components::ModelComponent>()->SetMaterial(m_DeferredLightMaterial);
+
+		for (int i = 0; i < s_LightsPerSide * s_LightsPerSide; ++i)
+		{
+			GameObject* light = new GameObject("Light " + std::to_string(i));
+			scene->AddGameObject(light->
+				AddComponent<components::TranslationComponent>(new components::TranslationComponent())->
+				AddComponent<components::LightComponent>(new components::LightComponent()));
+
+			// spread the hue around so the heat map and the lit result are easy to tell apart.
+			float hue = (float)i / (s_LightsPerSide * s_LightsPerSide) * 6.f;
+			glm::vec3 colour = glm::clamp(glm::vec3(std::abs(hue - 3.f) - 1.f, 2.f - std::abs(hue - 2.f), 2.f - std::abs(hue - 4.f)), 0.f, 1.f) * 2.f;
+			light->GetComponent<components::LightComponent>()->AddPointLight(colour, m_LightRadius, false);
+		}
+
+		BaseApplication::Get().GetScene()->LoadAssets();
+	}
+
+	void ManyLights::Update()
+	{
+		if (m_LightsPaused)
+		{
+			return;
+		}
+
+		m_LightTime += Application::Get().GetDeltaTime();
+
+		int index = 0;
+		float halfExtent = (s_LightsPerSide - 1) * m_LightSpacing * 0.5f;
+		for (GameObject* obj : Application::Get().GetScene()->GetObjects())
+		{
+			components::LightComponent* lightComp = obj->GetComponent<components::LightComponent>();
+			if (!lightComp)
+			{
+				continue;
+			}
+
+			float x = (index % s_LightsPerSide) * m_LightSpacing - halfExtent;
+			float z = (index / s_LightsPerSide) * m_LightSpacing - halfExtent;
+			float height = -1.5f + std::sin((float)m_LightTime * 2.f + x * 0.3f + z * 0.2f);
+			obj->GetComponent<components::TranslationComponent>()->SetTranslation(glm::vec3(x, height, z));
+			index++;
+
+			for (Light* light : lightComp->GetLights())
+			{
+				if (light->GetType() == LightType::Point)
+				{
+					static_cast<PointLight*>(light)->SetRadius(m_LightRadius);
+				}
+			}
+		}
+	}
+
+	void ManyLights::Shutdown()
+	{
+		vkDeviceWaitIdle(vk::VulkanRenderer::Get()->GetDevice()->GetVulkanDevice());
+		for (GameObject* obj : BaseApplication::Get().GetScene()->GetObjects())
+		{
+			if (components::ModelComponent* component = obj->GetComponent<components::ModelComponent>())
+			{
+				component->Cleanup();
+			}
+		}
+
+		BaseApplication::Get().GetScene()->ClearObjects();
+
+		m_DeferredLightMaterial.reset();
+	}
+
+	void ManyLights::OnGui()
+	{
+		ImGui::Text("Many Lights (%d)", s_LightsPerSide * s_LightsPerSide);
+		ImGui::Checkbox("Pause Lights", &m_LightsPaused);
+		ImGui::DragFloat("Light Radius", &m_LightRadius, 0.01f, 0.1f, 20.f);
+		ImGui::DragFloat("Light Spacing", &m_LightSpacing, 0.01f, 0.1f, 10.f);
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "tests/Test.h"
+
+namespace plumbus
+{
+	namespace tester::tests
+	{
+		// stress test for clustered lighting, a floor lit by a large grid of small moving point lights.
+		class ManyLights : public Test
+		{
+		public:
+			ManyLights();
+			~ManyLights();
+			void Init() override;
+			void Update() override;
+			void Shutdown() override;
+			void OnGui() override;
+		private:
+			static constexpr int s_LightsPerSide = 32;
+
+			double m_LightTime;
+			bool m_LightsPaused;
+			float m_LightRadius;
+			float m_LightSpacing;
+
+			vk::MaterialRef m_DeferredLightMaterial;
+		};
+	}
+}
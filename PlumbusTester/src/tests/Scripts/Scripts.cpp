@@ -18,6 +18,7 @@ namespace plumbus::tester::tests
 		: Test()
 		, m_DeferredLightMaterial(new vk::Material("shaders/shader.vert", "shaders/shader.frag"))
 	{
+		m_DeferredLightMaterial->SetInstancedVertShader("shaders/shader_instanced.vert");
 		m_DeferredLightMaterial->Setup();
 	}
 
@@ -22,6 +22,7 @@ namespace plumbus::tester::tests
 		: Test()
 		, m_DeferredLightMaterial(new vk::Material("shaders/shader.vert", "shaders/shader.frag"))
 	{
+		m_DeferredLightMaterial->SetInstancedVertShader("shaders/shader_instanced.vert");
 		m_DeferredLightMaterial->Setup();
 	}
 
@@ -102,19 +103,17 @@ namespace plumbus::tester::tests
 	void Shadows::Update()
 	{
 #if ENABLE_IMGUI
-        std::vector<vk::ShadowDirectional*>& shadows = vk::ShadowManager::Get()->GetDirectionalShadows();
-		if (m_ShadowTextureImGui.size() != shadows.size())
+        // every shadow is a tile in the one atlas, so that's all there is to show.
+        bool hasShadows = !vk::ShadowManager::Get()->GetShadows().empty();
+		if (m_ShadowTextureImGui.empty() == hasShadows)
 		{
 		    m_ShadowTextureImGui.clear();
-			if (shadows.size() > 0)
+			if (hasShadows)
 			{
-			    for (const vk::ShadowDirectional* shadow : shadows)
-			    {
-                    vk::VulkanRenderer *vkRenderer = vk::VulkanRenderer::Get();
-                    m_ShadowTextureImGui.push_back(vkRenderer->GetImGui()->CreateImGuiTextureMaterialInstance(
-                            shadow->GetFrameBuffer()->GetSampler(),
-                            shadow->GetFrameBuffer()->GetAttachment("depth")->m_ImageView, vk::TextureType::Depth32));
-                }
+                vk::ShadowAtlas* atlas = vk::ShadowManager::Get()->GetAtlas();
+                m_ShadowTextureImGui.push_back(vk::VulkanRenderer::Get()->GetImGui()->CreateImGuiTextureMaterialInstance(
+                        atlas->GetDebugSampler(),
+                        atlas->GetTexture().m_ImageView, vk::TextureType::Depth32));
 			}
 		}
 #endif
@@ -144,7 +143,7 @@ namespace plumbus::tester::tests
 #if !PL_DIST
 		for (vk::MaterialInstanceRef shadowMaterial : m_ShadowTextureImGui)
 		{
-            ImGui::Image(shadowMaterial.get(), ImVec2(400, 225), ImVec2(0, 0), ImVec2(1, 1), ImVec4(1, 1, 1, 1),
+            ImGui::Image(shadowMaterial.get(), ImVec2(400, 400), ImVec2(0, 0), ImVec2(1, 1), ImVec4(1, 1, 1, 1),
                          ImVec4(0, 0, 0, 0));
         }
 #endif